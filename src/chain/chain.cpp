@@ -6,6 +6,8 @@
 
 #include "chain/chain.h"
 
+#include <algorithm>
+
 using namespace std;
 
 /**
@@ -61,3 +63,14 @@ const CBlockIndex *CChain::FindFork(const CBlockIndex *pindex) const {
         pindex = pindex->pprev;
     return pindex;
 }
+
+static bool BlockIndexTimeMaxLess(const CBlockIndex *pBlock, int64_t nTime)
+{
+    return pBlock->nTimeMax < nTime;
+}
+
+CBlockIndex* CChain::FindEarliestAtLeast(int64_t nTime) const
+{
+    std::vector<CBlockIndex*>::const_iterator lower = std::lower_bound(vChain.begin(), vChain.end(), nTime, BlockIndexTimeMaxLess);
+    return (lower == vChain.end() ? NULL : *lower);
+}
@@ -11,6 +11,7 @@
 #include "utils/streams.h"
 #include "utils/util.h"
 #include "utils/utilmoneystr.h"
+#include "utils/memusage.h"
 #include "version/bcversion.h"
 #include "community/community.h"
 
@@ -35,8 +36,29 @@ void InvalidMempoolWTx(const uint256& wtxid, const char * reason)
 }
 //void InvalidWTx(const uint256& wtxid, const char * reason);
 
+const char *TxAdmissionClassName(int tx_class)
+{
+    switch(tx_class)
+    {
+        case MC_TAC_STREAM: return "stream";
+        case MC_TAC_ASSET:  return "asset";
+        case MC_TAC_ADMIN:  return "admin";
+    }
+    return "other";
+}
+
+static size_t TransactionDynamicMemoryUsage(const CTransaction& tx)
+{
+    size_t nUsage = memusage::DynamicUsage(tx.vin) + memusage::DynamicUsage(tx.vout);
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        nUsage += memusage::DynamicUsage(*static_cast<const std::vector<unsigned char>*>(&txin.scriptSig));
+    BOOST_FOREACH(const CTxOut& txout, tx.vout)
+        nUsage += memusage::DynamicUsage(*static_cast<const std::vector<unsigned char>*>(&txout.scriptPubKey));
+    return nUsage;
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry():
-    nFee(0), nTxSize(0), nModSize(0), nTime(0), dPriority(0.0)
+    nFee(0), nTxSize(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0), nAdmissionClass(MC_TAC_OTHER), fChangesState(true)
 {
     nHeight = MEMPOOL_HEIGHT;
     ResetReplayParams();
@@ -45,11 +67,12 @@ CTxMemPoolEntry::CTxMemPoolEntry():
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                                  int64_t _nTime, double _dPriority,
                                  unsigned int _nHeight):
-    tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight)
+    tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight), nAdmissionClass(MC_TAC_OTHER), fChangesState(true)
 {
     nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
 
     nModSize = tx.CalculateModifiedSize(nTxSize);
+    nUsageSize = TransactionDynamicMemoryUsage(tx);
     ResetReplayParams();
 }
 
@@ -418,7 +441,8 @@ public:
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) :
     nTransactionsUpdated(0),
-    minRelayFee(_minRelayFee)
+    minRelayFee(_minRelayFee),
+    cachedInnerUsage(0)
 {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
@@ -447,17 +471,16 @@ CTxMemPool::~CTxMemPool()
     delete minerPolicyEstimator;
 }
 
-void CTxMemPool::pruneSpent(const uint256 &hashTx, CCoins &coins)
+bool CTxMemPool::isSpent(const COutPoint& outpoint)
 {
     LOCK(cs);
+    return mapNextTx.count(outpoint);
+}
 
-    std::map<COutPoint, CInPoint>::iterator it = mapNextTx.lower_bound(COutPoint(hashTx, 0));
-
-    // iterate over all COutPoints in mapNextTx whose hash equals the provided hashTx
-    while (it != mapNextTx.end() && it->first.hash == hashTx) {
-        coins.Spend(it->first.n); // and remove those outputs from coins
-        it++;
-    }
+size_t CTxMemPool::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    return memusage::DynamicUsage(mapTx) + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
 }
 
 unsigned int CTxMemPool::GetTransactionsUpdated() const
@@ -486,8 +509,14 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry)
             mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
         nTransactionsUpdated++;
         totalTxSize += entry.GetTxSize();
+        cachedInnerUsage += entry.DynamicMemoryUsage();
         
 /* MCHN START */        
+        CTxAdmissionClassStats& stats=admissionClassStats[entry.GetAdmissionClass()];
+        stats.nCount++;
+        stats.nBytes+=entry.GetTxSize();
+        stats.nAccepted++;
+        
         if(hashListPos<hashList->m_Count)
         {
             hashList->PutRow(hashListPos,&hash,NULL);
@@ -607,6 +636,12 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             }
             removed.push_back(tx);
             totalTxSize -= mapTx[hash].GetTxSize();
+            cachedInnerUsage -= mapTx[hash].DynamicMemoryUsage();
+/* MCHN START */            
+            CTxAdmissionClassStats& stats=admissionClassStats[mapTx[hash].GetAdmissionClass()];
+            stats.nCount--;
+            stats.nBytes-=mapTx[hash].GetTxSize();
+/* MCHN END */            
             mapTx.erase(hash);
             nTransactionsUpdated++;
             if(wtx_reason.size())
@@ -639,11 +674,11 @@ void CTxMemPool::removeCoinbaseSpends(const CCoinsViewCache *pcoins, unsigned in
             std::map<uint256, CTxMemPoolEntry>::const_iterator it2 = mapTx.find(txin.prevout.hash);
             if (it2 != mapTx.end())
                 continue;
-            const CCoins *coins = pcoins->AccessCoins(txin.prevout.hash);
-            if (fSanityCheck) assert(coins);
+            const Coin &coin = pcoins->AccessCoin(txin.prevout);
+            if (fSanityCheck) assert(!coin.IsSpent());
 /* MCHN START */            
-//            if (!coins || (coins->IsCoinBase() && nMemPoolHeight - coins->nHeight < COINBASE_MATURITY)) {
-            if (!coins || (coins->IsCoinBase() && nMemPoolHeight - coins->nHeight < (unsigned int)COINBASE_MATURITY)) {
+//            if (coin.IsSpent() || (coin.IsCoinBase() && nMemPoolHeight - coin.nHeight < COINBASE_MATURITY)) {
+            if (coin.IsSpent() || (coin.IsCoinBase() && nMemPoolHeight - coin.nHeight < (unsigned int)COINBASE_MATURITY)) {
 /* MCHN END */            
                 transactionsToRemove.push_back(tx);
                 break;
@@ -688,6 +723,17 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
             entries.push_back(mapTx[hash]);
     }
     minerPolicyEstimator->seenBlock(entries, nBlockHeight, minRelayFee);
+/* MCHN START */    
+    int64_t nNow=GetTime();
+    BOOST_FOREACH(const CTxMemPoolEntry& entry, entries)
+    {
+        CTxAdmissionClassStats& stats=admissionClassStats[entry.GetAdmissionClass()];
+        int64_t nSeconds=max(nNow-entry.GetTime(),(int64_t)0);
+        stats.nConfirmed++;
+        stats.nConfirmSeconds+=nSeconds;
+        stats.nMaxConfirmSeconds=max(stats.nMaxConfirmSeconds,nSeconds);
+    }
+/* MCHN END */    
     BOOST_FOREACH(const CTransaction& tx, vtx)
     {
         std::list<CTransaction> dummy;
@@ -706,8 +752,14 @@ void CTxMemPool::clear()
 /* MCHN START */    
     hashList->Clear();
     hashListPos=0;
+    for(int c=0;c<MC_TAC_COUNT;c++)
+    {
+        admissionClassStats[c].nCount=0;
+        admissionClassStats[c].nBytes=0;
+    }
 /* MCHN END */    
     totalTxSize = 0;
+    cachedInnerUsage = 0;
     ++nTransactionsUpdated;
 }
 
@@ -737,8 +789,8 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                 assert(tx2.vout.size() > txin.prevout.n && !tx2.vout[txin.prevout.n].IsNull());
                 fDependsWait = true;
             } else {
-                const CCoins* coins = pcoins->AccessCoins(txin.prevout.hash);
-                assert(coins && coins->IsAvailable(txin.prevout.n));
+                const Coin& coin = pcoins->AccessCoin(txin.prevout);
+                assert(!coin.IsSpent());
             }
             // Check whether its inputs are marked in mapNextTx.
             std::map<COutPoint, CInPoint>::const_iterator it3 = mapNextTx.find(txin.prevout);
@@ -880,18 +932,27 @@ void CTxMemPool::ClearPrioritisation(const uint256 hash)
 
 CCoinsViewMemPool::CCoinsViewMemPool(CCoinsView *baseIn, CTxMemPool &mempoolIn) : CCoinsViewBacked(baseIn), mempool(mempoolIn) { }
 
-bool CCoinsViewMemPool::GetCoins(const uint256 &txid, CCoins &coins) const {
+bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     // If an entry in the mempool exists, always return that one, as it's guaranteed to never
     // conflict with the underlying cache, and it cannot have pruned entries (as it contains full)
     // transactions. First checking the underlying cache risks returning a pruned entry instead.
-    CTransaction tx;
-    if (mempool.lookup(txid, tx)) {
-        coins = CCoins(tx, MEMPOOL_HEIGHT);
-        return true;
+    // Only the requested output is copied.
+    {
+        LOCK(mempool.cs);
+        std::map<uint256, CTxMemPoolEntry>::const_iterator it = mempool.mapTx.find(outpoint.hash);
+        if (it != mempool.mapTx.end()) {
+            const CTransaction& tx = it->second.GetTx();
+            if (outpoint.n < tx.vout.size() && !tx.vout[outpoint.n].scriptPubKey.IsUnspendable()) {
+                coin = Coin(tx.vout[outpoint.n], MEMPOOL_HEIGHT, false, tx.nVersion);
+                return true;
+            }
+            return false;
+        }
     }
-    return (base->GetCoins(txid, coins) && !coins.IsPruned());
+    return (base->GetCoin(outpoint, coin) && !coin.IsSpent());
 }
 
-bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
-    return mempool.exists(txid) || base->HaveCoins(txid);
+bool CCoinsViewMemPool::HaveCoin(const COutPoint &outpoint) const {
+    Coin coin;
+    return GetCoin(outpoint, coin);
 }
@@ -30,12 +30,50 @@ inline bool AllowFree(double dPriority)
     return dPriority > AllowFreeThreshold();
 }
 
-/** Fake height value used in CCoins to signify they are only in the memory pool (since 0.8) */
+/** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
 /**
  * CTxMemPool stores these:
  */
+/** Admission classes of transactions, higher class is more urgent, see MultiChainTransaction_AdmissionClass */
+#define MC_TAC_OTHER                      0
+#define MC_TAC_STREAM                     1
+#define MC_TAC_ASSET                      2
+#define MC_TAC_ADMIN                      3
+#define MC_TAC_COUNT                      4
+
+const char *TxAdmissionClassName(int tx_class);
+
+/** Per-class counters, guarded by CTxMemPool::cs */
+struct CTxAdmissionClassStats
+{
+    int64_t nCount;                                                             // Transactions of this class in the pool
+    int64_t nBytes;                                                             // Their total size
+    int64_t nAccepted;                                                          // Transactions accepted since start
+    int64_t nConfirmed;                                                         // Transactions removed from the pool by connected block
+    int64_t nConfirmSeconds;                                                    // Total time between acceptance and confirmation
+    int64_t nMaxConfirmSeconds;                                                 // Maximal time between acceptance and confirmation
+    int64_t nDeferred;                                                          // Times skipped by CreateNewBlock because of block space reserved for other classes
+    int64_t nLastBlockBytes;                                                    // Bytes of this class in last block created by this node
+    int64_t nAcceptMicros;                                                      // Total time spent in AcceptToMemoryPool for accepted transactions
+    int64_t nMaxAcceptMicros;                                                   // Maximal time spent in AcceptToMemoryPool
+    
+    CTxAdmissionClassStats()
+    {
+        nCount=0;
+        nBytes=0;
+        nAccepted=0;
+        nConfirmed=0;
+        nConfirmSeconds=0;
+        nMaxConfirmSeconds=0;
+        nDeferred=0;
+        nLastBlockBytes=0;
+        nAcceptMicros=0;
+        nMaxAcceptMicros=0;
+    }
+};
+
 class CTxMemPoolEntry
 {
 private:
@@ -43,6 +81,7 @@ private:
     CAmount nFee; //! Cached to avoid expensive parent-transaction lookups
     size_t nTxSize; //! ... and avoid recomputing tx size
     size_t nModSize; //! ... and modified size for priority
+    size_t nUsageSize; //! ... and total memory usage
     int64_t nTime; //! Local time when entering the mempool
     double dPriority; //! Priority when entering the mempool
     unsigned int nHeight; //! Chain height when entering the mempool
@@ -52,6 +91,8 @@ private:
     int nPermissionsTo;
     int nWalletFrom;
     int nWalletTo;
+    int nAdmissionClass;
+    bool fChangesState; //! Following txs may depend on entities or permissions changed by this tx
     
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
@@ -63,9 +104,15 @@ public:
     double GetPriority(unsigned int currentHeight) const;
     CAmount GetFee() const { return nFee; }
     size_t GetTxSize() const { return nTxSize; }
+    size_t DynamicMemoryUsage() const { return nUsageSize; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return nHeight; }
     
+    void SetTime(int64_t _nTime) { nTime = _nTime; }
+    void SetEntryPriority(double _dPriority, unsigned int _nHeight) { dPriority = _dPriority; nHeight = _nHeight; }
+    int GetAdmissionClass() const { return nAdmissionClass; }
+    void SetAdmissionClass(int _nAdmissionClass, bool _fChangesState) { nAdmissionClass = _nAdmissionClass; fChangesState = _fChangesState; }
+    bool ChangesState() const { return fChangesState; }
     void ResetReplayParams();
     void SetReplayNodeParams(bool replay, int from, int to);
     void SetReplayWalletParams(int from, int to);
@@ -110,12 +157,16 @@ private:
 
     CFeeRate minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
+    uint64_t cachedInnerUsage; //! sum of dynamic memory usage of all the map elements (NOT the maps themselves)
 
 public:
     mutable CCriticalSection cs;
     std::map<uint256, CTxMemPoolEntry> mapTx;
     std::map<COutPoint, CInPoint> mapNextTx;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+/* MCHN START */    
+    CTxAdmissionClassStats admissionClassStats[MC_TAC_COUNT];
+/* MCHN END */    
 
     CTxMemPool(const CFeeRate& _minRelayFee);
     ~CTxMemPool();
@@ -137,7 +188,7 @@ public:
                         std::list<CTransaction>& conflicts);
     void clear();
     void queryHashes(std::vector<uint256>& vtxid);
-    void pruneSpent(const uint256& hash, CCoins &coins);
+    bool isSpent(const COutPoint& outpoint);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
 
@@ -157,6 +208,9 @@ public:
         return totalTxSize;
     }
 
+    /** Estimated heap memory used by the pool, usage of transactions is tracked incrementally */
+    size_t DynamicMemoryUsage() const;
+
     bool exists(uint256 hash)
     {
         LOCK(cs);
@@ -197,8 +251,8 @@ protected:
 
 public:
     CCoinsViewMemPool(CCoinsView *baseIn, CTxMemPool &mempoolIn);
-    bool GetCoins(const uint256 &txid, CCoins &coins) const;
-    bool HaveCoins(const uint256 &txid) const;
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
 };
 
 #endif // BITCOIN_TXMEMPOOL_H
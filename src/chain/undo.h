@@ -13,9 +13,10 @@
 
 /** Undo information for a CTxIn
  *
- *  Contains the prevout's CTxOut being spent, and if this was the
- *  last output of the affected transaction, its metadata as well
- *  (coinbase or not, height, transaction version)
+ *  Contains the prevout's CTxOut being spent and its metadata
+ *  (coinbase or not, height, transaction version). Undo data written
+ *  before per-output coins only carries the metadata for the last
+ *  spent output of a transaction and has nHeight == 0 otherwise.
  */
 class CTxInUndo
 {
@@ -274,6 +274,47 @@ typedef struct mc_TmpBuffers
     
 } mc_TmpBuffers;
 
+typedef struct mc_ValidationContext
+{
+    mc_ValidationContext()
+    {
+        Init();
+    }
+    
+    ~mc_ValidationContext()
+    {
+        Destroy();
+    }
+    
+    mc_Script               *m_TmpScript;                                       // Output script being checked
+    mc_Script               *m_TmpScript1;                                      // Secondary script - entity details, permissions
+    mc_Buffer               *m_TmpAssetsOut;                                    // Output asset quantities
+    mc_Buffer               *m_TmpAssetsIn;                                     // Input asset quantities
+    mc_Buffer               *m_TmpAssetsTmp;                                    // Per-input/output asset quantities
+    
+    void  Init()
+    {
+        m_TmpScript=new mc_Script;
+        m_TmpScript1=new mc_Script;
+        m_TmpAssetsOut=new mc_Buffer;
+        mc_InitABufferMap(m_TmpAssetsOut);
+        m_TmpAssetsIn=new mc_Buffer;
+        mc_InitABufferMap(m_TmpAssetsIn);
+        m_TmpAssetsTmp=new mc_Buffer;
+        mc_InitABufferMap(m_TmpAssetsTmp);
+    }    
+
+    void  Destroy()
+    {
+        delete m_TmpScript;
+        delete m_TmpScript1;
+        delete m_TmpAssetsOut;
+        delete m_TmpAssetsIn;
+        delete m_TmpAssetsTmp;
+    }
+    
+} mc_ValidationContext;
+
 typedef struct mc_State
 {    
     mc_State()
@@ -304,6 +345,7 @@ typedef struct mc_State
     char m_SeedResolvedAddress[256];
     int m_NumRPCThreads;
     
+    mc_ValidationContext    *m_ValidationContext;                               // Context of the main validation thread, owns objects below
     mc_Script               *m_TmpScript;
     mc_Script               *m_TmpScript1;
     mc_Buffer               *m_TmpAssetsOut;
@@ -325,8 +367,9 @@ typedef struct mc_State
         m_NetworkParams=new mc_MultichainParams;
         m_Permissions=NULL;
         m_Assets=NULL;
-        m_TmpScript=new mc_Script;
-        m_TmpScript1=new mc_Script;
+        m_ValidationContext=new mc_ValidationContext;
+        m_TmpScript=m_ValidationContext->m_TmpScript;
+        m_TmpScript1=m_ValidationContext->m_TmpScript1;
         m_NetworkState=MC_NTS_UNCONNECTED;
         m_NodePausedState=MC_NPS_NONE;
         m_ProtocolVersionToUpgrade=0;
@@ -337,12 +380,9 @@ typedef struct mc_State
         
         m_IPv4Address=0;
         m_WalletMode=0;
-        m_TmpAssetsOut=new mc_Buffer;
-        mc_InitABufferMap(m_TmpAssetsOut);
-        m_TmpAssetsIn=new mc_Buffer;
-        mc_InitABufferMap(m_TmpAssetsIn);
-        m_TmpAssetsTmp=new mc_Buffer;
-        mc_InitABufferMap(m_TmpAssetsTmp);
+        m_TmpAssetsOut=m_ValidationContext->m_TmpAssetsOut;
+        m_TmpAssetsIn=m_ValidationContext->m_TmpAssetsIn;
+        m_TmpAssetsTmp=m_ValidationContext->m_TmpAssetsTmp;
         m_Compatibility=MC_VCM_NONE;
         
         m_BlockHeaderSuccessors=new mc_Buffer;
@@ -382,25 +422,9 @@ typedef struct mc_State
         {
             delete m_NetworkParams;
         }
-        if(m_TmpScript)
-        {
-            delete m_TmpScript;
-        }
-        if(m_TmpScript1)
-        {
-            delete m_TmpScript1;
-        }
-        if(m_TmpAssetsOut)
-        {
-            delete m_TmpAssetsOut;
-        }
-        if(m_TmpAssetsIn)
-        {
-            delete m_TmpAssetsIn;
-        }
-        if(m_TmpAssetsTmp)
+        if(m_ValidationContext)
         {
-            delete m_TmpAssetsTmp;
+            delete m_ValidationContext;
         }
         if(m_BlockHeaderSuccessors)
         {
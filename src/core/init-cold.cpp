@@ -104,9 +104,9 @@ class CCoinsViewErrorCatcher : public CCoinsViewBacked
 {
 public:
     CCoinsViewErrorCatcher(CCoinsView* view) : CCoinsViewBacked(view) {}
-    bool GetCoins(const uint256 &txid, CCoins &coins) const {
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const {
         try {
-            return CCoinsViewBacked::GetCoins(txid, coins);
+            return CCoinsViewBacked::GetCoin(outpoint, coin);
         } catch(const std::runtime_error& e) {
             uiInterface.ThreadSafeMessageBox(_("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
             LogPrintf("Error reading from database: %s\n", e.what());
@@ -1051,7 +1051,7 @@ bool AppInit2_Cold(boost::thread_group& threadGroup,int OutputPipe)
     nTotalCache -= nBlockTreeDBCache;
     size_t nCoinDBCache = nTotalCache / 2; // use half of the remaining cache for coindb cache
     nTotalCache -= nCoinDBCache;
-    nCoinCacheSize = nTotalCache / 300; // coins in memory require around 300 bytes
+    nCoinCacheSize = nTotalCache / 150; // coins in memory require around 150 bytes per output
 
     bool fLoaded = false;
     while (!fLoaded) {
@@ -1077,6 +1077,12 @@ bool AppInit2_Cold(boost::thread_group& threadGroup,int OutputPipe)
                 if (fReindex)
                     pblocktree->WriteReindexing(true);
 
+                // Convert chainstate written in the per-transaction format before anything reads it
+                if (!pcoinsdbview->Upgrade()) {
+                    strLoadError = _("Error upgrading chainstate database");
+                    break;
+                }
+
                 if(mc_gState->m_WalletMode & MC_WMD_TXS)
                 {
                     bool fFirstRunForLoadChain = true;
@@ -1352,7 +1358,7 @@ bool AppInit2_Cold(boost::thread_group& threadGroup,int OutputPipe)
  */ 
 /* MCHN START */  
         pwalletMain->lpWalletTxs=pwalletTxsMain;
-        pwalletMain->InitializeUnspentList();
+        pwalletMain->InitializeUnspentList(true);
     
         
 /* MCHN END */        
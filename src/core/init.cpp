@@ -19,11 +19,13 @@
 #include "miner/miner.h"
 #include "net/net.h"
 #include "rpc/rpcserver.h"
+#include "script/sign.h"
 #include "script/standard.h"
 #include "storage/txdb.h"
 #include "ui/ui_interface.h"
 #include "utils/util.h"
 #include "utils/utilmoneystr.h"
+#include "utils/notifyqueue.h"
 #ifdef ENABLE_WALLET
 #include "wallet/dbwrap.h"
 #include "wallet/wallet.h"
@@ -76,6 +78,7 @@ CCriticalSection cs_NodeStatus;
 
 
 bool fFeeEstimatesInitialized = false;
+static bool fDumpMempoolLater = false;
 extern int JSON_DOUBLE_DECIMAL_DIGITS;                             
 
 #ifdef WIN32
@@ -160,9 +163,9 @@ class CCoinsViewErrorCatcher : public CCoinsViewBacked
 {
 public:
     CCoinsViewErrorCatcher(CCoinsView* view) : CCoinsViewBacked(view) {}
-    bool GetCoins(const uint256 &txid, CCoins &coins) const {
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const {
         try {
-            return CCoinsViewBacked::GetCoins(txid, coins);
+            return CCoinsViewBacked::GetCoin(outpoint, coin);
         } catch(const std::runtime_error& e) {
             uiInterface.ThreadSafeMessageBox(_("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
             LogPrintf("Error reading from database: %s\n", e.what());
@@ -202,6 +205,13 @@ void Shutdown()
 #endif
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
+    notifyQueue.Stop();
+
+    if (fDumpMempoolLater)
+    {
+        DumpMempool();
+        fDumpMempoolLater = false;
+    }
 
     if (fFeeEstimatesInitialized)
     {
@@ -376,7 +386,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
     strUsage += "  -loadblockmaxsize=<n>  " + _("Maximal block size in the files specified in -loadblock") + "\n";
     strUsage += "  -maxorphantx=<n>       " + strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS) + "\n";
+    strUsage += "  -multichainblockundo   " + strprintf(_("Store permission and entity database changes in block undo files and use them when disconnecting blocks, 0 keeps undo files readable by earlier versions (default: %u)"), 1) + "\n";
+    strUsage += "  -notifythreads=<n>     " + strprintf(_("Number of threads executing -blocknotify and -walletnotify commands (1 to %d, default: %d)"), MAX_NOTIFY_THREADS, DEFAULT_NOTIFY_THREADS) + "\n";
+    strUsage += "  -notifyqueuesize=<n>   " + strprintf(_("Maximal number of pending notification commands, notifications are dropped when the queue is full (default: %d)"), DEFAULT_NOTIFY_QUEUE_SIZE) + "\n";
+    strUsage += "  -notifybatch=<n>       " + strprintf(_("Maximal number of notifications with the same command executed in one invocation, values are separated by %s, events with list values are not batched (default: %d)"), MC_NTF_BATCH_SEPARATOR, DEFAULT_NOTIFY_BATCH_SIZE) + "\n";
     strUsage += "  -par=<n>               " + strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS) + "\n";
+    strUsage += "  -parallelprecheckmininputs=<n> " + strprintf(_("Blocks with at least <n> inputs run context-free MultiChain input checks on script verification threads (default: %d)"), DEFAULT_PARALLEL_PRECHECK_MIN_INPUTS) + "\n";
+    strUsage += "  -persistmempool        " + strprintf(_("Save memory pool at shutdown and reload it at startup, skipping verification of already verified signatures (default: %u)"), DEFAULT_PERSIST_MEMPOOL) + "\n";
 #ifndef WIN32
     strUsage += "  -pid=<file>            " + strprintf(_("Specify pid file (default: %s)"), "multichain.pid") + "\n";
 #endif
@@ -387,6 +403,7 @@ std::string HelpMessage(HelpMessageMode mode)
 /* MCHN START */    
 /* Default was 0 */    
     strUsage += "  -txindex=0|1           " + strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 1) + "\n";
+    strUsage += "  -blockfilterindex=0|1  " + strprintf(_("Maintain compact filters of stream IDs, item keys and publishers for every block and serve them to light clients (default: %u)"), 0) + "\n";
 /* MCHN END */    
 
     strUsage += "\n" + _("Connection options:") + "\n";
@@ -407,6 +424,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -maxsendbuffer=<n>     " + strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 100000) + "\n";
     strUsage += "  -onion=<ip:port>       " + strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy") + "\n";
     strUsage += "  -onlynet=<net>         " + _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)") + "\n";
+    strUsage += "  -p2pcompression=0|1    " + strprintf(_("Compress block, tx and headers messages to peers which enable it too (default: %u)"), DEFAULT_P2P_COMPRESSION) + "\n";
     strUsage += "  -permitbaremultisig    " + strprintf(_("Relay non-P2SH multisig (default: %u)"), 1) + "\n";
     strUsage += "  -port=<port>           " + _("Listen for connections on <port> ") + "\n";
     strUsage += "  -proxy=<ip:port>       " + _("Connect through SOCKS5 proxy") + "\n";
@@ -434,6 +452,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "\n" + _("Wallet options:") + "\n";
 //    strUsage += "  -disablewallet         " + _("Do not load the wallet and disable wallet RPC calls") + "\n";
     strUsage += "  -keypool=<n>           " + strprintf(_("Set key pool size to <n> (default: %u)"), 1) + "\n";
+    strUsage += "  -signthreads=<n>       " + strprintf(_("Set the number of transaction signing threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SIGNATURE_THREADS) + "\n";
+    strUsage += "  -walletkeycache=<n>    " + strprintf(_("Maximal number of decrypted private keys kept in locked memory while encrypted wallet is unlocked, 0 - disabled (default: %u)"), DEFAULT_WALLET_KEY_CACHE_SIZE) + "\n";
     if (GetBoolArg("-help-debug", false))
         strUsage += "  -mintxfee=<amt>        " + strprintf(_("Fees (in BTC/Kb) smaller than this are considered zero fee for transaction creation (default: %s)"), FormatMoney(CWallet::minTxFee.GetFeePerK())) + "\n";
     strUsage += "  -paytxfee=<amt>        " + strprintf(_("Fee (in BTC/kB) to add to transactions you send (default: %s)"), FormatMoney(payTxFee.GetFeePerK())) + "\n";
@@ -481,6 +501,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -help-debug            " + _("Show all debugging options (usage: --help -help-debug)") + "\n";
     strUsage += "  -logips                " + strprintf(_("Include IP addresses in debug output (default: %u)"), 0) + "\n";
     strUsage += "  -logtimestamps=0|1     " + strprintf(_("Prepend debug output with timestamp (default: %u)"), 1) + "\n";
+    strUsage += "  -memorydumpinterval=<n> " + _("Log live and peak memory of node subsystems every <n> seconds (default: 0 - disabled)") + "\n";
     strUsage += "  -limitfreerelay=<n>    " + strprintf(_("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:%u)"), 0) + "\n";
     if (GetBoolArg("-help-debug", false))
     {
@@ -522,6 +543,7 @@ std::string HelpMessage(HelpMessageMode mode)
 //    strUsage += "  -blockminsize=<n>      " + strprintf(_("Set minimum block size in bytes (default: %u)"), 0) + "\n";
 //    strUsage += "  -blockmaxsize=<n>      " + strprintf(_("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE) + "\n";
     strUsage += "  -blockmaxsize=<n>      " + _("Set maximum block size in bytes") + "\n";
+    strUsage += "  -admissionclassreserve=<class>:<n>,...  " + _("Percent of block size reserved for pending transactions of admission class - admin, asset, stream or other, none to disable (default: admin:5)") + "\n";
 //    strUsage += "  -blockprioritysize=<n> " + strprintf(_("Set maximum size of high-priority/low-fee transactions in bytes (default: %d)"), DEFAULT_BLOCK_PRIORITY_SIZE) + "\n";
 
     strUsage += "\n" + _("RPC server options:") + "\n";
@@ -535,8 +557,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24).") + "\n";
     strUsage += "                         " + _("This option can be specified multiple times") + "\n";
     strUsage += "  -rpcallowmethod=<methods> " + _("If specified, allow only comma delimited list of JSON-RPC <methods>. This option can be specified multiple times.") + "\n";
-    strUsage += "  -rpcthreads=<n>        " + strprintf(_("Set the number of threads to service RPC calls (default: %d)"), 4) + "\n";
+    strUsage += "  -rpcthreads=<n>        " + strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_RPC_THREADS) + "\n";
+    strUsage += "  -rpciothreads=<n>      " + strprintf(_("Set the number of threads reading RPC requests from client connections (default: %d)"), DEFAULT_RPC_IO_THREADS) + "\n";
+    strUsage += "  -rpcworkqueue=<n>      " + strprintf(_("Set the depth of the queue of RPC requests waiting for RPC thread, requests above it are rejected (default: %d)"), DEFAULT_RPC_WORK_QUEUE) + "\n";
+    strUsage += "  -rpcservertimeout=<n>  " + strprintf(_("Timeout in seconds for receiving complete request on RPC connection, idle keep-alive connections are closed after it (default: %d)"), DEFAULT_RPC_SERVER_TIMEOUT) + "\n";
     strUsage += "  -rpckeepalive          " + strprintf(_("RPC support for HTTP persistent connections (default: %d)"), 0) + "\n";
+    strUsage += "  -rpccapture=<file>     " + _("Append executed JSON-RPC requests with their timing to <file>, one JSON object per line, for replay with multichain-cli -replay") + "\n";
+    strUsage += "  -rpccaptureredact=<n>  " + strprintf(_("Redaction of captured parameters: 0 - none, 1 - drop parameters of key and passphrase methods, 2 - also zero-fill data payloads (default: %d)"), DEFAULT_RPC_CAPTURE_REDACT) + "\n";
 
     strUsage += "\n" + _("RPC SSL options") + "\n";
     strUsage += "  -rpcssl                                  " + _("Use OpenSSL (https) for JSON-RPC connections") + "\n";
@@ -559,6 +586,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -lockblock=<hash>                        " + _("Blocks on branches without this block will be rejected") + "\n";
     strUsage += "  -chunkquerytimeout=<n>                   " + _("Timeout, after which undelivered chunk is moved to the end of the chunk queue, default 25s") + "\n";
     strUsage += "  -chunkrequesttimeout=<n>                 " + _("Timeout, after which chunk request is dropped and another source is tried, default 10s") + "\n";
+    strUsage += "  -readsessiontimeout=<n>                  " + strprintf(_("Time, for which read permission proved by peer for read-permissioned stream is not checked again, in seconds, 0 - every chunk request is signed, default %u"),MC_RSS_DEFAULT_TIMEOUT) + "\n";
+    strUsage += "  -chunkreadahead=<n>                      " + strprintf(_("Size of the cache of offchain item data prefetched for sequential readers, in MB, 0 - disabled, default %u"),MC_CDB_DEFAULT_READ_AHEAD_SIZE) + "\n";
     strUsage += "  -flushsourcechunks=0|1                   " + _("Flush offchain items created by this node to disk immediately when created, default 1") + "\n";
     strUsage += "  -acceptfiltertimeout=<n>                 " + strprintf(_("Timeout, after which filter execution will be aborted, when accepting new txs, in milliseconds, default %u"),DEFAULT_ACCEPT_FILTER_TIMEOUT) + "\n";
     strUsage += "  -sendfiltertimeout=<n>                   " + strprintf(_("Timeout, after which filter execution will be aborted, when tx is sent from this node, in milliseconds, default %u"),DEFAULT_SEND_FILTER_TIMEOUT) + "\n";
@@ -615,10 +644,10 @@ std::string LicenseInfo()
 
 static void BlockNotifyCallback(const uint256& hashNewTip)
 {
-    std::string strCmd = GetArg("-blocknotify", "");
+    CNotifyEvent event(GetArg("-blocknotify", ""));
 
-    boost::replace_all(strCmd, "%s", hashNewTip.GetHex());
-    boost::thread t(runCommand, strCmd); // thread runs free
+    event.Set("%s", hashNewTip.GetHex());
+    QueueNotification(event);
 }
 
 struct CImportingNow
@@ -691,6 +720,14 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         LogPrintf("Stopping after block import\n");
         StartShutdown();
     }
+
+/* MCHN START */
+    // Memory pool is loaded after -reindex/-loadblock, transactions are validated against the final chain
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL) && !ShutdownRequested()) {
+        LoadMempool();
+        fDumpMempoolLater = !ShutdownRequested();
+    }
+/* MCHN END */
 }
 
 /** Sanity checks
@@ -945,6 +982,9 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
     // Checkmempool defaults to true in regtest mode
     mempool.setSanityCheck(GetBoolArg("-checkmempool", Params().DefaultCheckMemPool()));
     Checkpoints::fEnabled = GetBoolArg("-checkpoints", true);
+/* MCHN START */
+    fMultiChainBlockUndo = GetBoolArg("-multichainblockundo", true);
+/* MCHN END */
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -955,6 +995,16 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+/* MCHN START */
+    nSignatureThreads = GetArg("-signthreads", DEFAULT_SIGNATURE_THREADS);
+    if (nSignatureThreads <= 0)
+        nSignatureThreads += boost::thread::hardware_concurrency();
+    if (nSignatureThreads <= 1)
+        nSignatureThreads = 0;
+    else if (nSignatureThreads > MAX_SCRIPTCHECK_THREADS)
+        nSignatureThreads = MAX_SCRIPTCHECK_THREADS;
+/* MCHN END */
+
     fServer = GetBoolArg("-server", false);
 
 #ifdef ENABLE_WALLET
@@ -994,6 +1044,7 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
 #ifdef ENABLE_WALLET
     nTxConfirmTarget = GetArg("-txconfirmtarget", 1);
     bSpendZeroConfChange = GetArg("-spendzeroconfchange", true);
+    nWalletKeyCacheSize = GetArg("-walletkeycache", DEFAULT_WALLET_KEY_CACHE_SIZE);
     fSendFreeTransactions = GetArg("-sendfreetransactions", false);
 
     std::string strWalletFile = GetArg("-wallet", "wallet.dat");
@@ -1062,11 +1113,21 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     
+    if(mapArgs.count("-blocknotify") || mapArgs.count("-walletnotify") || mapArgs.count("-walletnotifynew"))
+    {
+        notifyQueue.Start(GetArg("-notifythreads", DEFAULT_NOTIFY_THREADS),GetArg("-notifyqueuesize", DEFAULT_NOTIFY_QUEUE_SIZE),
+                          GetArg("-notifybatch", DEFAULT_NOTIFY_BATCH_SIZE));
+    }
+    
     if(!GetBoolArg("-offline",false))
     {    
         if (nScriptCheckThreads) {
             for (int i=0; i<nScriptCheckThreads-1; i++)
                 threadGroup.create_thread(&ThreadScriptCheck);
+/* MCHN START */
+            for (int i=0; i<nScriptCheckThreads-1; i++)
+                threadGroup.create_thread(&ThreadMultiChainCheck);
+/* MCHN END */
         }
     }
 
@@ -2409,6 +2470,7 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
     fListen = GetBoolArg("-listen", DEFAULT_LISTEN);
     fDiscover = GetBoolArg("-discover", true);
     fNameLookup = GetBoolArg("-dns", true);
+    fP2PCompression = GetBoolArg("-p2pcompression", DEFAULT_P2P_COMPRESSION);
 
     if(GetBoolArg("-offline",false))
     {
@@ -2635,7 +2697,7 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
     nTotalCache -= nBlockTreeDBCache;
     size_t nCoinDBCache = nTotalCache / 2; // use half of the remaining cache for coindb cache
     nTotalCache -= nCoinDBCache;
-    nCoinCacheSize = nTotalCache / 300; // coins in memory require around 300 bytes
+    nCoinCacheSize = nTotalCache / 150; // coins in memory require around 150 bytes per output
 
     bool fLoaded = false;
     while (!fLoaded) {
@@ -2661,6 +2723,12 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
                 if (fReindex)
                     pblocktree->WriteReindexing(true);
 
+                // Convert chainstate written in the per-transaction format before anything reads it
+                if (!pcoinsdbview->Upgrade()) {
+                    strLoadError = _("Error upgrading chainstate database");
+                    break;
+                }
+
                 if(mc_gState->m_WalletMode & MC_WMD_TXS)
                 {
                     bool fFirstRunForLoadChain = true;
@@ -2714,6 +2782,12 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
                     strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
                     break;
                 }
+                if (fBlockFilterIndex != GetBoolArg("-blockfilterindex", false)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -blockfilterindex");
+                    break;
+                }
+                if (fBlockFilterIndex)
+                    nLocalServices |= NODE_COMPACT_FILTERS;
 /* MCHN END */    
 
                 uiInterface.InitMessage(_("Verifying blocks..."));
@@ -2973,7 +3047,7 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
         }
 /* MCHN START */  
         pwalletMain->lpWalletTxs=pwalletTxsMain;
-        pwalletMain->InitializeUnspentList();
+        pwalletMain->InitializeUnspentList(true);
 
         {
             LOCK(cs_main);
@@ -3053,6 +3127,13 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
     if (pwalletMain)
         bitdbwrap.Flush(false);
     
+    if(GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL) && GetBoolArg("-offline",false))
+    {                                                                           // Otherwise loaded by ThreadImport
+        uiInterface.InitMessage(_("Loading memory pool..."));
+        LoadMempool();
+        fDumpMempoolLater = !ShutdownRequested();
+    }
+    
     if(!GetBoolArg("-offline",false))
     {
         StartNode(threadGroup);
@@ -3081,9 +3162,28 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
     if (pwalletMain) {
         // Run a thread to flush wallet periodically
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
+/* MCHN START */
+        if (nSignatureThreads) {
+            for (int i=0; i<nSignatureThreads-1; i++)
+                threadGroup.create_thread(&ThreadSignatureWorker);
+        }
+/* MCHN END */
     }
+/* MCHN START */
+    else
+    {
+        nSignatureThreads = 0;                                                  // No signature workers without wallet, signrawtransaction with keys signs serially
+    }
+/* MCHN END */
 #endif
 
+/* MCHN START */    
+    if(GetArg("-memorydumpinterval",0) > 0)
+    {
+        threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "memdump", &DumpMemoryUsage, GetArg("-memorydumpinterval",0) * 1000));
+    }
+/* MCHN END */    
+
     pEF->LIC_VerifyLicenses(0);
     
     vector<string> conflicting_licenses=pEF->LIC_LicensesWithStatus("conflicting");
@@ -20,6 +20,7 @@
 #include "ui/ui_interface.h"
 #include "utils/util.h"
 #include "utils/utilmoneystr.h"
+#include "utils/memusage.h"
 
 /* MCHN START */
 
@@ -31,7 +32,9 @@
 #include "community/community.h"
 #include "wallet/wallettxs.h"
 #include "script/script.h"
+#include "script/sigcache.h"
 #include "protocol/relay.h"
+#include "crypto/hmac_sha256.h"
 
 
 extern mc_WalletTxs* pwalletTxsMain;
@@ -100,6 +103,11 @@ bool fImporting = false;
 bool fReindex = false;
 bool fRescan = false;
 bool fTxIndex = false;
+/* MCHN START */
+bool fBlockFilterIndex = false;
+bool fMultiChainBlockUndo = true;
+CBlockFilterStats blockFilterStats = {0, 0, 0, 0, 0, 0};
+/* MCHN END */
 bool fIsBareMultisigStd = true;
 unsigned int nCoinCacheSize = 5000;
 int GenesisBlockSize=0;
@@ -1355,6 +1363,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool* pfMissingInputs, bool fRejectInsaneFee,CWalletTx *wtx)
 {
     AssertLockHeld(cs_main);
+    int64_t nAcceptStartMicros=GetTimeMicros();
     if (pfMissingInputs)
         *pfMissingInputs = false;
     
@@ -1428,14 +1437,16 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         view.SetBackend(viewMemPool);
 
         // do we already have it?
-        if (view.HaveCoins(hash))
-            return false;
+        for (unsigned int out = 0; out < tx.vout.size(); out++) {
+            if (view.HaveCoin(COutPoint(hash, out)))
+                return false;
+        }
 
         // do all inputs exist?
-        // Note that this does not check for the presence of actual outputs (see the next check for that),
-        // only helps filling in pfMissingInputs (to determine missing vs spent).
+        // With per-output coins a spent output cannot be told apart from a missing one,
+        // so both are reported through pfMissingInputs.
         BOOST_FOREACH(const CTxIn txin, tx.vin) {
-            if (!view.HaveCoins(txin.prevout.hash)) {
+            if (!view.HaveCoin(txin.prevout)) {
                 if(fDebug)LogPrint("mchn","Missing tx (%s)\n",txin.prevout.hash.ToString().c_str());
                 if (pfMissingInputs)
                     *pfMissingInputs = true;
@@ -1456,8 +1467,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
             if (!tx.IsCoinBase()) {
                 for (unsigned int i = 0; i < tx.vin.size(); i++) {
                     const COutPoint &prevout = tx.vin[i].prevout;
-                    const CCoins* coins = view.AccessCoins(prevout.hash);
-                    if (!coins || !coins->IsAvailable(prevout.n)) {
+                    if (!view.HaveCoin(prevout)) {
                         if(fDebug)LogPrint("mchn","Missing coin (%s,%d)\n",prevout.hash.ToString().c_str(),prevout.n);
                         return state.Invalid(error("AcceptToMemoryPool : inputs already spent"),
                                  REJECT_DUPLICATE, "bad-txns-inputs-spent");
@@ -1506,6 +1516,11 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
 
         CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height());
         unsigned int nSize = entry.GetTxSize();
+/* MCHN START */        
+        bool fChangesState;
+        int nAdmissionClass=MultiChainTransaction_AdmissionClass(tx,&fChangesState);
+        entry.SetAdmissionClass(nAdmissionClass,fChangesState);
+/* MCHN END */        
 
         ::minRelayTxFee = CFeeRate(MIN_RELAY_TX_FEE);    
         
@@ -1664,6 +1679,15 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
 /* MCHN END */    
         // Store transaction in memory
         pool.addUnchecked(hash, entry);
+/* MCHN START */        
+        {
+            int64_t nAcceptMicros=GetTimeMicros()-nAcceptStartMicros;
+            LOCK(pool.cs);
+            CTxAdmissionClassStats& stats=pool.admissionClassStats[entry.GetAdmissionClass()];
+            stats.nAcceptMicros+=nAcceptMicros;
+            stats.nMaxAcceptMicros=max(stats.nMaxAcceptMicros,nAcceptMicros);
+        }
+/* MCHN END */        
         err=pEF->FED_EventChunksAvailable();
         if(err)
         {
@@ -1679,6 +1703,396 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return true;
 }
 
+int AcceptToMemoryPoolMany(CTxMemPool& pool, std::vector<CValidationState>& vstate, const std::vector<CTransaction>& vtx, bool fLimitFree,
+                        std::vector<bool>& vAccepted, bool fRejectInsaneFee, std::vector<CWalletTx*> *vwtx)
+{
+    LOCK(cs_main);
+    
+    set<uint256> setRejected;
+    int nAccepted=0;
+    
+    vstate.assign(vtx.size(),CValidationState());
+    vAccepted.assign(vtx.size(),false);
+    
+    for(unsigned int i=0;i<vtx.size();i++)
+    {
+        const CTransaction& tx=vtx[i];
+        bool fMissingInputs=false;
+        bool fDependsOnRejected=false;
+        
+        // Transactions are ordered topologically, all descendants of rejected transaction are rejected as well
+        BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        {
+            if(setRejected.count(txin.prevout.hash))
+            {
+                fDependsOnRejected=true;
+                break;
+            }
+        }
+        
+        if(fDependsOnRejected)
+        {
+            vstate[i].Invalid(false, REJECT_INVALID, "depends-on-rejected");
+        }
+        else
+        {
+            vAccepted[i]=AcceptToMemoryPool(pool, vstate[i], tx, fLimitFree, &fMissingInputs, fRejectInsaneFee, vwtx ? (*vwtx)[i] : NULL);
+            if(!vAccepted[i] && fMissingInputs && vstate[i].GetRejectReason().size() == 0)
+            {
+                vstate[i].Invalid(false, REJECT_INVALID, "missing inputs");
+            }
+        }
+        
+        if(vAccepted[i])
+        {
+            nAccepted++;
+        }
+        else
+        {
+            if(!pool.exists(tx.GetHash()))
+            {
+                setRejected.insert(tx.GetHash());
+            }
+        }
+    }
+    
+    return nAccepted;
+}
+
+/* MCHN START */
+
+static const char* MEMPOOL_FILENAME="mempool.dat";
+static const char* MEMPOOL_KEY_FILENAME="mempool.key";
+static const int MEMPOOL_DUMP_VERSION=3;
+static const int MEMPOOL_KEY_SIZE=32;
+static const int MEMPOOL_MIN_DELTA_SIZE=48;                                     // txid, priority delta, fee delta
+static const int MEMPOOL_MIN_SIGNATURE_SIZE=34;                                 // sighash, empty signature and pubkey
+static const int MEMPOOL_MIN_TX_SIZE=30;                                        // Empty tx, time, height, priority
+
+/*
+ * mempool.dat layout:
+ * version required, version that wrote, tip hash, tip height,
+ * priority/fee deltas, known-valid signatures, 
+ * transactions in hashList order with arrival time, entry height and priority at entry height,
+ * HMAC-SHA256 of all the above with per-node key from mempool.key.
+ * Signatures are trusted only if HMAC matches, i.e. the file was written by this node.
+ */
+
+static bool GetMempoolKey(vector<unsigned char>& vchKey,bool fCreate)
+{
+    boost::filesystem::path path=GetDataDir() / MEMPOOL_KEY_FILENAME;
+    
+    vchKey.resize(MEMPOOL_KEY_SIZE);
+    FILE *file=fopen(path.string().c_str(), "rb");
+    if(file)
+    {
+        size_t size=fread(&vchKey[0],1,MEMPOOL_KEY_SIZE,file);
+        fclose(file);
+        if(size == (size_t)MEMPOOL_KEY_SIZE)
+        {
+            return true;
+        }
+    }
+    
+    if(!fCreate)
+    {
+        return false;
+    }
+    
+    GetRandBytes(&vchKey[0],MEMPOOL_KEY_SIZE);
+    file=fopen(path.string().c_str(), "wb");
+    if(file == NULL)
+    {
+        return error("GetMempoolKey: Failed to open %s", path.string());
+    }
+    size_t size=fwrite(&vchKey[0],1,MEMPOOL_KEY_SIZE,file);
+    FileCommit(file);
+    fclose(file);
+    if(size != (size_t)MEMPOOL_KEY_SIZE)
+    {
+        return error("GetMempoolKey: Failed to write %s", path.string());
+    }
+    return true;
+}
+
+static uint256 MempoolHMAC(const vector<unsigned char>& vchKey,const CDataStream& ss)
+{
+    uint256 result;
+    CHMAC_SHA256((unsigned char*)&vchKey[0],vchKey.size()).Write((unsigned char*)&ss[0],ss.size()).Finalize((unsigned char*)&result);
+    return result;
+}
+
+bool DumpMempool()
+{
+    int64_t nStart=GetTimeMillis();
+    
+    uint256 hashTip=0;
+    int nTipHeight=-1;
+    vector<CTxMemPoolEntry> vEntries;
+    map<uint256, pair<double, CAmount> > mapDeltas;
+    vector<CSignatureCacheEntry> vSignatures;
+    vector<unsigned char> vchKey;
+    
+    {
+        LOCK2(cs_main, mempool.cs);
+        if(chainActive.Tip())
+        {
+            hashTip=chainActive.Tip()->GetBlockHash();
+            nTipHeight=chainActive.Height();
+        }
+        
+        set<uint256> setDumped;
+        vEntries.reserve(mempool.mapTx.size());
+        for(int pos=0;pos<mempool.hashList->m_Count;pos++)
+        {
+            uint256 hash=*(uint256*)mempool.hashList->GetRow(pos);
+            map<uint256, CTxMemPoolEntry>::const_iterator it=mempool.mapTx.find(hash);
+            if( (it != mempool.mapTx.end()) && (setDumped.insert(hash).second) )
+            {
+                vEntries.push_back(it->second);
+            }
+        }
+        mapDeltas=mempool.mapDeltas;
+    }
+    
+    if(!GetMempoolKey(vchKey,true))
+    {
+        return error("DumpMempool: Failed to get memory pool key");
+    }
+    
+    if(vEntries.size())
+    {
+        MultichainNode_GetSignatureCache(vSignatures);
+    }
+    
+    boost::filesystem::path path=GetDataDir() / MEMPOOL_FILENAME;
+    boost::filesystem::path path_new=GetDataDir() / (string(MEMPOOL_FILENAME) + ".new");
+    
+    try {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        
+        ss << MEMPOOL_DUMP_VERSION;
+        ss << CLIENT_VERSION;
+        ss << hashTip;
+        ss << nTipHeight;
+        ss << mapDeltas;
+        
+        ss << (uint64_t)vSignatures.size();
+        for(unsigned int i=0;i<vSignatures.size();i++)
+        {
+            ss << vSignatures[i].get<0>();
+            ss << vSignatures[i].get<1>();
+            ss << vSignatures[i].get<2>();
+        }
+        
+        ss << (uint64_t)vEntries.size();
+        for(unsigned int i=0;i<vEntries.size();i++)
+        {
+            ss << vEntries[i].GetTx();
+            ss << vEntries[i].GetTime();
+            ss << vEntries[i].GetHeight();
+            ss << vEntries[i].GetPriority(vEntries[i].GetHeight());
+        }
+        
+        uint256 hmac=MempoolHMAC(vchKey,ss);
+        ss << hmac;
+        
+        CAutoFile fileout(fopen(path_new.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        if(fileout.IsNull())
+            return error("DumpMempool: Failed to open %s", path_new.string());
+        
+        fileout << ss;
+        
+        FileCommit(fileout.Get());
+        fileout.fclose();
+        if(!RenameOver(path_new, path))
+            return error("DumpMempool: Failed to rename %s", path_new.string());
+    } catch (const std::exception& e) {
+        return error("DumpMempool: Failed to write memory pool: %s", e.what());
+    }
+    
+    LogPrintf("Dumped memory pool: %u transactions, %u signatures, tip height %d, %dms\n",
+              vEntries.size(),vSignatures.size(),nTipHeight,GetTimeMillis()-nStart);
+    return true;
+}
+
+/** Fails if remaining part of the file cannot hold count records of at least record_size bytes each */
+
+static void CheckMempoolRecordCount(CAutoFile& filein,int64_t dataSize,uint64_t count,int record_size,const char *name)
+{
+    int64_t pos=ftell(filein.Get());
+    if( (pos < 0) || (pos > dataSize) || (count > (uint64_t)(dataSize-pos)/record_size) )
+    {
+        throw std::ios_base::failure(strprintf("invalid number of %s: %u",name,count));
+    }
+}
+
+/** Deltas are applied to loaded transactions, like prioritisetransaction called after the restart */
+
+static void ApplyMempoolDeltas(const map<uint256, pair<double, CAmount> >& mapDeltas)
+{
+    for(map<uint256, pair<double, CAmount> >::const_iterator it=mapDeltas.begin();it != mapDeltas.end();it++)
+    {
+        mempool.PrioritiseTransaction(it->first, it->first.ToString(), it->second.first, it->second.second);
+    }
+}
+
+bool LoadMempool()
+{
+    int64_t nStart=GetTimeMillis();
+    
+    boost::filesystem::path path=GetDataDir() / MEMPOOL_FILENAME;
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if(filein.IsNull())
+    {
+        LogPrintf("Memory pool snapshot not found, starting with empty memory pool\n");
+        return false;
+    }
+    
+    int nVersionRequired,nVersionThatWrote;
+    uint256 hashTip;
+    int nTipHeight;
+    uint64_t nSignatures,nTxs;
+    int accepted=0;
+    int failed=0;
+    int already_there=0;
+    bool fAuthenticated=false;
+    vector<unsigned char> vchKey;
+    map<uint256, pair<double, CAmount> > mapDeltas;
+    
+    try {
+        int64_t dataSize=(int64_t)boost::filesystem::file_size(path)-(int64_t)sizeof(uint256);
+        if(dataSize < 0)
+            return error("LoadMempool: memory pool file is truncated");
+        
+        // File is read twice in small chunks - to authenticate it and to load it, it is never held in memory as a whole
+        
+        if(GetMempoolKey(vchKey,false))
+        {
+            CHMAC_SHA256 hmac((unsigned char*)&vchKey[0],vchKey.size());
+            char buf[65536];
+            int64_t remaining=dataSize;
+            while(remaining > 0)
+            {
+                size_t chunk=(size_t)min(remaining,(int64_t)sizeof(buf));
+                filein.read(buf,chunk);
+                hmac.Write((unsigned char*)buf,chunk);
+                remaining-=chunk;
+            }
+            uint256 hmacIn,hmacOut;
+            filein >> hmacIn;
+            hmac.Finalize((unsigned char*)&hmacOut);
+            fAuthenticated=(hmacOut == hmacIn);
+            if(fseek(filein.Get(),0,SEEK_SET))
+                return error("LoadMempool: failed to rewind memory pool file");
+        }
+        if(!fAuthenticated)
+        {
+            LogPrintf("LoadMempool: memory pool snapshot was not written by this node, all signatures will be verified\n");
+        }
+        
+        filein >> nVersionRequired >> nVersionThatWrote;
+        if(nVersionRequired > MEMPOOL_DUMP_VERSION)
+            return error("LoadMempool: up-version (%d) memory pool file", nVersionRequired);
+        if(nVersionRequired < MEMPOOL_DUMP_VERSION)
+            return error("LoadMempool: unsupported old version (%d) of memory pool file", nVersionRequired);
+        
+        filein >> hashTip >> nTipHeight;
+        
+        uint64_t nDeltas=ReadCompactSize(filein);
+        CheckMempoolRecordCount(filein,dataSize,nDeltas,MEMPOOL_MIN_DELTA_SIZE,"priority deltas");
+        for(uint64_t i=0;i<nDeltas;i++)
+        {
+            pair<uint256, pair<double, CAmount> > delta;
+            filein >> delta;
+            mapDeltas.insert(delta);
+        }
+        
+        // Signatures don't depend on chain state, seeding the cache makes script checks below skip ECDSA verification.
+        // Only signatures verified by this node before shutdown are accepted, anything else is a way to forge them
+        
+        filein >> nSignatures;
+        CheckMempoolRecordCount(filein,dataSize,nSignatures,MEMPOOL_MIN_SIGNATURE_SIZE,"signatures");
+        for(uint64_t i=0;i<nSignatures;i++)
+        {
+            uint256 sighash;
+            vector<unsigned char> vchSig;
+            CPubKey pubkey;
+            filein >> sighash >> vchSig >> pubkey;
+            if(fAuthenticated)
+            {
+                MultichainNode_AddSignatureToCache(vchSig,pubkey,sighash);
+            }
+        }
+        
+        // Permissions, assets and stream items are replayed in arrival order, like for transactions received from peers
+        
+        filein >> nTxs;
+        CheckMempoolRecordCount(filein,dataSize,nTxs,MEMPOOL_MIN_TX_SIZE,"transactions");
+        for(uint64_t i=0;i<nTxs;i++)
+        {
+            CTransaction tx;
+            int64_t nTime;
+            unsigned int nEntryHeight;
+            double dEntryPriority;
+            filein >> tx >> nTime >> nEntryHeight >> dEntryPriority;
+            
+            uint256 hash=tx.GetHash();
+            CValidationState state;
+            
+            LOCK(cs_main);
+            if(AcceptToMemoryPool(mempool, state, tx, false, NULL))
+            {
+                LOCK(mempool.cs);
+                map<uint256, CTxMemPoolEntry>::iterator it=mempool.mapTx.find(hash);
+                if(it != mempool.mapTx.end())
+                {
+                    it->second.SetTime(nTime);
+                    if(nEntryHeight <= it->second.GetHeight())                  // Entry height is above the tip if the chain was rolled back
+                    {
+                        it->second.SetEntryPriority(dEntryPriority,nEntryHeight);
+                    }
+                }
+                accepted++;
+            }
+            else
+            {
+                if(mempool.exists(hash))
+                {
+                    already_there++;
+                }
+                else
+                {
+                    if(fDebug)LogPrint("mempool","LoadMempool: tx %s rejected: %s\n",hash.ToString(),state.GetRejectReason());
+                    failed++;
+                }
+            }
+            
+            if(ShutdownRequested())
+            {
+                ApplyMempoolDeltas(mapDeltas);
+                return false;
+            }
+        }
+        
+        if(ftell(filein.Get()) != dataSize)
+            throw std::ios_base::failure("unexpected data after the last transaction");
+    } catch (const std::exception& e) {
+        LogPrintf("LoadMempool: Failed to read memory pool snapshot (non-fatal): %s\n", e.what());
+        ApplyMempoolDeltas(mapDeltas);                                          // Transactions accepted before the failure keep their deltas
+        return false;
+    }
+    
+    ApplyMempoolDeltas(mapDeltas);
+    
+    LogPrintf("Loaded memory pool: %d accepted, %d failed, %d already there, %u %s signatures, %u priority deltas, snapshot tip height %d%s, %dms\n",
+              accepted,failed,already_there,nSignatures,fAuthenticated ? "known-valid" : "ignored",mapDeltas.size(),nTipHeight,
+              (chainActive.Tip() && (chainActive.Tip()->GetBlockHash() == hashTip)) ? "" : " (tip changed)",GetTimeMillis()-nStart);
+    return true;
+}
+
+/* MCHN END */
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -1717,9 +2131,9 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
             int nHeight = -1;
             {
                 CCoinsViewCache &view = *pcoinsTip;
-                const CCoins* coins = view.AccessCoins(hash);
-                if (coins)
-                    nHeight = coins->nHeight;
+                const Coin& coin = AccessByTxid(view, hash);
+                if (!coin.IsSpent())
+                    nHeight = coin.nHeight;
             }
             if (nHeight > 0)
                 pindexSlow = chainActive[nHeight];
@@ -2013,14 +2427,15 @@ void UpdateCoins(const CTransaction& tx, CValidationState &state, CCoinsViewCach
     if (!tx.IsCoinBase()) {
         txundo.vprevout.reserve(tx.vin.size());
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
-            txundo.vprevout.push_back(CTxInUndo());
-            bool ret = inputs.ModifyCoins(txin.prevout.hash)->Spend(txin.prevout, txundo.vprevout.back());
+            Coin coin;
+            bool ret = inputs.SpendCoin(txin.prevout, &coin);
             assert(ret);
+            txundo.vprevout.push_back(CTxInUndo(coin.out, coin.fCoinBase, coin.nHeight, coin.nVersion));
         }
     }
 
     // add outputs
-    inputs.ModifyCoins(tx.GetHash())->FromTx(tx, nHeight);
+    AddCoins(inputs, tx, nHeight);
 }
 
 bool CScriptCheck::operator()() {
@@ -2064,20 +2479,20 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
         for (unsigned int i = 0; i < tx.vin.size(); i++)
         {
             const COutPoint &prevout = tx.vin[i].prevout;
-            const CCoins *coins = inputs.AccessCoins(prevout.hash);
-            assert(coins);
+            const Coin& coin = inputs.AccessCoin(prevout);
+            assert(!coin.IsSpent());
 
             // If prev is coinbase, check that it's matured
-            if (coins->IsCoinBase()) {
-                if (nSpendHeight - coins->nHeight < COINBASE_MATURITY)
+            if (coin.IsCoinBase()) {
+                if (nSpendHeight - (int)coin.nHeight < COINBASE_MATURITY)
                     return state.Invalid(
-                        error("CheckInputs() : tried to spend coinbase at depth %d", nSpendHeight - coins->nHeight),
+                        error("CheckInputs() : tried to spend coinbase at depth %d", nSpendHeight - (int)coin.nHeight),
                         REJECT_INVALID, "bad-txns-premature-spend-of-coinbase");
             }
 
             // Check for negative or overflow input values
-            nValueIn += coins->vout[prevout.n].nValue;
-            if (!MoneyRange(coins->vout[prevout.n].nValue) || !MoneyRange(nValueIn))
+            nValueIn += coin.out.nValue;
+            if (!MoneyRange(coin.out.nValue) || !MoneyRange(nValueIn))
                 return state.DoS(100, error("CheckInputs() : txin values out of range"),
                                  REJECT_INVALID, "bad-txns-inputvalues-outofrange");
             unsigned int send_permission_flags=0;
@@ -2085,7 +2500,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             if(fScriptChecks)
             {
                 CTxDestination addressRet;     
-                if(ExtractDestinationScriptValid(coins->vout[prevout.n].scriptPubKey, addressRet))
+                if(ExtractDestinationScriptValid(coin.out.scriptPubKey, addressRet))
                 {
                     if(!fIsLicenseTokenTransfer)
                     {                        
@@ -2154,11 +2569,11 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
         if (fScriptChecks) {
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
-                const CCoins* coins = inputs.AccessCoins(prevout.hash);
-                assert(coins);
+                const Coin& coin = inputs.AccessCoin(prevout);
+                assert(!coin.IsSpent());
 
                 // Verify signature
-                CScriptCheck check(*coins, tx, i, flags | vSendPermissionFlags[i], cacheStore);
+                CScriptCheck check(coin.out, tx, i, flags | vSendPermissionFlags[i], cacheStore);
 //                if (pvChecks) {
                 if ( (pvChecks != NULL) && (vSendPermissionFlags[i] != 0) ) {
                     pvChecks->push_back(CScriptCheck());
@@ -2171,7 +2586,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // arguments; if so, don't trigger DoS protection to
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
-                        CScriptCheck check2(*coins, tx, i,
+                        CScriptCheck check2(coin.out, tx, i,
                                 flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
@@ -2197,7 +2612,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
 
 
 
-bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
+bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean, CMultiChainBlockUndo* pmcundo)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
@@ -2215,6 +2630,10 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
         return error("DisconnectBlock() : block and undo data inconsistent");
+/* MCHN START */
+    if (pmcundo)
+        *pmcundo = blockUndo.mcundo;
+/* MCHN END */
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
@@ -2222,25 +2641,15 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         uint256 hash = tx.GetHash();
 
         // Check that all outputs are available and match the outputs in the block itself
-        // exactly. Note that transactions with only provably unspendable outputs won't
-        // have outputs available even in the block itself, so we handle that case
-        // specially with outsEmpty.
-        {
-        CCoins outsEmpty;
-        CCoinsModifier outs = view.ModifyCoins(hash);
-        outs->ClearUnspendable();
-
-        CCoins outsBlock(tx, pindex->nHeight);
-        // The CCoins serialization does not serialize negative numbers.
-        // No network rules currently depend on the version here, so an inconsistency is harmless
-        // but it must be corrected before txout nversion ever influences a network rule.
-        if (outsBlock.nVersion < 0)
-            outs->nVersion = outsBlock.nVersion;
-        if (*outs != outsBlock)
-            fClean = fClean && error("DisconnectBlock() : added transaction mismatch? database corrupted");
-
-        // remove outputs
-        outs->Clear();
+        // exactly. Provably unspendable outputs are never added to the coins database.
+        bool fCoinBase = tx.IsCoinBase();
+        for (unsigned int o = 0; o < tx.vout.size(); o++) {
+            if (tx.vout[o].scriptPubKey.IsUnspendable())
+                continue;
+            Coin coin;
+            bool fSpent = view.SpendCoin(COutPoint(hash, o), &coin);
+            if (!fSpent || tx.vout[o] != coin.out || (unsigned int)pindex->nHeight != coin.nHeight || fCoinBase != (bool)coin.fCoinBase)
+                fClean = fClean && error("DisconnectBlock() : added transaction mismatch? database corrupted");
         }
 
         // restore inputs
@@ -2251,24 +2660,21 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
                 const CTxInUndo &undo = txundo.vprevout[j];
-                CCoinsModifier coins = view.ModifyCoins(out.hash);
-                if (undo.nHeight != 0) {
-                    // undo data contains height: this is the last output of the prevout tx being spent
-                    if (!coins->IsPruned())
-                        fClean = fClean && error("DisconnectBlock() : undo data overwriting existing transaction");
-                    coins->Clear();
-                    coins->fCoinBase = undo.fCoinBase;
-                    coins->nHeight = undo.nHeight;
-                    coins->nVersion = undo.nVersion;
-                } else {
-                    if (coins->IsPruned())
-                        fClean = fClean && error("DisconnectBlock() : undo data adding output to missing transaction");
+                Coin coin(undo.txout, undo.nHeight, undo.fCoinBase, undo.nVersion);
+                if (undo.nHeight == 0) {
+                    // Undo data written before per-output coins only carries metadata for the last
+                    // spent output of a transaction. Inputs are restored in reverse order, so another
+                    // output of the same transaction is already back in the view.
+                    const Coin& alternate = AccessByTxid(view, out.hash);
+                    if (alternate.IsSpent())
+                        return error("DisconnectBlock() : undo data adding output to missing transaction");
+                    coin.fCoinBase = alternate.fCoinBase;
+                    coin.nHeight = alternate.nHeight;
+                    coin.nVersion = alternate.nVersion;
                 }
-                if (coins->IsAvailable(out.n))
+                if (view.HaveCoin(out))
                     fClean = fClean && error("DisconnectBlock() : undo data overwriting existing output");
-                if (coins->vout.size() < out.n+1)
-                    coins->vout.resize(out.n+1);
-                coins->vout[out.n] = undo.txout;
+                view.AddCoin(out, coin, true);
             }
         }
     }
@@ -2316,12 +2722,159 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/* MCHN START */
+static CCheckQueue<CMultiChainInputCheck> multichaincheckqueue(128);
+
+void ThreadMultiChainCheck() {
+    RenameThread("bitcoin-mcheck");
+    multichaincheckqueue.Thread();
+}
+
+/** 
+ * Fills spent scriptPubKeys for transactions from view or from earlier transactions in the list. 
+ * Prechecks of transactions spending outputs not found are left empty. Returns number of inputs found.
+ */
+int CollectMultiChainInputs(const std::vector<CTransaction>& vtx, CCoinsViewCache& view, std::vector<CMultiChainInputPrecheck>& vPrechecks)
+{
+    std::map<uint256, unsigned int> mapBlockTxs;
+    int nInputs=0;
+    
+    vPrechecks.clear();
+    vPrechecks.resize(vtx.size());
+    
+    for (unsigned int i = 0; i < vtx.size(); i++)
+    {
+        const CTransaction &tx = vtx[i];
+        if (!tx.IsCoinBase())
+        {
+            bool fFound=true;
+            CMultiChainInputPrecheck& precheck=vPrechecks[i];
+            precheck.vPrevScripts.reserve(tx.vin.size());
+            for (unsigned int j = 0; fFound && (j < tx.vin.size()); j++)
+            {
+                const COutPoint &prevout = tx.vin[j].prevout;
+                std::map<uint256, unsigned int>::const_iterator it = mapBlockTxs.find(prevout.hash);
+                if(it != mapBlockTxs.end())
+                {
+                    const CTransaction &txPrev = vtx[it->second];
+                    if(prevout.n < txPrev.vout.size())
+                    {
+                        precheck.vPrevScripts.push_back(txPrev.vout[prevout.n].scriptPubKey);
+                    }
+                    else
+                    {
+                        fFound=false;
+                    }
+                }
+                else
+                {
+                    const Coin& coin = view.AccessCoin(prevout);
+                    if(!coin.IsSpent())
+                    {
+                        precheck.vPrevScripts.push_back(coin.out.scriptPubKey);
+                    }
+                    else
+                    {
+                        fFound=false;
+                    }
+                }
+            }
+            if(fFound)
+            {
+                nInputs+=tx.vin.size();
+            }
+            else
+            {
+                precheck.vPrevScripts.clear();
+            }
+        }
+        mapBlockTxs[tx.GetHash()]=i;
+    }
+    
+    return nInputs;
+}
+
+/** 
+ * Runs context-free MultiChain input checks for prechecks with filled spent scriptPubKeys, 
+ * on script check threads if fParallel, otherwise in this thread
+ */
+void RunMultiChainInputPrechecks(const std::vector<CTransaction>& vtx, std::vector<CMultiChainInputPrecheck>& vPrechecks, bool fParallel)
+{
+    std::vector<CMultiChainInputCheck> vChecks;
+    
+    for (unsigned int i = 0; i < vtx.size(); i++)
+    {
+        if( !vtx[i].IsCoinBase() && (vPrechecks[i].vPrevScripts.size() == vtx[i].vin.size()) )
+        {
+            vChecks.push_back(CMultiChainInputCheck(vtx[i],&vPrechecks[i]));
+        }
+    }
+    
+    if(fParallel)
+    {
+        CCheckQueueControl<CMultiChainInputCheck> control(&multichaincheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+    else
+    {
+        BOOST_FOREACH(CMultiChainInputCheck& check, vChecks)
+        {
+            check();
+        }
+    }
+}
+
+/** 
+ * Runs context-free MultiChain input checks of block transactions on script check threads. 
+ * Small blocks are not worth the queue handoff, their prechecks are left empty and done by serial checks.
+ * Transactions spending outputs not found here are checked serially by AcceptMultiChainTransaction
+ */
+void PrecheckMultiChainInputs(const CBlock& block, CCoinsViewCache& view, std::vector<CMultiChainInputPrecheck>& vPrechecks)
+{
+    if(CollectMultiChainInputs(block.vtx,view,vPrechecks) < GetArg("-parallelprecheckmininputs",DEFAULT_PARALLEL_PRECHECK_MIN_INPUTS))
+    {
+        vPrechecks.clear();
+        return;
+    }
+    
+    RunMultiChainInputPrechecks(block.vtx,vPrechecks,true);
+}
+/* MCHN END */
+
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+/* MCHN START */
+/** Builds compact filter of the block and chains its header to the filter header of the previous block */
+static bool WriteBlockFilter(const CBlock& block, const CBlockIndex* pindex)
+{
+    int64_t nStart = GetTimeMicros();
+    uint256 prevHeader = 0;
+    uint256 prevFilterHash;
+
+    if (pindex->pprev)
+        if (!pblocktree->ReadBlockFilterHeader(pindex->pprev->GetBlockHash(), prevFilterHash, prevHeader))
+            return error("WriteBlockFilter() : filter header of block %s not found", pindex->pprev->GetBlockHash().ToString());
+
+    vector<vector<unsigned char> > vElements;
+    GetBlockFilterElements(block, vElements);
+    CBlockFilter filter(pindex->GetBlockHash(), vElements);
+    if (!pblocktree->WriteBlockFilter(filter, filter.ComputeHeader(prevHeader)))
+        return false;
+
+    blockFilterStats.nBuilt++;
+    blockFilterStats.nElements += filter.GetNumElements();
+    blockFilterStats.nBytes += filter.GetEncoded().size();
+    blockFilterStats.nBuildMicros += GetTimeMicros() - nStart;
+    if(fDebug)LogPrint("bench", "    - Block filter: %d elements, %u bytes, %.2fms\n", (int)filter.GetNumElements(), filter.GetEncoded().size(), 0.001 * (GetTimeMicros() - nStart));
+    return true;
+}
+/* MCHN END */
+
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck)
 {
     AssertLockHeld(cs_main);
@@ -2458,6 +3011,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             return state.DoS(100, error("ConnectBlock() : error on asset commit for the genesis block"),
                              REJECT_INVALID, "bad-prm-commit");            
         }
+        if (fBlockFilterIndex && !fJustCheck)
+            if (!WriteBlockFilter(block, pindex))
+            {
+                mc_gState->m_Assets->RollBack();
+                mc_gState->m_Permissions->RollBack();
+                return state.Abort("Failed to write block filter");
+            }
 /* MCHN END */        
         view.SetBestBlock(pindex->GetBlockHash());
         return true;
@@ -2491,10 +3051,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                            (pindex->nHeight==91880 && pindex->GetBlockHash() == uint256("0x00000000000743f190a18c5577a3c2d2a1f610ae9601ac046a38084ccb7cd721")));
     if (fEnforceBIP30) {
         BOOST_FOREACH(const CTransaction& tx, block.vtx) {
-            const CCoins* coins = view.AccessCoins(tx.GetHash());
-            if (coins && !coins->IsPruned())
-                return state.DoS(100, error("ConnectBlock() : tried to overwrite transaction"),
-                                 REJECT_INVALID, "bad-txns-BIP30");
+            for (unsigned int o = 0; o < tx.vout.size(); o++) {
+                if (view.HaveCoin(COutPoint(tx.GetHash(), o)))
+                    return state.DoS(100, error("ConnectBlock() : tried to overwrite transaction"),
+                                     REJECT_INVALID, "bad-txns-BIP30");
+            }
         }
     }
 
@@ -2529,6 +3090,17 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     
     if(fDebug)LogPrint("mchn","mchn: Checking Block with %d transactions\n",block.vtx.size());
     
+/* MCHN START */        
+    std::vector<CMultiChainInputPrecheck> vPrechecks;
+    if(!fJustCheck && nScriptCheckThreads && (mc_gState->m_NetworkParams->IsProtocolMultichain() != 0) )
+    {
+        PrecheckMultiChainInputs(block,view,vPrechecks);
+        int64_t nTimePrecheck = GetTimeMicros(); 
+        if(fDebug)LogPrint("bench", "      - MultiChain input precheck %u transactions (%s): %.2fms\n", (unsigned)block.vtx.size(), 
+                vPrechecks.size() ? "parallel" : "skipped", 0.001 * (nTimePrecheck - nTimeStart));
+    }
+/* MCHN END */        
+    
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = block.vtx[i];
@@ -2570,7 +3142,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             string reason;
             if(!fJustCheck)
             {
-                if(!AcceptMultiChainTransaction(tx,view,offset,MC_AMT_DEFAULT,reason,NULL,NULL))
+                if(!AcceptMultiChainTransaction(tx,view,offset,MC_AMT_DEFAULT,reason,NULL,NULL,vPrechecks.size() ? &vPrechecks[i] : NULL))
                 {
                     return state.DoS(0,
                                      error("ConnectBlock: : AcceptMultiChainTransaction failed %s : %s", tx.GetHash().ToString(),reason),
@@ -2631,15 +3203,52 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (fJustCheck)
         return true;
 
+/* MCHN START */        
+    if(fDebug)LogPrint("mchn","mchn: Committing permission changes for block %d...\n",mc_gState->m_Permissions->m_Block+1);
+    if(mc_gState->m_Permissions->Commit(miner_address,&block_hash) != 0)
+    {
+        return state.DoS(100, error("ConnectBlock() : error on permission commit"),
+                 REJECT_INVALID, "bad-prm-commit");            
+    }
+    if(mc_gState->m_Assets->Commit() != 0)
+    {
+        mc_gState->m_Permissions->RollBack();
+        return state.DoS(100, error("ConnectBlock() : error on asset commit"),
+                 REJECT_INVALID, "bad-prm-commit");            
+    }
+/* MCHN END */        
+
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS))
     {
         if (pindex->GetUndoPos().IsNull()) {
+/* MCHN START */        
+            if(fMultiChainBlockUndo)                                            // Values overwritten by the commit above, DisconnectTip restores them without ledger walk
+            {
+                mc_BlockUndo *prm_undo=mc_gState->m_Permissions->GetBlockUndo();
+                mc_BlockUndo *ent_undo=mc_gState->m_Assets->GetBlockUndo();
+                if( (prm_undo->m_Header.m_Block == pindex->nHeight-1) && (ent_undo->m_Header.m_Block == pindex->nHeight-1) )
+                {
+                    blockundo.mcundo.vPermissions.resize(prm_undo->GetSize());
+                    prm_undo->Serialize(&blockundo.mcundo.vPermissions[0]);
+                    blockundo.mcundo.vEntities.resize(ent_undo->GetSize());
+                    ent_undo->Serialize(&blockundo.mcundo.vEntities[0]);
+                }
+            }
+/* MCHN END */        
             CDiskBlockPos pos;
             if (!FindUndoPos(state, pindex->nFile, pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
+            {
+                mc_gState->m_Assets->RollBack();
+                mc_gState->m_Permissions->RollBack();
                 return error("ConnectBlock() : FindUndoPos failed");
+            }
             if (!blockundo.WriteToDisk(pos, pindex->pprev->GetBlockHash()))
+            {
+                mc_gState->m_Assets->RollBack();
+                mc_gState->m_Permissions->RollBack();
                 return state.Abort("Failed to write undo data");
+            }
 
             // update nUndoPos in block index
             pindex->nUndoPos = pos.nPos;
@@ -2652,22 +3261,25 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     if (fTxIndex)
         if (!pblocktree->WriteTxIndex(vPos))
+        {
+/* MCHN START */        
+            mc_gState->m_Assets->RollBack();
+            mc_gState->m_Permissions->RollBack();
+/* MCHN END */        
             return state.Abort("Failed to write transaction index");
+        }
+
+/* MCHN START */        
+    if (fBlockFilterIndex)
+        if (!WriteBlockFilter(block, pindex))
+        {
+            mc_gState->m_Assets->RollBack();
+            mc_gState->m_Permissions->RollBack();
+            return state.Abort("Failed to write block filter");
+        }
+/* MCHN END */        
 
 /* MCHN START */        
-    if(fDebug)LogPrint("mchn","mchn: Committing permission changes for block %d...\n",mc_gState->m_Permissions->m_Block+1);
-    if(mc_gState->m_Permissions->Commit(miner_address,&block_hash) != 0)
-    {
-        return state.DoS(100, error("ConnectBlock() : error on permission commit"),
-                 REJECT_INVALID, "bad-prm-commit");            
-    }
-    if(mc_gState->m_Assets->Commit() != 0)
-    {
-        mc_gState->m_Permissions->RollBack();
-        return state.DoS(100, error("ConnectBlock() : error on asset commit"),
-                 REJECT_INVALID, "bad-prm-commit");            
-    }
-    
     setBlockTransactions[mc_gState->m_Permissions->m_Block%MC_TXSET_BLOCKS].clear();
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
@@ -2711,12 +3323,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
     if ((mode == FLUSH_STATE_ALWAYS) ||
         ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->GetCacheSize() > nCoinCacheSize) ||
         (mode == FLUSH_STATE_PERIODIC && GetTimeMicros() > nLastWrite + DATABASE_WRITE_INTERVAL * 1000000)) {
-        // Typical CCoins structures on disk are around 100 bytes in size.
+        // Typical Coin structures on disk are around 50 bytes in size.
         // Pushing a new one to the database can cause it to be written
         // twice (once in the log, and once in the tables). This is already
         // an overestimation, as most will delete an existing entry or
         // overwrite one. Still, use a conservative safety factor of 2.
-        if (!CheckDiskSpace(100 * 2 * 2 * pcoinsTip->GetCacheSize()))
+        if (!CheckDiskSpace(50 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // First make sure all block and undo data is flushed to disk.
         FlushBlockFile();
@@ -2815,6 +3427,9 @@ bool static DisconnectTip(CValidationState &state) {
         return state.Abort("Failed to read block");
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
+/* MCHN START */    
+    CMultiChainBlockUndo mcundo;
+/* MCHN END */    
     {
         CCoinsViewCache view(pcoinsTip);
         int err;
@@ -2824,7 +3439,7 @@ bool static DisconnectTip(CValidationState &state) {
             LogPrintf("ERROR: Cannot disconnect(before) block %s in feeds, error %d\n",pindexDelete->GetBlockHash().ToString().c_str(),err);
         }        
         
-        if (!DisconnectBlock(block, state, pindexDelete, view))
+        if (!DisconnectBlock(block, state, pindexDelete, view, NULL, &mcundo))
         {
             err=pEF->FED_EventBlock(block, state, pindexDelete,"remove",true,true);
             if(err)
@@ -2855,8 +3470,27 @@ bool static DisconnectTip(CValidationState &state) {
     mempool.shiftHashList(block.vtx.size());
     setBlockTransactions[old_height%MC_TXSET_BLOCKS].clear();
     if(fDebug)LogPrint("mcblockperf","mchn-block-perf: Rolling back permission and asset databases\n");
-    mc_gState->m_Permissions->RollBack(old_height-1);
-    mc_gState->m_Assets->RollBack(old_height-1);
+    int64_t nRollBackStart = GetTimeMicros();
+    bool fPermissionsUndone=false;
+    bool fEntitiesUndone=false;
+    if(fMultiChainBlockUndo && !mcundo.IsNull())
+    {
+        fPermissionsUndone=(mc_gState->m_Permissions->ApplyBlockUndo(old_height-1,&mcundo.vPermissions[0],mcundo.vPermissions.size()) == MC_ERR_NOERROR);
+        if(fPermissionsUndone)
+        {
+            fEntitiesUndone=(mc_gState->m_Assets->ApplyBlockUndo(old_height-1,&mcundo.vEntities[0],mcundo.vEntities.size()) == MC_ERR_NOERROR);
+        }
+    }
+    if(!fPermissionsUndone)
+    {
+        mc_gState->m_Permissions->RollBack(old_height-1);
+    }
+    if(!fEntitiesUndone)
+    {
+        mc_gState->m_Assets->RollBack(old_height-1);
+    }
+    if(fDebug)LogPrint("bench", "- Permission and entity rollback (%s): %.2fms\n", 
+            (fPermissionsUndone && fEntitiesUndone) ? "undo record" : "ledger walk", (GetTimeMicros() - nRollBackStart) * 0.001);
     if(pMultiChainFilterEngine)
     {
         pMultiChainFilterEngine->Reset(old_height-1,0);
@@ -3772,6 +4406,39 @@ void ClearMemPools()
         LogPrintf("mempool cleared\n");
     }
 }
+
+void SampleMemoryUsage()
+{
+    {
+        LOCK(cs_main);
+        if(pcoinsTip)
+        {
+            mc_MemSetLive(MC_MEM_TAG_COINSCACHE,pcoinsTip->DynamicMemoryUsage());
+        }
+    }
+    
+    mc_MemSetLive(MC_MEM_TAG_TXMEMPOOL,mempool.DynamicMemoryUsage());
+    
+    {
+        LOCK(cs_mapRelay);
+        mc_MemSetLive(MC_MEM_TAG_RELAY,memusage::DynamicUsage(mapRelay)+nRelayDataUsage);
+    }
+}
+
+void DumpMemoryUsage()
+{
+    string str_usage;
+    int64_t total=0;
+    
+    SampleMemoryUsage();
+    
+    for(int tag=MC_MEM_TAG_NONE+1;tag<MC_MEM_TAG_COUNT;tag++)
+    {
+        str_usage+=strprintf(" %s=%d/%d",mc_MemTagName(tag),mc_MemLive(tag)/1024,mc_MemPeak(tag)/1024);
+        total+=mc_MemLive(tag);
+    }
+    LogPrintf("mchn: Memory usage, live/peak KB:%s, total=%d\n",str_usage,total/1024);
+}
 string SetLastBlock(uint256 hash)
 {
     return SetLastBlock(hash,NULL);
@@ -4174,6 +4841,7 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         pindexNew->BuildSkip();
     }
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
+    pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
     if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
         pindexBestHeader = pindexNew;
@@ -5221,6 +5889,7 @@ bool static LoadBlockIndexDB(std::string& strError)
     {
         CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
         if (pindex->nStatus & BLOCK_HAVE_DATA) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
@@ -5286,6 +5955,10 @@ bool static LoadBlockIndexDB(std::string& strError)
     // Check whether we have a transaction index
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("LoadBlockIndexDB(): transaction index %s\n", fTxIndex ? "enabled" : "disabled");
+/* MCHN START */    
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("LoadBlockIndexDB(): block filter index %s\n", fBlockFilterIndex ? "enabled" : "disabled");
+/* MCHN END */    
 
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
@@ -5569,6 +6242,10 @@ bool InitBlockIndex() {
     fTxIndex = GetBoolArg("-txindex", true);
 /* MCHN END */    
     pblocktree->WriteFlag("txindex", fTxIndex);
+/* MCHN START */    
+    fBlockFilterIndex = GetBoolArg("-blockfilterindex", false);
+    pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+/* MCHN END */    
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -5783,7 +6460,8 @@ bool static AlreadyHave(const CInv& inv)
             bool txInMap = false;
             txInMap = mempool.exists(inv.hash);
             return txInMap || mapOrphanTransactions.count(inv.hash) ||
-                pcoinsTip->HaveCoins(inv.hash);
+                pcoinsTip->HaveCoinInCache(COutPoint(inv.hash, 0)) || // Best effort: only try output 0 and 1
+                pcoinsTip->HaveCoinInCache(COutPoint(inv.hash, 1));
         }
     case MSG_BLOCK:
         return mapBlockIndex.count(inv.hash);
@@ -5997,6 +6675,34 @@ void CompleteProcessVersion(CNode* pfrom)
 /* MCHN END */
 
 
+/* MCHN START */
+/** Validates getcfilters/getcfheaders range, only blocks of the active chain are served */
+static bool GetBlockFilterRequestRange(CNode* pfrom, uint32_t nStartHeight, const uint256& hashStop, uint32_t nMaxSize, const CBlockIndex*& pindexStop)
+{
+    if (!fBlockFilterIndex)
+    {
+        if(fDebug)LogPrint("net", "peer=%d requested block filters, but they are not indexed\n", pfrom->id);
+        return false;
+    }
+
+    BlockMap::iterator mi = mapBlockIndex.find(hashStop);
+    if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second))
+    {
+        if(fDebug)LogPrint("net", "peer=%d requested block filters up to unknown or inactive block %s\n", pfrom->id, hashStop.ToString());
+        return false;
+    }
+    pindexStop = mi->second;
+
+                                                                                // Compared as unsigned, start height can be any 32-bit value from peer
+    if (nStartHeight > (uint32_t)pindexStop->nHeight || (uint32_t)pindexStop->nHeight - nStartHeight >= nMaxSize)
+    {
+        Misbehaving(pfrom->GetId(), 10);
+        return false;
+    }
+    return true;
+}
+/* MCHN END */
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
 /* MCHN START */
@@ -7106,6 +7812,73 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+/* MCHN START */    
+    else if (strCommand == "getcfilters")
+    {
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> nStartHeight >> hashStop;
+
+        LOCK(cs_main);
+
+        const CBlockIndex* pindexStop = NULL;
+        if (!GetBlockFilterRequestRange(pfrom, nStartHeight, hashStop, MAX_GETCFILTERS_SIZE, pindexStop))
+            return true;
+
+        for (int nHeight = (int)nStartHeight; nHeight <= pindexStop->nHeight; nHeight++)
+        {
+            CBlockFilter filter;
+            const CBlockIndex* pindex = chainActive[nHeight];
+            if (pindex == NULL)
+                return true;
+            if (!pblocktree->ReadBlockFilter(pindex->GetBlockHash(), filter))
+                return error("getcfilters : filter for block %d not found", nHeight);
+            pfrom->PushMessage("cfilter", filter);
+            blockFilterStats.nServedFilters++;
+        }
+    }
+
+
+    else if (strCommand == "getcfheaders")
+    {
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> nStartHeight >> hashStop;
+
+        LOCK(cs_main);
+
+        const CBlockIndex* pindexStop = NULL;
+        if (!GetBlockFilterRequestRange(pfrom, nStartHeight, hashStop, MAX_GETCFHEADERS_SIZE, pindexStop))
+            return true;
+
+        uint256 prevHeader = 0;
+        uint256 filterHash;
+        uint256 header;
+        if (nStartHeight > 0)
+        {
+            const CBlockIndex* pindexPrev = chainActive[(int)nStartHeight - 1];
+            if (pindexPrev == NULL)
+                return true;
+            if (!pblocktree->ReadBlockFilterHeader(pindexPrev->GetBlockHash(), filterHash, prevHeader))
+                return error("getcfheaders : filter header for block %d not found", nStartHeight - 1);
+        }
+
+        vector<uint256> vFilterHashes;                                          // Client recomputes headers from prevHeader and these hashes
+        for (int nHeight = (int)nStartHeight; nHeight <= pindexStop->nHeight; nHeight++)
+        {
+            const CBlockIndex* pindex = chainActive[nHeight];
+            if (pindex == NULL)
+                return true;
+            if (!pblocktree->ReadBlockFilterHeader(pindex->GetBlockHash(), filterHash, header))
+                return error("getcfheaders : filter header for block %d not found", nHeight);
+            vFilterHashes.push_back(filterHash);
+        }
+        pfrom->PushMessage("cfheaders", hashStop, prevHeader, vFilterHashes);
+        blockFilterStats.nServedHeaders++;
+    }
+/* MCHN END */    
+
+
     else if (strCommand == "reject")
     {
         if (fDebug) {
@@ -7322,7 +8095,11 @@ bool ProcessMessages(CNode* pfrom)
         try
         {
 /* MCHN START */            
-            if(pfrom->fDisconnect || !MultichainNode_DisconnectRemote(pfrom))
+            if(!pfrom->DecompressMessage(strCommand, vRecv))
+            {
+                pfrom->fDisconnect=true;
+            }
+            else if(pfrom->fDisconnect || !MultichainNode_DisconnectRemote(pfrom))
             {
 /* MCHN END */            
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
@@ -7790,14 +8567,32 @@ bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &hashBlock)
 bool CBlockUndo::ReadFromDisk(const CDiskBlockPos &pos, const uint256 &hashBlock)
 {
     // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+/* MCHN START */
+    if(pos.nPos < sizeof(unsigned int))
+        return error("CBlockUndo::ReadFromDisk : invalid position");
+    CAutoFile filein(OpenUndoFile(CDiskBlockPos(pos.nFile, pos.nPos - sizeof(unsigned int)), true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("CBlockUndo::ReadFromDisk : OpenBlockFile failed");
 
+    unsigned int nSize;                                                         // Size from index header tells whether MultiChain section is present
+    try {
+        filein >> nSize;
+    }
+    catch (std::exception &e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+/* MCHN END */
+
     // Read block
     uint256 hashChecksum;
     try {
         filein >> *this;
+/* MCHN START */
+        if(nSize > ::GetSerializeSize(vtxundo, SER_DISK, CLIENT_VERSION))
+        {
+            filein >> mcundo;
+        }
+/* MCHN END */
         filein >> hashChecksum;
     }
     catch (std::exception &e) {
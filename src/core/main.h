@@ -55,6 +55,8 @@ struct CNodeStateStats;
 /** Default for -blockmaxsize and -blockminsize, which control the range of sizes the mining code will create **/
 extern unsigned int DEFAULT_BLOCK_MAX_SIZE;                                     // MCHN global
 static const unsigned int DEFAULT_BLOCK_MIN_SIZE = 0;
+/** Default for -admissionclassreserve, percents of block size reserved for pending txs of admission classes **/
+static const char DEFAULT_ADMISSION_CLASS_RESERVE[] = "admin:5";
 /** Default for -blockprioritysize, maximum space for zero/low-fee transactions **/
 // static const unsigned int DEFAULT_BLOCK_PRIORITY_SIZE = 50000;
 /** The maximum size for transactions we're willing to relay/mine */
@@ -95,6 +97,8 @@ static const unsigned int LOCKTIME_THRESHOLD = 500000000; // Tue Nov  5 00:53:20
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Default for -parallelprecheckmininputs, smaller blocks run MultiChain input prechecks serially **/
+static const int DEFAULT_PARALLEL_PRECHECK_MIN_INPUTS = 500;                    // MCHN
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -109,6 +113,8 @@ static const unsigned int MAX_HEADERS_RESULTS = 2000;
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 /** Time to wait (in seconds) between writing blockchain state to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 3600;
+/** Default for -persistmempool, whether memory pool is saved at shutdown and reloaded at startup */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 
@@ -161,6 +167,37 @@ static const uint64_t nMinDiskSpace = 52428800;
 #define MC_AMT_NO_ACCEPT                                   0x00000001
 #define MC_AMT_NO_FILTERS                                  0x00000002
 
+/** 
+ * Context-free part of MultiChain input checks - depends only on tx and scriptPubKeys it spends.
+ * Filled on script check threads in ConnectBlock, consumed by serial AcceptMultiChainTransaction
+ */
+struct CMultiChainInputPrecheck
+{
+    bool fDone;                                                                 // Precheck was performed
+    int nFailedInput;                                                           // First input failing the precheck, -1 if none
+    std::string reason;                                                         // Rejection reason for nFailedInput
+    bool fScriptHashAllFound;                                                   // Input script with SIGHASH_ALL found
+    bool fRejectIfOpDropOpReturn;                                               // Tx should be rejected of OP_DROP+OP_RETURN script is found
+    std::vector<CScript> vPrevScripts;                                          // Spent scriptPubKeys, verified against UTXO view before use
+    std::vector<txnouttype> vInputScriptTypes;                                  // Input script types
+    std::vector<uint160> vInputDestinations;                                    // Addresses used in input scripts
+    std::vector<int> vInputHashTypes;                                           // Input hash types
+    std::vector< std::vector<CTxDestination> > vInputAddresses;                 // All addresses of spent scriptPubKeys
+    
+    CMultiChainInputPrecheck()
+    {
+        fDone=false;
+        nFailedInput=-1;
+        fScriptHashAllFound=false;
+        fRejectIfOpDropOpReturn=false;
+    }
+};
+
+bool MultiChainTransaction_PrecheckInputs(const CTransaction& tx,CMultiChainInputPrecheck *precheck);
+/** Fills spent scriptPubKeys of prechecks from view and earlier transactions in vtx, returns number of inputs found **/
+int CollectMultiChainInputs(const std::vector<CTransaction>& vtx, CCoinsViewCache& view, std::vector<CMultiChainInputPrecheck>& vPrechecks);
+/** Runs prechecks with filled scriptPubKeys, on script check threads if fParallel **/
+void RunMultiChainInputPrechecks(const std::vector<CTransaction>& vtx, std::vector<CMultiChainInputPrecheck>& vPrechecks, bool fParallel);
 
 bool AcceptMultiChainTransaction(const CTransaction& tx, 
                                  const CCoinsViewCache &inputs,
@@ -168,7 +205,33 @@ bool AcceptMultiChainTransaction(const CTransaction& tx,
                                  uint32_t flags,
                                  std::string& reason,
                                  int64_t *mandatory_fee_out,     
-                                 uint32_t *replay);
+                                 uint32_t *replay,
+                                 const CMultiChainInputPrecheck *precheck = NULL);
+
+/** Returns MC_TAC_ constant, see chain/txmempool.h, optionally whether tx changes entity/permission state */
+int MultiChainTransaction_AdmissionClass(const CTransaction& tx,bool *changes_state = NULL);
+
+/** Compact block filter index statistics, see structs/blockfilter.h */
+struct CBlockFilterStats
+{
+    int64_t nBuilt;                                                             // Filters built when connecting blocks
+    int64_t nElements;                                                          // Total number of distinct elements in built filters
+    int64_t nBytes;                                                             // Total size of built filters
+    int64_t nBuildMicros;                                                       // Total time of element extraction, encoding and writing
+    int64_t nServedFilters;                                                     // cfilter messages sent
+    int64_t nServedHeaders;                                                     // cfheaders messages sent
+};
+
+extern bool fBlockFilterIndex;
+extern bool fMultiChainBlockUndo;
+extern CBlockFilterStats blockFilterStats;
+
+void GetBlockFilterElements(const CBlock& block,std::vector<std::vector<unsigned char> >& vElements);
+
+/** Measures containers which are not accounted on allocation (coins cache, mempool, relay map), see mc_MemSetLive */
+void SampleMemoryUsage();
+/** Logs live and peak memory of accounted subsystems, run periodically if -memorydumpinterval is set */
+void DumpMemoryUsage();
 
 std::string MultichainServerAddress(bool check_external_ip);
 void ClearMemPools();
@@ -226,6 +289,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the MultiChain input precheck thread */
+void ThreadMultiChainCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core */
@@ -251,6 +316,13 @@ void FlushStateToDisk();
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                         bool* pfMissingInputs, bool fRejectInsaneFee=false, CWalletTx *wtx=NULL);
+/** Add topologically ordered batch of transactions to memory pool under single cs_main lock, returns number of accepted transactions **/
+int AcceptToMemoryPoolMany(CTxMemPool& pool, std::vector<CValidationState>& vstate, const std::vector<CTransaction>& vtx, bool fLimitFree,
+                        std::vector<bool>& vAccepted, bool fRejectInsaneFee=false, std::vector<CWalletTx*> *vwtx=NULL);
+/** Write memory pool transactions in arrival order to mempool.dat, together with known-valid signatures **/
+bool DumpMempool();
+/** Reload memory pool saved by DumpMempool, signatures found in the snapshot are not verified again if it was written by this node **/
+bool LoadMempool();
 
 
 struct CNodeStateStats {
@@ -346,16 +418,52 @@ bool IsStandardTx(const CTransaction& tx, std::string& reason);
 bool IsFinalTx(const CTransaction &tx, int nBlockHeight = 0, int64_t nBlockTime = 0);
 
 /** Undo information for a CBlock */
+/* MCHN START */
+/** 
+ * Permission and entity DB values overwritten by the block (serialized mc_BlockUndo records).
+ * Stored after vtxundo, records written by earlier versions end with vtxundo.
+ */
+class CMultiChainBlockUndo
+{
+public:
+    int nVersion;
+    std::vector<unsigned char> vPermissions;
+    std::vector<unsigned char> vEntities;
+
+    CMultiChainBlockUndo() : nVersion(1) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(this->nVersion);
+        READWRITE(vPermissions);
+        READWRITE(vEntities);
+    }
+
+    bool IsNull() const { return vPermissions.empty() && vEntities.empty(); }
+};
+/* MCHN END */
+
 class CBlockUndo
 {
 public:
     std::vector<CTxUndo> vtxundo; // for all but the coinbase
+/* MCHN START */
+    CMultiChainBlockUndo mcundo;                                                // Empty if not written, ReadFromDisk reads it only if present in the record
+/* MCHN END */
 
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(vtxundo);
+/* MCHN START */
+        if(!ser_action.ForRead() && !mcundo.IsNull())
+        {
+            READWRITE(mcundo);
+        }
+/* MCHN END */
     }
 
     bool WriteToDisk(CDiskBlockPos &pos, const uint256 &hashBlock);
@@ -379,8 +487,8 @@ private:
 
 public:
     CScriptCheck(): ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
-    CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) :
-        scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey),
+    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) :
+        scriptPubKey(outIn.scriptPubKey),
         ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
 
     bool operator()();
@@ -397,6 +505,31 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/* MCHN START */
+/** 
+ * Closure representing MultiChain input precheck of one transaction. 
+ * Never fails the queue - result, including rejection reason, is stored in precheck object and reported by serial checks in tx order
+ */
+class CMultiChainInputCheck
+{
+private:
+    const CTransaction *ptxTo;
+    CMultiChainInputPrecheck *pPrecheck;
+
+public:
+    CMultiChainInputCheck(): ptxTo(0), pPrecheck(0) {}
+    CMultiChainInputCheck(const CTransaction& txToIn, CMultiChainInputPrecheck *pPrecheckIn) :
+        ptxTo(&txToIn), pPrecheck(pPrecheckIn) { }
+
+    bool operator()();
+
+    void swap(CMultiChainInputCheck &check) {
+        std::swap(ptxTo, check.ptxTo);
+        std::swap(pPrecheck, check.pPrecheck);
+    }
+};
+/* MCHN END */
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos);
@@ -410,7 +543,7 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
  *  In case pfClean is provided, operation will try to be tolerant about errors, and *pfClean
  *  will be true if no problems were found. Otherwise, the return value will be false in case
  *  of problems. Note that in any case, coins may be modified. */
-bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL);
+bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL, CMultiChainBlockUndo* pmcundo = NULL);
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool fJustCheck = false);
@@ -296,6 +296,203 @@ int mc_EntityLedger::SetZeroRow(mc_EntityLedgerRow* row)
 }
 
 
+/** Entity details cache */
+
+#define MC_ENT_CACHE_DETAILS_SIZE (sizeof(mc_EntityDetails)-MC_ENT_SCRIPT_ALLOC_SIZE+MC_ENT_CACHE_MAX_SCRIPT_SIZE)
+
+void mc_EntityDetailsCache::Zero()
+{
+    m_Slots=NULL;
+    m_Data=NULL;
+    m_Hits=0;
+    m_Misses=0;
+    m_Invalidations=0;
+}
+
+int mc_EntityDetailsCache::Destroy()
+{
+    if(m_Slots)
+    {
+        delete [] m_Slots;
+    }
+    if(m_Data)
+    {
+        mc_Delete(m_Data);
+    }
+    Zero();
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_EntityDetailsCache::Initialize()
+{
+    int i;
+    
+    m_Data=(unsigned char*)mc_New(MC_ENT_CACHE_SLOTS*MC_ENT_CACHE_DETAILS_SIZE);
+    if(m_Data == NULL)
+    {
+        return MC_ERR_ALLOCATION;
+    }
+    
+    m_Slots=new mc_EntityCacheSlot[MC_ENT_CACHE_SLOTS];
+    
+    for(i=0;i<MC_ENT_CACHE_SLOTS;i++)
+    {
+        m_Slots[i].m_Sequence=0;
+        memset(m_Slots[i].m_Key,0,MC_ENT_KEY_SIZE);
+        m_Slots[i].m_KeyType=0;
+        memset(m_Slots[i].m_TxID,0,MC_ENT_KEY_SIZE);
+        m_Slots[i].m_ProtocolVersion=0;
+        m_Slots[i].m_Size=0;
+        m_Slots[i].m_Details=m_Data+i*MC_ENT_CACHE_DETAILS_SIZE;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+mc_EntityCacheSlot *mc_EntityDetailsCache::GetSlot(const unsigned char *key,uint32_t key_type)
+{
+    uint32_t hash=2166136261u;
+    int i;
+    
+    for(i=0;i<MC_ENT_KEY_SIZE;i++)
+    {
+        hash=(hash ^ key[i]) * 16777619u;
+    }
+    hash=(hash ^ key_type) * 16777619u;
+    
+    return m_Slots+(hash % MC_ENT_CACHE_SLOTS);
+}
+
+int mc_EntityDetailsCache::Get(mc_EntityDetails *entity,const unsigned char *key,uint32_t key_type,int protocol_version)
+{
+    mc_EntityCacheSlot *slot;
+    uint32_t seq,size;
+    
+    if(m_Slots == NULL)
+    {
+        return 0;
+    }
+    
+    slot=GetSlot(key,key_type);
+    seq=slot->m_Sequence.load(std::memory_order_acquire);
+    
+    if( (seq & 1) || (slot->m_KeyType != key_type) || (slot->m_ProtocolVersion != protocol_version) || 
+        (memcmp(slot->m_Key,key,MC_ENT_KEY_SIZE) != 0) )
+    {
+        m_Misses++;
+        return 0;
+    }
+    
+    size=slot->m_Size;
+    if(size > MC_ENT_CACHE_DETAILS_SIZE)
+    {
+        m_Misses++;
+        return 0;        
+    }
+    
+    memcpy(entity,slot->m_Details,size);
+    
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot->m_Sequence.load(std::memory_order_relaxed) != seq)                  // Slot was overwritten while copying
+    {
+        m_Misses++;
+        return 0;                
+    }
+    
+    memset((unsigned char*)entity+size,0,sizeof(mc_EntityDetails)-size);
+    
+    m_Hits++;
+    return 1;
+}
+
+void mc_EntityDetailsCache::Put(mc_EntityDetails *entity,const unsigned char *key,uint32_t key_type,int protocol_version)
+{
+    mc_EntityCacheSlot *slot;
+    uint32_t seq;
+    
+    if(m_Slots == NULL)
+    {
+        return;
+    }
+    
+    if( (entity->m_LedgerRow.m_ScriptSize > MC_ENT_CACHE_MAX_SCRIPT_SIZE) ||
+        (entity->m_LedgerRow.m_ExtendedScript != 0) )                           // Extended script is not stored in details object
+    {
+        return;
+    }
+    
+    slot=GetSlot(key,key_type);
+    
+    seq=slot->m_Sequence.load(std::memory_order_relaxed);
+    slot->m_Sequence.store(seq+1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    memcpy(slot->m_Key,key,MC_ENT_KEY_SIZE);
+    slot->m_KeyType=key_type;
+    memcpy(slot->m_TxID,entity->GetTxID(),MC_ENT_KEY_SIZE);
+    slot->m_ProtocolVersion=protocol_version;
+    slot->m_Size=sizeof(mc_EntityDetails)-MC_ENT_SCRIPT_ALLOC_SIZE+entity->m_LedgerRow.m_ScriptSize;
+    memcpy(slot->m_Details,entity,slot->m_Size);
+    
+    slot->m_Sequence.store(seq+2,std::memory_order_release);
+}
+
+void mc_EntityDetailsCache::ClearSlot(mc_EntityCacheSlot *slot)
+{
+    uint32_t seq;
+    
+    seq=slot->m_Sequence.load(std::memory_order_relaxed);
+    slot->m_Sequence.store(seq+1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    slot->m_KeyType=0;
+    slot->m_Size=0;
+    
+    slot->m_Sequence.store(seq+2,std::memory_order_release);    
+}
+
+void mc_EntityDetailsCache::Invalidate(const unsigned char *txid)
+{
+    int i;
+    
+    if(m_Slots == NULL)
+    {
+        return;
+    }
+    
+    for(i=0;i<MC_ENT_CACHE_SLOTS;i++)
+    {
+        if(m_Slots[i].m_KeyType)
+        {
+            if(memcmp(m_Slots[i].m_TxID,txid,MC_ENT_KEY_SIZE) == 0)
+            {
+                ClearSlot(m_Slots+i);
+                m_Invalidations++;
+            }
+        }
+    }
+}
+
+void mc_EntityDetailsCache::Clear()
+{
+    int i;
+    
+    if(m_Slots == NULL)
+    {
+        return;
+    }
+    
+    for(i=0;i<MC_ENT_CACHE_SLOTS;i++)
+    {
+        if(m_Slots[i].m_KeyType)
+        {
+            ClearSlot(m_Slots+i);
+            m_Invalidations++;
+        }
+    }
+}
+
 int mc_AssetDB::Zero()
 {
     m_Database = NULL;
@@ -303,6 +500,7 @@ int mc_AssetDB::Zero()
     m_MemPool = NULL;
     m_TmpRelevantEntities = NULL;
     m_ShortTxIDCache = NULL;
+    m_DetailsCache = NULL;
     m_ExtendedScripts=NULL;
     m_RowExtendedScript=NULL;
     
@@ -317,6 +515,7 @@ int mc_AssetDB::Zero()
     m_LockedBy=0;
     
     m_ThreadRollBackPos=NULL;
+    m_BlockUndo=NULL;
     
     return MC_ERR_NOERROR;
 }
@@ -379,6 +578,7 @@ int mc_AssetDB::Initialize(const char *name,int mode)
 #ifndef MAC_OSX
         adbRow.m_Flags|=MC_ENT_FLAG_ENTITYLIST;
 #endif        
+        adbRow.m_Flags|=MC_ENT_FLAG_CHAIN_INDEX;
         err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,0);
         if(err)
         {
@@ -395,13 +595,23 @@ int mc_AssetDB::Initialize(const char *name,int mode)
     
     m_MemPool=new mc_Buffer;    
     err=m_MemPool->Initialize(m_Ledger->m_KeySize,m_Ledger->m_MemPoolSize,MC_BUF_MODE_MAP);
+    m_MemPool->SetMemTag(MC_MEM_TAG_ASSETS);
 //SMPS    err=m_MemPool->Initialize(m_Ledger->m_KeySize,sizeof(mc_EntityLedgerRow),MC_BUF_MODE_MAP);
     
     m_TmpRelevantEntities=new mc_Buffer;
     err=m_TmpRelevantEntities->Initialize(MC_AST_SHORT_TXID_SIZE,MC_AST_SHORT_TXID_SIZE,MC_BUF_MODE_MAP);
+    m_TmpRelevantEntities->SetMemTag(MC_MEM_TAG_ASSETS);
     
     m_ShortTxIDCache=new mc_Buffer;    
     err=m_ShortTxIDCache->Initialize(MC_AST_SHORT_TXID_SIZE,MC_AST_SHORT_TXID_SIZE+MC_PLS_SIZE_ENTITY,MC_BUF_MODE_MAP);
+    m_ShortTxIDCache->SetMemTag(MC_MEM_TAG_ASSETS);
+    
+    m_DetailsCache=new mc_EntityDetailsCache;
+    if(m_DetailsCache->Initialize())
+    {
+        delete m_DetailsCache;
+        m_DetailsCache=NULL;
+    }
     
     m_ExtendedScripts=new mc_Script;
     m_RowExtendedScript=new mc_Script;
@@ -489,6 +699,15 @@ int mc_AssetDB::Initialize(const char *name,int mode)
         return MC_ERR_CORRUPTED;
     }
     
+    if(UseChainIndex() == 0)                                                    // Created by earlier version or disabled after inconsistency
+    {
+        err=BuildChainIndex();
+        if(err)
+        {
+            return err;
+        }
+    }
+    
     m_Semaphore=__US_SemCreate();
     if(m_Semaphore == NULL)
     {
@@ -504,10 +723,37 @@ int mc_AssetDB::Initialize(const char *name,int mode)
         mc_RollBackPos *rollback_pos=(mc_RollBackPos*)(m_ThreadRollBackPos->GetRow(mprow)+sizeof(uint64_t));    
         rollback_pos->Zero();
     }
+    
+    m_BlockUndo=new mc_BlockUndo;
+    m_BlockUndo->Initialize(m_Database->m_KeySize,m_Database->m_ValueSize,MC_MEM_TAG_ASSETS);
 
     return MC_ERR_NOERROR;
 }
 
+int mc_AssetDB::UseDetailsCache()
+{
+    if(m_DetailsCache == NULL)
+    {
+        return 0;
+    }
+    
+    if(m_TmpRelevantEntities->GetCount())                                       // Filter dependencies are collected
+    {
+        return 0;
+    }
+    
+    mc_RollBackPos *rollback_pos=GetRollBackPos();
+    if(rollback_pos)
+    {
+        if(rollback_pos->InBlock())                                             // Filter sees the chain as of earlier position
+        {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
 mc_RollBackPos *mc_AssetDB::GetRollBackPos()
 {
     uint64_t thread_id=__US_ThreadID();
@@ -570,6 +816,11 @@ int mc_AssetDB::Destroy()
         delete m_ShortTxIDCache;
     }  
     
+    if(m_DetailsCache)
+    {
+        delete m_DetailsCache;
+    }  
+    
     if(m_ExtendedScripts)
     {
         delete m_ExtendedScripts;
@@ -586,6 +837,11 @@ int mc_AssetDB::Destroy()
         m_ThreadRollBackPos=NULL;
     }
     
+    if(m_BlockUndo)
+    {
+        delete m_BlockUndo;
+    }
+    
     Zero();
     
     return MC_ERR_NOERROR;
@@ -1757,8 +2013,10 @@ int mc_AssetDB::Commit()
     mc_EntityLedgerRow aldGenesisRow;
     mc_EntityDetails details;
     unsigned char *ptr;
+    std::map<int64_t,mc_EntityDBRow> chains;
 
     err=MC_ERR_NOERROR;    
+    m_BlockUndo->Reset(m_Block,m_PrevPos,m_Pos);
     
     if(m_Ledger->Open() <= 0)
     {
@@ -1826,6 +2084,13 @@ int mc_AssetDB::Commit()
                                 err=MC_ERR_INTERNAL_ERROR;                                            
                                 goto exitlbl;
                             }
+                            if(UseChainIndex() && (aldRow.m_KeyType & MC_ENT_KEYTYPE_FOLLOW_ON))
+                            {
+                                if(AddToChainIndex(chains,&aldRow,m_PrevPos))
+                                {
+                                    m_Flags &= ~MC_ENT_FLAG_CHAIN_INDEX;        // Index is rebuilt on next start
+                                }
+                            }
                         }                    
                     }
                 }
@@ -1840,13 +2105,16 @@ int mc_AssetDB::Commit()
                     adbRow.m_LedgerPos=m_Pos;
                     adbRow.m_ChainPos=m_Pos;
 
-                    err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    err=WriteCommitRow(&adbRow);
                     
                     if(err == MC_ERR_NOERROR)
                     {
                         if(aldGenesisRow.m_KeyType)
                         {
+                            if(m_DetailsCache)
+                            {
+                                m_DetailsCache->Invalidate(aldGenesisRow.m_Key);
+                            }
                             details.Set(&aldGenesisRow);
                             adbRow.Zero();
                             memcpy(adbRow.m_Key,aldGenesisRow.m_Key,MC_ENT_KEY_SIZE);
@@ -1856,30 +2124,26 @@ int mc_AssetDB::Commit()
                             adbRow.m_LedgerPos=aldGenesisRow.m_FirstPos;
                             adbRow.m_ChainPos=m_Pos;
 
-                            err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                            err=WriteCommitRow(&adbRow);
                             
                             memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                             memcpy(adbRow.m_Key,details.m_LedgerRow.m_Key+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
                             adbRow.m_KeyType=MC_ENT_KEYTYPE_SHORT_TXID;
-                            err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                            (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                            err=WriteCommitRow(&adbRow);
                             
                             if(details.m_Flags & MC_ENT_FLAG_OFFSET_IS_SET)
                             {
                                 memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                                 memcpy(adbRow.m_Key,details.m_Ref,MC_ENT_REF_SIZE);
                                 adbRow.m_KeyType=MC_ENT_KEYTYPE_REF;                                    
-                                err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                                err=WriteCommitRow(&adbRow);
                             }
                             if(details.m_Flags & MC_ENT_FLAG_NAME_IS_SET)
                             {
                                 memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                                 memcpy(adbRow.m_Key,details.m_Name,MC_ENT_MAX_NAME_SIZE);
                                 adbRow.m_KeyType=MC_ENT_KEYTYPE_NAME;                                    
-                                err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                                err=WriteCommitRow(&adbRow);
                             }
                         }
                     }
@@ -1913,6 +2177,7 @@ int mc_AssetDB::Commit()
         
         adbRow.m_Block=m_Block+1;
         adbRow.m_LedgerPos=m_PrevPos;
+        adbRow.m_Flags=(adbRow.m_Flags & ~MC_ENT_FLAG_CHAIN_INDEX) | (m_Flags & MC_ENT_FLAG_CHAIN_INDEX);
         err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
                         (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
     }        
@@ -1933,6 +2198,11 @@ int mc_AssetDB::Commit()
     
 exitlbl:
     
+    if(err)
+    {
+        m_BlockUndo->Reset(-1,0,0);
+    }
+    
     UnLock();
     return err;
 }
@@ -1961,12 +2231,18 @@ int mc_AssetDB::RollBackInternal(int block)
     mc_EntityLedgerRow aldRow;
     mc_EntityDetails details;
     unsigned char *ptr;
+    std::map<int64_t,mc_EntityDBRow> chains;
     
     err=MC_ERR_NOERROR;
     
 
     ClearMemPoolInternal();
     
+    if(m_DetailsCache)
+    {
+        m_DetailsCache->Clear();
+    }
+    
     if(m_Ledger->Open() <= 0)
     {
         return MC_ERR_DBOPEN_ERROR;
@@ -2015,6 +2291,13 @@ int mc_AssetDB::RollBackInternal(int block)
             
             if(err == MC_ERR_NOERROR)
             {
+                if(UseChainIndex() && (aldRow.m_KeyType & MC_ENT_KEYTYPE_FOLLOW_ON))
+                {
+                    if(RemoveFromChainIndex(chains,&aldRow,this_pos))
+                    {
+                        m_Flags &= ~MC_ENT_FLAG_CHAIN_INDEX;                    // Index is rebuilt on next start
+                    }
+                }
                 if( aldRow.m_KeyType  & MC_ENT_KEYTYPE_FOLLOW_ON )
                 {
                     new_chain_pos=aldRow.m_LastPos;
@@ -2093,6 +2376,7 @@ int mc_AssetDB::RollBackInternal(int block)
             
         adbRow.m_Block=block;
         adbRow.m_LedgerPos=m_PrevPos;
+        adbRow.m_Flags=(adbRow.m_Flags & ~MC_ENT_FLAG_CHAIN_INDEX) | (m_Flags & MC_ENT_FLAG_CHAIN_INDEX);
         if(block<0)
         {
 #ifndef MAC_OSX
@@ -2129,103 +2413,277 @@ int mc_AssetDB::RollBackInternal(int block)
     return err;   
 }
 
-int mc_AssetDB::ClearMemPool()
-{
-    Lock(1);
-    
-    int err=ClearMemPoolInternal();
-    
-    UnLock();
-    return err;        
-}
+/** Writes DB row in block commit, previous value is recorded in block undo. Chain index rebuild doesn't record it */
 
-int mc_AssetDB::ClearMemPoolInternal()
+int mc_AssetDB::WriteCommitRow(mc_EntityDBRow *row)
 {
-    mc_EntityLedgerRow aldRow;
+    int err,value_len;
+    unsigned char *ptr;
     
-    if(m_MemPool)
+    if(m_BlockUndo && (m_BlockUndo->m_Header.m_Block == m_Block))
     {
-        if(m_MemPool->GetCount())
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(err)
         {
-            m_MemPool->Clear();
-            if(m_Ledger->Open() <= 0)
-            {
-                return MC_ERR_DBOPEN_ERROR;
-            }
-        
-            if(m_Ledger->GetRow(0,&aldRow))
-            {
-                return MC_ERR_CORRUPTED;        
-            }
-    
-            m_PrevPos=aldRow.m_PrevPos;
-            if(m_Ledger->GetRow(m_PrevPos,&aldRow))
-            {
-                return MC_ERR_CORRUPTED;        
-            }
-            
-            m_Pos=m_PrevPos+mc_AllocSize(m_Ledger->m_TotalSize+aldRow.m_ScriptSize+aldRow.m_ExtendedScript,m_Ledger->m_TotalSize,1);            
-            
-            m_Ledger->Close();
+            return err;
+        }
+        err=m_BlockUndo->Record((char*)row+m_Database->m_KeyOffset,ptr);
+        if(err)
+        {
+            return err;
         }
     }
     
-    if(m_ExtendedScripts)
-    {
-        m_ExtendedScripts->Clear();
-        m_ExtendedScripts->AddElement();
-    }
-    
-    return MC_ERR_NOERROR;
+    return m_Database->m_DB->Write((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                   (char*)row+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
 }
 
+/** Returns undo record of the last committed block, block in the header is -1 if commit failed */
 
-int mc_AssetDB::FindEntityByTxID(mc_EntityDetails *entity,const unsigned char* txid)
+mc_BlockUndo *mc_AssetDB::GetBlockUndo()
 {
-    mc_EntityLedgerRow aldRow;
+    return m_BlockUndo;
+}
 
-    Lock(0);
-    int res=0;
+/** 
+ * Disconnects the last block by restoring DB values recorded by its commit, without walking the ledger.
+ * Returns error without changing the state if the record doesn't match the last block, caller should use RollBack.
+ */
+
+int mc_AssetDB::ApplyBlockUndo(int block,const unsigned char *lpUndo,int size)
+{
+    int i,err,found,value_len;
+    mc_BlockUndo undo;
+    mc_EntityDBRow adbRow;
+    mc_EntityLedgerRow aldRow;
+    unsigned char *ptr;
+    unsigned char *lpKey;
+    unsigned char *lpValue;
     
-    entity->Zero();
-    aldRow.Zero();
+    Lock(1);
     
-    memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
-    aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
-
-    if(GetEntity(&aldRow))            
+    err=undo.Initialize(m_Database->m_KeySize,m_Database->m_ValueSize,MC_MEM_TAG_ASSETS);
+    if(err == MC_ERR_NOERROR)
     {
-        entity->Set(&aldRow);
-        if(m_TmpRelevantEntities->GetCount())
+        err=undo.Load(lpUndo,size);
+    }
+    if(err == MC_ERR_NOERROR)
+    {
+        if( (undo.m_Header.m_Block != block) || (m_Block != block+1) || 
+            (undo.m_Header.m_Row < 0) || (undo.m_Header.m_Row > m_PrevPos) || (undo.m_Header.m_Pos > m_Pos) )
         {
-            m_TmpRelevantEntities->Add(entity->GetTxID()+MC_AST_SHORT_TXID_OFFSET);
+            err=MC_ERR_NOT_ALLOWED;
         }
-        res=1;
-        goto exitlbl;
-    }            
-
-    aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID | MC_ENT_KEYTYPE_FOLLOW_ON;
-
-    if(GetEntity(&aldRow))            
+    }
+    if(err)
     {
-        entity->Set(&aldRow);
-        res=1;
-        goto exitlbl;
-    }            
+        UnLock();
+        return err;
+    }
     
+    ClearMemPoolInternal();
     
-exitlbl:
-            
-    UnLock();
-    return res;        
-}
-
+    if(m_DetailsCache)
+    {
+        m_DetailsCache->Clear();
+    }
+    
+    if(m_Ledger->Open() <= 0)
+    {
+        UnLock();
+        return MC_ERR_DBOPEN_ERROR;
+    }
+    
+    for(i=0;i<undo.m_Rows->GetCount();i++)
+    {
+        if(err == MC_ERR_NOERROR)
+        {
+            found=undo.GetRow(i,&lpKey,&lpValue);
+            if(found)
+            {
+                err=m_Database->m_DB->Write((char*)lpKey,m_Database->m_KeySize,(char*)lpValue,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            }
+            else
+            {
+                err=m_Database->m_DB->Delete((char*)lpKey,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            }
+        }
+    }
+    
+    if(err == MC_ERR_NOERROR)                                                   // Same as in RollBackInternal
+    {
+        adbRow.Zero();
+        
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(ptr)
+        {
+            memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+        }
+            
+        adbRow.m_Block=block;
+        adbRow.m_LedgerPos=undo.m_Header.m_Row;
+        adbRow.m_Flags=(adbRow.m_Flags & ~MC_ENT_FLAG_CHAIN_INDEX) | (m_Flags & MC_ENT_FLAG_CHAIN_INDEX);
+        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+    }        
+    
+    if(err == MC_ERR_NOERROR)
+    {
+        err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }    
+    
+    if(err == MC_ERR_NOERROR)
+    {
+        m_Ledger->GetRow(0,&aldRow);
+        aldRow.m_Block=block;
+        aldRow.m_PrevPos=undo.m_Header.m_Row;
+        m_Ledger->SetZeroRow(&aldRow);
+        
+        m_Block=block;
+        m_PrevPos=undo.m_Header.m_Row;
+        m_Pos=undo.m_Header.m_Pos;
+        m_BlockUndo->Reset(-1,0,0);
+    }
+    
+    m_Ledger->Close();
+    
+    if(err)
+    {
+        err=RollBackInternal(block);                                            // DB keys not committed yet, ledger walk restores them
+    }
+    
+    UnLock();
+    return err;
+}
+
+int mc_AssetDB::ClearMemPool()
+{
+    Lock(1);
+    
+    int err=ClearMemPoolInternal();
+    
+    UnLock();
+    return err;        
+}
+
+int mc_AssetDB::ClearMemPoolInternal()
+{
+    mc_EntityLedgerRow aldRow;
+    
+    if(m_MemPool)
+    {
+        if(m_MemPool->GetCount())
+        {
+            m_MemPool->Clear();
+            if(m_Ledger->Open() <= 0)
+            {
+                return MC_ERR_DBOPEN_ERROR;
+            }
+        
+            if(m_Ledger->GetRow(0,&aldRow))
+            {
+                return MC_ERR_CORRUPTED;        
+            }
+    
+            m_PrevPos=aldRow.m_PrevPos;
+            if(m_Ledger->GetRow(m_PrevPos,&aldRow))
+            {
+                return MC_ERR_CORRUPTED;        
+            }
+            
+            m_Pos=m_PrevPos+mc_AllocSize(m_Ledger->m_TotalSize+aldRow.m_ScriptSize+aldRow.m_ExtendedScript,m_Ledger->m_TotalSize,1);            
+            
+            m_Ledger->Close();
+        }
+    }
+    
+    if(m_ExtendedScripts)
+    {
+        m_ExtendedScripts->Clear();
+        m_ExtendedScripts->AddElement();
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+
+int mc_AssetDB::FindEntityByTxID(mc_EntityDetails *entity,const unsigned char* txid)
+{
+    mc_EntityLedgerRow aldRow;
+    int use_cache=UseDetailsCache();
+
+    if(use_cache)
+    {
+        if(m_DetailsCache->Get(entity,txid,MC_ENT_KEYTYPE_TXID,mc_gState->m_NetworkParams->ProtocolVersion()))
+        {
+            return 1;
+        }
+    }
+    
+    Lock(0);
+    int res=0;
+    
+    entity->Zero();
+    aldRow.Zero();
+    
+    memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
+    aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
+
+    if(GetEntity(&aldRow))            
+    {
+        entity->Set(&aldRow);
+        if(m_TmpRelevantEntities->GetCount())
+        {
+            m_TmpRelevantEntities->Add(entity->GetTxID()+MC_AST_SHORT_TXID_OFFSET);
+        }
+        if(use_cache && (aldRow.m_Block <= m_Block))                            // Only confirmed entities are cached
+        {
+            m_DetailsCache->Put(entity,txid,MC_ENT_KEYTYPE_TXID,mc_gState->m_NetworkParams->ProtocolVersion());
+        }
+        res=1;
+        goto exitlbl;
+    }            
+
+    aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID | MC_ENT_KEYTYPE_FOLLOW_ON;
+
+    if(GetEntity(&aldRow))            
+    {
+        entity->Set(&aldRow);
+        res=1;
+        goto exitlbl;
+    }            
+    
+    
+exitlbl:
+            
+    UnLock();
+    return res;        
+}
+
 int mc_AssetDB::FindEntityByShortTxID (mc_EntityDetails *entity, const unsigned char* short_txid)
 {
+    unsigned char key[MC_ENT_KEY_SIZE];
+    int use_cache=UseDetailsCache();
+    
+    if(use_cache)
+    {
+        memset(key,0,MC_ENT_KEY_SIZE);
+        memcpy(key,short_txid,MC_AST_SHORT_TXID_SIZE);
+        if(m_DetailsCache->Get(entity,key,MC_ENT_KEYTYPE_SHORT_TXID,mc_gState->m_NetworkParams->ProtocolVersion()))
+        {
+            return 1;
+        }
+    }
+    
     Lock(0);
     
     int res=FindEntityByShortTxIDInternal(entity,short_txid);
     
+    if(res && use_cache && (entity->m_LedgerRow.m_Block <= m_Block))
+    {
+        m_DetailsCache->Put(entity,key,MC_ENT_KEYTYPE_SHORT_TXID,mc_gState->m_NetworkParams->ProtocolVersion());
+    }
+    
     UnLock();
     return res;        
 }
@@ -2291,6 +2749,18 @@ exitlbl:
 int mc_AssetDB::FindEntityByRef (mc_EntityDetails *entity,const unsigned char* asset_ref)
 {
     mc_EntityLedgerRow aldRow;
+    unsigned char key[MC_ENT_KEY_SIZE];
+    int use_cache=UseDetailsCache();
+    
+    if(use_cache)
+    {
+        memset(key,0,MC_ENT_KEY_SIZE);
+        memcpy(key,asset_ref,MC_ENT_REF_SIZE);
+        if(m_DetailsCache->Get(entity,key,MC_ENT_KEYTYPE_REF,mc_gState->m_NetworkParams->ProtocolVersion()))
+        {
+            return 1;
+        }
+    }
 
     Lock(0);
     int res=0;
@@ -2308,6 +2778,10 @@ int mc_AssetDB::FindEntityByRef (mc_EntityDetails *entity,const unsigned char* a
         {
             m_TmpRelevantEntities->Add(entity->GetTxID()+MC_AST_SHORT_TXID_OFFSET);
         }
+        if(use_cache && (aldRow.m_Block <= m_Block))
+        {
+            m_DetailsCache->Put(entity,key,MC_ENT_KEYTYPE_REF,mc_gState->m_NetworkParams->ProtocolVersion());
+        }
         res=1;
         goto exitlbl;
     }            
@@ -2337,6 +2811,26 @@ int mc_AssetDB::FindEntityByFullRef (mc_EntityDetails *entity, unsigned char* fu
 int mc_AssetDB::FindEntityByName(mc_EntityDetails *entity,const char* name)
 {
     mc_EntityLedgerRow aldRow;
+    unsigned char key[MC_ENT_KEY_SIZE];
+    int use_cache=UseDetailsCache();
+    
+    if(use_cache)
+    {
+        if(strlen(name) > MC_ENT_MAX_NAME_SIZE)
+        {
+            use_cache=0;
+        }
+        else
+        {
+            memset(key,0,MC_ENT_KEY_SIZE);
+            memcpy(key,name,strlen(name));
+            mc_StringLowerCase((char*)key,MC_ENT_MAX_NAME_SIZE);
+            if(m_DetailsCache->Get(entity,key,MC_ENT_KEYTYPE_NAME,mc_gState->m_NetworkParams->ProtocolVersion()))
+            {
+                return 1;
+            }
+        }
+    }
 
     Lock(0);
     int res=0;
@@ -2355,6 +2849,10 @@ int mc_AssetDB::FindEntityByName(mc_EntityDetails *entity,const char* name)
         {
             m_TmpRelevantEntities->Add(entity->GetTxID()+MC_AST_SHORT_TXID_OFFSET);
         }
+        if(use_cache && (aldRow.m_Block <= m_Block))
+        {
+            m_DetailsCache->Put(entity,key,MC_ENT_KEYTYPE_NAME,mc_gState->m_NetworkParams->ProtocolVersion());
+        }
         res=1;
         goto exitlbl;
     }            
@@ -3173,6 +3671,311 @@ exitlbl:
     return result;
 }
 
+/** Chain index - dense per-chain array of confirmed follow-on positions and totals, stored in entity database */
+
+int mc_AssetDB::UseChainIndex()
+{
+    return (m_Flags & MC_ENT_FLAG_CHAIN_INDEX) ? 1 : 0;
+}
+
+void mc_AssetDB::SetChainIndexKey(mc_EntityDBRow *row,int64_t first_pos,int32_t index)
+{
+    int i;
+    
+    row->Zero();
+    for(i=0;i<8;i++)                                                            // Big-endian, elements of the chain are adjacent in the database
+    {
+        row->m_Key[i]=(unsigned char)((first_pos >> (56-8*i)) & 0xFF);
+    }
+    if(index >= 0)
+    {
+        for(i=0;i<4;i++)
+        {
+            row->m_Key[8+i]=(unsigned char)((index >> (24-8*i)) & 0xFF);
+        }
+        row->m_KeyType=MC_ENT_KEYTYPE_CHAIN_INDEX;
+    }
+    else
+    {
+        row->m_KeyType=MC_ENT_KEYTYPE_CHAIN_SIZE;        
+    }
+}
+
+int mc_AssetDB::GetChainIndexRow(mc_EntityDBRow *row,int64_t first_pos,int32_t index)
+{
+    int err,value_len;
+    unsigned char *ptr;
+    
+    SetChainIndexKey(row,first_pos,index);
+    
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    if(err || (ptr == NULL))
+    {
+        return 0;
+    }
+    
+    memcpy((char*)row+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+    return 1;
+}
+
+int64_t mc_AssetDB::GetChainIndexTotal(mc_EntityLedgerRow *row,int64_t prev_total)
+{
+    uint64_t value_offset;
+    size_t value_size;
+    
+    value_offset=mc_FindSpecialParamInDetailsScript(row->m_Script,row->m_ScriptSize,MC_ENT_SPRM_ASSET_TOTAL,&value_size);
+    if(value_offset < row->m_ScriptSize)
+    {
+        if( (value_size>0) && (value_size <= 8))
+        {
+            return mc_GetLE(row->m_Script+value_offset,value_size);             // Same rule as in GetTotalQuantity
+        }
+    }
+    
+    return prev_total+row->m_Quantity;
+}
+
+int mc_AssetDB::GetChainIndexLast(mc_EntityDBRow *row,int64_t first_pos)
+{
+    int err,value_len;
+    int64_t chain_pos;
+    int32_t size;
+    unsigned char *ptr;
+    mc_EntityDBRow adbRow;
+    mc_EntityLedgerRow aldRow;
+    
+    if(m_Ledger->GetRow(first_pos,&aldRow))
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    chain_pos=first_pos;
+    adbRow.Zero();
+    memcpy(adbRow.m_Key,aldRow.m_Key,MC_ENT_KEY_SIZE);
+    adbRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    if(ptr)                                                                     // Not found if genesis is committed in the same block
+    {
+        memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+        chain_pos=adbRow.m_ChainPos;
+    }
+    
+    if(GetChainIndexRow(&adbRow,first_pos,-1))
+    {
+        size=(int32_t)adbRow.m_LedgerPos;
+        if( (size < 2) || (GetChainIndexRow(row,first_pos,size-1) == 0) )
+        {
+            return MC_ERR_CORRUPTED;
+        }
+    }
+    else
+    {
+        SetChainIndexKey(row,first_pos,0);
+        row->m_Block=aldRow.m_Block;
+        row->m_LedgerPos=first_pos;
+        row->m_ChainPos=GetChainIndexTotal(&aldRow,0);
+        row->m_EntityType=aldRow.m_EntityType;
+    }
+    
+    if(row->m_LedgerPos != chain_pos)                                           // Chain was updated without updating the index
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_AssetDB::AddToChainIndex(std::map<int64_t,mc_EntityDBRow>& chains,mc_EntityLedgerRow *row,int64_t pos)
+{
+    int err;
+    int32_t index;
+    int64_t first_pos;
+    mc_EntityDBRow adbRow;
+    std::map<int64_t,mc_EntityDBRow>::iterator it;
+    
+    first_pos=row->m_FirstPos;
+    it=chains.find(first_pos);
+    if(it == chains.end())
+    {
+        err=GetChainIndexLast(&adbRow,first_pos);
+        if(err)
+        {
+            return err;
+        }
+        it=chains.insert(std::make_pair(first_pos,adbRow)).first;
+    }
+    
+    index=(int32_t)it->second.m_Flags+1;
+    SetChainIndexKey(&adbRow,first_pos,index);
+    adbRow.m_Block=row->m_Block;
+    adbRow.m_LedgerPos=pos;
+    adbRow.m_ChainPos=GetChainIndexTotal(row,it->second.m_ChainPos);
+    adbRow.m_EntityType=row->m_EntityType;
+    adbRow.m_Flags=index;
+    err=WriteCommitRow(&adbRow);
+    if(err)
+    {
+        return err;
+    }
+    it->second=adbRow;
+    
+    SetChainIndexKey(&adbRow,first_pos,-1);
+    adbRow.m_Block=row->m_Block;
+    adbRow.m_LedgerPos=index+1;
+    return WriteCommitRow(&adbRow);
+}
+
+int mc_AssetDB::RemoveFromChainIndex(std::map<int64_t,mc_EntityDBRow>& chains,mc_EntityLedgerRow *row,int64_t pos)
+{
+    int err;
+    int32_t index;
+    int64_t first_pos;
+    mc_EntityDBRow adbRow;
+    std::map<int64_t,mc_EntityDBRow>::iterator it;
+    
+    first_pos=row->m_FirstPos;
+    it=chains.find(first_pos);
+    if(it == chains.end())
+    {
+        err=GetChainIndexLast(&adbRow,first_pos);
+        if(err)
+        {
+            return err;
+        }
+        it=chains.insert(std::make_pair(first_pos,adbRow)).first;
+    }
+    
+    index=(int32_t)it->second.m_Flags;
+    if( (index == 0) || (it->second.m_LedgerPos != pos) )                       // Follow-ons are rolled back from the end of the chain
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    SetChainIndexKey(&adbRow,first_pos,index);
+    err=m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    if(err)
+    {
+        return err;
+    }
+    
+    if(index > 1)
+    {
+        if(GetChainIndexRow(&adbRow,first_pos,index-1) == 0)
+        {
+            return MC_ERR_CORRUPTED;
+        }
+        it->second=adbRow;
+        SetChainIndexKey(&adbRow,first_pos,-1);
+        adbRow.m_Block=it->second.m_Block;
+        adbRow.m_LedgerPos=index;
+        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                    (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    else
+    {
+        chains.erase(it);
+        SetChainIndexKey(&adbRow,first_pos,-1);
+        err=m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    
+    return err;
+}
+
+int mc_AssetDB::BuildChainIndex()
+{
+    int err,value_len,count;
+    int64_t pos;
+    unsigned char *ptr;
+    mc_EntityDBRow adbRow;
+    mc_EntityLedgerRow aldRow;
+    mc_EntityLedgerRow aldGenesisRow;
+    std::vector <int64_t> followons;
+    std::map<int64_t,mc_EntityDBRow> chains;
+    
+    err=MC_ERR_NOERROR;
+    
+    if(m_Ledger->Open() <= 0)
+    {
+        return MC_ERR_DBOPEN_ERROR;
+    }
+    
+    pos=m_PrevPos;
+    while(pos > 0)                                                              // Follow-on positions, ledger can only be walked backwards
+    {
+        if(m_Ledger->GetRow(pos,&aldRow))
+        {
+            err=MC_ERR_CORRUPTED;
+            goto exitlbl;
+        }
+        if( ((aldRow.m_KeyType & MC_ENT_KEYTYPE_MASK) == MC_ENT_KEYTYPE_TXID) && (aldRow.m_KeyType & MC_ENT_KEYTYPE_FOLLOW_ON) )
+        {
+            followons.push_back(pos);
+        }
+        pos=aldRow.m_PrevPos;
+    }
+    
+    count=0;
+    for(int i=(int)followons.size()-1;i>=0;i--)
+    {
+        m_Ledger->GetRow(followons[i],&aldRow);
+        if(chains.find(aldRow.m_FirstPos) == chains.end())                      // Existing index rows are overwritten, chain starts from genesis
+        {
+            if(m_Ledger->GetRow(aldRow.m_FirstPos,&aldGenesisRow))
+            {
+                err=MC_ERR_CORRUPTED;
+                goto exitlbl;
+            }
+            SetChainIndexKey(&adbRow,aldRow.m_FirstPos,0);
+            adbRow.m_Block=aldGenesisRow.m_Block;
+            adbRow.m_LedgerPos=aldRow.m_FirstPos;
+            adbRow.m_ChainPos=GetChainIndexTotal(&aldGenesisRow,0);
+            chains.insert(std::make_pair(aldRow.m_FirstPos,adbRow));
+        }
+        err=AddToChainIndex(chains,&aldRow,followons[i]);
+        if(err)
+        {
+            goto exitlbl;
+        }
+        count++;
+        if(count >= MC_ENT_CHAIN_INDEX_BATCH_SIZE)
+        {
+            err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            if(err)
+            {
+                goto exitlbl;
+            }
+            count=0;
+        }
+    }
+    
+    adbRow.Zero();
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    if(err)
+    {
+        goto exitlbl;
+    }
+    if(ptr)
+    {
+        memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+    }
+    adbRow.m_Flags |= MC_ENT_FLAG_CHAIN_INDEX;
+    err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    if(err == MC_ERR_NOERROR)
+    {
+        err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    if(err == MC_ERR_NOERROR)
+    {
+        m_Flags=adbRow.m_Flags;
+    }
+    
+exitlbl:
+    
+    m_Ledger->Close();
+    return err;
+}
+
 int64_t mc_AssetDB::GetTotalQuantity(mc_EntityDetails *entity)
 {
     Lock(0);
@@ -3300,6 +4103,31 @@ int64_t mc_AssetDB::GetChainPosition(mc_EntityLedgerRow *row,int32_t index)
     {
         m_Ledger->Open();
         
+        if(UseChainIndex())                                                     // Confirmed element, verified by its chain index parameter
+        {
+            mc_EntityDBRow adbRow;
+            if(GetChainIndexRow(&adbRow,first_pos,index))
+            {
+                if( (adbRow.m_LedgerPos <= row->m_ChainPos) &&                  // Not after the state the caller is looking at
+                    (m_Ledger->GetRow(adbRow.m_LedgerPos,&aldRow) == 0) && 
+                    (aldRow.m_FirstPos == first_pos) )                          // Same entity, index row may be stale
+                {
+                    value_offset=mc_FindSpecialParamInDetailsScript(aldRow.m_Script,aldRow.m_ScriptSize,MC_ENT_SPRM_CHAIN_INDEX,&value_size);
+                    if(value_offset < aldRow.m_ScriptSize)
+                    {
+                        if( (value_size>0) && (value_size <= 4))
+                        {
+                            if(mc_GetLE(aldRow.m_Script+value_offset,value_size) == index)
+                            {
+                                pos=adbRow.m_LedgerPos;
+                                take_it=0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        
         while(take_it)
         {
             m_Ledger->GetRow(pos,&aldRow);
@@ -3370,7 +4198,7 @@ int64_t mc_AssetDB::GetTotalQuantity(mc_EntityLedgerRow *row,int32_t *chain_size
 {
     mc_EntityLedgerRow aldRow;
     int64_t pos,first_pos;
-    int take_it,i;
+    int take_it,first_row,i;
     int64_t total;
     uint64_t value_offset;
     size_t value_size;
@@ -3422,6 +4250,7 @@ int64_t mc_AssetDB::GetTotalQuantity(mc_EntityLedgerRow *row,int32_t *chain_size
     }
         
     take_it=1;
+    first_row=1;
 
     if(first_pos >= 0)
     {
@@ -3457,6 +4286,23 @@ int64_t mc_AssetDB::GetTotalQuantity(mc_EntityLedgerRow *row,int32_t *chain_size
                 }                    
             }
 
+            if(take_it && first_row && (pos != first_pos) && UseChainIndex())  // Total of confirmed elements is stored in chain index
+            {
+                mc_EntityDBRow adbRow;
+                if(GetChainIndexRow(&adbRow,first_pos,-1))
+                {
+                    if(GetChainIndexRow(&adbRow,first_pos,(int32_t)adbRow.m_LedgerPos-1))
+                    {
+                        if(adbRow.m_LedgerPos == pos)
+                        {
+                            total+=adbRow.m_ChainPos;
+                            take_it=0;
+                        }
+                    }
+                }
+            }
+            first_row=0;
+            
             if(take_it)
             {
                 total+=aldRow.m_Quantity;
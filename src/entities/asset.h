@@ -7,6 +7,9 @@
 #include "utils/declare.h"
 #include "utils/dbwrapper.h"
 
+#include <atomic>
+#include <map>
+
 #define MC_AST_ASSET_REF_SIZE        10
 #define MC_AST_ASSET_BUF_TOTAL_SIZE  22
 #define MC_AST_SHORT_TXID_OFFSET     16
@@ -44,10 +47,15 @@
 #define MC_ENT_DEFAULT_MAX_ASSET_TOTAL 0x7FFFFFFFFFFFFFFF
 
 #define MC_ENT_KEY_SIZE              32
+
+#define MC_ENT_CACHE_SLOTS                           1024 // Number of slots in entity details cache
+#define MC_ENT_CACHE_MAX_SCRIPT_SIZE                 4096 // Entities with larger scripts are not cached
 #define MC_ENT_KEYTYPE_TXID           0x00000001
 #define MC_ENT_KEYTYPE_REF            0x00000002
 #define MC_ENT_KEYTYPE_NAME           0x00000003
 #define MC_ENT_KEYTYPE_SHORT_TXID     0x00000004
+#define MC_ENT_KEYTYPE_CHAIN_INDEX    0x00000005                                // Key - first position of the chain and element index, value - element position and chain total
+#define MC_ENT_KEYTYPE_CHAIN_SIZE     0x00000006                                // Key - first position of the chain, value - number of confirmed elements, absent if 1
 #define MC_ENT_KEYTYPE_MASK           0x000000FF
 #define MC_ENT_KEYTYPE_FOLLOW_ON      0x00000100
 #define MC_ENT_KEYTYPE_FOLLOW_MULTI   0x00000200
@@ -128,6 +136,9 @@
 #define MC_ENT_FLAG_NO_OFFSET_KEY     0x00000002
 #define MC_ENT_FLAG_NAME_IS_SET       0x00000010
 #define MC_ENT_FLAG_ENTITYLIST        0x00000100
+#define MC_ENT_FLAG_CHAIN_INDEX       0x00000200
+
+#define MC_ENT_CHAIN_INDEX_BATCH_SIZE       4096                                // Rows written in one transaction while chain index is built
 
 
 
@@ -299,6 +310,51 @@ typedef struct mc_EntityLedger
 } mc_EntityLedger;
 
 
+/** Entity details cache slot, protected by sequence counter - readers retry/miss if it changed while copying */
+
+typedef struct mc_EntityCacheSlot
+{
+    std::atomic<uint32_t> m_Sequence;                                           // Odd while slot is written
+    unsigned char m_Key[MC_ENT_KEY_SIZE];                                       // Lookup key - txid, short txid, ref or lowercase name
+    uint32_t m_KeyType;                                                         // Lookup key type - MC_ENT_KEYTYPE_ constants, 0 if slot is empty
+    unsigned char m_TxID[MC_ENT_KEY_SIZE];                                      // Entity genesis txid, for invalidation
+    int m_ProtocolVersion;                                                      // Protocol version details were resolved for
+    uint32_t m_Size;                                                            // Size of stored entity details
+    unsigned char *m_Details;                                                   // Entity details without unused script tail
+} mc_EntityCacheSlot;
+
+/** Read-mostly cache of resolved confirmed entity details, lookups don't take mc_AssetDB lock */
+
+typedef struct mc_EntityDetailsCache
+{
+    mc_EntityCacheSlot *m_Slots;
+    unsigned char *m_Data;
+    std::atomic<int64_t> m_Hits;
+    std::atomic<int64_t> m_Misses;
+    std::atomic<int64_t> m_Invalidations;
+    
+    mc_EntityDetailsCache()
+    {
+        Zero();
+    }
+    
+    ~mc_EntityDetailsCache()
+    {
+        Destroy();
+    }
+    
+    int Initialize();
+    int Get(mc_EntityDetails *entity,const unsigned char *key,uint32_t key_type,int protocol_version);
+    void Put(mc_EntityDetails *entity,const unsigned char *key,uint32_t key_type,int protocol_version);  // Writers are serialized by mc_AssetDB lock
+    void Invalidate(const unsigned char *txid);                                 // Removes all keys of the entity
+    void Clear();
+    
+    void Zero();
+    int Destroy();
+    mc_EntityCacheSlot *GetSlot(const unsigned char *key,uint32_t key_type);
+    void ClearSlot(mc_EntityCacheSlot *slot);
+} mc_EntityDetailsCache;
+
 typedef struct mc_AssetDB
 {    
     mc_EntityDB *m_Database;
@@ -307,6 +363,7 @@ typedef struct mc_AssetDB
     mc_Buffer   *m_MemPool;
     mc_Buffer   *m_TmpRelevantEntities;
     mc_Buffer   *m_ShortTxIDCache;
+    mc_EntityDetailsCache *m_DetailsCache;
     mc_Script   *m_ExtendedScripts;
     mc_Script   *m_RowExtendedScript;
     
@@ -320,6 +377,7 @@ typedef struct mc_AssetDB
     uint32_t m_Flags;
     
     mc_Buffer   *m_ThreadRollBackPos;    
+    mc_BlockUndo *m_BlockUndo;                                                  // DB values before last committed block, written to block undo file
     
     void *m_Semaphore;
     uint64_t m_LockedBy;
@@ -347,6 +405,8 @@ typedef struct mc_AssetDB
     int RollBack(int block);
     int RollBack();
     int ClearMemPool();
+    mc_BlockUndo *GetBlockUndo();
+    int ApplyBlockUndo(int block,const unsigned char *lpUndo,int size);
 
     int SetCheckPoint();
     int RollBackToCheckPoint();
@@ -397,9 +457,19 @@ typedef struct mc_AssetDB
     void GetFromMemPool(mc_EntityLedgerRow *row,int mprow);
     int RollBackInternal(int block);
     int ClearMemPoolInternal();
+    int WriteCommitRow(mc_EntityDBRow *row);
     int FindEntityByShortTxIDInternal (mc_EntityDetails *entity, const unsigned char* short_txid);
     int FindLastEntityByGenesisInternal(mc_EntityDetails *last_entity, mc_EntityDetails *genesis_entity);    
     int FindEntityByFollowOnInternal(mc_EntityDetails *entity, const unsigned char* txid);    
+    int UseDetailsCache();
+    int UseChainIndex();
+    int BuildChainIndex();
+    void SetChainIndexKey(mc_EntityDBRow *row,int64_t first_pos,int32_t index);
+    int GetChainIndexRow(mc_EntityDBRow *row,int64_t first_pos,int32_t index);
+    int64_t GetChainIndexTotal(mc_EntityLedgerRow *row,int64_t prev_total);
+    int GetChainIndexLast(mc_EntityDBRow *row,int64_t first_pos);
+    int AddToChainIndex(std::map<int64_t,mc_EntityDBRow>& chains,mc_EntityLedgerRow *row,int64_t pos);
+    int RemoveFromChainIndex(std::map<int64_t,mc_EntityDBRow>& chains,mc_EntityLedgerRow *row,int64_t pos);
      
     void Lock(int write_mode);
     void UnLock();
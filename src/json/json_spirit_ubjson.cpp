@@ -2,6 +2,9 @@
 // MultiChain code distributed under the GPLv3 license, see COPYING file.
 
 #include "json/json_spirit_ubjson.h"
+#include "json/json_spirit_writer_template.h"
+
+#include <inttypes.h>
 
 #define UBJ_UNDEFINED          0
 #define UBJ_NULLTYPE           1
@@ -140,10 +143,9 @@ int ubjson_best_int_type(int64_t int64_value,int *not_uint8)
     return type;
 }
 
-int ubjson_best_type(Value json_value,int last_type,int *not_uint8,int64_t *usize,int64_t *ssize)
+int ubjson_best_type(const Value& json_value,int last_type,int *not_uint8,int64_t *usize,int64_t *ssize)
 {
     int type;
-    string string_value;
     int64_t int64_value;
     int size;
 
@@ -168,8 +170,7 @@ int ubjson_best_type(Value json_value,int last_type,int *not_uint8,int64_t *usiz
             type=UBJ_FLOAT64;
             break;
         case str_type:
-            string_value=json_value.get_str();
-            if( (string_value.size() == 1) && (*(string_value.c_str()) >= 0) )
+            if( (json_value.get_str().size() == 1) && (*(json_value.get_str().c_str()) >= 0) )
             {
                 type=UBJ_CHAR;
             }
@@ -256,16 +257,13 @@ int ubjson_int64_write(int64_t int64_value,int known_type,mc_Script *lpScript)
     return MC_ERR_NOERROR;
 }
 
-int ubjson_write_internal(Value json_value,int known_type,mc_Script *lpScript,int max_depth)
+int ubjson_write_internal(const Value& json_value,int known_type,mc_Script *lpScript,int max_depth)
 {
     char type;
     int ubj_type,last_type,err;
     int optimized;
     double double_value;
-    string string_value;
     Value value;
-    Array array_value;
-    Object obj_value;
     int not_uint8;
     int64_t usize,ssize;
     int64_t int64_value;
@@ -303,13 +301,14 @@ int ubjson_write_internal(Value json_value,int known_type,mc_Script *lpScript,in
                 lpScript->SetData((unsigned char*)&int64_value,sizeof(double));
                 break;
             case UBJ_CHAR:
-                string_value=json_value.get_str();
-                lpScript->SetData((unsigned char*)string_value.c_str(),1);
+                lpScript->SetData((unsigned char*)json_value.get_str().c_str(),1);
                 break;
             case UBJ_STRING:
-                string_value=json_value.get_str();
+                {
+                const string& string_value=json_value.get_str();
                 ubjson_int64_write((int64_t)string_value.size(),UBJ_UNDEFINED,lpScript);
                 lpScript->SetData((unsigned char*)string_value.c_str(),string_value.size());
+                }
                 break;
             case UBJ_ARRAY:
                 if(max_depth <= 1)
@@ -323,7 +322,8 @@ int ubjson_write_internal(Value json_value,int known_type,mc_Script *lpScript,in
                 usize=0;
                 ssize=0;
                 i=0;
-                array_value=json_value.get_array();
+                {
+                const Array& array_value=json_value.get_array();                // Elements are referenced, not copied, on every level
                 while(i<array_value.size())
                 {
                     ubj_type=ubjson_best_type(array_value[i],last_type,&not_uint8,&usize,&ssize);
@@ -398,6 +398,7 @@ int ubjson_write_internal(Value json_value,int known_type,mc_Script *lpScript,in
                     type=']';
                     lpScript->SetData((unsigned char*)&type,1);                    
                 }
+                }
                 break;
             case UBJ_OBJECT:
                 if(max_depth <= 1)
@@ -411,7 +412,8 @@ int ubjson_write_internal(Value json_value,int known_type,mc_Script *lpScript,in
                 usize=0;
                 ssize=0;
                 i=0;
-                obj_value=json_value.get_obj();
+                {
+                const Object& obj_value=json_value.get_obj();
                 while(i<obj_value.size())
                 {
                     ubj_type=ubjson_best_type(obj_value[i].value_,last_type,&not_uint8,&usize,&ssize);
@@ -491,6 +493,7 @@ int ubjson_write_internal(Value json_value,int known_type,mc_Script *lpScript,in
                     type='}';
                     lpScript->SetData((unsigned char*)&type,1);                    
                 }
+                }
                 break;            
             default:
                 return MC_ERR_NOT_SUPPORTED;
@@ -502,7 +505,7 @@ exitlbl:
     return err;
 }
 
-int ubjson_write(Value json_value,mc_Script *lpScript,int max_depth)
+int ubjson_write(const Value& json_value,mc_Script *lpScript,int max_depth)
 {
     return ubjson_write_internal(json_value,0,lpScript,max_depth);
 }
@@ -921,3 +924,259 @@ Value ubjson_read(const unsigned char *elem,size_t elem_size,int max_depth,int *
 {
     return ubjson_read_internal(elem,elem_size,UBJ_UNDEFINED,max_depth,NULL,err);
 }
+
+/* 
+ * Streaming UBJSON -> JSON text transcoder. 
+ * Follows ubjson_read_internal step by step (same depth limits, same errors), but appends compact JSON text 
+ * (write_string(value,false) format) to json_text instead of building Value tree.
+ */
+
+int ubjson_read_json_text_internal(const unsigned char *ptrStart,size_t bytes,int known_type,int max_depth,int *shift,string& json_text)
+{
+    int ubj_type;
+    unsigned char *ptr;
+    unsigned char *ptrEnd;
+    int size,sh,i,err;
+    int64_t int64_value;
+    char buf[32];
+        
+    err=MC_ERR_NOERROR;
+    
+    if(max_depth == 0)
+    {
+        err=MC_ERR_NOT_SUPPORTED;    
+        goto exitlbl;
+    }
+    
+    ptr=(unsigned char *)ptrStart;
+    if(ptr == NULL)
+    {
+        err=MC_ERR_INVALID_PARAMETER_VALUE;
+        goto exitlbl;
+    }
+    
+    ptrEnd=ptr+bytes;
+
+    ubj_type=known_type;
+    
+    if(ubj_type == UBJ_UNDEFINED)
+    {
+        if(ptr+1 > ptrEnd)
+        {
+            err=MC_ERR_ERROR_IN_SCRIPT;
+            goto exitlbl;
+        }
+        ubj_type=UBJ_INTERNAL_TYPE[*ptr];
+        if(ubj_type < 0)
+        {
+            err=MC_ERR_ERROR_IN_SCRIPT;
+            goto exitlbl;        
+        }
+        ptr++;
+    }
+    
+    if(UBJ_ISINT[ubj_type])
+    {
+        int64_value=ubjson_int64_read(ptr,ptrEnd,ubj_type,&sh,&err);
+        if(err)
+        {
+            goto exitlbl;
+        }
+        ptr+=sh;
+        sprintf(buf,"%" PRId64,int64_value);
+        json_text.append(buf);
+    }
+    else
+    {
+        switch(ubj_type)
+        {
+            case UBJ_BOOL_FALSE:
+                json_text.append("false");
+                break;
+            case UBJ_BOOL_TRUE:
+                json_text.append("true");
+                break;
+            case UBJ_FLOAT32:
+                if(ptr+UBJ_SIZE[ubj_type] > ptrEnd)
+                {
+                    err=MC_ERR_ERROR_IN_SCRIPT;
+                    goto exitlbl;                            
+                }       
+                swap_bytes(&int64_value,ptr,sizeof(float));
+                json_text.append(write_string(Value((double)(*(float*)(void*)(&int64_value))),false));
+                ptr+=UBJ_SIZE[ubj_type];
+                break;
+            case UBJ_FLOAT64:
+                if(ptr+UBJ_SIZE[ubj_type] > ptrEnd)
+                {
+                    err=MC_ERR_ERROR_IN_SCRIPT;
+                    goto exitlbl;                            
+                }         
+                swap_bytes(&int64_value,ptr,sizeof(double));
+                json_text.append(write_string(Value(*(double*)(void*)(&int64_value)),false));
+                ptr+=UBJ_SIZE[ubj_type];
+                break;
+            case UBJ_CHAR:
+                if(ptr+UBJ_SIZE[ubj_type] > ptrEnd)
+                {
+                    err=MC_ERR_ERROR_IN_SCRIPT;
+                    goto exitlbl;                            
+                }                
+                json_text.push_back('"');
+                json_text.append(add_esc_chars(string((char*)ptr,1)));
+                json_text.push_back('"');
+                ptr+=UBJ_SIZE[ubj_type];
+                break;
+            case UBJ_STRING:
+            case UBJ_HIGH_PRECISION:
+                size=(int)ubjson_int64_read(ptr,ptrEnd,UBJ_UNDEFINED,&sh,&err);
+                if(err)
+                {
+                    goto exitlbl;
+                }
+                ptr+=sh;
+                if( (size < 0) || (ptr+size > ptrEnd) )
+                {
+                    err=MC_ERR_ERROR_IN_SCRIPT;
+                    goto exitlbl;                            
+                }                
+                json_text.push_back('"');
+                if(size)
+                {
+                    json_text.append(add_esc_chars(string((char*)ptr,size)));
+                }
+                json_text.push_back('"');
+                ptr+=size;                
+                break;
+            case UBJ_ARRAY:
+            case UBJ_OBJECT:
+                
+                if(max_depth <= 1)
+                {
+                    err=MC_ERR_NOT_SUPPORTED;    
+                    goto exitlbl;
+                }
+                
+                {
+                    int container_type=ubj_type;
+                    char close_char=(container_type == UBJ_ARRAY) ? ']' : '}';
+                    
+                    ubj_type=UBJ_UNDEFINED;
+                    if(ptr+1 > ptrEnd)
+                    {
+                        err=MC_ERR_ERROR_IN_SCRIPT;
+                        goto exitlbl;                            
+                    }  
+                    size=-1;
+                    if(*ptr == UBJ_TYPE[UBJ_STRONG_TYPE])
+                    {
+                        ptr++;
+                        if(ptr+1 > ptrEnd)
+                        {
+                            err=MC_ERR_ERROR_IN_SCRIPT;
+                            goto exitlbl;                            
+                        }  
+                        ubj_type=UBJ_INTERNAL_TYPE[*ptr];
+                        if(ubj_type < 0)
+                        {
+                            err=MC_ERR_ERROR_IN_SCRIPT;
+                            goto exitlbl;        
+                        }
+                        ptr++;
+                        if(ptr+1 > ptrEnd)
+                        {
+                            err=MC_ERR_ERROR_IN_SCRIPT;
+                            goto exitlbl;                                    
+                        }
+
+                        if(*ptr != UBJ_TYPE[UBJ_COUNT])
+                        {
+                            err=MC_ERR_ERROR_IN_SCRIPT;
+                            goto exitlbl;                                    
+                        }
+                    }
+                    if(*ptr == UBJ_TYPE[UBJ_COUNT])
+                    {
+                        ptr++;
+                        size=(int)ubjson_int64_read(ptr,ptrEnd,UBJ_UNDEFINED,&sh,&err);
+                        if(err)
+                        {
+                            goto exitlbl;
+                        }                    
+                        ptr+=sh;
+                    }
+
+                    json_text.push_back((container_type == UBJ_ARRAY) ? '[' : '{');
+                    i=0;
+                    while( (size >= 0) ? (i<size) : true )
+                    {
+                        if(size < 0)
+                        {
+                            if(ptr+1 > ptrEnd)
+                            {
+                                err=MC_ERR_ERROR_IN_SCRIPT;
+                                goto exitlbl;                            
+                            }                          
+                            if(*ptr == close_char)
+                            {
+                                ptr++;
+                                break;
+                            }
+                        }
+                        if(i)
+                        {
+                            json_text.push_back(',');
+                        }
+                        if(container_type == UBJ_OBJECT)
+                        {
+                            err=ubjson_read_json_text_internal(ptr,ptrEnd-ptr,UBJ_STRING,max_depth-1,&sh,json_text);
+                            if(err)
+                            {
+                                goto exitlbl;
+                            }                    
+                            ptr+=sh;
+                            json_text.push_back(':');
+                        }
+                        err=ubjson_read_json_text_internal(ptr,ptrEnd-ptr,ubj_type,max_depth-1,&sh,json_text);
+                        if(err)
+                        {
+                            goto exitlbl;
+                        }                    
+                        ptr+=sh;
+                        i++;
+                    }
+                    json_text.push_back(close_char);
+                }
+                break;
+            default:                                                            // Null and markers not expected here are read as null
+                json_text.append("null");
+                break;
+        }
+    }
+    
+exitlbl:
+                
+    if(err == MC_ERR_NOERROR)
+    {
+        if(shift)
+        {
+            *shift=ptr-ptrStart;    
+        }
+    }
+
+    return err;    
+}
+
+int ubjson_read_json_text(const unsigned char *elem,size_t elem_size,int max_depth,string& json_text)
+{
+    int err;
+    size_t original_size=json_text.size();
+    
+    err=ubjson_read_json_text_internal(elem,elem_size,UBJ_UNDEFINED,max_depth,NULL,json_text);
+    if(err)
+    {
+        json_text.resize(original_size);                                        // Partial output is discarded
+    }
+    
+    return err;
+}
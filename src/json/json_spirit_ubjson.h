@@ -15,8 +15,9 @@ using namespace json_spirit;
 extern "C" {
 #endif
 
-int ubjson_write(Value json_value,mc_Script *lpScript,int max_depth);
+int ubjson_write(const Value& json_value,mc_Script *lpScript,int max_depth);
 Value ubjson_read(const unsigned char *elem,size_t elem_size,int max_depth,int *err);
+int ubjson_read_json_text(const unsigned char *elem,size_t elem_size,int max_depth,string& json_text);
 
 
 #ifdef __cplusplus
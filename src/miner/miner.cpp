@@ -23,6 +23,7 @@
 
 #include "multichain/multichain.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 
@@ -62,6 +63,75 @@ public:
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
+/* MCHN START */
+/*
+ * Parses -admissionclassreserve=<class>:<percent>,... into percents of block size reserved 
+ * for admission classes. Reserve is applied only if there are pending txs of this class, 
+ * so unused reserved space is filled by txs of other classes.
+ */
+
+void GetAdmissionClassReserves(int *percents)
+{
+    vector<string> vItems;
+    string strReserves=GetArg("-admissionclassreserve",DEFAULT_ADMISSION_CLASS_RESERVE);
+    int total=0;
+    
+    for(int c=0;c<MC_TAC_COUNT;c++)
+    {
+        percents[c]=0;
+    }
+    
+    boost::split(vItems, strReserves, boost::is_any_of(","));
+    BOOST_FOREACH(const string& strItem, vItems)
+    {
+        size_t pos=strItem.find(':');
+        if(pos == string::npos)
+        {
+            continue;
+        }
+        string strClass=strItem.substr(0,pos);
+        int percent=atoi(strItem.substr(pos+1));
+        percent=max(0,min(percent,100-total));
+        for(int c=0;c<MC_TAC_COUNT;c++)
+        {
+            if(strClass == TxAdmissionClassName(c))
+            {
+                total+=percent-percents[c];
+                percents[c]=percent;
+            }
+        }
+    }    
+}
+
+bool HasStateChangingDependers(const uint256& hash,map<uint256, vector<COrphan*> >& mapDependers,set<uint256>& setVisited)
+{
+    map<uint256, vector<COrphan*> >::iterator it=mapDependers.find(hash);
+    if(it == mapDependers.end())
+    {
+        return false;
+    }
+    BOOST_FOREACH(COrphan* porphan, it->second)
+    {
+        const uint256& child_hash=porphan->ptx->GetHash();
+        if(setVisited.count(child_hash))
+        {
+            continue;
+        }
+        setVisited.insert(child_hash);
+        map<uint256, CTxMemPoolEntry>::const_iterator mi=mempool.mapTx.find(child_hash);
+        if( (mi == mempool.mapTx.end()) || mi->second.ChangesState() )
+        {
+            return true;
+        }
+        if(HasStateChangingDependers(child_hash,mapDependers,setVisited))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/* MCHN END */
+
 
 
 uint32_t nMiningStatus = MC_MST_NO_MINER;
@@ -380,6 +450,17 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
         vector<TxPriority> vecPriority;
         vecPriority.reserve(mempool.mapTx.size());
 /* MCHN START */        
+        int64_t nClassPending[MC_TAC_COUNT];
+        int64_t nClassReserve[MC_TAC_COUNT];
+        int64_t nClassUsed[MC_TAC_COUNT];
+        int nReservePercents[MC_TAC_COUNT];
+        for(int c=0;c<MC_TAC_COUNT;c++)
+        {
+            nClassPending[c]=0;
+            nClassUsed[c]=0;
+        }
+        GetAdmissionClassReserves(nReservePercents);
+        
 // mempool records are processed in the order they were accepted       
         
         set <uint256> setAdded;
@@ -428,7 +509,7 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
             BOOST_FOREACH(const CTxIn& txin, tx.vin)
             {
                 // Read prev transaction
-                if (!view.HaveCoins(txin.prevout.hash))
+                if (!view.HaveCoin(txin.prevout))
                 {
                     // This should never happen; all transactions in the memory
                     // pool should connect to either transactions in the chain
@@ -462,13 +543,13 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
                     nTotalIn += mempool.mapTx[txin.prevout.hash].GetTx().vout[txin.prevout.n].nValue;
                     continue;
                 }
-                const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                assert(coins);
+                const Coin& coin = view.AccessCoin(txin.prevout);
+                assert(!coin.IsSpent());
 
-                CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
+                CAmount nValueIn = coin.out.nValue;
                 nTotalIn += nValueIn;
 
-                int nConf = nHeight - coins->nHeight;
+                int nConf = nHeight - coin.nHeight;
 
                 dPriority += (double)nValueIn * nConf;
             }
@@ -482,6 +563,9 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
             // Priority is sum(valuein * age) / modified_txsize
             unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
             dPriority = tx.ComputePriority(dPriority, nTxSize);
+/* MCHN START */            
+            nClassPending[mempool.mapTx[hash].GetAdmissionClass()]+=nTxSize;
+/* MCHN END */                        
 
 /* MCHN START */            
 // Priority ignored - txs are processed in the order they were accepted
@@ -523,6 +607,18 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
         TxPriorityCompare comparer(false);
 //        TxPriorityCompare comparer(fSortedByFee);
         bool overblocksize_logged=false;
+        bool deferred_logged=false;
+        bool fReserveActive=false;
+        bool fDeferred=false;
+        bool fStateTxSkipped=false;
+        for(int c=0;c<MC_TAC_COUNT;c++)
+        {
+            nClassReserve[c]=min(nClassPending[c],(int64_t)nBlockMaxSize*nReservePercents[c]/100);
+            if(nClassReserve[c] > 0)
+            {
+                fReserveActive=true;
+            }
+        }
 /* MCHN END */            
         std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
 
@@ -536,6 +632,22 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
             std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
             vecPriority.pop_back();
 
+/* MCHN START */            
+            if(fStateTxSkipped)                                                 // MultiChain checks are not rerun for reordered txs,
+            {                                                                   // following txs may depend on entities or permissions of skipped one
+                LogPrint("mchn","mchn-miner: Stopped, tx changing entity or permission state was skipped after deferral\n");
+                break;
+            }
+            const CTxMemPoolEntry& mempool_entry=mempool.mapTx[tx.GetHash()];
+            int tx_class=mempool_entry.GetAdmissionClass();
+            bool fTxChangesState=mempool_entry.ChangesState();
+            if(!fTxChangesState && (fDeferred || fReserveActive))
+            {
+                set<uint256> setVisited;
+                fTxChangesState=HasStateChangingDependers(tx.GetHash(),mapDependers,setVisited);
+            }
+            fStateTxSkipped=fDeferred && fTxChangesState;                       // Cleared when tx is added
+/* MCHN END */            
             // Size limits
             unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
             if (nBlockSize + nTxSize >= nBlockMaxSize)
@@ -547,6 +659,30 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
                 }
                 continue;
             }
+/* MCHN START */            
+            // Space reserved for pending txs of other admission classes
+            int64_t nReservedForOthers=0;
+            for(int c=0;c<MC_TAC_COUNT;c++)
+            {
+                if( (c != tx_class) && (nClassUsed[c] < nClassReserve[c]) )
+                {
+                    nReservedForOthers+=nClassReserve[c]-nClassUsed[c];
+                }
+            }
+            if( !fTxChangesState &&                                             // Txs others may depend on are included over the reserve
+                ((int64_t)(nBlockSize + nTxSize) + nReservedForOthers >= (int64_t)nBlockMaxSize) )
+            {
+                if(!deferred_logged)
+                {
+                    deferred_logged=true;
+                    LogPrint("mchn","mchn-miner: Deferred, space reserved for other admission classes: %s\n",tx.GetHash().GetHex().c_str());
+                }
+                mempool.admissionClassStats[tx_class].nDeferred++;
+                fPreservedMempoolOrder=false;                                   // Skipped tx may be required by the following ones
+                fDeferred=true;
+                continue;
+            }
+/* MCHN END */            
             // Legacy limits on sigOps:
             unsigned int nTxSigOps = GetLegacySigOpCount(tx);
             if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
@@ -614,6 +750,10 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
             pblocktemplate->vTxFees.push_back(nTxFees);
             pblocktemplate->vTxSigOps.push_back(nTxSigOps);
             nBlockSize += nTxSize;
+/* MCHN START */            
+            nClassUsed[tx_class]+=nTxSize;
+            fStateTxSkipped=false;
+/* MCHN END */            
             ++nBlockTx;
             nBlockSigOps += nTxSigOps;
             nFees += nTxFees;
@@ -644,6 +784,12 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,CWallet *pwallet,CP
 
         nLastBlockTx = nBlockTx;
         nLastBlockSize = nBlockSize;
+/* MCHN START */    
+        for(int c=0;c<MC_TAC_COUNT;c++)
+        {
+            mempool.admissionClassStats[c].nLastBlockBytes=nClassUsed[c];
+        }
+/* MCHN END */    
 
 /* MCHN START */    
 // If block was dropped, this happens too many times        
@@ -53,6 +53,8 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int&
 bool CreateBlockSignature(CBlock *block,uint32_t hash_type,CWallet *pwallet,uint256 *cachedMerkleRoot);
 //void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 /* MCHN END */
+/** Fills percents of block size reserved for MC_TAC_COUNT admission classes, see -admissionclassreserve */
+void GetAdmissionClassReserves(int *percents);
 /** Check mined block */
 bool CheckWork(CBlock* pblock, CWallet& wallet, CReserveKey& reservekey);
 bool UpdateTime(CBlockHeader* block, const CBlockIndex* pindexPrev);
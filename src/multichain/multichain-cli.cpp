@@ -19,6 +19,10 @@
 #include <boost/filesystem.hpp>
 //#include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <fstream>
 
 #define _(x) std::string(x) /* Keep the _() around in case gettext or such will be used later to translate non-UI */
 
@@ -42,6 +46,9 @@ std::string HelpMessageCli()
 /* MCHN START */    
     strUsage += "  -requestout=<requestout> " + _("Send request to stderr, stdout or null (not print it at all), default stderr") + "\n"; 
     strUsage += "  -saveclilog=<n>          " + _("If <n>=0 multichain-cli history is not saved, default 1") + "\n";
+    strUsage += "  -replay=<file>           " + _("Replay requests captured by multichaind -rpccapture and report latency distribution per method") + "\n"; 
+    strUsage += "  -replayspeed=<x>         " + _("Replay speed-up relative to captured timing, 0 - send requests without delay, default 1") + "\n"; 
+    strUsage += "  -replaythreads=<n>       " + _("Number of concurrent replay threads, each request opens a new connection, default 4") + "\n"; 
 /*    
     strUsage += "  -testnet               " + _("Use the test network") + "\n";
     strUsage += "  -regtest               " + _("Enter regression test mode, which uses a special chain in which blocks can be "
@@ -125,7 +132,7 @@ static int AppInitRPC(int argc, char* argv[])
         mc_gState->m_Params->HasOption("-help") || 
         mc_gState->m_Params->HasOption("-version") || 
         (mc_gState->m_Params->NetworkName() == NULL) ||
-        mc_gState->m_Params->m_NumArguments<minargs)
+        (mc_gState->m_Params->m_NumArguments<minargs && !mc_gState->m_Params->HasOption("-replay")))
       {
         fprintf(stdout,"\nMultiChain %s RPC client\n\n",mc_BuildDescription(mc_gState->GetNumericVersion()).c_str());
         
@@ -213,9 +220,37 @@ static int AppInitRPC(int argc, char* argv[])
     return CONTINUE_EXECUTION;
 }
 
-Object CallRPC(const string& strMethod, const Array& params)
+/* MCHN START */
+
+/**
+ * Connection settings read from mapArgs once, so CallRPC can run concurrently without touching mapArgs
+ */
+
+struct CRPCClientParams
 {
-    if (mapArgs["-rpcuser"] == "" && mapArgs["-rpcpassword"] == "")
+    string strUser;
+    string strPassword;
+    string strConnect;
+    string strPort;
+    string strRequestOut;
+    bool fUseSSL;
+    
+    CRPCClientParams()
+    {
+        strUser=GetArg("-rpcuser","");
+        strPassword=GetArg("-rpcpassword","");
+        strConnect=GetArg("-rpcconnect", "127.0.0.1");
+        strPort=GetArg("-rpcport", itostr(BaseParams().RPCPort()));
+        strRequestOut=GetArg("-requestout","stderr");
+        fUseSSL=GetBoolArg("-rpcssl", false);
+    }
+};
+
+/* MCHN END */
+
+Object CallRPC(const CRPCClientParams& rpc_params, const string& strMethod, const Array& params)
+{
+    if (rpc_params.strUser == "" && rpc_params.strPassword == "")
         throw runtime_error(strprintf(
             _("No credentials found for chain \"%s\"\n\n"
               "You must set rpcpassword=<password> in the configuration file:\n%s/multichain.conf\n"
@@ -223,7 +258,7 @@ Object CallRPC(const string& strMethod, const Array& params)
                 mc_gState->m_Params->NetworkName(),mc_gState->m_Params->DataDir(1,0)));
 
     // Connect to localhost
-    bool fUseSSL = GetBoolArg("-rpcssl", false);
+    bool fUseSSL = rpc_params.fUseSSL;
     asio::io_service io_service;
     ssl::context context(io_service, ssl::context::sslv23);
     context.set_options(ssl::context::no_sslv2 | ssl::context::no_sslv3);
@@ -231,13 +266,13 @@ Object CallRPC(const string& strMethod, const Array& params)
     SSLIOStreamDevice<asio::ip::tcp> d(sslStream, fUseSSL);
     iostreams::stream< SSLIOStreamDevice<asio::ip::tcp> > stream(d);
 
-    const bool fConnected = d.connect(GetArg("-rpcconnect", "127.0.0.1"), GetArg("-rpcport", itostr(BaseParams().RPCPort())));
+    const bool fConnected = d.connect(rpc_params.strConnect, rpc_params.strPort);
     if (!fConnected)
         throw CConnectionFailed("couldn't connect to server");
 
     // HTTP basic authentication
     
-    string strUserPass64 = EncodeBase64(mapArgs["-rpcuser"] + ":" + mapArgs["-rpcpassword"]);
+    string strUserPass64 = EncodeBase64(rpc_params.strUser + ":" + rpc_params.strPassword);
     map<string, string> mapRequestHeaders;
     mapRequestHeaders["Authorization"] = string("Basic ") + strUserPass64;
     // Send request
@@ -249,11 +284,10 @@ Object CallRPC(const string& strMethod, const Array& params)
     
     string strRequest = JSONRPCRequest(strMethod, params, req_id);
 //    JSON_NO_DOUBLE_FORMATTING=0;    
-    JSON_DOUBLE_DECIMAL_DIGITS=GetArg("-apidecimaldigits",-1);        
     string strPost = HTTPPost(strRequest, mapRequestHeaders);
     stream << strPost << std::flush;
 
-    string requestout=GetArg("-requestout","stderr");
+    const string& requestout=rpc_params.strRequestOut;
     if(requestout == "stdout")
     {
         fprintf(stdout, "%s\n", strRequest.c_str());        
@@ -290,6 +324,265 @@ Object CallRPC(const string& strMethod, const Array& params)
     return reply;
 }
 
+Object CallRPC(const string& strMethod, const Array& params)
+{
+    CRPCClientParams rpc_params;
+    JSON_DOUBLE_DECIMAL_DIGITS=GetArg("-apidecimaldigits",-1);        
+    return CallRPC(rpc_params, strMethod, params);
+}
+
+/* MCHN START */
+
+struct CReplayRequest
+{
+    int64_t nTime;                                                              // Microseconds from capture start
+    int64_t nCapturedDuration;
+    string strMethod;
+    Array params;
+    bool fCapturedError;
+};
+
+struct CReplayMethodStats
+{
+    vector<int64_t> vLatency;
+    vector<int64_t> vCapturedDuration;
+    int nErrors;
+    int nCapturedErrors;
+    
+    CReplayMethodStats()
+    {
+        nErrors=0;
+        nCapturedErrors=0;
+    }
+};
+
+class CReplayState
+{
+public:
+    vector<CReplayRequest> vRequests;
+    map<string,CReplayMethodStats> mapStats;
+    size_t nNext;
+    int64_t nReplayStart;
+    double dSpeed;
+    CRPCClientParams rpcParams;                                                 // Read before workers start, shared read-only
+    boost::mutex mutex;
+    
+    CReplayState()
+    {
+        nNext=0;
+        nReplayStart=0;
+        dSpeed=1.;
+    }
+};
+
+static Value ReplayLatencyObject(vector<int64_t>& vLatency)
+{
+    Object obj;
+    if(vLatency.empty())
+    {
+        return Value::null;
+    }
+    sort(vLatency.begin(),vLatency.end());
+    int64_t nTotal=0;
+    for(unsigned int i=0;i<vLatency.size();i++)
+    {
+        nTotal+=vLatency[i];
+    }
+    obj.push_back(Pair("mean",(double)nTotal/vLatency.size()/1000.));
+    obj.push_back(Pair("p50",(double)vLatency[(vLatency.size()-1)*50/100]/1000.));
+    obj.push_back(Pair("p90",(double)vLatency[(vLatency.size()-1)*90/100]/1000.));
+    obj.push_back(Pair("p99",(double)vLatency[(vLatency.size()-1)*99/100]/1000.));
+    obj.push_back(Pair("max",(double)vLatency.back()/1000.));
+    return obj;
+}
+
+static void ReplayWorker(CReplayState *state)
+{
+    while(true)
+    {
+        size_t nIndex;
+        {
+            boost::lock_guard<boost::mutex> lock(state->mutex);
+            if(state->nNext >= state->vRequests.size())
+            {
+                return;
+            }
+            nIndex=state->nNext;
+            state->nNext++;
+        }
+        
+        const CReplayRequest& request=state->vRequests[nIndex];
+        if(state->dSpeed > 0)
+        {
+            int64_t nDue=state->nReplayStart+(int64_t)(request.nTime/state->dSpeed);
+            int64_t nNow=GetTimeMicros();
+            if(nDue > nNow)
+            {
+                MilliSleep((nDue-nNow)/1000);
+            }
+        }
+        
+        bool fError=false;
+        int64_t nStart=GetTimeMicros();
+        try {
+            const Object reply = CallRPC(state->rpcParams, request.strMethod, request.params);
+            fError=(find_value(reply, "error").type() != null_type);
+        }
+        catch (std::exception& e) {
+            fError=true;
+        }
+        int64_t nLatency=GetTimeMicros()-nStart;
+        
+        boost::lock_guard<boost::mutex> lock(state->mutex);
+        CReplayMethodStats& stats=state->mapStats[request.strMethod];
+        stats.vLatency.push_back(nLatency);
+        stats.vCapturedDuration.push_back(request.nCapturedDuration);
+        if(fError)
+        {
+            stats.nErrors++;
+        }
+        if(request.fCapturedError)
+        {
+            stats.nCapturedErrors++;
+        }
+    }
+}
+
+/**
+ * Sends requests from -rpccapture file keeping their relative timing scaled by -replayspeed, 
+ * prints per-method latency distribution (client round trip) next to execution time recorded in capture.
+ * Each request opens its own connection, so latency includes connect time.
+ */
+int ReplayRPC()
+{
+    string strFile=GetArg("-replay","");
+    ifstream file(strFile.c_str());
+    if(!file.is_open())
+    {
+        fprintf(stderr, "error: cannot open replay file %s\n", strFile.c_str());
+        return EXIT_FAILURE;
+    }
+    
+    CReplayState state;
+    int nSkipped=0;
+    string strLine;
+    while(getline(file,strLine))
+    {
+        Value value;
+        if(!read_string(strLine, value) || (value.type() != obj_type))
+        {
+            nSkipped++;
+            continue;
+        }
+        const Object& obj=value.get_obj();
+        const Value& method=find_value(obj, "method");
+        if(method.type() != str_type)                                           // Capture header
+        {
+            continue;
+        }
+        const Value& redacted=find_value(obj, "redacted");
+        if( (redacted.type() == bool_type) && redacted.get_bool() )
+        {
+            nSkipped++;
+            continue;
+        }
+        
+        CReplayRequest request;
+        request.strMethod=method.get_str();
+        request.nTime=0;
+        request.nCapturedDuration=0;
+        request.fCapturedError=false;
+        const Value& params=find_value(obj, "params");
+        if(params.type() == array_type)
+        {
+            request.params=params.get_array();
+        }
+        const Value& time=find_value(obj, "time");
+        if(time.type() == int_type)
+        {
+            request.nTime=time.get_int64();
+        }
+        const Value& duration=find_value(obj, "duration");
+        if(duration.type() == int_type)
+        {
+            request.nCapturedDuration=duration.get_int64();
+        }
+        const Value& error=find_value(obj, "error");
+        if(error.type() == bool_type)
+        {
+            request.fCapturedError=error.get_bool();
+        }
+        state.vRequests.push_back(request);
+    }
+    
+    if(state.vRequests.empty())
+    {
+        fprintf(stderr, "error: no requests to replay in %s\n", strFile.c_str());
+        return EXIT_FAILURE;
+    }
+    
+    int64_t nFirst=state.vRequests[0].nTime;
+    for(unsigned int i=0;i<state.vRequests.size();i++)
+    {
+        state.vRequests[i].nTime-=nFirst;
+    }
+    
+    state.dSpeed=atof(GetArg("-replayspeed","1").c_str());
+    int nThreads=GetArg("-replaythreads",4);
+    if(nThreads < 1)
+    {
+        nThreads=1;
+    }
+    if(!mapArgs.count("-requestout"))
+    {
+        mapArgs["-requestout"]="null";
+    }
+    state.rpcParams=CRPCClientParams();
+    JSON_DOUBLE_DECIMAL_DIGITS=GetArg("-apidecimaldigits",-1);                 // Set once, workers only read it
+    
+    fprintf(stderr, "Replaying %d requests from %s, speed-up %g, %d threads\n", (int)state.vRequests.size(), strFile.c_str(), state.dSpeed, nThreads);
+    
+    state.nReplayStart=GetTimeMicros();
+    boost::thread_group threads;
+    for(int i=0;i<nThreads;i++)
+    {
+        threads.create_thread(boost::bind(&ReplayWorker, &state));
+    }
+    threads.join_all();
+    int64_t nElapsed=GetTimeMicros()-state.nReplayStart;
+    
+    Object result;
+    Array methods;
+    vector<int64_t> vAllLatency;
+    int nErrors=0;
+    for(map<string,CReplayMethodStats>::iterator it=state.mapStats.begin();it != state.mapStats.end();it++)
+    {
+        Object entry;
+        entry.push_back(Pair("method",it->first));
+        entry.push_back(Pair("count",(int)it->second.vLatency.size()));
+        entry.push_back(Pair("errors",it->second.nErrors));
+        entry.push_back(Pair("capturederrors",it->second.nCapturedErrors));
+        vAllLatency.insert(vAllLatency.end(),it->second.vLatency.begin(),it->second.vLatency.end());
+        nErrors+=it->second.nErrors;
+        entry.push_back(Pair("latency",ReplayLatencyObject(it->second.vLatency)));
+        entry.push_back(Pair("captured",ReplayLatencyObject(it->second.vCapturedDuration)));
+        methods.push_back(entry);
+    }
+    
+    result.push_back(Pair("requests",(int)state.vRequests.size()));
+    result.push_back(Pair("skipped",nSkipped));
+    result.push_back(Pair("errors",nErrors));
+    result.push_back(Pair("elapsed",(double)nElapsed/1000000.));
+    result.push_back(Pair("rate",(nElapsed > 0) ? (double)state.vRequests.size()*1000000./nElapsed : 0.));
+    result.push_back(Pair("latency",ReplayLatencyObject(vAllLatency)));
+    result.push_back(Pair("methods",methods));
+    
+    fprintf(stdout, "%s\n", write_string(Value(result), true).c_str());
+    return EXIT_SUCCESS;
+}
+
+/* MCHN END */
+
 int CommandLineRPC(int argc, char *argv[])
 {
     string strPrint;
@@ -416,6 +709,22 @@ int main(int argc, char* argv[])
     boost::filesystem::create_directories(path_cli_log);
     path_cli_log /= string(mc_gState->m_Params->NetworkName() + string(".log"));
     
+/* MCHN START */
+    if(mapArgs.count("-replay"))
+    {
+        int ret = EXIT_FAILURE;
+        try {
+            ret = ReplayRPC();
+        }
+        catch (std::exception& e) {
+            PrintExceptionContinue(&e, "ReplayRPC()");
+        } catch (...) {
+            PrintExceptionContinue(NULL, "ReplayRPC()");
+        }
+        return ret;
+    }
+/* MCHN END */
+    
     if (mapArgs["-rpcuser"] == "" && mapArgs["-rpcpassword"] == "")
     {
         string strMethod=strprintf("%s",mc_gState->m_Params->NetworkName());
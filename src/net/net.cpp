@@ -19,6 +19,8 @@
 #include "structs/base58.h"
 #include "keys/key.h"
 #include "keys/pubkey.h"
+#include "utils/lzcodec.h"
+#include "utils/memusage.h"
 #include "wallet/wallet.h"
 extern CWallet* pwalletMain;
 #include "multichain/multichain.h"
@@ -77,6 +79,7 @@ namespace {
 //
 bool fDiscover = true;
 bool fListen = true;
+bool fP2PCompression = DEFAULT_P2P_COMPRESSION;
 uint64_t nLocalServices = NODE_NETWORK;
 uint64_t nLocalMultiChainServices = 0;
 CCriticalSection cs_mapLocalHost;
@@ -97,6 +100,9 @@ vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
 map<CInv, CDataStream> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
+/* MCHN START */
+size_t nRelayDataUsage = 0;                                                     // Serialized tx bytes held in mapRelay, guarded by cs_mapRelay
+/* MCHN END */
 CCriticalSection cs_mapRelay;
 limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 
@@ -617,6 +623,12 @@ void CNode::copyStats(CNodeStats &stats)
     stats.kAddrRemote=kAddrRemote;
     stats.fSuccessfullyConnected=fSuccessfullyConnected;
     stats.fEncrypted=pEF->NET_IsEncrypted(this);
+    stats.fCompressionSend=fCompressionSend;
+    stats.fCompressionRecv=fCompressionRecv;
+    stats.nCompressionSendRaw=nCompressionSendRaw;
+    stats.nCompressionSendBytes=nCompressionSendBytes;
+    stats.nCompressionRecvRaw=nCompressionRecvRaw;
+    stats.nCompressionRecvBytes=nCompressionRecvBytes;
 /* MCHN END */    
     
 }
@@ -2115,12 +2127,22 @@ void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
         // Expire old relay messages
         while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
         {
-            mapRelay.erase(vRelayExpiration.front().second);
+/* MCHN START */
+            map<CInv, CDataStream>::iterator mi = mapRelay.find(vRelayExpiration.front().second);
+            if (mi != mapRelay.end())
+            {
+                nRelayDataUsage -= memusage::MallocUsage(mi->second.size());
+                mapRelay.erase(mi);
+            }
+/* MCHN END */
             vRelayExpiration.pop_front();
         }
 
         // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
+/* MCHN START */
+        if (mapRelay.insert(std::make_pair(inv, ss)).second)
+            nRelayDataUsage += memusage::MallocUsage(ss.size());
+/* MCHN END */
         vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
     }
     LOCK(cs_vNodes);
@@ -2138,6 +2160,58 @@ void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
     }
 }
 
+void RelayTransactions(const std::vector<CTransaction>& vtx)
+{
+    std::vector<CInv> vInv;
+    vInv.reserve(vtx.size());
+    {
+        LOCK(cs_mapRelay);
+        // Expire old relay messages
+        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
+        {
+/* MCHN START */
+            map<CInv, CDataStream>::iterator mi = mapRelay.find(vRelayExpiration.front().second);
+            if (mi != mapRelay.end())
+            {
+                nRelayDataUsage -= memusage::MallocUsage(mi->second.size());
+                mapRelay.erase(mi);
+            }
+/* MCHN END */
+            vRelayExpiration.pop_front();
+        }
+
+        BOOST_FOREACH(const CTransaction& tx, vtx)
+        {
+            CInv inv(MSG_TX, tx.GetHash());
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss.reserve(10000);
+            ss << tx;
+            if (mapRelay.insert(std::make_pair(inv, ss)).second)
+                nRelayDataUsage += memusage::MallocUsage(ss.size());
+            vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
+            vInv.push_back(inv);
+        }
+    }
+    
+    // All inventory is queued to each peer in one pass, so it goes out in the same inv message
+    LOCK(cs_vNodes);
+    BOOST_FOREACH(CNode* pnode, vNodes)
+    {
+        if(!pnode->fRelayTxes)
+            continue;
+        LOCK(pnode->cs_filter);
+        for (unsigned int i = 0; i < vtx.size(); i++)
+        {
+            if (pnode->pfilter)
+            {
+                if (pnode->pfilter->IsRelevantAndUpdate(vtx[i]))
+                    pnode->PushInventory(vInv[i]);
+            } else
+                pnode->PushInventory(vInv[i]);
+        }
+    }
+}
+
 void CNode::RecordBytesRecv(uint64_t bytes)
 {
     LOCK(cs_totalBytesRecv);
@@ -2348,6 +2422,26 @@ CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fIn
     fLastIgnoreIncoming=false;
     nLastKBPerDestinationChangeTimestamp=0;
     nMaxKBPerDestination=0;
+    nChunkRTTSample=0;
+    nChunkBytesSample=0;
+    nChunkSRTT=0;
+    nChunkMinRTT=0;
+    nChunkMinRTTTimestamp=0;
+    nChunkBandwidth[0]=0;
+    nChunkBandwidth[1]=0;
+    nChunkBandwidthTimestamp=0;
+    nChunkStartupBandwidth=0;
+    nChunkStartupRounds=0;
+    nChunkDelivered=0;
+    nChunkRateDelivered=0;
+    nChunkRateTimestamp=0;
+    nChunkTimeouts=0;
+    fCompressionSend=false;
+    fCompressionRecv=false;
+    nCompressionSendRaw=0;
+    nCompressionSendBytes=0;
+    nCompressionRecvRaw=0;
+    nCompressionRecvBytes=0;
     
     pEntData=NULL;
     nNextSendTime=0;    
@@ -2466,6 +2560,13 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     if (ssSend.size() == 0)
         return;
 
+/* MCHN START */    
+    if(fCompressionSend)
+    {
+        CompressMessage();
+    }
+/* MCHN END */    
+    
     // Set the size
     unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
     memcpy((char*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
@@ -2495,6 +2596,102 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
 /* MCHN START */
 
+static bool IsCompressibleCommand(const std::string& strCommand)
+{
+    return (strCommand == "block") || (strCommand == "tx") || (strCommand == "headers");
+}
+
+/**
+ * Compressed message payload: original command, CompactSize(uncompressed size), LZ codec output.
+ * Sent only if it is smaller than the original payload.
+ */
+
+void CNode::CompressMessage()
+{
+    std::string strCommand=std::string(&ssSend[MESSAGE_START_SIZE],CMessageHeader::COMMAND_SIZE).c_str();
+    if(!IsCompressibleCommand(strCommand))
+    {
+        return;
+    }
+    
+    unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
+    unsigned int nWireSize = nSize;
+    if(nSize >= MIN_COMPRESSED_MESSAGE_SIZE)
+    {
+        std::vector<unsigned char> vCompressed;
+        LZCompress((unsigned char*)&ssSend[CMessageHeader::HEADER_SIZE],nSize,vCompressed);
+        if(::GetSerializeSize(strCommand, SER_NETWORK, PROTOCOL_VERSION) + GetSizeOfCompactSize(nSize) + vCompressed.size() < nSize)
+        {
+            ssSend.clear();
+            ssSend << CMessageHeader("compressed", 0);
+            ssSend << strCommand;
+            WriteCompactSize(ssSend, nSize);
+            ssSend.write((char*)&vCompressed[0],vCompressed.size());
+            nWireSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
+        }
+    }
+    
+    nCompressionSendRaw += nSize;
+    nCompressionSendBytes += nWireSize;
+}
+
+bool CNode::DecompressMessage(std::string& strCommand, CDataStream& vRecv)
+{
+    if(strCommand != "compressed")
+    {
+        if(fCompressionRecv && IsCompressibleCommand(strCommand))
+        {
+            nCompressionRecvRaw += vRecv.size();
+            nCompressionRecvBytes += vRecv.size();
+        }
+        return true;
+    }
+    
+    if(!fCompressionRecv)
+    {
+        LogPrintf("mchn: Compressed message from peer=%d, compression was not offered\n", id);
+        return false;
+    }
+    
+    unsigned int nWireSize = vRecv.size();
+    std::string strOriginalCommand;
+    uint64_t nRawSize;
+    try
+    {
+        vRecv >> LIMITED_STRING(strOriginalCommand, CMessageHeader::COMMAND_SIZE);
+        nRawSize = ReadCompactSize(vRecv);                                      // Throws if above MAX_SIZE
+    }
+    catch (std::exception& e)
+    {
+        LogPrintf("mchn: Malformed compressed message header from peer=%d: %s\n", id, e.what());
+        return false;
+    }
+    if(!IsCompressibleCommand(strOriginalCommand))
+    {
+        LogPrintf("mchn: Unexpected compressed command %s from peer=%d\n", SanitizeString(strOriginalCommand), id);
+        return false;
+    }
+    
+    std::vector<unsigned char> vRaw;
+    if(!LZDecompress(vRecv.size() ? (unsigned char*)&vRecv[0] : NULL,vRecv.size(),nRawSize,vRaw))
+    {
+        LogPrintf("mchn: Malformed compressed %s from peer=%d\n", SanitizeString(strOriginalCommand), id);
+        return false;
+    }
+    
+    vRecv.clear();
+    if(vRaw.size())
+    {
+        vRecv.write((char*)&vRaw[0],vRaw.size());
+    }
+    strCommand=strOriginalCommand;
+    
+    nCompressionRecvRaw += nRawSize;
+    nCompressionRecvBytes += nWireSize;
+    
+    return true;
+}
+
 int mc_QuerySeed(boost::thread_group& threadGroup,const char *seedAddr)
 {
     int err;
@@ -61,6 +61,14 @@ static const bool DEFAULT_UPNP = false;
 #endif
 /** The maximum number of entries in mapAskFor */
 static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
+/* MCHN START */
+/** -p2pcompression default */
+static const bool DEFAULT_P2P_COMPRESSION = false;
+/** Compression codecs offered in verack, only LZ codec is defined */
+static const uint32_t MC_NET_COMPRESSION_LZ = 0x00000001;
+/** Payloads below this size are sent uncompressed */
+static const unsigned int MIN_COMPRESSED_MESSAGE_SIZE = 256;
+/* MCHN END */
 
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
@@ -128,6 +136,7 @@ CAddress GetLocalAddress(const CNetAddr *paddrPeer = NULL);
 
 extern bool fDiscover;
 extern bool fListen;
+extern bool fP2PCompression;
 extern uint64_t nLocalServices;
 extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
@@ -137,6 +146,7 @@ extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
 extern std::map<CInv, CDataStream> mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
+extern size_t nRelayDataUsage;
 extern CCriticalSection cs_mapRelay;
 extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
 
@@ -178,6 +188,12 @@ public:
     CKeyID kAddrLocal;    
     bool fSuccessfullyConnected;
     bool fEncrypted;
+    bool fCompressionSend;
+    bool fCompressionRecv;
+    uint64_t nCompressionSendRaw;
+    uint64_t nCompressionSendBytes;
+    uint64_t nCompressionRecvRaw;
+    uint64_t nCompressionRecvBytes;
 /* MCHN END */    
 };
 
@@ -294,7 +310,26 @@ public:
     CKeyID kAddrRemote;
     CKeyID kAddrLocal;
     int64_t nLastKBPerDestinationChangeTimestamp;
-    int nMaxKBPerDestination;
+    int nMaxKBPerDestination;                                                  // Offchain request window, KB outstanding
+    int64_t nChunkRTTSample;                                                   // Last chunk response round trip, ms, consumed by collector
+    int nChunkBytesSample;                                                     // Size of the last chunk response
+    int64_t nChunkSRTT;                                                        // Smoothed chunk response round trip, ms
+    int64_t nChunkMinRTT;                                                      // Minimal path delay in the current window, ms
+    int64_t nChunkMinRTTTimestamp;
+    int nChunkBandwidth[2];                                                    // Max delivery rate, KB/s, in current and previous window
+    int64_t nChunkBandwidthTimestamp;
+    int nChunkStartupBandwidth;                                                // Delivery rate at the last startup growth step, KB/s
+    int nChunkStartupRounds;                                                   // Responses without growth, -1 after startup is over
+    int64_t nChunkDelivered;                                                   // Total chunk response bytes
+    int64_t nChunkRateDelivered;                                               // nChunkDelivered at the start of rate measurement interval
+    int64_t nChunkRateTimestamp;                                               // Start of rate measurement interval, ms
+    int nChunkTimeouts;                                                        // Total timed out chunk requests
+    bool fCompressionSend;                                                     // Peer offered compression in verack, we may compress to it
+    bool fCompressionRecv;                                                     // We offered compression in verack, peer may compress to us
+    uint64_t nCompressionSendRaw;                                              // Uncompressed size of sent block/tx/headers payloads
+    uint64_t nCompressionSendBytes;                                            // Their size on the wire
+    uint64_t nCompressionRecvRaw;                                              // Same for received
+    uint64_t nCompressionRecvBytes;
 
     CAddress addrFromVersion;
     
@@ -317,6 +352,9 @@ protected:
 
     // Basic fuzz-testing
     void Fuzz(int nChance); // modifies ssSend
+/* MCHN START */    
+    void CompressMessage(); // modifies ssSend
+/* MCHN END */    
 
 public:
     uint256 hashContinue;
@@ -450,6 +488,11 @@ public:
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
     void EndMessage() UNLOCK_FUNCTION(cs_vSend);
 
+/* MCHN START */    
+    // Replaces "compressed" message by the original one, counts compression statistics
+    bool DecompressMessage(std::string& strCommand, CDataStream& vRecv);
+/* MCHN END */    
+
     void PushVersion();
 
     void PushMessage(const char* pszCommand)
@@ -700,6 +743,7 @@ public:
 class CTransaction;
 void RelayTransaction(const CTransaction& tx);
 void RelayTransaction(const CTransaction& tx, const CDataStream& ss);
+void RelayTransactions(const std::vector<CTransaction>& vtx);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB
@@ -255,12 +255,163 @@ int mc_PermissionLedger::SetRow(uint64_t RowID, mc_PermissionLedgerRow* row)
     return WriteRow(row);
 }
 
+/** Writes consecutive rows into ledger starting from specified position in one call */
+
+int mc_PermissionLedger::SetRows(uint64_t RowID,const unsigned char *rows,int count)
+{
+    int64_t off,size,written,this_write;
+    
+    if(m_FileHan<=0)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    off=RowID*m_TotalSize;
+    
+    if(lseek64(m_FileHan,off,SEEK_SET) != off)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    size=(int64_t)count*m_TotalSize;
+    written=0;
+    while(written<size)
+    {
+        this_write=write(m_FileHan,rows+written,size-written);
+        if(this_write <= 0)
+        {
+            return MC_ERR_INTERNAL_ERROR;
+        }
+        written+=this_write;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+/** Permission negative lookup filter */
+
+void mc_PermissionFilter::Zero()
+{
+    m_Bits=NULL;
+    m_BitCount=0;
+    m_Capacity=0;
+    m_Keys=0;
+    m_Stale=0;
+    m_KeyOffset=0;
+    m_Lookups=0;
+    m_Skipped=0;
+    m_FalsePositives=0;
+    m_Rebuilds=0;
+}
+
+int mc_PermissionFilter::Destroy()
+{
+    if(m_Bits)
+    {
+        mc_Delete(m_Bits);
+        m_Bits=NULL;
+    }
+    m_BitCount=0;
+    m_Capacity=0;
+    m_Keys=0;
+    m_Stale=0;
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_PermissionFilter::Initialize(uint64_t capacity,uint32_t key_offset)
+{
+    Destroy();
+    
+    if(capacity < MC_PFT_MIN_CAPACITY)
+    {
+        capacity=MC_PFT_MIN_CAPACITY;
+    }
+    
+    m_KeyOffset=key_offset;
+    m_Capacity=capacity;
+    m_BitCount=capacity*MC_PFT_BITS_PER_KEY;
+    m_Bits=(unsigned char*)mc_New((m_BitCount+7)/8);
+    if(m_Bits == NULL)
+    {
+        m_BitCount=0;
+        m_Capacity=0;
+        return MC_ERR_ALLOCATION;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+uint64_t mc_PermissionFilter::GetHash(const void *lpRow)
+{
+    uint64_t hash=14695981039346656037ULL;
+    const unsigned char *ptr;
+    int i;
+                                                                                // Entity (if part of the key) and address
+    ptr=(const unsigned char*)lpRow+m_KeyOffset;
+    for(i=0;i<(int)(MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS-m_KeyOffset);i++)
+    {
+        hash=(hash ^ ptr[i]) * 1099511628211ULL;
+    }
+    
+    return hash;
+}
+
+void mc_PermissionFilter::Add(const void *lpRow)
+{
+    uint64_t hash,h1,h2,bit;
+    int i;
+    
+    if(m_Bits == NULL)
+    {
+        return;
+    }
+    
+    hash=GetHash(lpRow);
+    h1=hash & 0xFFFFFFFF;
+    h2=(hash >> 32) | 1;
+    for(i=0;i<MC_PFT_HASH_COUNT;i++)
+    {
+        bit=(h1+i*h2) % m_BitCount;
+        m_Bits[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+    }
+    m_Keys++;
+}
+
+int mc_PermissionFilter::MayContain(const void *lpRow)
+{
+    uint64_t hash,h1,h2,bit;
+    int i;
+    
+    if(m_Bits == NULL)
+    {
+        return 1;
+    }
+    
+    m_Lookups++;
+    hash=GetHash(lpRow);
+    h1=hash & 0xFFFFFFFF;
+    h2=(hash >> 32) | 1;
+    for(i=0;i<MC_PFT_HASH_COUNT;i++)
+    {
+        bit=(h1+i*h2) % m_BitCount;
+        if( (m_Bits[bit >> 3] & (1 << (bit & 7))) == 0 )
+        {
+            m_Skipped++;
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
 /** Setting initial values */
 
 int mc_Permissions::Zero()
 {
     m_Database=NULL;
     m_Ledger=NULL;
+    m_Filter=NULL;
     m_MemPool = NULL;
     m_TmpPool = NULL;
     m_CopiedMemPool=NULL;
@@ -296,6 +447,12 @@ int mc_Permissions::Zero()
     
     m_ThreadRollBackPos=NULL;
     
+    m_BatchThread=0;
+    m_BatchGrantors=NULL;
+    m_BatchLogFile=NULL;
+    m_CommitKeys=NULL;
+    m_BlockUndo=NULL;
+    
     return MC_ERR_NOERROR;
 }
 
@@ -379,26 +536,43 @@ int mc_Permissions::Initialize(const char *name,int mode)
     
     m_TmpPool=new mc_Buffer;
     m_TmpPool->Initialize(m_Database->m_ValueOffset,sizeof(mc_PermissionLedgerRow),MC_BUF_MODE_MAP);
+    m_TmpPool->SetMemTag(MC_MEM_TAG_PERMISSIONS);
+    
+    m_BatchGrantors=new mc_Buffer;
+    m_BatchGrantors->Initialize(MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+sizeof(uint32_t),MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+2*sizeof(uint32_t),MC_BUF_MODE_MAP);
+    m_BatchGrantors->SetMemTag(MC_MEM_TAG_PERMISSIONS);
+    
+    m_CommitKeys=new mc_Buffer;
+    m_CommitKeys->Initialize(m_Database->m_KeySize,m_Database->m_KeySize+sizeof(int),MC_BUF_MODE_MAP);
+    m_CommitKeys->SetMemTag(MC_MEM_TAG_PERMISSIONS);
+    
+    m_BlockUndo=new mc_BlockUndo;
+    m_BlockUndo->Initialize(m_Database->m_KeySize,m_Database->m_ValueSize,MC_MEM_TAG_PERMISSIONS);
         
     m_MemPool=new mc_Buffer;
     
     err=m_MemPool->Initialize(m_Ledger->m_KeySize,m_Ledger->m_TotalSize,MC_BUF_MODE_MAP);
+    m_MemPool->SetMemTag(MC_MEM_TAG_PERMISSIONS);
     
     m_CopiedMemPool=new mc_Buffer;
     
     err=m_CopiedMemPool->Initialize(m_Ledger->m_KeySize,m_Ledger->m_TotalSize,0);
+    m_CopiedMemPool->SetMemTag(MC_MEM_TAG_PERMISSIONS);
     
     m_MempoolPermissions=new mc_Buffer;
     
     err=m_MempoolPermissions->Initialize(sizeof(mc_MempoolPermissionRow),sizeof(mc_MempoolPermissionRow),0);
+    m_MempoolPermissions->SetMemTag(MC_MEM_TAG_PERMISSIONS);
 
     m_MempoolPermissionsToReplay=new mc_Buffer;
     
     err=m_MempoolPermissionsToReplay->Initialize(sizeof(mc_MempoolPermissionRow),sizeof(mc_MempoolPermissionRow),0);
+    m_MempoolPermissionsToReplay->SetMemTag(MC_MEM_TAG_PERMISSIONS);
     
     m_MempoolTxIDs=new mc_Buffer;
     
     err=m_MempoolTxIDs->Initialize(MC_PLS_SIZE_HASH,MC_PLS_SIZE_HASH,0);
+    m_MempoolTxIDs->SetMemTag(MC_MEM_TAG_PERMISSIONS);
     
     pldBlock=-1;
     pldLastRow=1;
@@ -504,6 +678,12 @@ int mc_Permissions::Initialize(const char *name,int mode)
         rollback_pos->Zero();
     }
     
+    m_Filter=new mc_PermissionFilter;
+    if(RebuildFilter())
+    {
+        LogString("Initialize: Cannot build negative lookup filter, all lookups will use database");
+    }
+    
     err=UpdateCounts();
     if(err)
     {
@@ -624,6 +804,19 @@ void mc_Permissions::LogString(const char *message)
 {
     FILE *fHan;
     
+    if(InBatch())                                                               // One open for all grants of the transaction
+    {
+        if(m_BatchLogFile == NULL)
+        {
+            m_BatchLogFile=fopen(m_LogFileName,"a");
+        }
+        if(m_BatchLogFile)
+        {
+            mc_LogString(m_BatchLogFile,message);    
+            return;
+        }
+    }
+    
     fHan=fopen(m_LogFileName,"a");
     if(fHan == NULL)
     {
@@ -679,6 +872,11 @@ int mc_Permissions::Destroy()
         delete m_Ledger;
     }
     
+    if(m_Filter)
+    {
+        delete m_Filter;
+    }
+    
     if(m_MemPool)
     {
         delete m_MemPool;
@@ -687,6 +885,22 @@ int mc_Permissions::Destroy()
     {
         delete m_TmpPool;
     }  
+    if(m_BatchGrantors)
+    {
+        delete m_BatchGrantors;
+    }  
+    if(m_CommitKeys)
+    {
+        delete m_CommitKeys;
+    }  
+    if(m_BlockUndo)
+    {
+        delete m_BlockUndo;
+    }  
+    if(m_BatchLogFile)
+    {
+        fclose(m_BatchLogFile);
+    }
     if(m_CopiedMemPool)
     {
         delete m_CopiedMemPool;        
@@ -1052,12 +1266,21 @@ uint32_t mc_Permissions::GetPermission(const void* lpEntity,const void* lpAddres
         LogString("GetPermission: Database not opened");
         return 0;
     }
-                                                                                
-    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
-    if(err)
+    
+    ptr=NULL;
+    err=MC_ERR_NOERROR;
+    if( (m_Filter == NULL) || m_Filter->MayContain(&pdbRow) )                   // Most addresses have no entity-specific permissions
     {
-        LogString("GetPermission: Cannot read from database");
-        return 0;
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(err)
+        {
+            LogString("GetPermission: Cannot read from database");
+            return 0;
+        }
+        if( (ptr == NULL) && m_Filter && m_Filter->m_Bits)
+        {
+            m_Filter->m_FalsePositives++;
+        }
     }
     
     result=0;
@@ -2069,6 +2292,57 @@ int mc_Permissions::CanActivate(const void* lpEntity,const void* lpAddress)
 
 /** Updates admin and miner counts (NULL entity only) */
 
+/** Rebuilds negative lookup filter from database, on error filter is disabled */
+
+int mc_Permissions::RebuildFilter()
+{
+    int err,value_len;
+    uint64_t capacity;
+    mc_PermissionDBRow pdbRow;
+    unsigned char *ptr;
+    char msg[256];
+    
+    if(m_Filter == NULL)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    capacity=2*m_Filter->m_Keys;
+    do
+    {
+        err=m_Filter->Initialize(capacity,m_Database->m_KeyOffset);
+        if(err)
+        {
+            return err;
+        }
+
+        pdbRow.Zero();
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,MC_OPT_DB_DATABASE_NEXT_ON_READ,&err);
+        while(ptr)
+        {
+            memcpy((char*)&pdbRow+m_Database->m_KeyOffset,ptr,m_Database->m_KeySize);
+            m_Filter->Add(&pdbRow);
+            ptr=(unsigned char*)m_Database->m_DB->MoveNext(&err);
+        }
+        
+        if(err)
+        {
+            m_Filter->Destroy();
+            LogString("Error: Cannot rebuild negative lookup filter");
+            return err;
+        }
+        
+        capacity=2*m_Filter->m_Keys;
+    } while(m_Filter->m_Keys > m_Filter->m_Capacity);
+    
+    m_Filter->m_Rebuilds++;
+    
+    sprintf(msg,"Negative lookup filter rebuilt: keys: %ld, capacity: %ld",m_Filter->m_Keys,m_Filter->m_Capacity);
+    LogString(msg);
+    
+    return MC_ERR_NOERROR;
+}
+
 int mc_Permissions::UpdateCounts()
 {
     mc_PermissionDBRow pdbRow;
@@ -2136,7 +2410,6 @@ int mc_Permissions::UpdateCounts()
         pdbAdminMinerRow.Zero();
         memcpy(pdbAdminMinerRow.m_Entity,adminminerlist_entity,MC_PLS_SIZE_ENTITY);
         pdbAdminMinerRow.m_Type=MC_PTP_CONNECT;
-        
         err=m_Database->m_DB->Write((char*)&pdbAdminMinerRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
                                     (char*)&pdbAdminMinerRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
         if(err)
@@ -3478,19 +3751,9 @@ int mc_Permissions::SetPermission(const void* lpEntity,const void* lpAddress,uin
     
     if(mc_IsNullEntity(lpEntity) || ((flags & MC_PFL_ENTITY_GENESIS) == 0))
     {
-        if(!CanAdmin(lpEntity,lpAdmin))
+        if(!CanGrant(lpEntity,lpAdmin,type))
         {
-            if(IsActivateEnough(type))
-            {
-                if(!CanActivate(lpEntity,lpAdmin))
-                {
-                    return MC_ERR_NOT_ALLOWED;                
-                }
-            }
-            else
-            {
-                return MC_ERR_NOT_ALLOWED;
-            }
+            return MC_ERR_NOT_ALLOWED;
         }    
     }
     
@@ -3500,6 +3763,85 @@ int mc_Permissions::SetPermission(const void* lpEntity,const void* lpAddress,uin
     return result;
 }
 
+/** Returns non-zero if admin can grant permission of this type, cached inside the batch */
+
+int mc_Permissions::CanGrant(const void* lpEntity,const void* lpAdmin,uint32_t type)
+{
+    unsigned char key[MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+2*sizeof(uint32_t)];
+    uint32_t activate_is_enough;
+    uint32_t result;
+    int row;
+    
+    activate_is_enough=IsActivateEnough(type) ? 1 : 0;
+    
+    if(InBatch())
+    {
+        memset(key,0,MC_PLS_SIZE_ENTITY);
+        if(lpEntity)
+        {
+            memcpy(key,lpEntity,MC_PLS_SIZE_ENTITY);
+        }
+        memcpy(key+MC_PLS_SIZE_ENTITY,lpAdmin,MC_PLS_SIZE_ADDRESS);
+        memcpy(key+MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS,&activate_is_enough,sizeof(uint32_t));
+        row=m_BatchGrantors->Seek(key);
+        if(row >= 0)
+        {
+            memcpy(&result,m_BatchGrantors->GetRow(row)+m_BatchGrantors->m_KeySize,sizeof(uint32_t));
+            return result;
+        }
+    }
+    
+    result=CanAdmin(lpEntity,lpAdmin);
+    if( (result == 0) && activate_is_enough )
+    {
+        result=CanActivate(lpEntity,lpAdmin);
+    }
+    
+    if(InBatch())
+    {
+        m_BatchGrantors->Add(key,&result);
+    }
+    
+    return result;
+}
+
+/** 
+ * Starts batch of grants from one transaction.
+ * Grant rights of each admin are checked once and log file is opened once,
+ * both are exactly as without batch - cached rights are reset on every admin/activate row.
+ */
+
+void mc_Permissions::BeginBatch()
+{
+    m_BatchGrantors->Clear();
+    m_BatchThread=__US_ThreadID();
+}
+
+void mc_Permissions::EndBatch()
+{
+    if(!InBatch())
+    {
+        return;
+    }
+    m_BatchThread=0;
+    m_BatchGrantors->Clear();
+    if(m_BatchLogFile)
+    {
+        fclose(m_BatchLogFile);
+        m_BatchLogFile=NULL;
+    }
+}
+
+/** 
+ * Returns non-zero if this thread started the batch. 
+ * Other threads logging or checking grant rights meanwhile don't touch batch log file or cache.
+ */
+
+int mc_Permissions::InBatch()
+{
+    return ( (m_BatchThread != 0) && (m_BatchThread == __US_ThreadID()) ) ? 1 : 0;
+}
+
 /** Sets approval record, external, locks */
 
 int mc_Permissions::SetApproval(const void* lpUpgrade,uint32_t approval,const void* lpAdmin,uint32_t from,uint32_t timestamp,uint32_t flags,int update_mempool,int offset)
@@ -3627,6 +3969,11 @@ int mc_Permissions::SetPermissionInternal(const void* lpEntity,const void* lpAdd
                     }
                     m_MemPool->Add((unsigned char*)&pldRow+m_Ledger->m_KeyOffset,(unsigned char*)&pldRow+m_Ledger->m_ValueOffset);
                     m_Row++;                
+                    
+                    if( (type == MC_PTP_ADMIN) || (type == MC_PTP_ACTIVATE) )
+                    {
+                        m_BatchGrantors->Clear();                               // Grant rights may change
+                    }
 
                     if( (type == MC_PTP_ADMIN) || (type == MC_PTP_MINE))
                     {
@@ -4005,6 +4352,7 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
     
     block_flags=CalculateBlockFlags();
     pld_items=m_MemPool->GetCount();
+    m_BlockUndo->Reset(m_Block,m_Row-pld_items,0);
     
     if(lpMiner)
     {
@@ -4050,16 +4398,31 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
     thisBlock=m_Block+1;
     if(m_MemPool->GetCount())
     {
-        for(i=0;i<pld_items;i++)
+        if(pld_items)                                                           // Mempool rows have ledger layout, written in one call
+        {
+            if(m_Ledger->SetRows(m_Row-m_MemPool->GetCount(),m_MemPool->GetRow(0),pld_items))
+            {
+                LogString("Error: Commit: ledger write error");                        
+                err=MC_ERR_INTERNAL_ERROR;
+            }
+        }
+        
+        m_CommitKeys->Clear();                                                  // Only the last row for each key is written to DB
+        for(i=0;i<m_MemPool->GetCount();i++)
         {
             memcpy((unsigned char*)&pldRow+m_Ledger->m_KeyOffset,m_MemPool->GetRow(i),m_Ledger->m_TotalSize);
-            if(i)
+            pdbRow.Zero();
+            memcpy(pdbRow.m_Entity,pldRow.m_Entity,MC_PLS_SIZE_ENTITY);
+            memcpy(pdbRow.m_Address,pldRow.m_Address,MC_PLS_SIZE_ADDRESS);
+            pdbRow.m_Type=pldRow.m_Type;
+            int key_row=m_CommitKeys->Seek((unsigned char*)&pdbRow+m_Database->m_KeyOffset);
+            if(key_row >= 0)
             {
-                m_Ledger->WriteRow(&pldRow);
+                memcpy(m_CommitKeys->GetRow(key_row)+m_Database->m_KeySize,&i,sizeof(int));
             }
-            else                
+            else
             {
-                m_Ledger->SetRow(m_Row-m_MemPool->GetCount(),&pldRow);
+                m_CommitKeys->Add((unsigned char*)&pdbRow+m_Database->m_KeyOffset,&i);
             }
         }
         
@@ -4067,10 +4430,23 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
         {
             for(i=0;i<m_MemPool->GetCount();i++)
             {
+                int key_row,last_row;
+                memcpy((unsigned char*)&pldRow+m_Ledger->m_KeyOffset,m_MemPool->GetRow(i),m_Ledger->m_TotalSize);
+                pdbRow.Zero();
+                memcpy(pdbRow.m_Entity,pldRow.m_Entity,MC_PLS_SIZE_ENTITY);
+                memcpy(pdbRow.m_Address,pldRow.m_Address,MC_PLS_SIZE_ADDRESS);
+                pdbRow.m_Type=pldRow.m_Type;
+                key_row=m_CommitKeys->Seek((unsigned char*)&pdbRow+m_Database->m_KeyOffset);
+                if(key_row >= 0)
+                {
+                    memcpy(&last_row,m_CommitKeys->GetRow(key_row)+m_Database->m_KeySize,sizeof(int));
+                    if(last_row != i)
+                    {
+                        continue;                                               // Overwritten by later row in this block
+                    }
+                }
                 if(err == MC_ERR_NOERROR)
                 {
-                    memcpy((unsigned char*)&pldRow+m_Ledger->m_KeyOffset,m_MemPool->GetRow(i),m_Ledger->m_TotalSize);
-
                     pdbRow.Zero();
                     memcpy(pdbRow.m_Entity,pldRow.m_Entity,MC_PLS_SIZE_ENTITY);
                     memcpy(pdbRow.m_Address,pldRow.m_Address,MC_PLS_SIZE_ADDRESS);
@@ -4086,8 +4462,13 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
                         m_DBRowCount++;
                     }
  */ 
-                    err=m_Database->m_DB->Write((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&pdbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    m_Filter->Add(&pdbRow);                                     // Updates of existing keys are counted too, rebuild recounts them
+                    err=RecordBlockUndo(&pdbRow);
+                    if(err == MC_ERR_NOERROR)
+                    {
+                        err=m_Database->m_DB->Write((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                                    (char*)&pdbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    }
                     if(err)
                     {
                         LogString("Error: Commit: DB write error");                        
@@ -4179,6 +4560,10 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
 
     if(err == MC_ERR_NOERROR)
     {
+        if(m_Filter->m_Keys > m_Filter->m_Capacity)
+        {
+            RebuildFilter();
+        }
         m_Block++;
         UpdateCounts();        
         m_Block--;
@@ -4198,6 +4583,7 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
     
     if(err)
     {
+        m_BlockUndo->Reset(-1,0,0);
         RollBackInternal(m_Block);        
     }
     else
@@ -4541,6 +4927,7 @@ int mc_Permissions::RollBackInternal(int block)
             else
             {
 //                m_DBRowCount--;
+                m_Filter->m_Stale++;
                 err=m_Database->m_DB->Delete((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                 if(err)
                 {
@@ -4607,6 +4994,10 @@ int mc_Permissions::RollBackInternal(int block)
     
     if(err == MC_ERR_NOERROR)
     {
+        if(m_Filter->m_Stale*MC_PFT_STALE_REBUILD_DIVISOR > m_Filter->m_Keys)    // Deleted keys only raise false positive rate
+        {
+            RebuildFilter();
+        }
         m_Block=block;
         m_Row=this_row;
         UpdateCounts();        
@@ -4619,5 +5010,156 @@ int mc_Permissions::RollBackInternal(int block)
     return err;   
 }
 
+/** Records DB value of the key before it is overwritten by block commit */
+
+int mc_Permissions::RecordBlockUndo(mc_PermissionDBRow *row)
+{
+    int err,value_len;
+    unsigned char *ptr;
+    
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    if(err)
+    {
+        return err;
+    }
+    
+    return m_BlockUndo->Record((char*)row+m_Database->m_KeyOffset,ptr);
+}
+
+/** Returns undo record of the last committed block, block in the header is -1 if commit failed */
+
+mc_BlockUndo *mc_Permissions::GetBlockUndo()
+{
+    return m_BlockUndo;
+}
+
+/** 
+ * Disconnects the last block by restoring DB values recorded by its commit, without walking the ledger.
+ * Returns error without changing the state if the record doesn't match the last block, caller should use RollBack.
+ */
+
+int mc_Permissions::ApplyBlockUndo(int block,const unsigned char *lpUndo,int size)
+{
+    int i,err,found;
+    mc_BlockUndo undo;
+    mc_PermissionDBRow pdbRow;
+    mc_PermissionLedgerRow pldRow;
+    unsigned char *ptr;
+    unsigned char *lpKey;
+    unsigned char *lpValue;
+    int value_len;
+    char msg[256];
+    
+    Lock(1);
+    
+    err=undo.Initialize(m_Database->m_KeySize,m_Database->m_ValueSize,MC_MEM_TAG_PERMISSIONS);
+    if(err == MC_ERR_NOERROR)
+    {
+        err=undo.Load(lpUndo,size);
+    }
+    if(err == MC_ERR_NOERROR)
+    {
+        if( (undo.m_Header.m_Block != block) || (m_Block != block+1) || (undo.m_Header.m_Row <= 0) || 
+            (undo.m_Header.m_Row > (int64_t)(m_Row-m_MemPool->GetCount())) )
+        {
+            err=MC_ERR_NOT_ALLOWED;
+        }
+    }
+    if(err)
+    {
+        UnLock();
+        return err;
+    }
+    
+    if(m_Ledger->Open() <= 0)
+    {
+        UnLock();
+        LogString("Error: Block undo: couldn't open ledger");
+        return MC_ERR_DBOPEN_ERROR;
+    }
+    
+    ClearMemPoolInternal();
+    
+    for(i=0;i<undo.m_Rows->GetCount();i++)
+    {
+        if(err == MC_ERR_NOERROR)
+        {
+            found=undo.GetRow(i,&lpKey,&lpValue);
+            if(found)
+            {
+                err=m_Database->m_DB->Write((char*)lpKey,m_Database->m_KeySize,(char*)lpValue,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            }
+            else
+            {
+                m_Filter->m_Stale++;
+                err=m_Database->m_DB->Delete((char*)lpKey,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            }
+            if(err)
+            {
+                LogString("Error: Block undo: db write error");                    
+            }
+        }
+    }
+    
+    if(err == MC_ERR_NOERROR)                                                   // Same as in RollBackInternal
+    {
+        pdbRow.Zero();
+        
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(ptr)
+        {
+            memcpy((char*)&pdbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+        }
+        pdbRow.m_BlockTo=block;
+        pdbRow.m_LedgerRow=undo.m_Header.m_Row;
+        err=m_Database->m_DB->Write((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                    (char*)&pdbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+        if(err)
+        {
+            LogString("Error: Block undo: db write error (0)");                    
+        }
+    }
+    
+    if(err == MC_ERR_NOERROR)
+    {
+        err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }    
+    
+    if(err == MC_ERR_NOERROR)
+    {
+        m_Ledger->GetRow(0,&pldRow);
+
+        pldRow.m_BlockTo=block;
+        pldRow.m_PrevRow=undo.m_Header.m_Row;
+        m_Ledger->SetRow(0,&pldRow);        
+    }
+    
+    m_Ledger->Close();  
+    
+    if(err == MC_ERR_NOERROR)
+    {
+        if(m_Filter->m_Stale*MC_PFT_STALE_REBUILD_DIVISOR > m_Filter->m_Keys)
+        {
+            RebuildFilter();
+        }
+        m_Block=block;
+        m_Row=undo.m_Header.m_Row;
+        UpdateCounts();        
+        m_ClearedAdminCount=m_AdminCount;
+        m_ClearedMinerCount=m_MinerCount;
+        m_BlockUndo->Reset(-1,0,0);
+        
+        sprintf(msg,"Block undo    : %9d, Admin count: %d, Miner count: %d, Ledger Rows: %ld, Keys: %d",m_Block,m_AdminCount,m_MinerCount,m_Row,undo.m_Rows->GetCount());
+        LogString(msg);
+    }
+    else
+    {
+        err=RollBackInternal(block);                                            // DB keys not committed yet, ledger walk restores them
+    }
+    
+    UnLock();
+    return err;
+}
+
 
 
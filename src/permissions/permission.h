@@ -7,6 +7,8 @@
 #include "utils/declare.h"
 #include "utils/dbwrapper.h"
 
+#include <atomic>
+
 #define MC_PTP_NONE             0x00000000
 #define MC_PTP_CONNECT          0x00000001
 #define MC_PTP_SEND             0x00000002
@@ -62,6 +64,11 @@
 #define MC_PPL_REPLAY             0x00000001    
 #define MC_PPL_ADMINMINERGRANT    0x00000002    
 
+#define MC_PFT_BITS_PER_KEY             10                                      // Negative lookup filter bits per key, ~1% false positives
+#define MC_PFT_HASH_COUNT                7                                      // Number of negative lookup filter hash functions
+#define MC_PFT_MIN_CAPACITY          65536                                      // Minimal number of keys negative lookup filter is sized for
+#define MC_PFT_STALE_REBUILD_DIVISOR     8                                      // Filter is rebuilt after rollback if more than 1/8 of its keys were deleted
+
 #define MC_PSE_UPGRADE                0x01                                      
 #define MC_PSE_ADMINMINERLIST         0x02                                      
 
@@ -146,6 +153,39 @@ typedef struct mc_PermissionDB
     void SetName(const char *name);
 } mc_PermissionDB;
 
+/** Probabilistic filter of (entity,address) pairs found in permission database, no false negatives */
+
+typedef struct mc_PermissionFilter
+{
+    unsigned char *m_Bits;                                                      // Bit array, NULL - filter is not built, all lookups go to database
+    uint64_t m_BitCount;                                                        // Size of the bit array in bits
+    uint64_t m_Capacity;                                                        // Number of keys filter is sized for
+    uint64_t m_Keys;                                                            // Keys added since last rebuild
+    uint64_t m_Stale;                                                           // Keys deleted from database since last rebuild
+    uint32_t m_KeyOffset;                                                       // Offset of the filtered part of mc_PermissionDBRow, ends before m_Type
+    std::atomic<int64_t> m_Lookups;                                             // Database lookups checked against filter
+    std::atomic<int64_t> m_Skipped;                                             // Definite misses, database read skipped
+    std::atomic<int64_t> m_FalsePositives;                                      // Filter hits not found in database
+    std::atomic<int64_t> m_Rebuilds;                                            // Number of rebuilds
+
+    mc_PermissionFilter()
+    {
+        Zero();
+    }
+    
+    ~mc_PermissionFilter()
+    {
+        Destroy();
+    }
+    
+    void Zero();
+    int Destroy();
+    int Initialize(uint64_t capacity,uint32_t key_offset);
+    void Add(const void *lpRow);
+    int MayContain(const void *lpRow);
+    uint64_t GetHash(const void *lpRow);
+} mc_PermissionFilter;
+
 /** Ledger and mempool record structure */
 
 typedef struct mc_PermissionLedgerRow
@@ -222,6 +262,7 @@ typedef struct mc_PermissionLedger
     uint64_t GetSize();
     int WriteRow(mc_PermissionLedgerRow *row);
     int SetRow(uint64_t RowID,mc_PermissionLedgerRow *row);
+    int SetRows(uint64_t RowID,const unsigned char *rows,int count);
     
 } mc_PermissionLedger;
 
@@ -264,6 +305,7 @@ typedef struct mc_Permissions
 {    
     mc_PermissionDB *m_Database;
     mc_PermissionLedger *m_Ledger;
+    mc_PermissionFilter *m_Filter;
     mc_Buffer   *m_MemPool;
     mc_Buffer   *m_TmpPool;
     char m_Name[MC_PRM_NETWORK_NAME_MAX_SIZE+1]; 
@@ -299,6 +341,12 @@ typedef struct mc_Permissions
     
     mc_Buffer   *m_ThreadRollBackPos;
     
+    uint64_t m_BatchThread;                                                     // Thread inside BeginBatch/EndBatch, 0 if none. Batch state is used only by this thread
+    mc_Buffer   *m_BatchGrantors;                                               // (entity,admin,activate-is-enough) -> result of grant right check 
+    FILE        *m_BatchLogFile;                                                // Log file kept open for the batch
+    mc_Buffer   *m_CommitKeys;                                                  // DB key -> last mempool row with this key, used in commit
+    mc_BlockUndo *m_BlockUndo;                                                  // DB values before last committed block, written to block undo file
+    
     void *m_Semaphore;
     uint64_t m_LockedBy;
 
@@ -322,9 +370,14 @@ typedef struct mc_Permissions
     const void* GetMempoolTxID(int pos);
     
     int SetApproval(const void* lpUpgrade,uint32_t approval,const void* lpAdmin,uint32_t from,uint32_t timestamp,uint32_t flags,int update_mempool,int offset);
+    void BeginBatch();
+    void EndBatch();
+    int InBatch();
     int Commit(const void* lpMiner,const void* lpHash);
     int RollBack(int block);
     int RollBack();
+    mc_BlockUndo *GetBlockUndo();
+    int ApplyBlockUndo(int block,const unsigned char *lpUndo,int size);
     
     int ClearMemPool();
     int CopyMemPool();
@@ -406,9 +459,11 @@ typedef struct mc_Permissions
     int SetPermissionInternal(const void* lpEntity,const void* lpAddress,uint32_t type,const void* lpAdmin,uint32_t from,uint32_t to,uint32_t timestamp,
                                                                                                            uint32_t flags,int update_mempool,int offset);
     int CanConnectInternal(const void* lpEntity,const void* lpAddress,int with_implicit);
+    int CanGrant(const void* lpEntity,const void* lpAdmin,uint32_t type);
     int CommitInternal(const void* lpMiner,const void* lpHash);
     int StoreBlockInfoInternal(const void* lpMiner,const void* lpHash,int update_counts);    
     int RollBackInternal(int block);
+    int RecordBlockUndo(mc_PermissionDBRow *row);
     uint32_t CalculateBlockFlags();
     int FindLastAllowedMinerRow(mc_PermissionLedgerRow *row,uint32_t block,int prev_result);
     
@@ -418,6 +473,7 @@ typedef struct mc_Permissions
     int AdminConsensus(const void* lpEntity,uint32_t type);
     
     int ClearMemPoolInternal();
+    int RebuildFilter();
 
     
     
@@ -440,6 +496,28 @@ typedef struct mc_Permissions
     
 } mc_Permissions;
 
+/** Keeps permission DB in batch mode for the lifetime of the object, ends batch on every exit path */
+
+typedef struct mc_PermissionBatch
+{
+    mc_Permissions *m_Permissions;
+    
+    mc_PermissionBatch(mc_Permissions *permissions)
+    {
+        m_Permissions=permissions;
+        m_Permissions->BeginBatch();
+    }
+    
+    ~mc_PermissionBatch()
+    {
+        m_Permissions->EndBatch();
+    }
+    
+private:
+    mc_PermissionBatch(const mc_PermissionBatch&);
+    mc_PermissionBatch& operator=(const mc_PermissionBatch&);
+} mc_PermissionBatch;
+
 
 
 #endif	/* MULTICHAIN_PERMISSION_H */
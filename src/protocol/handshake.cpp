@@ -203,6 +203,21 @@ bool ProcessMultichainVerack(CNode* pfrom, CDataStream& vRecv,bool fIsVerackack,
     
     vRecv >> sSigScript;
     
+    if(!fIsVerackack)
+    {
+        pfrom->fCompressionSend=false;
+        if(fP2PCompression && (vRecv.size() >= sizeof(uint32_t)))              // Optional trailing field, ignored by older nodes
+        {
+            uint32_t nCompression;
+            vRecv >> nCompression;
+            if(nCompression & MC_NET_COMPRESSION_LZ)
+            {
+                pfrom->fCompressionSend=true;
+                if(fDebug)LogPrint("mchn","mchn: P2P compression enabled for messages to peer=%d\n", pfrom->id);
+            }
+        }
+    }
+    
     if(mc_gState->m_NetworkParams->m_Status == MC_PRM_STATUS_VALID)
     {
         if(!VerifyMultichainVerackHash(sParameterSetHash,nNonce))
@@ -585,13 +600,29 @@ bool PushMultiChainVerack(CNode* pfrom, bool fIsVerackack)
     if(!fIsVerackack)
     {
         GetRandBytes((unsigned char*)&(pfrom->nVerackNonceSent), sizeof(pfrom->nVerackNonceSent));
-        if(vEntData.size())
+        pfrom->fCompressionRecv=fP2PCompression;
+        if(fP2PCompression)                                                     // Compression codecs we accept are appended after signature
         {
-            pfrom->PushMessage("verack", pfrom->nVerackNonceSent, vParameterSet, vEntData, vParameterSetHash, vSigScript);                    
+            uint32_t nCompression=MC_NET_COMPRESSION_LZ;
+            if(vEntData.size())
+            {
+                pfrom->PushMessage("verack", pfrom->nVerackNonceSent, vParameterSet, vEntData, vParameterSetHash, vSigScript, nCompression);                    
+            }
+            else
+            {
+                pfrom->PushMessage("verack", pfrom->nVerackNonceSent, vParameterSet, vParameterSetHash, vSigScript, nCompression);        
+            }            
         }
         else
         {
-            pfrom->PushMessage("verack", pfrom->nVerackNonceSent, vParameterSet, vParameterSetHash, vSigScript);        
+            if(vEntData.size())
+            {
+                pfrom->PushMessage("verack", pfrom->nVerackNonceSent, vParameterSet, vEntData, vParameterSetHash, vSigScript);                    
+            }
+            else
+            {
+                pfrom->PushMessage("verack", pfrom->nVerackNonceSent, vParameterSet, vParameterSetHash, vSigScript);        
+            }
         }
     }
     else
@@ -9,6 +9,7 @@
 #include "multichain/multichain.h"
 #include "wallet/wallettxs.h"
 #include "community/community.h"
+#include "structs/blockfilter.h"
 
 #include <boost/assign/list_of.hpp>
 
@@ -925,3 +926,71 @@ bool CheckBlockPermissions(const CBlock& block,CBlockIndex* prev_block,unsigned
     return checked;
 }
 
+void GetBlockFilterElements(const CBlock& block,vector<vector<unsigned char> >& vElements)
+{
+    mc_Script *lpScript;
+    unsigned char short_txid[MC_AST_SHORT_TXID_SIZE];
+    unsigned char item_key[MC_ENT_MAX_ITEM_KEY_SIZE];
+    int item_key_size;
+    int op_addr_offset,op_addr_size,is_redeem_script,sighash_type;
+    bool has_items;
+    vector<unsigned char> vElement;
+    
+    lpScript=new mc_Script;                                                     // Not m_TmpScript - may be called outside validation 
+    
+    BOOST_FOREACH(const CTransaction& tx, block.vtx)
+    {
+        has_items=false;
+        for(unsigned int j=0;j<tx.vout.size();j++)
+        {
+            const CScript& script1 = tx.vout[j].scriptPubKey;        
+            CScript::const_iterator pc1 = script1.begin();
+            
+            lpScript->Clear();
+            lpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+            lpScript->ExtractAndDeleteDataFormat(NULL);
+            if( (lpScript->IsOpReturnScript() == 0) || (lpScript->GetNumElements() < 2) )
+            {
+                continue;
+            }
+            lpScript->SetElement(0);
+            if(lpScript->GetEntity(short_txid))                                 // Not a stream item
+            {
+                continue;
+            }
+            has_items=true;
+            CBlockFilter::MakeElement(vElement,BLOCKFILTER_ELEMENT_STREAM,short_txid,MC_AST_SHORT_TXID_SIZE,NULL,0);
+            vElements.push_back(vElement);
+            for(int e=1;e<lpScript->GetNumElements()-1;e++)
+            {
+                lpScript->SetElement(e);
+                if(lpScript->GetItemKey(item_key,&item_key_size) == 0)
+                {
+                    CBlockFilter::MakeElement(vElement,BLOCKFILTER_ELEMENT_KEY,short_txid,MC_AST_SHORT_TXID_SIZE,item_key,item_key_size);
+                    vElements.push_back(vElement);
+                }
+            }
+        }
+        
+        if(!has_items || tx.IsCoinBase())
+        {
+            continue;
+        }
+        
+        for(unsigned int i=0;i<tx.vin.size();i++)                               // Publishers - signers of the inputs, as in stream item validation 
+        {
+            const CScript& script2 = tx.vin[i].scriptSig;        
+            CScript::const_iterator pc2 = script2.begin();
+            
+            if(mc_ExtractAddressFromInputScript((unsigned char*)(&pc2[0]),(int)(script2.end()-pc2),&op_addr_offset,&op_addr_size,&is_redeem_script,&sighash_type,0) == NULL)
+            {
+                continue;
+            }
+            uint160 publisher=Hash160(pc2+op_addr_offset,pc2+op_addr_offset+op_addr_size);
+            CBlockFilter::MakeElement(vElement,BLOCKFILTER_ELEMENT_PUBLISHER,NULL,0,(unsigned char*)&publisher,sizeof(publisher));
+            vElements.push_back(vElement);
+        }
+    }
+    
+    delete lpScript;
+}
@@ -71,9 +71,18 @@ int mc_Script::Destroy()
         mc_Delete(m_lpCoord);
     }
     
+    mc_MemAccount(m_MemTag,-((int64_t)m_AllocSize+(int64_t)m_AllocElements*2*sizeof(int)));
+    
     return Zero();
 }
 
+void mc_Script::SetMemTag(int tag)
+{
+    mc_MemAccount(m_MemTag,-((int64_t)m_AllocSize+(int64_t)m_AllocElements*2*sizeof(int)));
+    m_MemTag=tag;
+    mc_MemAccount(m_MemTag,(int64_t)m_AllocSize+(int64_t)m_AllocElements*2*sizeof(int));
+}
+
 int mc_Script::Resize(size_t bytes,int elements)
 {
     int NewSize;
@@ -102,6 +111,7 @@ int mc_Script::Resize(size_t bytes,int elements)
             mc_Delete(m_lpData);
         }
         m_lpData=lpNewBuffer;
+        mc_MemAccount(m_MemTag,NewSize-m_AllocSize);
         m_AllocSize=NewSize;
     }
     
@@ -127,6 +137,7 @@ int mc_Script::Resize(size_t bytes,int elements)
             mc_Delete(m_lpCoord);
         }
         m_lpCoord=lpNewCoord;
+        mc_MemAccount(m_MemTag,(int64_t)(NewSize-m_AllocElements)*2*sizeof(int));
         m_AllocElements=NewSize;
     }
     
@@ -31,9 +31,11 @@ typedef struct mc_Script
     int m_AllocSize;
     int m_ScriptType;
     uint32_t m_Restrictions;
+    int m_MemTag;                                                               // Subsystem allocation is accounted to, kept by Zero()
     
     mc_Script()
     {
+        m_MemTag=MC_MEM_TAG_NONE;
         Zero();
     }
 
@@ -45,6 +47,7 @@ typedef struct mc_Script
     int Zero();
     int Destroy();    
     int Resize(size_t bytes,int elements);
+    void SetMemTag(int tag);
     
     int SetScript(const unsigned char* src,const size_t bytes,int type);
     int IsOpReturnScript();
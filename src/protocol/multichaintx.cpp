@@ -73,9 +73,11 @@ typedef struct CMultiChainTxDetails
     int64_t total_value_in;                                                     // Total amount in inputs
     int64_t total_value_out;                                                    // Total amount in outputs
     int emergency_disapproval_output;                                           // Output carrying emergency filter disapproval - bypassed by filters
+    mc_ValidationContext *context;                                              // Scratch scripts and asset buffers of the validating thread
     
     CMultiChainTxDetails()
     {
+        context=mc_gState->m_ValidationContext;
         Zero();
     }
     
@@ -169,21 +171,21 @@ void CMultiChainTxDetails::SetAffectedLibrary(void *entity)
     }    
 }
 
-uint160 mc_GenesisAdmin(const CTransaction& tx)
+uint160 mc_GenesisAdmin(const CTransaction& tx,mc_ValidationContext *context)
 {
     uint32_t type,from,to,timestamp;    
     for (unsigned int j = 0; j < tx.vout.size(); j++)
     {
-        mc_gState->m_TmpScript->Clear();
+        context->m_TmpScript->Clear();
         const CScript& script1 = tx.vout[j].scriptPubKey;        
         CScript::const_iterator pc1 = script1.begin();
         CTxDestination addressRet;
 
-        mc_gState->m_TmpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
-        for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+        context->m_TmpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+        for (int e = 0; e < context->m_TmpScript->GetNumElements(); e++)
         {
-            mc_gState->m_TmpScript->SetElement(e);
-            if(mc_gState->m_TmpScript->GetPermission(&type,&from,&to,&timestamp) == 0)
+            context->m_TmpScript->SetElement(e);
+            if(context->m_TmpScript->GetPermission(&type,&from,&to,&timestamp) == 0)
             {
                 if(type == MC_PTP_GLOBAL_ALL)
                 {
@@ -203,25 +205,25 @@ uint160 mc_GenesisAdmin(const CTransaction& tx)
     return 0;
 }
 
-bool mc_ExtractInputAssetQuantities(mc_Buffer *assets, const CScript& script1, uint256 hash, string& reason)
+bool mc_ExtractInputAssetQuantities(mc_ValidationContext *context,mc_Buffer *assets, const CScript& script1, uint256 hash, string& reason)
 {
     int err;
     int64_t quantity;
     CScript::const_iterator pc1 = script1.begin();
 
-    mc_gState->m_TmpScript->Clear();
-    mc_gState->m_TmpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+    context->m_TmpScript->Clear();
+    context->m_TmpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
 
-    for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+    for (int e = 0; e < context->m_TmpScript->GetNumElements(); e++)
     {
-        mc_gState->m_TmpScript->SetElement(e);
-        err=mc_gState->m_TmpScript->GetAssetQuantities(assets,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER | MC_SCR_ASSET_SCRIPT_TYPE_FOLLOWON | MC_SCR_ASSET_SCRIPT_TYPE_TOKEN);
+        context->m_TmpScript->SetElement(e);
+        err=context->m_TmpScript->GetAssetQuantities(assets,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER | MC_SCR_ASSET_SCRIPT_TYPE_FOLLOWON | MC_SCR_ASSET_SCRIPT_TYPE_TOKEN);
         if((err != MC_ERR_NOERROR) && (err != MC_ERR_WRONG_SCRIPT))
         {
             reason="Asset transfer script rejected - error in script";
             return false;                                
         }
-        err=mc_gState->m_TmpScript->GetAssetGenesis(&quantity);
+        err=context->m_TmpScript->GetAssetGenesis(&quantity);
         if(err == 0)
         {
             mc_EntityDetails entity;
@@ -269,16 +271,16 @@ bool mc_CompareAssetQuantities(CMultiChainTxDetails *details,string& reason)
     int64_t quantity;
     mc_EntityDetails entity;
 
-    for(int i=0;i<mc_gState->m_TmpAssetsIn->GetCount();i++)
+    for(int i=0;i<details->context->m_TmpAssetsIn->GetCount();i++)
     {
-        ptrIn=mc_gState->m_TmpAssetsIn->GetRow(i);
-        int row=mc_gState->m_TmpAssetsOut->Seek(ptrIn);
+        ptrIn=details->context->m_TmpAssetsIn->GetRow(i);
+        int row=details->context->m_TmpAssetsOut->Seek(ptrIn);
         quantity=mc_GetABQuantity(ptrIn);
         if(quantity>0)
         {
             if(row>=0)
             {
-                ptrOut=mc_gState->m_TmpAssetsOut->GetRow(row);       
+                ptrOut=details->context->m_TmpAssetsOut->GetRow(row);       
                 if(memcmp(ptrIn,ptrOut,MC_AST_ASSET_QUANTITY_OFFSET+MC_AST_ASSET_QUANTITY_SIZE))
                 {
                     reason="Asset transfer script rejected - mismatch in input/output quantities";
@@ -293,10 +295,10 @@ bool mc_CompareAssetQuantities(CMultiChainTxDetails *details,string& reason)
         }
     }
     
-    for(int i=0;i<mc_gState->m_TmpAssetsOut->GetCount();i++)
+    for(int i=0;i<details->context->m_TmpAssetsOut->GetCount();i++)
     {
-        ptrOut=mc_gState->m_TmpAssetsOut->GetRow(i);
-        int row=mc_gState->m_TmpAssetsIn->Seek(ptrOut);
+        ptrOut=details->context->m_TmpAssetsOut->GetRow(i);
+        int row=details->context->m_TmpAssetsIn->Seek(ptrOut);
         quantity=mc_GetABQuantity(ptrOut);
 
         if(mc_gState->m_Assets->FindEntityByFullRef(&entity,ptrOut) == 0)
@@ -311,7 +313,7 @@ bool mc_CompareAssetQuantities(CMultiChainTxDetails *details,string& reason)
         {
             if(row>=0)
             {
-                ptrIn=mc_gState->m_TmpAssetsIn->GetRow(row);       
+                ptrIn=details->context->m_TmpAssetsIn->GetRow(row);       
                 if(memcmp(ptrIn,ptrOut,MC_AST_ASSET_QUANTITY_OFFSET+MC_AST_ASSET_QUANTITY_SIZE))
                 {
                     reason="Asset transfer script rejected - mismatch in input/output quantities";
@@ -329,11 +331,16 @@ bool mc_CompareAssetQuantities(CMultiChainTxDetails *details,string& reason)
     return true;
 }
 
-void MultiChainTransaction_SetTmpOutputScript(const CScript& script1)
+void MultiChainTransaction_SetOutputScript(mc_ValidationContext *context,const CScript& script1)
 {
     CScript::const_iterator pc1 = script1.begin();
-    mc_gState->m_TmpScript->Clear();
-    mc_gState->m_TmpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+    context->m_TmpScript->Clear();
+    context->m_TmpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+}
+
+void MultiChainTransaction_SetTmpOutputScript(const CScript& script1)
+{
+    MultiChainTransaction_SetOutputScript(mc_gState->m_ValidationContext,script1);
 }
 
 bool MultiChainTransaction_CheckCachedScriptFlag(const CTransaction& tx)
@@ -361,7 +368,7 @@ bool MultiChainTransaction_CheckCoinbaseInputs(const CTransaction& tx,
     if(mc_gState->m_Permissions->m_Block == -1)                     
     {                    
         details->vInputScriptTypes.push_back(TX_PUBKEYHASH);
-        details->vInputDestinations.push_back(mc_GenesisAdmin(tx));             // Genesis admin is considered to be admin/opener of everything in genesis coinbase        
+        details->vInputDestinations.push_back(mc_GenesisAdmin(tx,details->context)); // Genesis admin is considered to be admin/opener of everything in genesis coinbase        
     }
     else
     {
@@ -377,30 +384,30 @@ bool MultiChainTransaction_CheckCoinbaseInputs(const CTransaction& tx,
 }
 
 
-bool MultiChainTransaction_CheckInputs(const CTransaction& tx,                  // Tx to check
-                                       const CCoinsViewCache &inputs,           // Tx inputs from UTXO database
-                                       CMultiChainTxDetails *details,           // Tx details object
-                                       string& reason)                          // Error message
-        
+bool MultiChainTransaction_PrecheckInputs(const CTransaction& tx,             // Tx to check
+                                          CMultiChainInputPrecheck *precheck)   // Precheck object, vPrevScripts should be filled
 {
+    precheck->fDone=true;
+    precheck->nFailedInput=-1;
+    precheck->fScriptHashAllFound=false;
+    precheck->fRejectIfOpDropOpReturn=false;
+    precheck->vInputScriptTypes.clear();
+    precheck->vInputDestinations.clear();
+    precheck->vInputHashTypes.clear();
+    precheck->vInputAddresses.clear();
+    
     for (unsigned int i = 0; i < tx.vin.size(); i++)                            
     {                                                                                                                                                                
         const CScript& script2 = tx.vin[i].scriptSig;        
         CScript::const_iterator pc2 = script2.begin();
         if (!script2.IsPushOnly())
         {
-            reason="sigScript should be push-only";
+            precheck->nFailedInput=i;
+            precheck->reason="sigScript should be push-only";
             return false;
         }
 
-        const COutPoint &prevout = tx.vin[i].prevout;
-        const CCoins *coins = inputs.AccessCoins(prevout.hash);
-        assert(coins);
-
-        const CScript& script1 = coins->vout[prevout.n].scriptPubKey;        
-        CScript::const_iterator pc1 = script1.begin();
-
-        details->total_value_in+=coins->vout[prevout.n].nValue;
+        const CScript& script1 = precheck->vPrevScripts[i];        
         
         txnouttype typeRet;
         int nRequiredRet;
@@ -416,7 +423,8 @@ bool MultiChainTransaction_CheckInputs(const CTransaction& tx,
                 CScriptID *lpScriptID=boost::get<CScriptID> (&addressRets[0]);
                 if( (lpKeyID == NULL) && (lpScriptID == NULL) )
                 {
-                    reason="Internal error: cannot extract address from input scriptPubKey";
+                    precheck->nFailedInput=i;
+                    precheck->reason="Internal error: cannot extract address from input scriptPubKey";
                     return false;
                 }
                 else
@@ -425,16 +433,16 @@ bool MultiChainTransaction_CheckInputs(const CTransaction& tx,
                     {
                         if(lpKeyID)
                         {
-                            details->vInputDestinations.push_back(*(uint160*)lpKeyID);                               
+                            precheck->vInputDestinations.push_back(*(uint160*)lpKeyID);                               
                         }
                         if(lpScriptID)
                         {
-                            details->vInputDestinations.push_back(*(uint160*)lpScriptID);                               
+                            precheck->vInputDestinations.push_back(*(uint160*)lpScriptID);                               
                         }
                     }
                     else
                     {
-                        details->vInputDestinations.push_back(0);               // Multisig scripts cannot be used for signing tx objects - issues, stream items, etc.
+                        precheck->vInputDestinations.push_back(0);              // Multisig scripts cannot be used for signing tx objects - issues, stream items, etc.
                     }
                 }
 
@@ -442,7 +450,7 @@ bool MultiChainTransaction_CheckInputs(const CTransaction& tx,
                 if( (typeRet == TX_PUBKEY) || (typeRet == TX_MULTISIG) )
                 {
                     check_last=1;
-                    details->fRejectIfOpDropOpReturn=true;                      // pay-to-pubkey and bare multisig  scripts cannot be considered "publisher" for the stream, 
+                    precheck->fRejectIfOpDropOpReturn=true;                     // pay-to-pubkey and bare multisig  scripts cannot be considered "publisher" for the stream, 
                                                                                 // because we cannot extract publisher address from the input script itself. 
                                                                                 // Though we can still accept this transaction, it is rejected for consistency with principle
                                                                                 // "each input which signs the stream item must have permitted writer"
@@ -452,50 +460,129 @@ bool MultiChainTransaction_CheckInputs(const CTransaction& tx,
                 mc_ExtractAddressFromInputScript((unsigned char*)(&pc2[0]),(int)(script2.end()-pc2),&op_addr_offset,&op_addr_size,&is_redeem_script,&sighash_type,check_last);        
                 if(sighash_type == SIGHASH_ALL)
                 {
-                    details->fScriptHashAllFound=true;
+                    precheck->fScriptHashAllFound=true;
                 }
                 if(sighash_type == SIGHASH_SINGLE)
                 {
                     if(i >= tx.vout.size())
                     {
-                        reason="SIGHASH_SINGLE input without matching output";
+                        precheck->nFailedInput=i;
+                        precheck->reason="SIGHASH_SINGLE input without matching output";
                         return false;                                
                     }
                 }                    
             }
             else                                                                // Null-data script
             {
-                details->fRejectIfOpDropOpReturn=true;                          // Null data scripts cannot be used in txs with OP_DROP+OP_RETURN
+                precheck->fRejectIfOpDropOpReturn=true;                         // Null data scripts cannot be used in txs with OP_DROP+OP_RETURN
                                                                                 // We should not be there at all 
-                details->vInputDestinations.push_back(0);       
+                precheck->vInputDestinations.push_back(0);       
             }            
-            details->vInputScriptTypes.push_back(typeRet);
+            precheck->vInputScriptTypes.push_back(typeRet);
         }
         else                                                                    // Non-standard script        
         {
-            details->fRejectIfOpDropOpReturn=true;                              // Non-standard inputs cannot be used in txs with OP_DROP+OP_RETURN
+            precheck->fRejectIfOpDropOpReturn=true;                             // Non-standard inputs cannot be used in txs with OP_DROP+OP_RETURN
                                                                                 // We cannot be sure where are the signatures in input script
-            details->vInputScriptTypes.push_back(TX_NONSTANDARD);
-            details->vInputDestinations.push_back(0);                                
+            precheck->vInputScriptTypes.push_back(TX_NONSTANDARD);
+            precheck->vInputDestinations.push_back(0);                                
         }            
 
-        details->vInputHashTypes.push_back(sighash_type);        
+        precheck->vInputHashTypes.push_back(sighash_type);        
+        precheck->vInputAddresses.push_back(addressRets);
+    }    
+    
+    return true;
+}
+
+bool CMultiChainInputCheck::operator()() 
+{
+    MultiChainTransaction_PrecheckInputs(*ptxTo,pPrecheck);                     // Rejection is reported by serial checks, in tx order
+    return true;
+}
+
+bool MultiChainTransaction_CheckInputs(const CTransaction& tx,                  // Tx to check
+                                       const CCoinsViewCache &inputs,           // Tx inputs from UTXO database
+                                       const CMultiChainInputPrecheck *precheck,// Context-free part of the check, performed in advance, NULL if not
+                                       CMultiChainTxDetails *details,           // Tx details object
+                                       string& reason)                          // Error message
+        
+{
+    CMultiChainInputPrecheck local_precheck;
+    
+    if(precheck)
+    {
+        if( !precheck->fDone || (precheck->vPrevScripts.size() != tx.vin.size()) )
+        {
+            precheck=NULL;
+        }
+    }
+    
+    for (unsigned int i = 0; i < tx.vin.size(); i++)                            
+    {                                                                                                                                                                
+        const COutPoint &prevout = tx.vin[i].prevout;
+        const Coin &coin = inputs.AccessCoin(prevout);
+        assert(!coin.IsSpent());
+
+        const CScript& script1 = coin.out.scriptPubKey;        
+        if(precheck)
+        {
+            if(precheck->vPrevScripts[i] != script1)                            // Precheck was done for different inputs, redoing it
+            {
+                precheck=NULL;
+            }
+        }
+        local_precheck.vPrevScripts.push_back(script1);
+    }
+    
+    if(precheck == NULL)
+    {
+        MultiChainTransaction_PrecheckInputs(tx,&local_precheck);
+        precheck=&local_precheck;
+    }
+    
+    if(precheck->fScriptHashAllFound)
+    {
+        details->fScriptHashAllFound=true;
+    }
+    if(precheck->fRejectIfOpDropOpReturn)
+    {
+        details->fRejectIfOpDropOpReturn=true;
+    }
+    
+    for (unsigned int i = 0; i < tx.vin.size(); i++)                            
+    {                                                                                                                                                                
+        if((int)i == precheck->nFailedInput)
+        {
+            reason=precheck->reason;
+            return false;
+        }
+        
+        const COutPoint &prevout = tx.vin[i].prevout;
+        const Coin &coin = inputs.AccessCoin(prevout);
+        const CScript& script1 = coin.out.scriptPubKey;        
+
+        details->total_value_in+=coin.out.nValue;
+        
+        details->vInputScriptTypes.push_back(precheck->vInputScriptTypes[i]);
+        details->vInputDestinations.push_back(precheck->vInputDestinations[i]);
+        details->vInputHashTypes.push_back(precheck->vInputHashTypes[i]);        
 
         if(mc_gState->m_Features->PerAssetPermissions())                        // Checking per-asset send permissions
         {
-            mc_gState->m_TmpAssetsTmp->Clear();
-            if(!mc_ExtractInputAssetQuantities(mc_gState->m_TmpAssetsTmp,script1,prevout.hash,reason))    
+            details->context->m_TmpAssetsTmp->Clear();
+            if(!mc_ExtractInputAssetQuantities(details->context,details->context->m_TmpAssetsTmp,script1,prevout.hash,reason))    
             {
                 return false;
             }
-            if(!mc_VerifyAssetPermissions(mc_gState->m_TmpAssetsTmp,addressRets,1,MC_PTP_SEND,reason))
+            if(!mc_VerifyAssetPermissions(details->context->m_TmpAssetsTmp,precheck->vInputAddresses[i],1,MC_PTP_SEND,reason))
             {
                 return false;                                
             }
         }
 
                                                                                 // Filling input asset quantity list
-        if(!mc_ExtractInputAssetQuantities(mc_gState->m_TmpAssetsIn,script1,prevout.hash,reason))   
+        if(!mc_ExtractInputAssetQuantities(details->context,details->context->m_TmpAssetsIn,script1,prevout.hash,reason))   
         {
             return false;
         }                
@@ -515,8 +602,8 @@ bool MultiChainTransaction_CheckNewEntity(int vout,
     int err;
     int entity_update;
     
-    mc_gState->m_TmpScript->SetElement(0);
-    err=mc_gState->m_TmpScript->GetNewEntityType(&(details->new_entity_type),&entity_update,details->details_script,&(details->details_script_size));
+    details->context->m_TmpScript->SetElement(0);
+    err=details->context->m_TmpScript->GetNewEntityType(&(details->new_entity_type),&entity_update,details->details_script,&(details->details_script_size));
     if(err == 0)    
     {
         fScriptParsed=true;
@@ -542,8 +629,8 @@ bool MultiChainTransaction_CheckNewEntity(int vout,
         }
         unsigned char *ptr;
         size_t bytes;        
-        mc_gState->m_TmpScript->SetElement(1);
-        err=mc_gState->m_TmpScript->GetExtendedDetails(&ptr,&bytes);
+        details->context->m_TmpScript->SetElement(1);
+        err=details->context->m_TmpScript->GetExtendedDetails(&ptr,&bytes);
         if(err == 0)
         {
             if(bytes)
@@ -579,9 +666,9 @@ bool MultiChainTransaction_CheckCachedScript(const CTransaction& tx,
     int cs_offset,cs_new_offset,cs_size,cs_vin;
     unsigned char *cs_script;
     
-    mc_gState->m_TmpScript->SetElement(0);
+    details->context->m_TmpScript->SetElement(0);
     cs_offset=0;
-    while( (err=mc_gState->m_TmpScript->GetCachedScript(cs_offset,&cs_new_offset,&cs_vin,&cs_script,&cs_size)) != MC_ERR_WRONG_SCRIPT )
+    while( (err=details->context->m_TmpScript->GetCachedScript(cs_offset,&cs_new_offset,&cs_vin,&cs_script,&cs_size)) != MC_ERR_WRONG_SCRIPT )
     {
         fScriptParsed=true;
         if(err != MC_ERR_NOERROR)
@@ -598,9 +685,9 @@ bool MultiChainTransaction_CheckCachedScript(const CTransaction& tx,
             }
 
             const COutPoint &prevout = tx.vin[cs_vin].prevout;
-            const CCoins *coins = inputs.AccessCoins(prevout.hash);
+            const Coin &coin = inputs.AccessCoin(prevout);
 
-            const CScript& script3 = coins->vout[prevout.n].scriptPubKey;        
+            const CScript& script3 = coin.out.scriptPubKey;        
             CScript::const_iterator pc3 = script3.begin();
 
             if(cs_size != (int)script3.size())
@@ -639,9 +726,9 @@ void MultiChainTransaction_FillAdminPermissionsBeforeTx(const CTransaction& tx,
     }
 }
 
-bool MultiChainTransaction_VerifyAndDeleteDataFormatElements(string& reason,int64_t *total_size,uint32_t *salt_size)
+bool MultiChainTransaction_VerifyAndDeleteDataFormatElements(mc_ValidationContext *context,string& reason,int64_t *total_size,uint32_t *salt_size)
 {    
-    if(mc_gState->m_TmpScript->ExtractAndDeleteDataFormat(NULL,NULL,NULL,total_size,salt_size,1))
+    if(context->m_TmpScript->ExtractAndDeleteDataFormat(NULL,NULL,NULL,total_size,salt_size,1))
     {
         reason="Error in data format script";
         return false;                    
@@ -663,7 +750,7 @@ bool MultiChainTransaction_CheckOpReturnScript(const CTransaction& tx,
     int64_t total_offchain_size;
     
     total_offchain_size=0;
-    if(!MultiChainTransaction_VerifyAndDeleteDataFormatElements(reason,&total_offchain_size,NULL))
+    if(!MultiChainTransaction_VerifyAndDeleteDataFormatElements(details->context,reason,&total_offchain_size,NULL))
     {
         return false;
     }
@@ -679,7 +766,7 @@ bool MultiChainTransaction_CheckOpReturnScript(const CTransaction& tx,
         }                        
     }
 
-    if( mc_gState->m_TmpScript->GetNumElements() > 1 )                          // OP_DROP+OP_RETURN script
+    if( details->context->m_TmpScript->GetNumElements() > 1 )                          // OP_DROP+OP_RETURN script
     {
         if(details->fRejectIfOpDropOpReturn)                                    // We cannot extract address sighash_type properly from the input script 
                                                                                 // as we don't know where are the signatures
@@ -688,14 +775,14 @@ bool MultiChainTransaction_CheckOpReturnScript(const CTransaction& tx,
             return false;
         }
 
-        if(mc_gState->m_TmpScript->IsDirtyOpReturnScript())
+        if(details->context->m_TmpScript->IsDirtyOpReturnScript())
         {
             reason="Non-standard, Only OP_DROP elements are allowed in metadata outputs with OP_DROP";
             return false;
         }
     }
     
-    if( mc_gState->m_TmpScript->GetNumElements() == 2 )                         // Cached input script or new entity
+    if( details->context->m_TmpScript->GetNumElements() == 2 )                         // Cached input script or new entity
     {
         if(!fScriptParsed)
         {
@@ -722,26 +809,26 @@ bool MultiChainTransaction_CheckOpReturnScript(const CTransaction& tx,
         }        
     }
     
-    if( (mc_gState->m_TmpScript->GetNumElements() > 3) && 
+    if( (details->context->m_TmpScript->GetNumElements() > 3) && 
         (mc_gState->m_Features->MultipleStreamKeys() == 0) )                    // More than 2 OP_DROPs
     {
         reason="Metadata script rejected - too many elements";
         return false;
     }
 
-    if(mc_gState->m_TmpScript->GetNumElements() == 3 )                          // 2 OP_DROPs + OP_RETURN - possible upgrade approval
+    if(details->context->m_TmpScript->GetNumElements() == 3 )                          // 2 OP_DROPs + OP_RETURN - possible upgrade approval
                                                                                 // Admin permissions before tx should be used 
                                                                                 // Performed only if it is indeed needed
     {
-        mc_gState->m_TmpScript->SetElement(1);
+        details->context->m_TmpScript->SetElement(1);
 
-        if(mc_gState->m_TmpScript->GetApproval(&approval,&timestamp) == 0)
+        if(details->context->m_TmpScript->GetApproval(&approval,&timestamp) == 0)
         {
             MultiChainTransaction_FillAdminPermissionsBeforeTx(tx,details);
         }                        
     }
     
-    if(mc_gState->m_TmpScript->GetNumElements() >= 3 )                          // This output should be processed later - after all permissions
+    if(details->context->m_TmpScript->GetNumElements() >= 3 )                          // This output should be processed later - after all permissions
     {
         details->vOutputScriptFlags[vout] |= MC_MTX_OUTPUT_DETAIL_FLAG_OP_RETURN_ENTITY_ITEM;
     }
@@ -761,15 +848,15 @@ bool MultiChainTransaction_CheckAssetUpdateDetails(mc_EntityDetails *entity,
     int err;
     int entity_update;
     
-    if(mc_gState->m_TmpScript->GetNumElements() > 3)                            
+    if(details->context->m_TmpScript->GetNumElements() > 3)                            
     {
         reason="Metadata script rejected - too many elements in asset update script";
         return false;
     }
     
-    mc_gState->m_TmpScript->SetElement(1);
+    details->context->m_TmpScript->SetElement(1);
     
-    err=mc_gState->m_TmpScript->GetNewEntityType(&(details->new_entity_type),&entity_update,details->details_script,&(details->details_script_size));
+    err=details->context->m_TmpScript->GetNewEntityType(&(details->new_entity_type),&entity_update,details->details_script,&(details->details_script_size));
     
     if(err == 0)    
     {
@@ -821,7 +908,7 @@ bool MultiChainTransaction_CheckVariableUpdateDetails(const CTransaction& tx,
     uint32_t flags;
     uint256 txid;
     
-    if(mc_gState->m_TmpScript->GetNumElements() > 3)                            
+    if(details->context->m_TmpScript->GetNumElements() > 3)                            
     {
         reason="Metadata script rejected - too many elements in asset update script";
         return false;
@@ -833,11 +920,11 @@ bool MultiChainTransaction_CheckVariableUpdateDetails(const CTransaction& tx,
         return false;        
     }
     
-    mc_gState->m_TmpScript->SetElement(1);
+    details->context->m_TmpScript->SetElement(1);
     
     extended_script_row=0;
     
-    err=mc_gState->m_TmpScript->GetNewEntityType(&new_entity_type,&entity_update,details_script,&details_script_size);
+    err=details->context->m_TmpScript->GetNewEntityType(&new_entity_type,&entity_update,details_script,&details_script_size);
     
     string entity_type_str="Variable";
     if(err == 0)    
@@ -899,8 +986,8 @@ bool MultiChainTransaction_CheckVariableUpdateDetails(const CTransaction& tx,
         
         unsigned char *ptr;
         size_t bytes;        
-        mc_gState->m_TmpScript->SetElement(2);
-        err=mc_gState->m_TmpScript->GetExtendedDetails(&ptr,&bytes);
+        details->context->m_TmpScript->SetElement(2);
+        err=details->context->m_TmpScript->GetExtendedDetails(&ptr,&bytes);
         if(err == 0)
         {
             if(bytes)
@@ -973,22 +1060,22 @@ bool MultiChainTransaction_CheckVariableUpdateDetails(const CTransaction& tx,
     
     err=MC_ERR_NOERROR;
     
-    mc_gState->m_TmpScript->Clear();
-    mc_gState->m_TmpScript->AddElement();
+    details->context->m_TmpScript->Clear();
+    details->context->m_TmpScript->AddElement();
     
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ASSET_TOTAL,(unsigned char*)&last_total,sizeof(last_total));                            
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ASSET_TOTAL,(unsigned char*)&last_total,sizeof(last_total));                            
 
     if(chain_size >= 0)
     {
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHAIN_INDEX,(unsigned char*)&chain_size,sizeof(chain_size));                            
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHAIN_INDEX,(unsigned char*)&chain_size,sizeof(chain_size));                            
     }
 
     if(left_position > 0)
     {
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_LEFT_POSITION,(unsigned char*)&left_position,sizeof(left_position));                            
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_LEFT_POSITION,(unsigned char*)&left_position,sizeof(left_position));                            
     }
         
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_VOUT,(unsigned char*)&vout,sizeof(vout));                            
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_VOUT,(unsigned char*)&vout,sizeof(vout));                            
     
     unsigned char issuer_buf[24];
     memset(issuer_buf,0,sizeof(issuer_buf));
@@ -1004,7 +1091,7 @@ bool MultiChainTransaction_CheckVariableUpdateDetails(const CTransaction& tx,
                 mc_PutLE(issuer_buf+sizeof(uint160),&issuer_flags[i],4);
                 if((int)i < mc_gState->m_Assets->MaxStoredIssuers())            // Adding list of issuers to the asset script
                 {
-                    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,sizeof(issuer_buf));            
+                    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,sizeof(issuer_buf));            
                 }
                 stored_issuers.insert(issuers[i]);
             }
@@ -1012,11 +1099,11 @@ bool MultiChainTransaction_CheckVariableUpdateDetails(const CTransaction& tx,
     }        
 
     memset(issuer_buf,0,sizeof(issuer_buf));
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,1);                    
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,1);                    
     
     const unsigned char *special_script;
     size_t special_script_size=0;
-    special_script=mc_gState->m_TmpScript->GetData(0,&special_script_size);
+    special_script=details->context->m_TmpScript->GetData(0,&special_script_size);
     txid=tx.GetHash();
     err=mc_gState->m_Assets->InsertAssetFollowOn(&txid,offset,total,details_script,details_script_size,special_script,special_script_size,extended_script_row,entity->GetTxID(),1);
             
@@ -1051,15 +1138,15 @@ bool MultiChainTransaction_CheckUpgradeApproval(const CTransaction& tx,
     uint256 upgrade_hash;
     bool fAdminFound;
     
-    if(mc_gState->m_TmpScript->GetNumElements() > 3)                            
+    if(details->context->m_TmpScript->GetNumElements() > 3)                            
     {
         reason="Metadata script rejected - too many elements in upgrade approval script";
         return false;
     }
     
-    mc_gState->m_TmpScript->SetElement(1);          
+    details->context->m_TmpScript->SetElement(1);          
 
-    if(mc_gState->m_TmpScript->GetApproval(&approval,&timestamp))
+    if(details->context->m_TmpScript->GetApproval(&approval,&timestamp))
     {
         reason="Metadata script rejected - wrong element, should be upgrade approval";
         return false;
@@ -1115,18 +1202,18 @@ bool MultiChainTransaction_CheckStreamItem(mc_EntityDetails *entity,
     
     if(mc_gState->m_Features->OffChainData())
     {
-        if(mc_gState->m_TmpScript->m_Restrictions & entity->m_Restrictions)
+        if(details->context->m_TmpScript->m_Restrictions & entity->m_Restrictions)
         {
             reason="Metadata script rejected - stream restrictions violation";
             return false;        
         }
     }
                                                                                 // Multiple keys, if not allowed, check for count is made in different place
-    for (int e = 1; e < mc_gState->m_TmpScript->GetNumElements()-1; e++)
+    for (int e = 1; e < details->context->m_TmpScript->GetNumElements()-1; e++)
     {
-        mc_gState->m_TmpScript->SetElement(e);
+        details->context->m_TmpScript->SetElement(e);
                                                                                 
-        if(mc_gState->m_TmpScript->GetItemKey(item_key,&item_key_size))         
+        if(details->context->m_TmpScript->GetItemKey(item_key,&item_key_size))         
         {
             reason="Metadata script rejected - wrong element, should be item key";
             return false;
@@ -1170,7 +1257,7 @@ bool MultiChainTransaction_CheckEntityItem(const CTransaction& tx,
     mc_EntityDetails entity;
     uint32_t salt_size=0;
     
-    if(!MultiChainTransaction_VerifyAndDeleteDataFormatElements(reason,NULL,&salt_size))
+    if(!MultiChainTransaction_VerifyAndDeleteDataFormatElements(details->context,reason,NULL,&salt_size))
     {
         return false;
     }
@@ -1189,9 +1276,9 @@ bool MultiChainTransaction_CheckEntityItem(const CTransaction& tx,
         }
     }
     
-    mc_gState->m_TmpScript->SetElement(0);
+    details->context->m_TmpScript->SetElement(0);
                                                                                 // Should be spke
-    if(mc_gState->m_TmpScript->GetEntity(short_txid))                           // Entity element
+    if(details->context->m_TmpScript->GetEntity(short_txid))                           // Entity element
     {
         reason="Metadata script rejected - wrong element, should be entityref";
         return false;
@@ -1237,7 +1324,7 @@ bool MultiChainTransaction_CheckEntityItem(const CTransaction& tx,
         {
             if(entity.GetEntityType() <= MC_ENT_TYPE_STREAM_MAX)
             {
-                if(mc_gState->m_TmpScript->m_Restrictions & MC_ENT_ENTITY_RESTRICTION_OFFCHAIN)
+                if(details->context->m_TmpScript->m_Restrictions & MC_ENT_ENTITY_RESTRICTION_OFFCHAIN)
                 {
                     if(mc_gState->m_Features->SaltedChunks())
                     {
@@ -1378,7 +1465,7 @@ bool MultiChainTransaction_ProcessPermissions(const CTransaction& tx,
     uint32_t type,from,to,timestamp,flags;
     
     fIsPurePermission=false;
-    if(mc_gState->m_TmpScript->GetNumElements())
+    if(details->context->m_TmpScript->GetNumElements())
     {
         fIsPurePermission=true;
     }
@@ -1386,10 +1473,10 @@ bool MultiChainTransaction_ProcessPermissions(const CTransaction& tx,
     fNoDestinationInOutput=( (details->vOutputScriptFlags[vout] & MC_MTX_OUTPUT_DETAIL_FLAG_NO_DESTINATION) != 0);
     
     entity.Zero();                                                  
-    for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+    for (int e = 0; e < details->context->m_TmpScript->GetNumElements(); e++)
     {
-        mc_gState->m_TmpScript->SetElement(e);
-        if(mc_gState->m_TmpScript->GetEntity(short_txid) == 0)                  // Entity element
+        details->context->m_TmpScript->SetElement(e);
+        if(details->context->m_TmpScript->GetEntity(short_txid) == 0)                  // Entity element
         {
             if(entity.GetEntityType())
             {
@@ -1407,7 +1494,7 @@ bool MultiChainTransaction_ProcessPermissions(const CTransaction& tx,
         }
         else                                                                    // Not entity element
         {   
-            if(mc_gState->m_TmpScript->GetPermission(&type,&from,&to,&timestamp) == 0) // Grant script
+            if(details->context->m_TmpScript->GetPermission(&type,&from,&to,&timestamp) == 0) // Grant script
             {
                 if(fNoDestinationInOutput)
                 {
@@ -1665,9 +1752,9 @@ bool MultiChainTransaction_CheckLicenseTokenTransfer(const CTransaction& tx,
         return true;
     }
     
-    for(int i=unchecked_row;i<mc_gState->m_TmpAssetsOut->GetCount();i++)
+    for(int i=unchecked_row;i<details->context->m_TmpAssetsOut->GetCount();i++)
     {
-        if(mc_gState->m_Assets->FindEntityByFullRef(&entity,mc_gState->m_TmpAssetsOut->GetRow(i)))
+        if(mc_gState->m_Assets->FindEntityByFullRef(&entity,details->context->m_TmpAssetsOut->GetRow(i)))
         {
             if(entity.GetEntityType() == MC_ENT_TYPE_LICENSE_TOKEN)
             {
@@ -1695,7 +1782,7 @@ bool MultiChainTransaction_CheckLicenseTokenTransfer(const CTransaction& tx,
     
     if(mc_gState->m_Features->License20010())
     {
-        if(mc_gState->m_TmpScript->GetNumElements() < 2)
+        if(details->context->m_TmpScript->GetNumElements() < 2)
         {
             reason="License token transfer script rejected - wrong number of elements";
             return false;                                                                                                                                                                                
@@ -1703,7 +1790,7 @@ bool MultiChainTransaction_CheckLicenseTokenTransfer(const CTransaction& tx,
     }
     else
     {
-        if(mc_gState->m_TmpScript->GetNumElements() != 3)
+        if(details->context->m_TmpScript->GetNumElements() != 3)
         {
             reason="License token transfer script rejected - wrong number of elements";
             return false;                                                                                                                                                                                
@@ -1716,13 +1803,13 @@ bool MultiChainTransaction_CheckLicenseTokenTransfer(const CTransaction& tx,
         return false;                                                                                                                                                                                        
     }
     
-    if(mc_gState->m_TmpAssetsOut->GetCount() != 1)
+    if(details->context->m_TmpAssetsOut->GetCount() != 1)
     {
         reason="License token transfer script rejected - wrong script";
         return false;                                                                                                                                                                                                        
     }
         
-    if(mc_GetABQuantity(mc_gState->m_TmpAssetsOut->GetRow(0)) != 1)            
+    if(mc_GetABQuantity(details->context->m_TmpAssetsOut->GetRow(0)) != 1)            
     {
         reason="License token transfer script rejected - wrong number of license token units";
         return false;                                                                                                                                                                                                        
@@ -1744,19 +1831,19 @@ bool MultiChainTransaction_CheckAssetTransfers(const CTransaction& tx,
     
     if(mc_gState->m_Features->PerAssetPermissions())                            // Checking per-asset receive permissions
     {
-        mc_gState->m_TmpAssetsTmp->Clear();
-        if(!mc_ExtractOutputAssetQuantities(mc_gState->m_TmpAssetsTmp,reason,true))   
+        details->context->m_TmpAssetsTmp->Clear();
+        if(!mc_ExtractOutputAssetQuantities(details->context->m_TmpScript,details->context->m_TmpAssetsTmp,reason,true))   
         {
             return false;
         }
-        if(!mc_VerifyAssetPermissions(mc_gState->m_TmpAssetsTmp,details->vOutputDestinations[vout],receive_required,MC_PTP_RECEIVE,reason))
+        if(!mc_VerifyAssetPermissions(details->context->m_TmpAssetsTmp,details->vOutputDestinations[vout],receive_required,MC_PTP_RECEIVE,reason))
         {
             return false;                                
         }
     }
     
-    int unchecked_row=mc_gState->m_TmpAssetsOut->GetCount();
-    if(!mc_ExtractOutputAssetQuantities(mc_gState->m_TmpAssetsOut,reason,false))// Filling output asset quantity list
+    int unchecked_row=details->context->m_TmpAssetsOut->GetCount();
+    if(!mc_ExtractOutputAssetQuantities(details->context->m_TmpScript,details->context->m_TmpAssetsOut,reason,false))// Filling output asset quantity list
     {
         return false;                                
     }    
@@ -1818,7 +1905,7 @@ bool MultiChainTransaction_CheckAssetTransfers(const CTransaction& tx,
         if(receive_required>0)
         {
             if( (tx.vout[vout].nValue > 0) || 
-                (mc_gState->m_TmpScript->GetNumElements() > 0) ||
+                (details->context->m_TmpScript->GetNumElements() > 0) ||
                 (mc_gState->m_Features->AnyoneCanReceiveEmpty() == 0) )
             {
                 reason="One of the outputs doesn't have receive permission";
@@ -1864,10 +1951,10 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
     }
     
     token_details_element=-1;
-    for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+    for (int e = 0; e < details->context->m_TmpScript->GetNumElements(); e++)
     {
-        mc_gState->m_TmpScript->SetElement(e);
-        err=mc_gState->m_TmpScript->GetInlineDetails(&token_details,&token_details_size);
+        details->context->m_TmpScript->SetElement(e);
+        err=details->context->m_TmpScript->GetInlineDetails(&token_details,&token_details_size);
         if(err == 0)
         {
             if(token_details_element >= 0)
@@ -1890,23 +1977,23 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
         }                
     }
     
-    mc_gState->m_TmpAssetsOut->Clear();
+    details->context->m_TmpAssetsOut->Clear();
     
     new_issue=false;
     vout_total=0;
-    for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+    for (int e = 0; e < details->context->m_TmpScript->GetNumElements(); e++)
     {
-        mc_gState->m_TmpScript->SetElement(e);
+        details->context->m_TmpScript->SetElement(e);
         if(txid != 0)
         {
-            err=mc_gState->m_TmpScript->GetAssetGenesis(&quantity);         
+            err=details->context->m_TmpScript->GetAssetGenesis(&quantity);         
             if(err == 0)                                               
             {
                 vout_total+=quantity;
                 new_issue=true;
             }
         }
-        err=mc_gState->m_TmpScript->GetAssetQuantities(mc_gState->m_TmpAssetsOut,MC_SCR_ASSET_SCRIPT_TYPE_TOKEN);
+        err=details->context->m_TmpScript->GetAssetQuantities(details->context->m_TmpAssetsOut,MC_SCR_ASSET_SCRIPT_TYPE_TOKEN);
         if((err != MC_ERR_NOERROR) && (err != MC_ERR_WRONG_SCRIPT))
         {
             reason="Token issuance script rejected - error in token script";
@@ -1927,7 +2014,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
         }
     }
     
-    if(!new_issue && (mc_gState->m_TmpAssetsOut->GetCount() == 0))
+    if(!new_issue && (details->context->m_TmpAssetsOut->GetCount() == 0))
     {
         return true;
     }
@@ -1938,7 +2025,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
         return false;                                                            
     }
         
-    if(mc_gState->m_TmpAssetsOut->GetCount() > 1)
+    if(details->context->m_TmpAssetsOut->GetCount() > 1)
     {
         reason="Token issuance script rejected - multiple token scripts";
         return false;                                                                    
@@ -1946,7 +2033,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
 
     if(new_issue)
     {
-        if(mc_gState->m_TmpAssetsOut->GetCount() > 0)
+        if(details->context->m_TmpAssetsOut->GetCount() > 0)
         {
             reason="Token issuance script rejected - token script in asset issuance output";
             return false;                                                                    
@@ -1954,7 +2041,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
     }
     else
     {
-        vout_total=mc_GetABQuantity(mc_gState->m_TmpAssetsOut->GetRow(0));
+        vout_total=mc_GetABQuantity(details->context->m_TmpAssetsOut->GetRow(0));
     }
     
     
@@ -2024,7 +2111,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
     
     if(txid == 0)
     {
-        if(memcmp((unsigned char*)&token_hash+MC_AST_SHORT_TXID_OFFSET,mc_gState->m_TmpAssetsOut->GetRow(0)+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE))
+        if(memcmp((unsigned char*)&token_hash+MC_AST_SHORT_TXID_OFFSET,details->context->m_TmpAssetsOut->GetRow(0)+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE))
         {
             reason="Token issuance script rejected - token hash mismatch";
             return false;                                                                                                    
@@ -2117,26 +2204,26 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
     
     last_total+=vout_total;
    
-    mc_gState->m_TmpScript->Clear();
-    mc_gState->m_TmpScript->AddElement();
+    details->context->m_TmpScript->Clear();
+    details->context->m_TmpScript->AddElement();
     
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ASSET_TOTAL,(unsigned char*)&last_total,sizeof(last_total));                            
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ASSET_TOTAL,(unsigned char*)&last_total,sizeof(last_total));                            
 
     if(chain_size >= 0)
     {
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHAIN_INDEX,(unsigned char*)&chain_size,sizeof(chain_size));                            
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHAIN_INDEX,(unsigned char*)&chain_size,sizeof(chain_size));                            
     }
 
     if(left_position > 0)
     {
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_LEFT_POSITION,(unsigned char*)&left_position,sizeof(left_position));                            
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_LEFT_POSITION,(unsigned char*)&left_position,sizeof(left_position));                            
     }
         
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_VOUT,(unsigned char*)&vout,sizeof(vout));                            
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_VOUT,(unsigned char*)&vout,sizeof(vout));                            
         
     if(txid != 0)
     {
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_PARENT_ENTITY,(unsigned char*)&txid,sizeof(txid));                                    
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_PARENT_ENTITY,(unsigned char*)&txid,sizeof(txid));                                    
     }
     
     unsigned char issuer_buf[24];
@@ -2154,7 +2241,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
                 mc_PutLE(issuer_buf+sizeof(uint160),&issuer_flags[i],4);
                 if((int)i < mc_gState->m_Assets->MaxStoredIssuers())            // Adding list of issuers to the asset script
                 {
-                    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,sizeof(issuer_buf));            
+                    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,sizeof(issuer_buf));            
                 }
                 stored_issuers.insert(issuers[i]);
             }
@@ -2162,7 +2249,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
     }        
 
     memset(issuer_buf,0,sizeof(issuer_buf));
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,1);                    
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,1);                    
     if(err)
     {
         reason="Cannot update permission database for issued token";
@@ -2171,7 +2258,7 @@ bool MultiChainTransaction_ProcessTokenIssuance(const CTransaction& tx,
     
     const unsigned char *special_script;
     size_t special_script_size=0;
-    special_script=mc_gState->m_TmpScript->GetData(0,&special_script_size);
+    special_script=details->context->m_TmpScript->GetData(0,&special_script_size);
     this_txid=tx.GetHash();
     err=mc_gState->m_Assets->InsertAssetFollowOn(&this_txid,offset,vout_total,token_details,token_details_size+1,special_script,special_script_size,0,entity.GetTxID(),update_mempool);
     
@@ -2243,9 +2330,9 @@ bool MultiChainTransaction_CheckOutputs(const CTransaction& tx,
     {
         details->total_value_out+=tx.vout[vout].nValue;
         
-        MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+        MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
 
-        if(mc_gState->m_TmpScript->IsOpReturnScript())                    
+        if(details->context->m_TmpScript->IsOpReturnScript())                    
         {
             if(!MultiChainTransaction_CheckOpReturnScript(tx,inputs,vout,details,reason))
             {
@@ -2276,7 +2363,7 @@ bool MultiChainTransaction_CheckOutputs(const CTransaction& tx,
     {
         if(details->vOutputScriptFlags[vout] & (MC_MTX_OUTPUT_DETAIL_FLAG_PERMISSION_CREATE | MC_MTX_OUTPUT_DETAIL_FLAG_PERMISSION_FILTER) )
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
             
             permission_type=MC_PTP_CREATE | MC_PTP_ISSUE | MC_PTP_ACTIVATE | MC_PTP_FILTER;
             if(mc_gState->m_Features->NFTokens())
@@ -2295,7 +2382,7 @@ bool MultiChainTransaction_CheckOutputs(const CTransaction& tx,
     {
         if(details->vOutputScriptFlags[vout] & MC_MTX_OUTPUT_DETAIL_FLAG_PERMISSION_ADMIN)
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
             
             permission_type=MC_PTP_MINE | MC_PTP_ADMIN;
             if(!MultiChainTransaction_ProcessPermissions(tx,offset,vout,permission_type,false,details,reason))
@@ -2310,7 +2397,7 @@ bool MultiChainTransaction_CheckOutputs(const CTransaction& tx,
                                                                                 // Entity items (stream items, upgrade approvals, updates)
         if(details->vOutputScriptFlags[vout] & MC_MTX_OUTPUT_DETAIL_FLAG_OP_RETURN_ENTITY_ITEM)
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
             
             if(!MultiChainTransaction_CheckEntityItem(tx,offset,vout,details,reason))
             {
@@ -2323,7 +2410,7 @@ bool MultiChainTransaction_CheckOutputs(const CTransaction& tx,
     {
         for (unsigned int vout = 0; vout < tx.vout.size(); vout++)
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
 
             if(!MultiChainTransaction_ProcessTokenIssuance(tx,offset,accept,vout,0,details,reason))
             {
@@ -2341,14 +2428,14 @@ bool MultiChainTransaction_CheckTransfers(const CTransaction& tx,
                                         CMultiChainTxDetails *details,          // Tx details object
                                         string& reason)                         // Error message
 {
-    mc_gState->m_TmpAssetsOut->Clear();
+    details->context->m_TmpAssetsOut->Clear();
     
     for (unsigned int vout = 0; vout < tx.vout.size(); vout++)
     {
                                                                                 // Assets quantities and permission checks
         if(details->vOutputScriptFlags[vout] & MC_MTX_OUTPUT_DETAIL_FLAG_NOT_OP_RETURN)
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
 
             if(!MultiChainTransaction_CheckAssetTransfers(tx,offset,vout,details,reason))
             {
@@ -2370,6 +2457,161 @@ int64_t MultiChainTransaction_OffchainFee(int64_t total_offchain_size)
     return (MIN_OFFCHAIN_FEE*total_offchain_size + 999)/ 1000;
 }
 
+/*
+ * Admission class of the transaction, used for block space reservation in CreateNewBlock. 
+ * Only script elements are parsed, tx is not validated here. The highest class found in outputs is returned:
+ * admin - permission changes, approvals, creation of upgrades and filters
+ * asset - issuance, follow-on issuance and transfer of assets and tokens, asset updates
+ * stream - stream creation and stream items
+ * If changes_state is not NULL, it is set if following txs may depend on this tx not only through its outputs:
+ * entity creation, permission changes, approvals, issuance, follow-ons and updates of non-stream entities.
+ * Such txs cannot be reordered by CreateNewBlock without rerunning MultiChain checks for the following ones.
+ */
+
+int MultiChainTransaction_AdmissionClass(const CTransaction& tx,bool *changes_state)
+{
+    int tx_class=MC_TAC_OTHER;
+    bool fChangesState=false;
+    mc_Script *lpScript;
+    mc_Buffer *lpAmounts;
+    mc_EntityDetails entity;
+    unsigned char short_txid[MC_AST_SHORT_TXID_SIZE];
+    uint32_t type,from,to,timestamp,approval;
+    int64_t quantity;
+    
+    if(changes_state)
+    {
+        *changes_state=false;
+    }
+    
+    if(tx.IsCoinBase())
+    {
+        return tx_class;
+    }
+    
+    lpScript=new mc_Script;                                                     // Not m_TmpScript - called after validation is complete
+    lpAmounts=NULL;
+    
+    for(unsigned int j=0;(j<tx.vout.size()) && (tx_class != MC_TAC_ADMIN);j++) // Admin class always changes state
+    {
+        const CScript& script1 = tx.vout[j].scriptPubKey;        
+        CScript::const_iterator pc1 = script1.begin();
+
+        lpScript->Clear();
+        lpScript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+        
+        if(lpScript->IsOpReturnScript())
+        {
+            lpScript->ExtractAndDeleteDataFormat(NULL);
+            if(lpScript->GetNumElements() == 0)
+            {
+                continue;
+            }
+            lpScript->SetElement(0);
+            if(lpScript->GetNewEntityType(&type) == 0)
+            {
+                fChangesState=true;
+                if( (type == MC_ENT_TYPE_UPGRADE) || (type == MC_ENT_TYPE_FILTER) )
+                {
+                    tx_class=MC_TAC_ADMIN;
+                }
+                else if( (type == MC_ENT_TYPE_ASSET) || (type == MC_ENT_TYPE_TOKEN) )
+                {
+                    tx_class=max(tx_class,MC_TAC_ASSET);
+                }
+                else if(type <= MC_ENT_TYPE_STREAM_MAX)
+                {
+                    tx_class=max(tx_class,MC_TAC_STREAM);
+                }
+                continue;
+            }
+            if(lpScript->GetEntity(short_txid))
+            {
+                continue;
+            }
+            if(lpScript->GetNumElements() > 1)
+            {
+                lpScript->SetElement(1);
+                if(lpScript->GetApproval(&approval,&timestamp) == 0)            // Upgrade, filter or library approval
+                {
+                    tx_class=MC_TAC_ADMIN;
+                    fChangesState=true;
+                    continue;
+                }
+            }
+            if(mc_gState->m_Assets->FindEntityByShortTxID(&entity,short_txid))
+            {
+                if( (entity.GetEntityType() == MC_ENT_TYPE_ASSET) || (entity.GetEntityType() == MC_ENT_TYPE_TOKEN) )
+                {
+                    tx_class=max(tx_class,MC_TAC_ASSET);
+                    fChangesState=true;                                         // Follow-on details or asset update
+                }
+                else if(entity.GetEntityType() <= MC_ENT_TYPE_STREAM_MAX)
+                {
+                    tx_class=max(tx_class,MC_TAC_STREAM);                       // Stream item
+                }
+                else
+                {
+                    fChangesState=true;                                         // Library or variable update
+                }
+            }
+            else
+            {
+                fChangesState=true;                                             // Unknown entity, assume the worst
+            }
+        }
+        else
+        {
+            for(int e=0;e<lpScript->GetNumElements();e++)
+            {
+                lpScript->SetElement(e);
+                if(lpScript->GetPermission(&type,&from,&to,&timestamp) == 0)
+                {
+                    tx_class=MC_TAC_ADMIN;
+                    fChangesState=true;
+                    break;
+                }
+                if(lpScript->GetAssetGenesis(&quantity) == 0)
+                {
+                    tx_class=MC_TAC_ASSET;
+                    fChangesState=true;
+                    continue;
+                }
+                if(lpAmounts == NULL)
+                {
+                    lpAmounts=new mc_Buffer;
+                    mc_InitABufferMap(lpAmounts);
+                }
+                lpAmounts->Clear();
+                if(lpScript->GetAssetQuantities(lpAmounts,MC_SCR_ASSET_SCRIPT_TYPE_FOLLOWON | MC_SCR_ASSET_SCRIPT_TYPE_TOKEN) == 0)
+                {
+                    tx_class=MC_TAC_ASSET;
+                    fChangesState=true;                                         // Follow-on or token issuance
+                    continue;
+                }
+                lpAmounts->Clear();
+                if(lpScript->GetAssetQuantities(lpAmounts,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER) == 0)
+                {
+                    tx_class=MC_TAC_ASSET;
+                }
+            }
+        }
+    }
+    
+    if(lpAmounts)
+    {
+        delete lpAmounts;
+    }
+    delete lpScript;
+    
+    if(changes_state)
+    {
+        *changes_state=fChangesState;
+    }
+    
+    return tx_class;
+}
+
 bool MultiChainTransaction_CheckMandatoryFee(CMultiChainTxDetails *details,     // Tx details object
                                              int64_t *mandatory_fee,            // Mandatory Fee    
                                              string& reason)                    // Error message
@@ -2618,17 +2860,17 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
         }                                    
     }
 
-    mc_gState->m_TmpAssetsOut->Clear();
+    details->context->m_TmpAssetsOut->Clear();
 
     for (unsigned int vout = 0; vout < tx.vout.size(); vout++)
     {
                                                                                 // We already extracted the details, we just have to find entity
         if(details->vOutputScriptFlags[vout] & MC_MTX_OUTPUT_DETAIL_FLAG_FOLLOWON_DETAILS)
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
-            mc_gState->m_TmpScript->SetElement(0);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
+            details->context->m_TmpScript->SetElement(0);
                                                                         
-            if(mc_gState->m_TmpScript->GetEntity(short_txid))           
+            if(details->context->m_TmpScript->GetEntity(short_txid))           
             {
                 reason="Metadata script rejected - wrong element, should be entityref";
                 return false;
@@ -2637,16 +2879,16 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
         
         if(details->vOutputScriptFlags[vout] & MC_MTX_OUTPUT_DETAIL_FLAG_NOT_OP_RETURN)
         {
-            MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+            MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
 
-            mc_gState->m_TmpAssetsTmp->Clear();
+            details->context->m_TmpAssetsTmp->Clear();
             issue_in_output=false;
             
             vout_total=0;
-            for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+            for (int e = 0; e < details->context->m_TmpScript->GetNumElements(); e++)
             {
-                mc_gState->m_TmpScript->SetElement(e);
-                err=mc_gState->m_TmpScript->GetAssetGenesis(&quantity);         
+                details->context->m_TmpScript->SetElement(e);
+                err=details->context->m_TmpScript->GetAssetGenesis(&quantity);         
                 if(err == 0)                                                    // Asset genesis issuance 
                 {
                     out_count++;
@@ -2721,7 +2963,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
                     }
                     if(mc_gState->m_Features->PerAssetPermissions())
                     {
-                        err=mc_gState->m_TmpScript->GetAssetQuantities(mc_gState->m_TmpAssetsTmp,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER);
+                        err=details->context->m_TmpScript->GetAssetQuantities(details->context->m_TmpAssetsTmp,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER);
                         if((err != MC_ERR_NOERROR) && (err != MC_ERR_WRONG_SCRIPT))
                         {
                             reason="Script rejected - error in asset transfer script";
@@ -2729,7 +2971,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
                         }
                     }                    
 
-                    err=mc_gState->m_TmpScript->GetAssetQuantities(mc_gState->m_TmpAssetsOut,MC_SCR_ASSET_SCRIPT_TYPE_FOLLOWON);
+                    err=details->context->m_TmpScript->GetAssetQuantities(details->context->m_TmpAssetsOut,MC_SCR_ASSET_SCRIPT_TYPE_FOLLOWON);
                     if((err != MC_ERR_NOERROR) && (err != MC_ERR_WRONG_SCRIPT))
                     {
                         reason="Asset follow-on script rejected - error in follow-on script";
@@ -2750,7 +2992,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
             {
                 if(mc_gState->m_Features->PerAssetPermissions())
                 {
-                    if(mc_gState->m_TmpAssetsTmp->GetCount())
+                    if(details->context->m_TmpAssetsTmp->GetCount())
                     {
                         reason="Asset issue script rejected - asset transfer in script";
                         return false;                                    
@@ -2780,7 +3022,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
                 reason=entity_type_str + " script rejected - genesis script found";
                 return false;                                                            
             }
-            if(mc_gState->m_TmpAssetsOut->GetCount())
+            if(details->context->m_TmpAssetsOut->GetCount())
             {
                 reason=entity_type_str + " script rejected - followon script found";
                 return false;                                                                            
@@ -2806,7 +3048,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
         }
     }
     
-    if(mc_gState->m_TmpAssetsOut->GetCount())
+    if(details->context->m_TmpAssetsOut->GetCount())
     {
         follow_on=true;
     }   
@@ -2818,7 +3060,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
     if(follow_on)
     {
         total=0;
-        if(mc_gState->m_TmpAssetsOut->GetCount() > 1)
+        if(details->context->m_TmpAssetsOut->GetCount() > 1)
         {
             reason="Asset follow-on script rejected - follow-on for several assets";
             return false;                                                
@@ -2829,7 +3071,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
             return false;                                                            
         }
         ptrOut=NULL;
-        if(mc_gState->m_TmpAssetsOut->GetCount() == 0)
+        if(details->context->m_TmpAssetsOut->GetCount() == 0)
         {
             if(mc_gState->m_Assets->FindEntityByShortTxID(&entity,short_txid) == 0)
             {
@@ -2845,7 +3087,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
         }
         else
         {
-            ptrOut=mc_gState->m_TmpAssetsOut->GetRow(0);       
+            ptrOut=details->context->m_TmpAssetsOut->GetRow(0);       
             if(mc_gState->m_Assets->FindEntityByFullRef(&entity,ptrOut) == 0)
             {
                 reason="Asset follow-on script rejected - asset not found";
@@ -2993,10 +3235,10 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
                         return false;                                                                                                                                                        
                     }
                     
-                    MultiChainTransaction_SetTmpOutputScript(tx.vout[issue_vout].scriptPubKey);
+                    MultiChainTransaction_SetOutputScript(details->context,tx.vout[issue_vout].scriptPubKey);
                     if(mc_gState->m_Features->License20010())
                     {
-                        if(mc_gState->m_TmpScript->GetNumElements() < 2)
+                        if(details->context->m_TmpScript->GetNumElements() < 2)
                         {
                             reason="License token issue script rejected - wrong number of elements";
                             return false;                                                                                                                                                                                
@@ -3004,7 +3246,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
                     }
                     else
                     {
-                        if(mc_gState->m_TmpScript->GetNumElements() != 3)
+                        if(details->context->m_TmpScript->GetNumElements() != 3)
                         {
                             reason="License token issue script rejected - wrong number of elements";
                             return false;                                                                                                                                                                                
@@ -3100,26 +3342,26 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
     
     last_total+=total;
     
-    mc_gState->m_TmpScript->Clear();
-    mc_gState->m_TmpScript->AddElement();
+    details->context->m_TmpScript->Clear();
+    details->context->m_TmpScript->AddElement();
     
     if(!details->fLicenseTokenIssuance)
     {
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ASSET_TOTAL,(unsigned char*)&last_total,sizeof(last_total));                            
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ASSET_TOTAL,(unsigned char*)&last_total,sizeof(last_total));                            
         
         if(chain_size >= 0)
         {
-            mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHAIN_INDEX,(unsigned char*)&chain_size,sizeof(chain_size));                            
+            details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHAIN_INDEX,(unsigned char*)&chain_size,sizeof(chain_size));                            
         }
         
         if(left_position > 0)
         {
-            mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_LEFT_POSITION,(unsigned char*)&left_position,sizeof(left_position));                            
+            details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_LEFT_POSITION,(unsigned char*)&left_position,sizeof(left_position));                            
         }
         
         if( (details->new_entity_type == MC_ENT_TYPE_VARIABLE) || (details->new_entity_type == MC_ENT_TYPE_LIBRARY) )                  
         {        
-            mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_VOUT,(unsigned char*)&(details->new_entity_output),sizeof(details->new_entity_output));                            
+            details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_VOUT,(unsigned char*)&(details->new_entity_output),sizeof(details->new_entity_output));                            
         }
         
         unsigned char issuer_buf[24];
@@ -3160,7 +3402,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
                     mc_PutLE(issuer_buf+sizeof(uint160),&issuer_flags[i],4);
                     if((int)i < mc_gState->m_Assets->MaxStoredIssuers())            // Adding list of issuers to the asset script
                     {
-                        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,sizeof(issuer_buf));            
+                        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,sizeof(issuer_buf));            
                     }
                     if(new_issue)                                                   // Setting first permission record - to scan from
                     {                    
@@ -3173,7 +3415,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
         }        
 
         memset(issuer_buf,0,sizeof(issuer_buf));
-        mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,1);                    
+        details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,issuer_buf,1);                    
         if(err == MC_ERR_NOERROR)
         {
             if(new_issue)                                                               
@@ -3200,7 +3442,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
     
     const unsigned char *special_script;
     size_t special_script_size=0;
-    special_script=mc_gState->m_TmpScript->GetData(0,&special_script_size);
+    special_script=details->context->m_TmpScript->GetData(0,&special_script_size);
     txid=tx.GetHash();
     if(new_issue)                                                               // Updating entity database
     {        
@@ -3228,7 +3470,7 @@ bool MultiChainTransaction_ProcessAssetIssuance(const CTransaction& tx,
             {
                 for (unsigned int vout = 0; vout < tx.vout.size(); vout++)
                 {
-                    MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+                    MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
                     if(!MultiChainTransaction_ProcessTokenIssuance(tx,offset,accept,vout,txid,details,reason))
                     {
                         return false;                
@@ -3411,8 +3653,8 @@ bool MultiChainTransaction_ProcessEntityCreation(const CTransaction& tx,
 
     err=MC_ERR_NOERROR;
 
-    mc_gState->m_TmpScript->Clear();
-    mc_gState->m_TmpScript->AddElement();
+    details->context->m_TmpScript->Clear();
+    details->context->m_TmpScript->AddElement();
     txid=tx.GetHash();                                                          // Setting first record in the per-entity permissions list
     
     if(details->new_entity_type <= MC_ENT_TYPE_STREAM_MAX)
@@ -3432,7 +3674,7 @@ bool MultiChainTransaction_ProcessEntityCreation(const CTransaction& tx,
                 mc_PutLE(opener_buf+sizeof(uint160),&opener_flags[i],4);
                 if((int)i < mc_gState->m_Assets->MaxStoredIssuers())
                 {
-                    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,opener_buf,sizeof(opener_buf));            
+                    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,opener_buf,sizeof(opener_buf));            
                 }
                 if(details->new_entity_type <= MC_ENT_TYPE_STREAM_MAX)
                 {
@@ -3452,11 +3694,11 @@ bool MultiChainTransaction_ProcessEntityCreation(const CTransaction& tx,
     }
 
     memset(opener_buf,0,sizeof(opener_buf));                                    // Storing opener list in entity metadata
-    mc_gState->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,opener_buf,1);                    
+    details->context->m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_ISSUER,opener_buf,1);                    
 
     const unsigned char *special_script;
     size_t special_script_size=0;
-    special_script=mc_gState->m_TmpScript->GetData(0,&special_script_size);
+    special_script=details->context->m_TmpScript->GetData(0,&special_script_size);
                                                                                 // Updating entity datanase
     err=mc_gState->m_Assets->InsertEntity(&txid,offset,details->new_entity_type,details->details_script,details->details_script_size,
             special_script,special_script_size,details->extended_script_row,update_mempool,0);
@@ -3569,11 +3811,11 @@ bool MultiChainTransaction_VerifyNotFilteredRestrictions(const CTransaction& tx,
             }
         }
                 
-        MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+        MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
         
         if((int)vout == details->emergency_disapproval_output)
         {
-            if(mc_gState->m_TmpScript->GetNumElements() > 1)
+            if(details->context->m_TmpScript->GetNumElements() > 1)
             {
                 details->emergency_disapproval_output=-2;
                 return true;                            
@@ -3581,11 +3823,11 @@ bool MultiChainTransaction_VerifyNotFilteredRestrictions(const CTransaction& tx,
         }
         else
         {
-            mc_gState->m_TmpAssetsTmp->Clear();
-            for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+            details->context->m_TmpAssetsTmp->Clear();
+            for (int e = 0; e < details->context->m_TmpScript->GetNumElements(); e++)
             {
-                mc_gState->m_TmpScript->SetElement(e);
-                if(mc_gState->m_TmpScript->GetAssetQuantities(mc_gState->m_TmpAssetsTmp,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER) != MC_ERR_NOERROR)
+                details->context->m_TmpScript->SetElement(e);
+                if(details->context->m_TmpScript->GetAssetQuantities(details->context->m_TmpAssetsTmp,MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER) != MC_ERR_NOERROR)
                 {
                     details->emergency_disapproval_output=-2;
                     return true;                                                
@@ -3645,16 +3887,16 @@ bool MultiChainTransaction_VerifyStandardCoinbase(const CTransaction& tx,
     bool signature_output=false;
     for (unsigned int vout = 0; vout < tx.vout.size(); vout++)
     {
-        MultiChainTransaction_SetTmpOutputScript(tx.vout[vout].scriptPubKey);
+        MultiChainTransaction_SetOutputScript(details->context,tx.vout[vout].scriptPubKey);
 
-        if(mc_gState->m_TmpScript->IsOpReturnScript())                    
+        if(details->context->m_TmpScript->IsOpReturnScript())                    
         {
             if(signature_output)
             {
                 LogPrintf("Non-standard coinbase: Multiple signatures\n");
                 return true;                                                    
             }
-            if(mc_gState->m_TmpScript->GetNumElements() != 1)
+            if(details->context->m_TmpScript->GetNumElements() != 1)
             {
                 if(mc_gState->m_Permissions->m_Block >= 0)
                 {
@@ -3741,7 +3983,8 @@ bool AcceptMultiChainTransaction   (const CTransaction& tx,
                                     uint32_t flags,                             // Accept to mempools if successful, no filters
                                     string& reason,                             // Error message
                                     int64_t *mandatory_fee_out,                 // Mandatory fee
-                                    uint32_t *replay)                           // Replay flag - if tx should be rechecked or only permissions
+                                    uint32_t *replay,                           // Replay flag - if tx should be rechecked or only permissions
+                                    const CMultiChainInputPrecheck *precheck)   // Context-free input checks performed in advance, NULL if not
 {
     CMultiChainTxDetails details;
     bool fReject=false;
@@ -3760,11 +4003,11 @@ bool AcceptMultiChainTransaction   (const CTransaction& tx,
     
     details.fCheckCachedScript=MultiChainTransaction_CheckCachedScriptFlag(tx);
     
-    mc_gState->m_TmpAssetsIn->Clear();
+    details.context->m_TmpAssetsIn->Clear();
     
     if(!MultiChainTransaction_CheckCoinbaseInputs(tx,&details))                 // Inputs
     {
-        if(!MultiChainTransaction_CheckInputs(tx,inputs,&details,reason))
+        if(!MultiChainTransaction_CheckInputs(tx,inputs,precheck,&details,reason))
         {
             return false;
         }
@@ -3777,10 +4020,13 @@ bool AcceptMultiChainTransaction   (const CTransaction& tx,
         permission_mempool_size=(int)mc_gState->m_Permissions->m_CheckPointMemPoolSize;
     }
     
-    if(!MultiChainTransaction_CheckOutputs(tx,inputs,offset,accept,&details,reason))   // Outputs        
     {
-        fReject=true;
-        goto exitlbl;                                                                    
+        mc_PermissionBatch batch(mc_gState->m_Permissions);                     // Grants to many addresses in one transaction, batch ends also if CheckOutputs throws
+        if(!MultiChainTransaction_CheckOutputs(tx,inputs,offset,accept,&details,reason))   // Outputs        
+        {
+            fReject=true;
+            goto exitlbl;                                                                    
+        }
     }
     
     if(!MultiChainTransaction_ProcessAssetIssuance(tx,offset,accept,&details,reason))                // Asset genesis/followon
@@ -69,6 +69,10 @@ public:
 /** nServices flags */
 enum {
     NODE_NETWORK = (1 << 0),
+/* MCHN START */    
+    // NODE_COMPACT_FILTERS means the node serves compact stream filters of blocks (getcfilters, getcfheaders)
+    NODE_COMPACT_FILTERS = (1 << 6),
+/* MCHN END */    
 
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
@@ -43,7 +43,8 @@ typedef struct CRelayRequestPairs
     map<int,int> m_Pairs;
 } CRelayRequestPairs;
 
-int mc_IsReadPermissionedStream(mc_ChunkEntityKey* chunk,map<uint160,int>& cache,set<CPubKey>* sAddressesToSign)
+int mc_IsReadPermissionedStream(mc_ChunkEntityKey* chunk,map<uint160,int>& cache,set<CPubKey>* sAddressesToSign,
+                                NodeId session_node=-1,set<uint160>* sReadPermissioned=NULL)
 {
     if(chunk->m_Entity.m_EntityType != MC_TET_STREAM)
     {
@@ -79,7 +80,15 @@ int mc_IsReadPermissionedStream(mc_ChunkEntityKey* chunk,map<uint160,int>& cache
     if(entity.AnyoneCanRead() == 0)
     {
         result=1;
-        if(sAddressesToSign)
+        if(sReadPermissioned)
+        {
+            sReadPermissioned->insert(enthash);
+        }
+        if(sAddressesToSign && (session_node >= 0) && pRelayManager->HasReadSession(session_node,enthash))
+        {
+            result=0;                                                           // Permission was already proved to this peer, no signature
+        }
+        else if(sAddressesToSign)
         {
             CKeyID keyID;
             set<CPubKey>::iterator it;
@@ -166,6 +175,17 @@ bool MultichainProcessChunkResponse(const CRelayResponsePair *response_pair,map
                     if(mc_IsReadPermissionedStream((mc_ChunkEntityKey*)ptr,mapReadPermissionCache,NULL))
                     {
                         result=pEF->OFF_ProcessChunkResponse(request,response,request_pairs,collector,strError);
+                        if(result && (response->m_Flags & MC_RFL_READ_SESSION) && (response->m_HopCount == 0))
+                        {
+                            for(int s=c;s<count;s++)                            // Responder opened read sessions, following requests are not signed
+                            {
+                                chunk=(mc_ChunkEntityKey*)(ptr+(s-c)*size);
+                                if(mc_IsReadPermissionedStream(chunk,mapReadPermissionCache,NULL))
+                                {
+                                    pRelayManager->SetReadSession(response->m_NodeFrom,*(uint160*)(chunk->m_Entity.m_EntityID));
+                                }
+                            }
+                        }
                         goto exitlbl;
                     }
                     total_size+=((mc_ChunkEntityKey*)ptr)->m_Size+size;
@@ -295,7 +315,7 @@ exitlbl:
     return result;
 }
 
-int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *collect_row,map<int64_t,int64_t>& destination_loads,uint32_t max_total_size)
+int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *collect_row,map<int64_t,int64_t>& destination_loads,map<NodeId,uint32_t>& destination_windows,uint32_t max_total_size)
 {
     unsigned char *ptr;
     unsigned char *ptrEnd;
@@ -309,6 +329,12 @@ int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *col
         return MC_CCW_WORST_RESPONSE_SCORE;
     }
 
+    map<NodeId,uint32_t>::iterator itwnd = destination_windows.find(response->m_NodeFrom);
+    if (itwnd != destination_windows.end())
+    {
+        max_total_size=itwnd->second;
+    }                                    
+
     total_size=0;
     map<int64_t,int64_t>::iterator itdld = destination_loads.find(response->SourceID());
     if (itdld != destination_loads.end())
@@ -389,6 +415,8 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
     map <CRelayResponsePair,CRelayRequestPairs> requests_to_send;    
     map <CRelayResponsePair,CRelayRequestPairs> responses_to_process;    
     map <int64_t,int64_t> destination_loads;    
+    map <NodeId,uint32_t> destination_windows;    
+    set <NodeId> destinations_timed_out;    
     mc_RelayRequest *request;
     mc_RelayRequest *query;
     mc_RelayResponse *response;
@@ -413,6 +441,12 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
             {
                 if(!collect_row->m_State.m_Request.IsZero())
                 {
+                    request=pRelayManager->FindRequest(collect_row->m_State.m_Request);
+                    if(request)
+                    {
+                        destinations_timed_out.insert(request->m_NodeTo);
+                        pRelayManager->UnLock();
+                    }
                     pRelayManager->DeleteRequest(collect_row->m_State.m_Request);
                     collect_row->m_State.m_Request=0;                    
                     for(int k=0;k<2;k++)collector->m_StatTotal[k].m_Undelivered+=k ? collect_row->m_ChunkDef.m_Size : 1;                
@@ -478,9 +512,28 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
     {
         max_total_destination_size=max_total_query_size;
     }
+    if(max_total_destination_size > MAX_SIZE-OFFCHAIN_MSG_PADDING)               // Chunks for one destination should fit into single response
+    {
+        max_total_destination_size=MAX_SIZE-OFFCHAIN_MSG_PADDING;        
+    }
+    
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)                                     // Outstanding chunk requests are limited by per-peer window
+        {
+            if(pnode->nMaxKBPerDestination)
+            {
+                uint32_t window=max((uint32_t)pnode->nMaxKBPerDestination*1024,max_total_query_size);
+                if(window > MAX_SIZE-OFFCHAIN_MSG_PADDING)
+                {
+                    window=MAX_SIZE-OFFCHAIN_MSG_PADDING;
+                }
+                destination_windows.insert(make_pair(pnode->GetId(),window));
+            }
+        }
+    }
     
     max_total_in_queries=collector->m_MaxKBPerDestination*1024;
-    max_total_in_queries*=collector->m_TimeoutRequest;
     total_in_queries=0;
     query_count=0;
     
@@ -552,7 +605,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
                     best_score=MC_CCW_WORST_RESPONSE_SCORE;
                     for(int i=0;i<(int)query->m_Responses.size();i++)
                     {
-                        this_score=MultichainResponseScore(&(query->m_Responses[i]),collect_row,destination_loads,max_total_destination_size);
+                        this_score=MultichainResponseScore(&(query->m_Responses[i]),collect_row,destination_loads,destination_windows,max_total_destination_size);
                         if(this_score < best_score)
                         {
                             best_score=this_score;
@@ -605,17 +658,44 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
         bool lost_permission=false;
         mapReadPermissionCache.clear();
         int ef_cache_id;
+        uint32_t request_flags;
+        NodeId session_node=-1;
+        set<uint160> sReadPermissioned;
         sAddressesToSign.clear();
         
+        request=pRelayManager->FindRequest(item.first.request_id);
+        if(request)
+        {
+            if(request->m_Responses[item.first.response_id].m_HopCount == 0)    // Sessions exist only with directly connected responders
+            {
+                session_node=request->m_Responses[item.first.response_id].m_NodeFrom;
+            }
+            pRelayManager->UnLock();
+        }
+        
         vector<unsigned char> vRPPayload;
         BOOST_FOREACH(PAIRTYPE(const int, int)& chunk_row, item.second.m_Pairs)    
         {                            
             collect_subrow=(mc_ChunkCollectorRow *)collector->m_MemPool->GetRow(chunk_row.first);
-            if(mc_IsReadPermissionedStream(&(collect_subrow->m_ChunkDef),mapReadPermissionCache,&sAddressesToSign) != 0)
+            if(mc_IsReadPermissionedStream(&(collect_subrow->m_ChunkDef),mapReadPermissionCache,&sAddressesToSign,session_node,&sReadPermissioned) != 0)
             {
                 lost_permission=true;
             }            
         }
+        if(!lost_permission && sAddressesToSign.size() && (session_node >= 0))  // If any stream needs signature, request is signed for all its streams,
+        {                                                                       // responder verifies all of them and renews their sessions
+            mapReadPermissionCache.clear();
+            sAddressesToSign.clear();
+            sReadPermissioned.clear();
+            BOOST_FOREACH(PAIRTYPE(const int, int)& chunk_row, item.second.m_Pairs)    
+            {                            
+                collect_subrow=(mc_ChunkCollectorRow *)collector->m_MemPool->GetRow(chunk_row.first);
+                if(mc_IsReadPermissionedStream(&(collect_subrow->m_ChunkDef),mapReadPermissionCache,&sAddressesToSign,-1,&sReadPermissioned) != 0)
+                {
+                    lost_permission=true;
+                }            
+            }
+        }
         if(!lost_permission)
         {
             vRPPayload.clear();
@@ -628,8 +708,13 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
             response=&(request->m_Responses[item.first.response_id]);
             
             ef_cache_id=-1;
-            if(sAddressesToSign.size())
+            request_flags=MC_RFL_NONE;
+            if(sReadPermissioned.size())
             {
+                if(pRelayManager->m_ReadSessionTimeout > 0)
+                {
+                    request_flags |= MC_RFL_READ_SESSION;
+                }
                 if(!pEF->OFF_GetPayloadForReadPermissioned(&vRPPayload,&ef_cache_id,strError))
                 {
                     if(fDebug)LogPrint("chunks","Error creating read-permissioned EF payload: %s\n",
@@ -669,7 +754,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
                 count++;
             }
     //        mc_DumpSize("req",&(payload[0]),1+shift+sizeof(mc_ChunkEntityKey)*item.second.m_Pairs.size(),64);
-            request_id=pRelayManager->SendNextRequest(response,MC_RMT_CHUNK_REQUEST,0,payload,sAddressesToSign,ef_cache_id);
+            request_id=pRelayManager->SendNextRequest(response,MC_RMT_CHUNK_REQUEST,request_flags,payload,sAddressesToSign,ef_cache_id);
             if(!request_id.IsZero())
             {
                 if(fDebug)LogPrint("chunks","New chunk request: %s, response: %s, chunks: %d\n",request_id.ToString().c_str(),response->m_MsgID.ToString().c_str(),item.second.m_Pairs.size());
@@ -819,6 +904,13 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
                 {
                     if(!collect_row->m_State.m_Request.IsZero())
                     {
+                        request=pRelayManager->FindRequest(collect_row->m_State.m_Request);
+                        if(request)
+                        {
+                            NodeId request_node=request->m_NodeTo;
+                            pRelayManager->UnLock();
+                            pRelayManager->DeleteReadSessions(request_node);    // Responder may have dropped the session, next request is signed
+                        }
                         pRelayManager->DeleteRequest(collect_row->m_State.m_Request);
                         collect_row->m_State.m_Request=0;
                         for(int k=0;k<2;k++)collector->m_StatTotal[k].m_Undelivered+=k ? collect_row->m_ChunkDef.m_Size : 1;                
@@ -928,6 +1020,19 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
     }
  */   
     collector->UnLock();
+    
+    if(destinations_timed_out.size())
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            if(destinations_timed_out.count(pnode->GetId()))
+            {
+                collector->AdjustKBPerDestination(pnode,false);
+            }
+        }
+    }
+    
     if(not_processed < collector->m_MaxMemPoolSize/2)
     {
         if(collector->m_NextAutoCommitTimestamp < GetTimeMillis())
@@ -1365,7 +1470,8 @@ bool mc_RelayProcess_Address_Query(unsigned char *ptrStart,unsigned char *ptrEnd
 bool MultichainRelayResponse(uint32_t msg_type_stored, CNode *pto_stored,
                              uint32_t msg_type_in, uint32_t  flags, vector<unsigned char>& vPayloadIn,vector<CScript>& vSigScriptsIn,vector<CScript>& vSigScriptsToVerify,
                              uint32_t* msg_type_response,uint32_t  *flags_response,vector<unsigned char>& vPayloadResponse,vector<CScript>& vSigScriptsRespond,
-                             uint32_t* msg_type_relay,uint32_t  *flags_relay,vector<unsigned char>& vPayloadRelay,vector<CScript>& vSigScriptsRelay,string& strError)
+                             uint32_t* msg_type_relay,uint32_t  *flags_relay,vector<unsigned char>& vPayloadRelay,vector<CScript>& vSigScriptsRelay,
+                             NodeId session_node,set<uint160>& sReadSessionsToOpen,string& strError)
 {
     unsigned char *ptr;
     unsigned char *ptrEnd;
@@ -1502,10 +1608,33 @@ bool MultichainRelayResponse(uint32_t msg_type_stored, CNode *pto_stored,
                     {
                         goto exitlbl;                                                    
                     }
-                    if(!pEF->OFF_GetScriptsToVerify(mapReadPermissionCache,vSigScriptsIn,vSigScriptsToVerify,strError))
+                    map<uint160,int> mapStreamsToVerify;                        // Signatures are required only for streams without open read session
+                    unsigned int permissioned_streams=0;
+                    bool signed_request=(vSigScriptsIn.size() != 0);           // Signed request covers all its streams, open sessions are renewed
+                    BOOST_FOREACH(PAIRTYPE(const uint160, int)& item, mapReadPermissionCache)    
+                    {
+                        if(item.second)
+                        {
+                            permissioned_streams++;
+                        }
+                        if( (item.second == 0) || (session_node < 0) || signed_request || !pRelayManager->HasPeerReadSession(session_node,item.first) )
+                        {
+                            mapStreamsToVerify.insert(item);
+                            if(item.second && (session_node >= 0) && (flags & MC_RFL_READ_SESSION) && (pRelayManager->m_ReadSessionTimeout > 0))
+                            {
+                                sReadSessionsToOpen.insert(item.first);
+                            }
+                        }
+                    }
+                    if(!pEF->OFF_GetScriptsToVerify(mapStreamsToVerify,vSigScriptsIn,vSigScriptsToVerify,strError))
                     {
                         goto exitlbl;                            
                     }
+                    if( sReadSessionsToOpen.size() &&                           // Flag is set only if this request opened or renewed sessions for all its streams,
+                       (sReadSessionsToOpen.size() == permissioned_streams) )   // requester doesn't extend sessions responder didn't renew
+                    {
+                        *flags_response |= MC_RFL_READ_SESSION;                 // Cleared by ProcessRelay if sessions cannot be opened
+                    }
                 }
                 else
                 {
@@ -1809,6 +1938,7 @@ void mc_RelayManager::Zero()
     m_Semaphore=NULL;
     m_LockedBy=0;         
     m_LastTime=0;
+    m_ReadSessionTimeout=0;
 }
 
 void mc_RelayManager::Destroy()
@@ -1867,6 +1997,8 @@ void mc_RelayManager::SetDefaults()
     MsgTypeSettings(MC_RMT_ERROR_IN_MESSAGE,30,10,1000,  1*1024*1024);
     MsgTypeSettings(MC_RMT_NEW_REQUEST     ,30,10,1000,  1*1024*1024);
     
+    m_ReadSessionTimeout=GetArg("-readsessiontimeout",MC_RSS_DEFAULT_TIMEOUT);
+    
     
     m_MinTimeShift=2 * 6 * Params().TargetSpacing();
     m_MaxTimeShift=2 * 6 * Params().TargetSpacing();
@@ -1900,6 +2032,8 @@ void mc_RelayManager::CheckTime()
     }        
     m_LastTime=time_now;
     UnLock();
+    
+    PurgeReadSessions();
 }
 
 void mc_RelayManager::SetRelayRecord(CNode *pto,CNode *pfrom,uint32_t msg_type,mc_OffchainMessageID msg_id)
@@ -2166,6 +2300,7 @@ bool mc_RelayManager::ProcessRelay( CNode* pfrom,
     uint32_t *msg_type_response_ptr;
     vector<unsigned char> vPayloadResponse;
     vector<unsigned char> vPayloadRelay;
+    set<uint160> sReadSessionsToOpen;
     string strError;    
     
     msg_type_stored=MC_RMT_NONE;
@@ -2473,7 +2608,8 @@ bool mc_RelayManager::ProcessRelay( CNode* pfrom,
             if(MultichainRelayResponse(msg_type_stored,pto_stored,
                                        msg_type_in,flags_in,vPayloadIn,vSigScripts,vSigScriptsToVerify,
                                        msg_type_response_ptr,&flags_response,vPayloadResponse,vSigScriptsRespond,
-                                       msg_type_relay_ptr,&flags_relay,vPayloadRelay,vSigScriptsRelay,strError))
+                                       msg_type_relay_ptr,&flags_relay,vPayloadRelay,vSigScriptsRelay,
+                                       hop_count ? -1 : pfrom->GetId(),sReadSessionsToOpen,strError))
             {
                 int dos_score=0;
                 if(!pEF->OFF_VerifySignatureScripts(msg_type_in,msg_id_received,msg_id_to_respond,flags_in,vPayloadIn,vSigScriptsToVerify,strError,dos_score))
@@ -2486,6 +2622,13 @@ bool mc_RelayManager::ProcessRelay( CNode* pfrom,
                     }
                     return false;
                 }
+                if(flags_response & MC_RFL_READ_SESSION)
+                {
+                    if(!OpenPeerReadSessions(pfrom->GetId(),sReadSessionsToOpen,vSigScriptsToVerify))
+                    {
+                        flags_response &= ~MC_RFL_READ_SESSION;
+                    }
+                }
                 if(msg_type_response_ptr && *msg_type_response_ptr)
                 {
                     if(*msg_type_response_ptr != MC_RMT_ADD_RESPONSE)
@@ -2568,6 +2711,7 @@ void mc_RelayRequest::Zero()
     m_Flags=0;
     m_NodeTo=0;
     m_LastTryTimestamp=0;
+    m_SentMillis=0;
     m_TryCount=0;
     m_Status=MC_RST_NONE;
     m_DestinationID=0;
@@ -2590,6 +2734,7 @@ int mc_RelayManager::AddRequest(CNode *pto,int64_t destination,mc_OffchainMessag
         request.m_Flags=flags;
         request.m_NodeTo=pto ? pto->GetId() : 0;
         request.m_LastTryTimestamp=0;
+        request.m_SentMillis=GetTimeMillis();
         request.m_TryCount=0;
         request.m_Status=status;
         request.m_DestinationID=destination;
@@ -2647,6 +2792,15 @@ int mc_RelayManager::AddResponse(mc_OffchainMessageID request,CNode *pfrom,int32
             if(status & MC_RST_SUCCESS)
             {
                 itreq->second.m_Status |= MC_RST_SUCCESS;
+                if( (msg_type == MC_RMT_CHUNK_RESPONSE) && (pfrom != NULL) )    // Sample consumed by mc_ChunkCollector::AdjustKBPerDestination
+                {
+                    pfrom->nChunkRTTSample=GetTimeMillis()-itreq->second.m_SentMillis;
+                    if(pfrom->nChunkRTTSample <= 0)
+                    {
+                        pfrom->nChunkRTTSample=1;
+                    }
+                    pfrom->nChunkBytesSample=(int)payload.size();
+                }
             }
         }
         else
@@ -2815,3 +2969,146 @@ void mc_RelayManager::InvalidateResponsesFromDisconnected()
     UnLock();
 }
 
+bool mc_RelayManager::HasReadSession(NodeId node,const uint160& stream)
+{
+    LOCK(cs_ReadSessions);
+    map<mc_ReadSessionKey,mc_ReadSession>::iterator it = m_ReadSessions.find(mc_ReadSessionKey(node,stream));
+    if(it == m_ReadSessions.end())
+    {
+        return false;
+    }
+    if(it->second.m_Expiration <= mc_TimeNowAsUInt())
+    {
+        m_ReadSessions.erase(it);
+        return false;
+    }
+    return true;
+}
+
+void mc_RelayManager::SetReadSession(NodeId node,const uint160& stream)
+{
+    mc_ReadSession session;
+    session.m_Expiration=mc_TimeNowAsUInt()+m_ReadSessionTimeout/2;             // Expires before responder session, otherwise the request is not served
+    
+    LOCK(cs_ReadSessions);
+    if(m_ReadSessions.count(mc_ReadSessionKey(node,stream)) == 0)
+    {
+        if(fDebug)LogPrint("offchain","Offchain read session open: peer: %d, stream: %s\n",node,stream.ToString().c_str());
+    }
+    m_ReadSessions[mc_ReadSessionKey(node,stream)]=session;                     // Responder opened or renewed the session for this request
+}
+
+void mc_RelayManager::DeleteReadSessions(NodeId node)
+{
+    LOCK(cs_ReadSessions);
+    map<mc_ReadSessionKey,mc_ReadSession>::iterator it = m_ReadSessions.lower_bound(mc_ReadSessionKey(node,uint160(0)));
+    while( (it != m_ReadSessions.end()) && (it->first.m_Node == node) )
+    {
+        if(fDebug)LogPrint("offchain","Offchain read session closed: peer: %d, stream: %s\n",node,it->first.m_Stream.ToString().c_str());
+        m_ReadSessions.erase(it++);
+    }
+}
+
+bool mc_RelayManager::HasPeerReadSession(NodeId node,const uint160& stream)
+{
+    LOCK(cs_ReadSessions);
+    map<mc_ReadSessionKey,mc_ReadSession>::iterator it = m_PeerReadSessions.find(mc_ReadSessionKey(node,stream));
+    if(it == m_PeerReadSessions.end())
+    {
+        return false;
+    }
+    if( (it->second.m_Expiration <= mc_TimeNowAsUInt()) ||
+        !mc_gState->m_Permissions->CanRead((unsigned char*)&stream,(unsigned char*)&(it->second.m_Address)) )    // Revoked
+    {
+        if(fDebug)LogPrint("offchain","Offchain peer read session closed: peer: %d, stream: %s\n",node,stream.ToString().c_str());
+        m_PeerReadSessions.erase(it);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Opens read sessions for streams using addresses of verified signatures, 
+ * returns false if permission for some stream cannot be attributed to any of them.
+ */
+
+bool mc_RelayManager::OpenPeerReadSessions(NodeId node,set<uint160>& sStreams,vector<CScript>& vSigScripts)
+{
+    vector<CKeyID> vSigners;
+    bool result=true;
+    
+    for(unsigned int i=0;i<vSigScripts.size();i++)
+    {
+        opcodetype opcode;
+        vector<unsigned char> vchSig;
+        vector<unsigned char> vchPubKey;
+        CScript::const_iterator pc = vSigScripts[i].begin();
+        
+        if(vSigScripts[i].GetOp(pc, opcode, vchSig) && vSigScripts[i].GetOp(pc, opcode, vchPubKey))
+        {
+            CPubKey pubkey(vchPubKey);
+            if(pubkey.IsValid())
+            {
+                vSigners.push_back(pubkey.GetID());
+            }
+        }
+    }
+    
+    mc_ReadSession session;
+    session.m_Expiration=mc_TimeNowAsUInt()+m_ReadSessionTimeout;
+    
+    BOOST_FOREACH(const uint160& stream, sStreams)
+    {
+        bool found=false;
+        for(unsigned int i=0;(i<vSigners.size()) && !found;i++)
+        {
+            if(mc_gState->m_Permissions->CanRead((unsigned char*)&stream,(unsigned char*)&(vSigners[i])))
+            {
+                session.m_Address=vSigners[i];
+                found=true;
+            }
+        }
+        if(found)
+        {
+            LOCK(cs_ReadSessions);
+            m_PeerReadSessions[mc_ReadSessionKey(node,stream)]=session;
+            if(fDebug)LogPrint("offchain","Offchain peer read session open: peer: %d, stream: %s, address: %s\n",
+                    node,stream.ToString().c_str(),CBitcoinAddress(session.m_Address).ToString().c_str());
+        }
+        else
+        {
+            result=false;
+        }
+    }
+    
+    return result;
+}
+
+void mc_RelayManager::PurgeReadSessions()
+{
+    uint32_t time_now=mc_TimeNowAsUInt();
+    
+    LOCK(cs_ReadSessions);
+    for(map<mc_ReadSessionKey,mc_ReadSession>::iterator it = m_ReadSessions.begin(); it != m_ReadSessions.end();)
+    {
+        if(it->second.m_Expiration <= time_now)
+        {
+            m_ReadSessions.erase(it++);
+        }
+        else
+        {
+            it++;
+        }
+    }        
+    for(map<mc_ReadSessionKey,mc_ReadSession>::iterator it = m_PeerReadSessions.begin(); it != m_PeerReadSessions.end();)
+    {
+        if(it->second.m_Expiration <= time_now)
+        {
+            m_PeerReadSessions.erase(it++);
+        }
+        else
+        {
+            it++;
+        }
+    }        
+}
@@ -62,6 +62,11 @@
 #define MC_RDT_CHUNKS                              0x12
 #define MC_RDT_ENTERPRISE_FEATURES                 0x21
 
+#define MC_RFL_NONE                          0x00000000
+#define MC_RFL_READ_SESSION                  0x00000001                         // chrq - sender supports read sessions, chrs - read sessions were opened or renewed by this request for all its read-permissioned streams
+
+#define MC_RSS_DEFAULT_TIMEOUT                      600
+
 #define MC_LIM_MAX_SECONDS                60
 #define MC_LIM_MAX_MEASURES                4
 
@@ -126,8 +131,13 @@ typedef struct mc_OffchainMessageID
         m_TimeStamp=0;
         m_Nonce=0;
     }
-       
-    
+
+    mc_OffchainMessageID(const mc_OffchainMessageID& b)
+    {
+        m_TimeStamp=b.m_TimeStamp;
+        m_Nonce=b.m_Nonce;
+    }
+
     friend bool operator<(const mc_OffchainMessageID& a, const mc_OffchainMessageID& b)
     {
         return ((a.m_TimeStamp < b.m_TimeStamp) || 
@@ -213,6 +223,38 @@ typedef struct mc_RelayRecordValue
     
 } mc_RelayRecordValue;
 
+typedef struct mc_ReadSessionKey
+{
+    NodeId m_Node;
+    uint160 m_Stream;
+
+    mc_ReadSessionKey(NodeId node,const uint160& stream)
+    {
+        m_Node=node;
+        m_Stream=stream;
+    }
+    
+    friend bool operator<(const mc_ReadSessionKey& a, const mc_ReadSessionKey& b)
+    {
+        return ((a.m_Node < b.m_Node) || 
+                (a.m_Node == b.m_Node && a.m_Stream < b.m_Stream));
+    }
+    
+} mc_ReadSessionKey;
+
+/*
+ * Read session - peer proved read permission for the stream once, following chunk requests 
+ * for this stream on the same connection are not signed. Responder keeps the address which 
+ * proved the permission and drops the session once the permission is revoked.
+ */
+
+typedef struct mc_ReadSession
+{
+    CKeyID m_Address;                                                           // Responder side only
+    uint32_t m_Expiration;
+    
+} mc_ReadSession;
+
 struct mc_RelayRequest;
 
 typedef struct mc_RelayResponse
@@ -246,6 +288,7 @@ typedef struct mc_RelayRequest
     uint32_t m_Flags;
     NodeId m_NodeTo;
     uint32_t m_LastTryTimestamp;
+    int64_t m_SentMillis;                                                       // Local time request was added, for round trip measurement
     int m_TryCount;
     uint32_t m_Status;
     int64_t m_DestinationID;
@@ -288,6 +331,11 @@ typedef struct mc_RelayManager
     map<const mc_RelayRecordKey,mc_RelayRecordValue> m_RelayRecords;
     map<mc_OffchainMessageID,mc_RelayRequest> m_Requests;
     
+    int m_ReadSessionTimeout;
+    CCriticalSection cs_ReadSessions;
+    map<mc_ReadSessionKey,mc_ReadSession> m_ReadSessions;                      // Streams this node proved read permission for, by destination
+    map<mc_ReadSessionKey,mc_ReadSession> m_PeerReadSessions;                  // Streams peers proved read permission for
+    
     void Zero();
     void Destroy();
     int Lock();
@@ -334,6 +382,13 @@ typedef struct mc_RelayManager
     mc_RelayRequest *FindRequest(mc_OffchainMessageID request);
     void InvalidateResponsesFromDisconnected();
     
+    bool HasReadSession(NodeId node,const uint160& stream);
+    void SetReadSession(NodeId node,const uint160& stream);
+    void DeleteReadSessions(NodeId node);
+    bool HasPeerReadSession(NodeId node,const uint160& stream);
+    bool OpenPeerReadSessions(NodeId node,set<uint160>& sStreams,vector<CScript>& vSigScripts);
+    void PurgeReadSessions();
+    
     mc_OffchainMessageID SendRequest(CNode* pto,uint32_t msg_type,uint32_t flags,vector <unsigned char>& payload);
 //    int64_t SendRequest(CNode* pto,uint32_t msg_type,uint32_t flags,vector <unsigned char>& payload);
     mc_OffchainMessageID SendNextRequest(mc_RelayResponse* response,uint32_t msg_type,uint32_t flags,vector <unsigned char>& payload,set<CPubKey>& vSigScripts,int ef_cache_id);
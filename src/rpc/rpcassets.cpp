@@ -2482,12 +2482,12 @@ Value getfilterassetbalances_operation(const Array& params, bool fHelp,bool aggr
     
     for(int j=0;j<(int)pMultiChainFilterEngine->m_Tx.vin.size();j++)
     {
-        int n=pMultiChainFilterEngine->m_Tx.vin[j].prevout.n;
-        CCoins coins;
+        const COutPoint &prevout=pMultiChainFilterEngine->m_Tx.vin[j].prevout;
+        Coin coin;
         {
             if(pMultiChainFilterEngine->m_CoinsCache)
             {
-                if (!((CCoinsViewCache*)(pMultiChainFilterEngine->m_CoinsCache))->GetCoins(pMultiChainFilterEngine->m_Tx.vin[j].prevout.hash, coins))
+                if (!((CCoinsViewCache*)(pMultiChainFilterEngine->m_CoinsCache))->GetCoin(prevout, coin))
                     return Value::null;        
             }
             else
@@ -2495,24 +2495,24 @@ Value getfilterassetbalances_operation(const Array& params, bool fHelp,bool aggr
                 LOCK(mempool.cs);
 
                 CCoinsViewMemPool view(pcoinsTip, mempool);
-                if (!view.GetCoins(pMultiChainFilterEngine->m_Tx.vin[j].prevout.hash, coins))
+                if (!view.GetCoin(prevout, coin))
                 {
                     return Value::null;                                                                 
                 }
             }
-            if (n<0 || (unsigned int)n>=coins.vout.size() || coins.vout[n].IsNull())
+            if (coin.IsSpent())
                 return Value::null;
 
             CTxDestination address;
             int required=0;
 
-            ExtractDestination(coins.vout[n].scriptPubKey, address);
+            ExtractDestination(coin.out.scriptPubKey, address);
     
             quantity=-1;
             if(lpAsset)
             {
                 asset_amounts->Clear();
-                if(CreateAssetBalanceList(coins.vout[n],asset_amounts,lpScript,&required,aggregate_tokens))
+                if(CreateAssetBalanceList(coin.out,asset_amounts,lpScript,&required,aggregate_tokens))
                 {
                     for(int i=0;i<asset_amounts->GetCount();i++)
                     {
@@ -2580,7 +2580,7 @@ Value getfilterassetbalances_operation(const Array& params, bool fHelp,bool aggr
             }
             else
             {
-                quantity=coins.vout[n].nValue;
+                quantity=coin.out.nValue;
             }    
             
             if(aggregate_tokens)
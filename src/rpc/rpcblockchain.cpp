@@ -615,10 +615,14 @@ Value gettxout(const Array& params, bool fHelp)
     if (params.size() > 2)
         fMempool = params[2].get_bool();
 
-    CCoins coins;
+    if (n<0 || n>0xFFFFFFFFLL)
+        return Value::null;
+    COutPoint out(hash, (uint32_t)n);
+
+    Coin coin;
     if(pMultiChainFilterEngine->m_CoinsCache)
     {
-        if (!((CCoinsViewCache*)(pMultiChainFilterEngine->m_CoinsCache))->GetCoins(hash, coins))
+        if (!((CCoinsViewCache*)(pMultiChainFilterEngine->m_CoinsCache))->GetCoin(out, coin))
             return Value::null;        
     }
     else
@@ -626,33 +630,32 @@ Value gettxout(const Array& params, bool fHelp)
         if (fMempool) {
             LOCK(mempool.cs);
             CCoinsViewMemPool view(pcoinsTip, mempool);
-            if (!view.GetCoins(hash, coins))
+            if (!view.GetCoin(out, coin))
                 return Value::null;
             if(pMultiChainFilterEngine->InFilter() == 0)                                // In filter we already checked this input exists, but mempool is dirty
             {
-                mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
+                if (mempool.isSpent(out))
+                    return Value::null;
             }
         } else {
-            if (!pcoinsTip->GetCoins(hash, coins))
+            if (!pcoinsTip->GetCoin(out, coin))
                 return Value::null;
         }
     }
-    if (n<0 || (unsigned int)n>=coins.vout.size() || coins.vout[n].IsNull())
-        return Value::null;
 
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *pindex = it->second;
     ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
-    if ((unsigned int)coins.nHeight == MEMPOOL_HEIGHT)
+    if ((unsigned int)coin.nHeight == MEMPOOL_HEIGHT)
         ret.push_back(Pair("confirmations", 0));
     else
-        ret.push_back(Pair("confirmations", pindex->nHeight - coins.nHeight + 1));
-    ret.push_back(Pair("value", ValueFromAmount(coins.vout[n].nValue)));
+        ret.push_back(Pair("confirmations", pindex->nHeight - (int)coin.nHeight + 1));
+    ret.push_back(Pair("value", ValueFromAmount(coin.out.nValue)));
     Object o;
-    ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
+    ScriptPubKeyToJSON(coin.out.scriptPubKey, o, true);
     ret.push_back(Pair("scriptPubKey", o));
-    ret.push_back(Pair("version", coins.nVersion));
-    ret.push_back(Pair("coinbase", coins.fCoinBase));
+    ret.push_back(Pair("version", coin.nVersion));
+    ret.push_back(Pair("coinbase", (bool)coin.fCoinBase));
     
 /* MCHN START */        
 
@@ -662,7 +665,7 @@ Value gettxout(const Array& params, bool fHelp)
     lpScript->Clear();
     
     asset_amounts->Clear();
-    CTxOut txout=coins.vout[n];
+    CTxOut txout=coin.out;
     if(CreateAssetBalanceList(txout,asset_amounts,lpScript,NULL,false))
     {
         Array assets;
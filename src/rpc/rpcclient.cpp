@@ -575,6 +575,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "createrawsendfrom", 2 },
     { "signrawtransaction", 1 },
     { "signrawtransaction", 2 },
+    { "sendrawtransaction", 0 },
     { "sendrawtransaction", 1 },
     { "gettxout", 1 },
     { "gettxout", 2 },
@@ -705,6 +706,7 @@ public:
 
 static const CRPCConvertParamMayBeString vRPCConvertParamsMayBeString[] =
 {
+    { "sendrawtransaction", 0 },
     { "issue", 1 },
     { "issuefrom", 2 },
     { "appendrawmetadata", 1 },
@@ -734,6 +736,9 @@ static const CRPCConvertParamMayBeString vRPCConvertParamsMayBeString[] =
     { "liststreamkeys", 1 },
     { "liststreampublishers", 1 },
     { "liststreamtxitems", 1 },
+    { "liststreamitems", 3 },
+    { "liststreamkeyitems", 4 },
+    { "liststreampublisheritems", 4 },
     { "listassets", 0 },
     { "liststreams", 0 },
     { "listvariables", 0 },
@@ -807,6 +812,9 @@ static const CRPCConvertParamAnyType vRPCConvertParamsAnyType[] =
     { "create", 3 },                                                            
     { "setvariablevaluefrom", 2 },                                                            
     { "setvariablevalue", 1 },                                                                
+    { "liststreamitems", 3 },
+    { "liststreamkeyitems", 4 },
+    { "liststreampublisheritems", 4 },
 };
 
 class CRPCConvertTableAnyType
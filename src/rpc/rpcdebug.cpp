@@ -7,6 +7,9 @@
 #include "json/json_spirit_ubjson.h"
 #include "wallet/wallettxs.h"
 #include "net/net.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "storage/txdb.h"
 
 void *mcd_RWLock=NULL;
 
@@ -488,6 +491,443 @@ Value mcd_DebugIssueLicenseToken(const Object& params)
     return wtx.GetHash().GetHex();    
 }
 
+/** 
+ * Signs synthetic transactions with 1, 10, 100, ... maxinputs inputs input-by-input (SignSignature) and by SignSignatures.
+ * With "wallet" keys are taken from the wallet (decrypted on every GetKey if wallet is encrypted), otherwise random keys are used.
+ */
+
+Value mcd_BenchSign(const Object& params)
+{
+    int max_inputs=mcd_ParamIntValue(params,"maxinputs",1000);
+    int key_count=mcd_ParamIntValue(params,"keys",1);
+    int rounds=mcd_ParamIntValue(params,"rounds",1);
+    int use_wallet=mcd_ParamIntValue(params,"wallet",0);
+    if( (max_inputs < 1) || (key_count < 1) || (rounds < 1) )
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameters");                                            
+    }
+    
+    CBasicKeyStore random_keystore;
+    const CKeyStore *keystore=&random_keystore;
+    vector<CScript> vKeyScripts;
+    
+    if(use_wallet)
+    {
+        if(pwalletMain == NULL)
+        {
+            throw JSONRPCError(RPC_NOT_SUPPORTED, "Wallet is disabled");                                            
+        }
+        EnsureWalletIsUnlocked();
+        set<CKeyID> setKeys;
+        pwalletMain->GetKeys(setKeys);
+        BOOST_FOREACH(const CKeyID& keyID, setKeys)
+        {
+            if((int)vKeyScripts.size() >= key_count)
+            {
+                break;
+            }
+            vKeyScripts.push_back(GetScriptForDestination(keyID));
+        }
+        if(vKeyScripts.size() == 0)
+        {
+            throw JSONRPCError(RPC_WALLET_ERROR, "No keys in the wallet");                                            
+        }
+        keystore=pwalletMain;
+    }
+    else
+    {
+        for(int k=0;k<key_count;k++)
+        {
+            CKey key;
+            key.MakeNewKey(true);
+            random_keystore.AddKey(key);
+            vKeyScripts.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+        }
+    }
+    
+    vector<int> vSizes;
+    for(int n=1;n<max_inputs;n*=10)
+    {
+        vSizes.push_back(n);
+    }
+    vSizes.push_back(max_inputs);
+    
+    Array results;
+    BOOST_FOREACH(int n, vSizes)
+    {
+        CMutableTransaction txBase;
+        vector<CScript> vFromPubKeys;
+        vector<unsigned int> vIn;
+        for(int i=0;i<n;i++)
+        {
+            txBase.vin.push_back(CTxIn(COutPoint(GetRandHash(),i)));
+            vFromPubKeys.push_back(vKeyScripts[i % vKeyScripts.size()]);
+            vIn.push_back(i);
+        }
+        txBase.vout.push_back(CTxOut(0,vKeyScripts[0]));
+        
+        CMutableTransaction txSerial,txParallel;
+        bool fSigned=true;
+        double serial_time=0.;
+        double parallel_time=0.;
+        for(int r=0;r<rounds;r++)
+        {
+            txSerial=txBase;
+            double start=mc_TimeNowAsDouble();
+            for(int i=0;i<n;i++)
+            {
+                fSigned &= SignSignature(*keystore, vFromPubKeys[i], txSerial, i);
+            }
+            serial_time+=mc_TimeNowAsDouble()-start;
+            
+            txParallel=txBase;
+            start=mc_TimeNowAsDouble();
+            fSigned &= SignSignatures(*keystore, vFromPubKeys, txParallel, vIn);
+            parallel_time+=mc_TimeNowAsDouble()-start;
+        }
+        
+        bool fIdentical=true;                                                   // RFC6979 signatures don't depend on the order or thread
+        for(int i=0;i<n;i++)
+        {
+            if(txSerial.vin[i].scriptSig != txParallel.vin[i].scriptSig)
+            {
+                fIdentical=false;
+            }
+        }
+        
+        Object entry;
+        entry.push_back(Pair("inputs",n));
+        entry.push_back(Pair("signed",fSigned));
+        entry.push_back(Pair("identical",fIdentical));
+        entry.push_back(Pair("serialms",1000.*serial_time/rounds));
+        entry.push_back(Pair("parallelms",1000.*parallel_time/rounds));
+        entry.push_back(Pair("speedup",(parallel_time > 0.) ? serial_time/parallel_time : 0.));
+        results.push_back(entry);
+    }
+    
+    Object result;
+    result.push_back(Pair("threads",nSignatureThreads));
+    result.push_back(Pair("keys",(int)vKeyScripts.size()));
+    result.push_back(Pair("wallet",use_wallet != 0));
+    result.push_back(Pair("rounds",rounds));
+    result.push_back(Pair("results",results));
+    return result;
+}
+
+/** Encrypted key store with random keys and master key, decrypted key cache size is set per benchmark run */
+class CBenchCryptoKeyStore : public CCryptoKeyStore
+{
+public:
+    bool Initialize(int key_count)
+    {
+        for(int k=0;k<key_count;k++)
+        {
+            CKey key;
+            key.MakeNewKey(true);
+            if(!AddKey(key))
+            {
+                return false;
+            }
+        }
+        vBenchMasterKey.resize(WALLET_CRYPTO_KEY_SIZE);
+        GetRandBytes(&vBenchMasterKey[0],WALLET_CRYPTO_KEY_SIZE);
+        return EncryptKeys(vBenchMasterKey);
+    }
+    
+    bool Reset(int cache_size)                                                  // Lock/Unlock clears decrypted key cache
+    {
+        nDecryptedKeyCacheSize=cache_size;
+        Lock();
+        return Unlock(vBenchMasterKey);
+    }
+    
+private:
+    CKeyingMaterial vBenchMasterKey;
+};
+
+/** 
+ * Key lookups and signing of a transaction with inputs spending keys round-robin, 
+ * on encrypted key store without and with decrypted key cache.
+ */
+
+Value mcd_BenchKeyCache(const Object& params)
+{
+    int key_count=mcd_ParamIntValue(params,"keys",10);
+    int inputs=mcd_ParamIntValue(params,"inputs",200);
+    int lookups=mcd_ParamIntValue(params,"lookups",100000);
+    int rounds=mcd_ParamIntValue(params,"rounds",3);
+    if( (key_count < 1) || (inputs < 1) || (lookups < 1) || (rounds < 1) )
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameters");                                            
+    }
+    
+    CBenchCryptoKeyStore keystore;
+    if(!keystore.Initialize(key_count))
+    {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create encrypted key store");                                            
+    }
+    
+    vector<CKeyID> vKeyIDs;
+    vector<CScript> vFromPubKeys;
+    vector<unsigned int> vIn;
+    set<CKeyID> setKeys;
+    keystore.GetKeys(setKeys);
+    BOOST_FOREACH(const CKeyID& keyID, setKeys)
+    {
+        vKeyIDs.push_back(keyID);
+    }
+    
+    CMutableTransaction txBase;
+    for(int i=0;i<inputs;i++)
+    {
+        txBase.vin.push_back(CTxIn(COutPoint(GetRandHash(),i)));
+        vFromPubKeys.push_back(GetScriptForDestination(vKeyIDs[i % vKeyIDs.size()]));
+        vIn.push_back(i);
+    }
+    txBase.vout.push_back(CTxOut(0,vFromPubKeys[0]));
+    
+    Array results;
+    for(int cached=0;cached<2;cached++)
+    {
+        if(!keystore.Reset(cached ? DEFAULT_WALLET_KEY_CACHE_SIZE : 0))
+        {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't unlock encrypted key store");                                            
+        }
+        
+        double start=mc_TimeNowAsDouble();
+        for(int l=0;l<lookups;l++)
+        {
+            CKey key;
+            if(!keystore.GetKey(vKeyIDs[l % vKeyIDs.size()],key))
+            {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't get key");                                            
+            }
+        }
+        double lookup_time=mc_TimeNowAsDouble()-start;
+        
+        double serial_time=0.;
+        double batch_time=0.;
+        for(int r=0;r<rounds;r++)
+        {
+            CMutableTransaction tx=txBase;
+            start=mc_TimeNowAsDouble();
+            for(int i=0;i<inputs;i++)
+            {
+                SignSignature(keystore, vFromPubKeys[i], tx, i);
+            }
+            serial_time+=mc_TimeNowAsDouble()-start;
+            
+            tx=txBase;
+            start=mc_TimeNowAsDouble();
+            SignSignatures(keystore, vFromPubKeys, tx, vIn);
+            batch_time+=mc_TimeNowAsDouble()-start;
+        }
+        
+        Object entry;
+        entry.push_back(Pair("cache",cached != 0));
+        entry.push_back(Pair("getkeyus",1000000.*lookup_time/lookups));
+        entry.push_back(Pair("signserialms",1000.*serial_time/rounds));
+        entry.push_back(Pair("signbatchms",1000.*batch_time/rounds));
+        results.push_back(entry);
+    }
+    
+    Object result;
+    result.push_back(Pair("keys",key_count));
+    result.push_back(Pair("inputs",inputs));
+    result.push_back(Pair("threads",nSignatureThreads));
+    result.push_back(Pair("results",results));
+    return result;
+}
+
+/** 
+ * Context-free MultiChain input checks of recent blocks, serially and on script check threads.
+ * Spent scriptPubKeys are taken from block undo data, so blocks already in the chain can be used.
+ */
+
+Value mcd_BenchPrecheck(const Object& params)
+{
+    int blocks=mcd_ParamIntValue(params,"blocks",1);
+    int rounds=mcd_ParamIntValue(params,"rounds",3);
+    int height;
+    
+    vector<CTransaction> vtx;
+    vector<CMultiChainInputPrecheck> vPrechecks;
+    int tx_count=0;
+    int input_count=0;
+    
+    LOCK(cs_main);                                                              // Check queue is used by ConnectBlock under cs_main
+    {
+        height=mcd_ParamIntValue(params,"height",chainActive.Height());
+        if( (blocks < 1) || (rounds < 1) || (height < 1) || (height > chainActive.Height()) )
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameters");                                            
+        }
+        
+        for(int h=height;(h > 0) && (h > height-blocks);h--)
+        {
+            CBlockIndex* pindex=chainActive[h];
+            CBlock block;
+            CBlockUndo blockundo;
+            if(!ReadBlockFromDisk(block, pindex))
+            {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't read block");                                            
+            }
+            CDiskBlockPos pos = pindex->GetUndoPos();
+            if (pos.IsNull() || !blockundo.ReadFromDisk(pos, pindex->pprev->GetBlockHash()))
+            {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't read block undo data");                                            
+            }
+            for(unsigned int i=1;i<block.vtx.size();i++)
+            {
+                const CTxUndo &txundo = blockundo.vtxundo[i-1];
+                CMultiChainInputPrecheck precheck;
+                for(unsigned int j=0;j<txundo.vprevout.size();j++)
+                {
+                    precheck.vPrevScripts.push_back(txundo.vprevout[j].txout.scriptPubKey);
+                }
+                vtx.push_back(block.vtx[i]);
+                vPrechecks.push_back(precheck);
+                tx_count++;
+                input_count+=block.vtx[i].vin.size();
+            }
+        }
+    }
+    
+    vector<CMultiChainInputPrecheck> vSerial=vPrechecks;
+    double serial_time=0.;
+    double parallel_time=0.;
+    bool identical=true;
+    for(int r=0;r<rounds;r++)
+    {
+        double start=mc_TimeNowAsDouble();
+        RunMultiChainInputPrechecks(vtx,vSerial,false);
+        serial_time+=mc_TimeNowAsDouble()-start;
+        
+        start=mc_TimeNowAsDouble();
+        RunMultiChainInputPrechecks(vtx,vPrechecks,true);
+        parallel_time+=mc_TimeNowAsDouble()-start;
+    }
+    
+    for(unsigned int i=0;i<vtx.size();i++)
+    {
+        if( (vSerial[i].nFailedInput != vPrechecks[i].nFailedInput) || 
+            (vSerial[i].vInputDestinations != vPrechecks[i].vInputDestinations) ||
+            (vSerial[i].vInputHashTypes != vPrechecks[i].vInputHashTypes) )
+        {
+            identical=false;
+        }
+    }
+    
+    Object result;
+    result.push_back(Pair("height",height));
+    result.push_back(Pair("blocks",blocks));
+    result.push_back(Pair("txs",tx_count));
+    result.push_back(Pair("inputs",input_count));
+    result.push_back(Pair("threads",nScriptCheckThreads));
+    result.push_back(Pair("mininputs",GetArg("-parallelprecheckmininputs",DEFAULT_PARALLEL_PRECHECK_MIN_INPUTS)));
+    result.push_back(Pair("identical",identical));
+    result.push_back(Pair("serialms",1000.*serial_time/rounds));
+    result.push_back(Pair("parallelms",1000.*parallel_time/rounds));
+    result.push_back(Pair("speedup",(parallel_time > 0.) ? serial_time/parallel_time : 0.));
+    return result;
+}
+
+/** 
+ * UTXO part of connecting a fan-out-heavy block: the block spends a few outputs of one transaction 
+ * with many outputs, stored in an in-memory coins database. Time, cache entries and cache memory 
+ * per block are reported for growing numbers of outputs of the parent transaction.
+ */
+
+Value mcd_BenchCoins(const Object& params)
+{
+    int max_outputs=mcd_ParamIntValue(params,"outputs",10000);
+    int spends=mcd_ParamIntValue(params,"spends",100);
+    int rounds=mcd_ParamIntValue(params,"rounds",3);
+    if( (max_outputs < 1) || (spends < 1) || (spends > max_outputs) || (rounds < 1) )
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameters");                                            
+    }
+    
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey=GetScriptForDestination(key.GetPubKey().GetID());
+    
+    vector<int> vSizes;
+    for(int n=spends;n<max_outputs;n*=10)
+    {
+        vSizes.push_back(n);
+    }
+    vSizes.push_back(max_outputs);
+    
+    Array results;
+    BOOST_FOREACH(int n, vSizes)
+    {
+        CCoinsViewDB db(1 << 20, true);                                         // In-memory LevelDB, not the node chainstate
+        CMutableTransaction txParent;
+        txParent.vin.push_back(CTxIn(COutPoint(GetRandHash(),0)));
+        for(int i=0;i<n;i++)
+        {
+            txParent.vout.push_back(CTxOut(i+1,scriptPubKey));
+        }
+        CTransaction parent(txParent);
+        {
+            CCoinsViewCache cache(&db);
+            AddCoins(cache, parent, 1);
+            cache.SetBestBlock(GetRandHash());
+            if(!cache.Flush())
+            {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't write coins");                                            
+            }
+        }
+        
+        vector<CTransaction> vtx;
+        for(int i=0;i<spends;i++)
+        {
+            CMutableTransaction tx;
+            tx.vin.push_back(CTxIn(COutPoint(parent.GetHash(),(uint32_t)((int64_t)i*n/spends))));
+            tx.vout.push_back(CTxOut(1,scriptPubKey));
+            vtx.push_back(CTransaction(tx));
+        }
+        
+        double connect_time=0.;
+        size_t cache_entries=0;
+        size_t cache_bytes=0;
+        for(int r=0;r<rounds;r++)
+        {
+            CCoinsViewCache view(&db);
+            CValidationState state;
+            CBlockUndo blockundo;
+            double start=mc_TimeNowAsDouble();
+            for(unsigned int t=0;t<vtx.size();t++)
+            {
+                if(!view.HaveInputs(vtx[t]))
+                {
+                    throw JSONRPCError(RPC_INTERNAL_ERROR, "Missing inputs");                                            
+                }
+                blockundo.vtxundo.push_back(CTxUndo());
+                UpdateCoins(vtx[t], state, view, blockundo.vtxundo.back(), 2);
+            }
+            connect_time+=mc_TimeNowAsDouble()-start;
+            cache_entries=view.GetCacheSize();
+            cache_bytes=view.DynamicMemoryUsage();
+        }
+        
+        Object entry;
+        entry.push_back(Pair("outputs",n));
+        entry.push_back(Pair("connectms",1000.*connect_time/rounds));
+        entry.push_back(Pair("spendus",1000000.*connect_time/rounds/spends));
+        entry.push_back(Pair("cacheentries",(int64_t)cache_entries));
+        entry.push_back(Pair("cachebytesperspend",(int64_t)(cache_bytes/spends)));
+        results.push_back(entry);
+    }
+    
+    Object result;
+    result.push_back(Pair("spends",spends));
+    result.push_back(Pair("rounds",rounds));
+    result.push_back(Pair("results",results));
+    return result;
+}
+
 Value mcd_DebugRequest(string method,const Object& params)
 {
     if(method == "issuelicensetoken")
@@ -631,6 +1071,22 @@ Value mcd_DebugRequest(string method,const Object& params)
         mcd_CloseDatabase(m_DB);
         return dres;
     }
+    if(method == "benchsign")
+    {
+        return mcd_BenchSign(params);
+    }
+    if(method == "benchkeycache")
+    {
+        return mcd_BenchKeyCache(params);
+    }
+    if(method == "benchprecheck")
+    {
+        return mcd_BenchPrecheck(params);
+    }
+    if(method == "benchcoins")
+    {
+        return mcd_BenchCoins(params);
+    }
     if(method == "chunksdump")
     {
         int force=mcd_ParamIntValue(params,"force",0);
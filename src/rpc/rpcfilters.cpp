@@ -1067,7 +1067,6 @@ Value testfilter(const vector <uint160>& entities,string filter_code, Value txpa
             {
                 LOCK(mempool.cs);
                 all_inputs_found=true;
-                CCoins coins;
                 string reason;
                 CCoinsView dummy;
                 CCoinsViewCache view(&dummy);
@@ -1075,17 +1074,10 @@ Value testfilter(const vector <uint160>& entities,string filter_code, Value txpa
                 view.SetBackend(viewMemPool);
                 for(unsigned int i=0;i<tx.vin.size();i++)
                 {
-                    if (!view.GetCoins(tx.vin[i].prevout.hash, coins))
+                    if (!view.HaveCoin(tx.vin[i].prevout))
                     {
                         all_inputs_found=false;                                            
                     }                    
-                    else
-                    {
-                        if(!coins.IsAvailable(tx.vin[i].prevout.n))
-                        {
-                            all_inputs_found=false;                                                                        
-                        }
-                    }
                 }
             }                
             if ( (filter_type == MC_FLT_TYPE_TX) && all_inputs_found)
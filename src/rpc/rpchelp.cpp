@@ -761,6 +761,17 @@ void mc_InitRPCHelpMap04()
             "    \"handshakelocal\": n,            (string) If protocol is Multichain. Address used by local node for handshake.\n"
             "    \"handshake\": n,                 (string) If protocol is Multichain. Address used by remote node for handshake.\n"
             "    \"inbound\": true|false,          (boolean) Inbound (true) or Outbound (false)\n"
+            "    \"encrypted\": true|false,        (boolean) Connection is encrypted\n"
+            "    \"compression\": {                (object) Compression of block, tx and headers messages\n"
+            "      \"send\": true|false,           (boolean) Messages to the peer are compressed\n"
+            "      \"recv\": true|false,           (boolean) Compression was offered to the peer\n"
+            "      \"bytessentraw\": n,            (numeric) Uncompressed size of these messages sent\n"
+            "      \"bytessent\": n,               (numeric) Their size on the wire\n"
+            "      \"sendratio\": x.xx,            (numeric) bytessentraw/bytessent\n"
+            "      \"bytesrecvraw\": n,            (numeric) Uncompressed size of these messages received\n"
+            "      \"bytesrecv\": n,               (numeric) Their size on the wire\n"
+            "      \"recvratio\": x.xx,            (numeric) bytesrecvraw/bytesrecv\n"
+            "    },\n"
             "    \"startingheight\": n,            (numeric) The starting height (block) of the peer\n"
             "    \"banscore\": n,                  (numeric) The ban score\n"
             "    \"synced_headers\": n,            (numeric) The last header we have in common with this peer\n"
@@ -1143,9 +1154,14 @@ void mc_InitRPCHelpMap05()
             "\nAlso see createrawtransaction and signrawtransaction calls.\n"
             "\nArguments:\n"
             "1. \"tx-hex\"                         (string, required) The hex string of the raw transaction)\n"
+            " or\n"
+            "1. tx-hexes                         (array, required) Topologically ordered array of raw transaction hex strings,\n"
+            "                                                      accepted in one batch\n"
             "2. allowhighfees                    (boolean, optional, default=false) Allow high fees\n"
             "\nResult:\n"
             "\"hex\"                               (string) The transaction hash in hex\n"
+            " or\n"
+            "[{\"txid\":\"hex\",\"error\":...},...]    (array) If array of transactions is passed, transaction hashes and rejection reasons, null if accepted\n"
             "\nExamples:\n"
             "\nCreate a transaction\n"
             + HelpExampleCli("createrawtransaction", "\"[{\\\"txid\\\" : \\\"mytxid\\\",\\\"vout\\\":0}]\" \"{\\\"myaddress\\\":0.01}\"") +
@@ -2759,10 +2775,27 @@ void mc_InitRPCHelpMap12()
             "2. verbose                          (boolean, optional, default=false) If true, returns information about item transaction \n"
             "3. count                            (number, optional, default=10) The number of items to display\n"
             "4. start                            (number, optional, default=-count - last) Start from specific item, 0 based, if negative - from the end\n"
+            " or\n"
+            "4. start                            (string, optional) \"first\" - page forward from the oldest item, \"last\" - page backward from the newest item,\n"
+            "                                                      or continuation token returned in \"next\" field by the previous call\n"
+            " or\n"
+            "4. start                            (object, optional) Time window, returns count items confirmed in blocks with timestamp in this window\n"
+            "    {\n"
+            "      \"starttime\" : start-time      (numeric,optional) Start time, default - from the first block.\n"
+            "      \"endtime\" : end-time          (numeric,optional) End time, default - up to the last block.\n"
+            "      \"start\" : start               (numeric,optional, default=0) Start from specific item in the window, 0 based\n"
+            "    }\n"
             "5. local-ordering                   (boolean, optional, default=false) If true, items appear in the order they were processed by the wallet,\n"
             "                                                                       if false - in the order they appear in blockchain\n"
             "\nResult:\n"
             "\"stream-items\"                      (array) List of stream items.\n"
+            " or\n"
+            "{\"items\":[...],\"next\":token}          (object) If start is string, list of stream items and continuation token.\n"
+            "                                                      Paging forward, token is always returned and can be used later to get items added after this call.\n"
+            "                                                      Paging backward, items are in descending order, token is null after the first item is returned.\n"
+            " or\n"
+            "{\"items\":[...],\"next\":start}          (object) If start is time window, list of stream items and start of the next page in this window,\n"
+            "                                                      null if there are no more items in the window.\n"
             "\nExamples:\n"
             + HelpExampleCli("liststreamitems", "\"test-stream\"") 
             + HelpExampleCli("liststreamitems", "\"test-stream\" true 10 100") 
@@ -2778,10 +2811,27 @@ void mc_InitRPCHelpMap12()
             "3. verbose                          (boolean, optional, default=false) If true, returns information about item transaction \n"
             "4. count                            (number, optional, default=10) The number of items to display\n"
             "5. start                            (number, optional, default=-count - last) Start from specific item, 0 based, if negative - from the end\n"
+            " or\n"
+            "5. start                            (string, optional) \"first\" - page forward from the oldest item, \"last\" - page backward from the newest item,\n"
+            "                                                      or continuation token returned in \"next\" field by the previous call\n"
+            " or\n"
+            "5. start                            (object, optional) Time window, returns count items confirmed in blocks with timestamp in this window\n"
+            "    {\n"
+            "      \"starttime\" : start-time      (numeric,optional) Start time, default - from the first block.\n"
+            "      \"endtime\" : end-time          (numeric,optional) End time, default - up to the last block.\n"
+            "      \"start\" : start               (numeric,optional, default=0) Start from specific item in the window, 0 based\n"
+            "    }\n"
             "6. local-ordering                   (boolean, optional, default=false) If true, items appear in the order they were processed by the wallet,\n"
             "                                                                       if false - in the order they appear in blockchain\n"
             "\nResult:\n"
             "\"stream-items\"                      (array) List of stream items for specific key.\n"
+            " or\n"
+            "{\"items\":[...],\"next\":token}          (object) If start is string, list of stream items and continuation token.\n"
+            "                                                      Paging forward, token is always returned and can be used later to get items added after this call.\n"
+            "                                                      Paging backward, items are in descending order, token is null after the first item is returned.\n"
+            " or\n"
+            "{\"items\":[...],\"next\":start}          (object) If start is time window, list of stream items and start of the next page in this window,\n"
+            "                                                      null if there are no more items in the window.\n"
             "\nExamples:\n"
             + HelpExampleCli("liststreamkeyitems", "\"test-stream\" \"key01\"") 
             + HelpExampleCli("liststreamkeyitems", "\"test-stream\" \"key01\" true 10 100") 
@@ -2819,10 +2869,27 @@ void mc_InitRPCHelpMap12()
             "3. verbose                          (boolean, optional, default=false) If true, returns information about item transaction \n"
             "4. count                            (number, optional, default=10) The number of items to display\n"
             "5. start                            (number, optional, default=-count - last) Start from specific item, 0 based, if negative - from the end\n"
+            " or\n"
+            "5. start                            (string, optional) \"first\" - page forward from the oldest item, \"last\" - page backward from the newest item,\n"
+            "                                                      or continuation token returned in \"next\" field by the previous call\n"
+            " or\n"
+            "5. start                            (object, optional) Time window, returns count items confirmed in blocks with timestamp in this window\n"
+            "    {\n"
+            "      \"starttime\" : start-time      (numeric,optional) Start time, default - from the first block.\n"
+            "      \"endtime\" : end-time          (numeric,optional) End time, default - up to the last block.\n"
+            "      \"start\" : start               (numeric,optional, default=0) Start from specific item in the window, 0 based\n"
+            "    }\n"
             "6. local-ordering                   (boolean, optional, default=false) If true, items appear in the order they were processed by the wallet,\n"
             "                                                                       if false - in the order they appear in blockchain\n"
             "\nResult:\n"
             "\"stream-items\"                      (array) List of stream items for specific publisher.\n"
+            " or\n"
+            "{\"items\":[...],\"next\":token}          (object) If start is string, list of stream items and continuation token.\n"
+            "                                                      Paging forward, token is always returned and can be used later to get items added after this call.\n"
+            "                                                      Paging backward, items are in descending order, token is null after the first item is returned.\n"
+            " or\n"
+            "{\"items\":[...],\"next\":start}          (object) If start is time window, list of stream items and start of the next page in this window,\n"
+            "                                                      null if there are no more items in the window.\n"
             "\nExamples:\n"
             + HelpExampleCli("liststreampublisheritems", "\"test-stream\" \"1M72Sfpbz1BPpXFHz9m3CdqATR44Jvaydd\"") 
             + HelpExampleCli("liststreampublisheritems", "\"test-stream\" \"1M72Sfpbz1BPpXFHz9m3CdqATR44Jvaydd\" true 10 100") 
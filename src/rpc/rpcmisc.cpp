@@ -13,6 +13,8 @@
 #include "rpc/rpcserver.h"
 #include "utils/timedata.h"
 #include "utils/util.h"
+#include "utils/notifyqueue.h"
+#include "miner/miner.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
@@ -1528,6 +1530,149 @@ Value getdiagnostics(const Array& params, bool fHelp)
     mempool_info.push_back(Pair("size", (int64_t) mempool.size()));
     mempool_info.push_back(Pair("bytes", (int64_t) mempool.GetTotalTxSize()));    
     result.push_back(Pair("mempoolinfo",mempool_info));
+    
+    CNotifyQueueStats notify_stats=notifyQueue.GetStats();
+    Object notify_info;
+    notify_info.push_back(Pair("threads", notify_stats.nThreads));
+    notify_info.push_back(Pair("batchsize", notify_stats.nBatchSize));
+    notify_info.push_back(Pair("queuesize", notify_stats.nMaxSize));
+    notify_info.push_back(Pair("queued", notify_stats.nDepth));
+    notify_info.push_back(Pair("maxqueued", notify_stats.nMaxDepth));
+    notify_info.push_back(Pair("events", notify_stats.nPushed));
+    notify_info.push_back(Pair("coalesced", notify_stats.nCoalesced));
+    notify_info.push_back(Pair("invocations", notify_stats.nInvocations));
+    notify_info.push_back(Pair("dropped", notify_stats.nDropped));
+    notify_info.push_back(Pair("discarded", notify_stats.nDiscarded));
+    notify_info.push_back(Pair("avgwaitms", (notify_stats.nPushed > notify_stats.nDepth+notify_stats.nDiscarded) ? 
+            (double)notify_stats.nWaitMicros/(1000.*(notify_stats.nPushed-notify_stats.nDepth-notify_stats.nDiscarded)) : 0.));
+    result.push_back(Pair("notifications",notify_info));
+    
+    CRPCWorkQueueStats rpc_stats=GetRPCWorkQueueStats();
+    Object rpc_queue_info;
+    rpc_queue_info.push_back(Pair("iothreads", rpc_stats.nIOThreads));
+    rpc_queue_info.push_back(Pair("threads", rpc_stats.nWorkers));
+    rpc_queue_info.push_back(Pair("queuesize", rpc_stats.nMaxSize));
+    rpc_queue_info.push_back(Pair("queued", rpc_stats.nDepth));
+    rpc_queue_info.push_back(Pair("maxqueued", rpc_stats.nMaxDepth));
+    rpc_queue_info.push_back(Pair("clients", rpc_stats.nClients));
+    rpc_queue_info.push_back(Pair("requests", rpc_stats.nQueued));
+    rpc_queue_info.push_back(Pair("rejected", rpc_stats.nRejected));
+    rpc_queue_info.push_back(Pair("avgwaitms", (rpc_stats.nCompleted > 0) ? 
+            (double)rpc_stats.nWaitMicros/(1000.*rpc_stats.nCompleted) : 0.));
+    rpc_queue_info.push_back(Pair("avgexecms", (rpc_stats.nCompleted > 0) ? 
+            (double)rpc_stats.nExecMicros/(1000.*rpc_stats.nCompleted) : 0.));
+    result.push_back(Pair("rpcqueue",rpc_queue_info));
+    
+    Object read_ahead_info;
+    if(pwalletTxsMain && pwalletTxsMain->m_ChunkDB)
+    {
+        mc_ChunkDBReadAheadStats read_ahead_stats;
+        pwalletTxsMain->m_ChunkDB->GetReadAheadStats(&read_ahead_stats);
+        read_ahead_info.push_back(Pair("blocks", read_ahead_stats.m_Blocks));
+        read_ahead_info.push_back(Pair("cached", read_ahead_stats.m_Cached));
+        read_ahead_info.push_back(Pair("hits", read_ahead_stats.m_Hits));
+        read_ahead_info.push_back(Pair("misses", read_ahead_stats.m_Misses));
+        read_ahead_info.push_back(Pair("prefetched", read_ahead_stats.m_Prefetched));
+        read_ahead_info.push_back(Pair("prefetchedbytes", read_ahead_stats.m_PrefetchedBytes));
+        read_ahead_info.push_back(Pair("invalidated", read_ahead_stats.m_Invalidated));
+    }
+    result.push_back(Pair("chunkreadahead",read_ahead_info));
+    
+    Object entity_cache_info;
+    if(mc_gState->m_Assets->m_DetailsCache)
+    {
+        entity_cache_info.push_back(Pair("slots", MC_ENT_CACHE_SLOTS));
+        entity_cache_info.push_back(Pair("hits", (int64_t)mc_gState->m_Assets->m_DetailsCache->m_Hits));
+        entity_cache_info.push_back(Pair("misses", (int64_t)mc_gState->m_Assets->m_DetailsCache->m_Misses));
+        entity_cache_info.push_back(Pair("invalidations", (int64_t)mc_gState->m_Assets->m_DetailsCache->m_Invalidations));
+    }
+    result.push_back(Pair("entitycache",entity_cache_info));
+    
+    Object permission_filter_info;
+    if(mc_gState->m_Permissions->m_Filter)
+    {
+        mc_PermissionFilter *filter=mc_gState->m_Permissions->m_Filter;
+        int64_t lookups=filter->m_Lookups;
+        int64_t skipped=filter->m_Skipped;
+        permission_filter_info.push_back(Pair("enabled", filter->m_Bits ? true : false));
+        permission_filter_info.push_back(Pair("capacity", (int64_t)filter->m_Capacity));
+        permission_filter_info.push_back(Pair("keys", (int64_t)filter->m_Keys));
+        permission_filter_info.push_back(Pair("stale", (int64_t)filter->m_Stale));
+        permission_filter_info.push_back(Pair("rebuilds", (int64_t)filter->m_Rebuilds));
+        permission_filter_info.push_back(Pair("lookups", lookups));
+        permission_filter_info.push_back(Pair("skipped", skipped));
+        permission_filter_info.push_back(Pair("falsepositives", (int64_t)filter->m_FalsePositives));
+        permission_filter_info.push_back(Pair("skipratio", (lookups > 0) ? (double)skipped/lookups : 0.));
+    }
+    result.push_back(Pair("permissionfilter",permission_filter_info));
+    
+    Object key_cache_info;
+    if(pwalletMain && pwalletMain->IsCrypted())
+    {
+        int key_cache_size;
+        int64_t key_cache_hits,key_cache_misses;
+        pwalletMain->GetDecryptedKeyCacheStats(key_cache_size,key_cache_hits,key_cache_misses);
+        key_cache_info.push_back(Pair("maxsize", nWalletKeyCacheSize));
+        key_cache_info.push_back(Pair("size", key_cache_size));
+        key_cache_info.push_back(Pair("hits", key_cache_hits));
+        key_cache_info.push_back(Pair("misses", key_cache_misses));
+    }
+    result.push_back(Pair("walletkeycache",key_cache_info));
+    
+    Object block_filter_info;
+    block_filter_info.push_back(Pair("enabled", fBlockFilterIndex));
+    if(fBlockFilterIndex)
+    {
+        block_filter_info.push_back(Pair("built", blockFilterStats.nBuilt));
+        block_filter_info.push_back(Pair("elements", blockFilterStats.nElements));
+        block_filter_info.push_back(Pair("bytes", blockFilterStats.nBytes));
+        block_filter_info.push_back(Pair("avgbuildms", (blockFilterStats.nBuilt > 0) ? 
+                (double)blockFilterStats.nBuildMicros/(1000.*blockFilterStats.nBuilt) : 0.));
+        block_filter_info.push_back(Pair("servedfilters", blockFilterStats.nServedFilters));
+        block_filter_info.push_back(Pair("servedheaders", blockFilterStats.nServedHeaders));
+    }
+    result.push_back(Pair("blockfilters",block_filter_info));
+    
+    Object memory_info;
+    int64_t memory_total=0;
+    SampleMemoryUsage();
+    for(int tag=MC_MEM_TAG_NONE+1;tag<MC_MEM_TAG_COUNT;tag++)
+    {
+        Object tag_info;
+        tag_info.push_back(Pair("live", mc_MemLive(tag)));
+        tag_info.push_back(Pair("peak", mc_MemPeak(tag)));
+        memory_info.push_back(Pair(mc_MemTagName(tag), tag_info));
+        memory_total+=mc_MemLive(tag);
+    }
+    memory_info.push_back(Pair("total", memory_total));
+    result.push_back(Pair("memory",memory_info));
+    
+    Object admission_class_info;
+    int reserve_percents[MC_TAC_COUNT];
+    GetAdmissionClassReserves(reserve_percents);
+    {
+        LOCK(mempool.cs);
+        for(int c=0;c<MC_TAC_COUNT;c++)
+        {
+            const CTxAdmissionClassStats& stats=mempool.admissionClassStats[c];
+            Object class_info;
+            class_info.push_back(Pair("reserve", reserve_percents[c]));
+            class_info.push_back(Pair("mempooltxs", stats.nCount));
+            class_info.push_back(Pair("mempoolbytes", stats.nBytes));
+            class_info.push_back(Pair("accepted", stats.nAccepted));
+            class_info.push_back(Pair("confirmed", stats.nConfirmed));
+            class_info.push_back(Pair("avgconfirmseconds", (stats.nConfirmed > 0) ? 
+                    (double)stats.nConfirmSeconds/stats.nConfirmed : 0.));
+            class_info.push_back(Pair("maxconfirmseconds", stats.nMaxConfirmSeconds));
+            class_info.push_back(Pair("avgacceptms", (stats.nAccepted > 0) ? 
+                    0.001*stats.nAcceptMicros/stats.nAccepted : 0.));
+            class_info.push_back(Pair("maxacceptms", 0.001*stats.nMaxAcceptMicros));
+            class_info.push_back(Pair("deferred", stats.nDeferred));
+            class_info.push_back(Pair("lastblockbytes", stats.nLastBlockBytes));
+            admission_class_info.push_back(Pair(TxAdmissionClassName(c), class_info));
+        }
+    }
+    result.push_back(Pair("admissionclasses",admission_class_info));
 //    obj.push_back(Pair("", mc_gState->m_NetworkParams->GetInt64Param("")));    
     
     Array chaintips_params;
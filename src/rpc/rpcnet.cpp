@@ -129,6 +129,20 @@ Value getpeerinfo(const Array& params, bool fHelp)
 /* MCHN END */        
         obj.push_back(Pair("inbound", stats.fInbound));
         obj.push_back(Pair("encrypted", stats.fEncrypted));
+/* MCHN START */        
+        {
+            Object compression;
+            compression.push_back(Pair("send", stats.fCompressionSend));
+            compression.push_back(Pair("recv", stats.fCompressionRecv));
+            compression.push_back(Pair("bytessentraw", stats.nCompressionSendRaw));
+            compression.push_back(Pair("bytessent", stats.nCompressionSendBytes));
+            compression.push_back(Pair("sendratio", stats.nCompressionSendBytes ? (double)stats.nCompressionSendRaw/(double)stats.nCompressionSendBytes : 1.0));
+            compression.push_back(Pair("bytesrecvraw", stats.nCompressionRecvRaw));
+            compression.push_back(Pair("bytesrecv", stats.nCompressionRecvBytes));
+            compression.push_back(Pair("recvratio", stats.nCompressionRecvBytes ? (double)stats.nCompressionRecvRaw/(double)stats.nCompressionRecvBytes : 1.0));
+            obj.push_back(Pair("compression", compression));
+        }
+/* MCHN END */        
         obj.push_back(Pair("startingheight", stats.nStartingHeight));
         if (fStateStats) {
             obj.push_back(Pair("banscore", statestats.nMisbehavior));
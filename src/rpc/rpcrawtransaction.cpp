@@ -1322,9 +1322,7 @@ void AddCacheInputScriptIfNeeded(CMutableTransaction& rawTx,Array inputs, bool f
             view.SetBackend(viewMempool); // temporarily switch cache backend to db+mempool view
 
             BOOST_FOREACH(const CTxIn& txin, rawTx.vin) {
-                const uint256& prevHash = txin.prevout.hash;
-                CCoins coins;
-                view.AccessCoins(prevHash); // this is certainly allowed to fail
+                view.AccessCoin(txin.prevout); // this is certainly allowed to fail
             }
 
             view.SetBackend(viewDummy); // switch back to avoid locking mempool for too long
@@ -1337,10 +1335,10 @@ void AddCacheInputScriptIfNeeded(CMutableTransaction& rawTx,Array inputs, bool f
                 uint256 txid = ParseHashO(o, "txid");
                 int vout_v = find_value(o, "vout").get_int();
                 
-                CCoinsModifier coins = view.ModifyCoins(txid);
-                if (coins->IsAvailable(vout_v)) 
+                const Coin& coin = view.AccessCoin(COutPoint(txid, vout_v));
+                if (!coin.IsSpent()) 
                 {
-                    script_for_cache[i]=coins->vout[vout_v].scriptPubKey;
+                    script_for_cache[i]=coin.out.scriptPubKey;
                 }
                 else
                 {
@@ -2104,9 +2102,7 @@ Value signrawtransaction(const Array& params, bool fHelp)
         view.SetBackend(viewMempool); // temporarily switch cache backend to db+mempool view
 
         BOOST_FOREACH(const CTxIn& txin, mergedTx.vin) {
-            const uint256& prevHash = txin.prevout.hash;
-            CCoins coins;
-            view.AccessCoins(prevHash); // this is certainly allowed to fail
+            view.AccessCoin(txin.prevout); // this is certainly allowed to fail
         }
 
         view.SetBackend(viewDummy); // switch back to avoid locking mempool for too long
@@ -2154,17 +2150,16 @@ Value signrawtransaction(const Array& params, bool fHelp)
             CScript scriptPubKey(pkData.begin(), pkData.end());
 
             {
-                CCoinsModifier coins = view.ModifyCoins(txid);
-                if (coins->IsAvailable(nOut) && coins->vout[nOut].scriptPubKey != scriptPubKey) {
+                COutPoint out(txid, nOut);
+                const Coin& coin = view.AccessCoin(out);
+                if (!coin.IsSpent() && coin.out.scriptPubKey != scriptPubKey) {
                     string err("Previous output scriptPubKey mismatch:\n");
-                    err = err + coins->vout[nOut].scriptPubKey.ToString() + "\nvs:\n"+
+                    err = err + coin.out.scriptPubKey.ToString() + "\nvs:\n"+
                         scriptPubKey.ToString();
                     throw JSONRPCError(RPC_OUTPUT_NOT_FOUND, err);
                 }
-                if ((unsigned int)nOut >= coins->vout.size())
-                    coins->vout.resize(nOut+1);
-                coins->vout[nOut].scriptPubKey = scriptPubKey;
-                coins->vout[nOut].nValue = 0; // we don't know the actual output value
+                // we don't know the actual output value
+                view.AddCoin(out, Coin(CTxOut(0, scriptPubKey), 1, false, 0), true);
             }
 
             // if redeemScript given and not using the local wallet (private keys
@@ -2208,19 +2203,34 @@ Value signrawtransaction(const Array& params, bool fHelp)
     bool fHashSingle = ((nHashType & ~SIGHASH_ANYONECANPAY) == SIGHASH_SINGLE);
 
     // Sign what we can:
+/* MCHN START */
+    vector<CScript> vFromPubKeys;
+    vector<unsigned int> vSignIn;
     for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
         CTxIn& txin = mergedTx.vin[i];
-        const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-        if (coins == NULL || !coins->IsAvailable(txin.prevout.n)) {
-            fComplete = false;
+        const Coin& coin = view.AccessCoin(txin.prevout);
+        if (coin.IsSpent()) {
             continue;
         }
-        const CScript& prevPubKey = coins->vout[txin.prevout.n].scriptPubKey;
-
         txin.scriptSig.clear();
         // Only sign SIGHASH_SINGLE if there's a corresponding output:
         if (!fHashSingle || (i < mergedTx.vout.size()))
-            SignSignature(keystore, prevPubKey, mergedTx, i, nHashType);
+        {
+            vFromPubKeys.push_back(coin.out.scriptPubKey);
+            vSignIn.push_back(i);
+        }
+    }
+    SignSignatures(keystore, vFromPubKeys, mergedTx, vSignIn, nHashType);        // Other input scripts are blanked in signature hashes
+/* MCHN END */
+
+    for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
+        CTxIn& txin = mergedTx.vin[i];
+        const Coin& coin = view.AccessCoin(txin.prevout);
+        if (coin.IsSpent()) {
+            fComplete = false;
+            continue;
+        }
+        const CScript& prevPubKey = coin.out.scriptPubKey;
 
         // ... and merge in other signatures:
         BOOST_FOREACH(const CMutableTransaction& txv, txVariants) {
@@ -2237,11 +2247,140 @@ Value signrawtransaction(const Array& params, bool fHelp)
     return result;
 }
 
+static void BeginRawTransactionAccept()
+{
+    if(pMultiChainFilterEngine)
+    {
+        pMultiChainFilterEngine->SetTimeout(pMultiChainFilterEngine->GetSendTimeout());
+    }
+}
+
+static void EndRawTransactionAccept()
+{
+    pwalletTxsMain->WRPWriteLock();        
+    pwalletTxsMain->WRPSync(0);
+    pwalletTxsMain->WRPWriteUnLock();
+    if(pMultiChainFilterEngine)
+    {
+        pMultiChainFilterEngine->SetTimeout(pMultiChainFilterEngine->GetAcceptTimeout());
+    }
+}
+
+Value sendrawtransactions(const Array& tx_hexes,bool fOverrideFees)
+{
+    vector<CTransaction> vtx;
+    vector<CTransaction> vtxAccept;
+    vector<int> vAcceptIndex;
+    vector<bool> vHaveChain;
+    vector<CValidationState> vstate;
+    vector<bool> vAccepted;
+    vector<CTransaction> vRelay;
+    Array results;
+    
+    BOOST_FOREACH(const Value& tx_hex, tx_hexes)
+    {
+        CTransaction tx;
+        if( (tx_hex.type() != str_type) || !DecodeHexTx(tx, tx_hex.get_str()) )
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "TX decode failed");
+        
+        mc_MultiChainFilter* lpFilter;
+        int applied=0;
+        string filter_error="";
+
+        if(VerifyNewTxForStreamFilters(tx,filter_error,&lpFilter,&applied) == MC_ERR_NOT_ALLOWED)
+        {
+            throw JSONRPCError(RPC_NOT_ALLOWED, "Transaction " + tx.GetHash().GetHex() + " didn't pass stream filter " + lpFilter->m_FilterCaption + ": " + filter_error);                            
+        }
+        vtx.push_back(tx);
+    }
+    
+    CCoinsViewCache &view = *pcoinsTip;
+    vAcceptIndex.assign(vtx.size(),-1);
+    vHaveChain.assign(vtx.size(),false);
+    for(unsigned int t=0;t<vtx.size();t++)                                      // Same pre-checks as for single transaction
+    {
+        uint256 hashTx=vtx[t].GetHash();
+        for (unsigned int o = 0; !vHaveChain[t] && o < vtx[t].vout.size(); o++) {
+            vHaveChain[t] = !view.AccessCoin(COutPoint(hashTx, o)).IsSpent();
+        }
+        if(!vHaveChain[t] && !mempool.exists(hashTx))
+        {
+            vAcceptIndex[t]=vtxAccept.size();
+            vtxAccept.push_back(vtx[t]);
+        }
+    }
+    
+    if(mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS)
+    {
+        if(pwalletTxsMain->m_ChunkDB->FlushSourceChunks(GetArg("-flushsourcechunks",true) ? (MC_CDB_FLUSH_MODE_FILE | MC_CDB_FLUSH_MODE_DATASYNC) : MC_CDB_FLUSH_MODE_NONE))
+        {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't store offchain items, probably chunk database is corrupted");                                        
+        }
+    }
+    
+    if(vtxAccept.size())
+    {
+        BeginRawTransactionAccept();
+        AcceptToMemoryPoolMany(mempool, vstate, vtxAccept, false, vAccepted, !fOverrideFees);
+        EndRawTransactionAccept();
+    }
+    
+    for(unsigned int t=0;t<vtx.size();t++)
+    {
+        int a=vAcceptIndex[t];
+        Object entry;
+        entry.push_back(Pair("txid", vtx[t].GetHash().GetHex()));
+        if(vHaveChain[t])
+        {
+            entry.push_back(Pair("error", "transaction already in block chain"));
+        }
+        else if( ((a >= 0) && vAccepted[a]) || mempool.exists(vtx[t].GetHash()) )  // Already in mempool is relayed as in single transaction case
+        {
+            if(pwalletMain)
+            {
+                for (unsigned int i = 0; i < vtx[t].vin.size(); i++) 
+                {
+                    COutPoint outp=vtx[t].vin[i].prevout;
+                    pwalletMain->UnlockCoin(outp);
+                }
+            }
+            vRelay.push_back(vtx[t]);
+            entry.push_back(Pair("error", Value::null));
+        }
+        else if(a < 0)                                                          // Was in mempool during pre-check, evicted since
+        {
+            entry.push_back(Pair("error", "transaction already in mempool, evicted since"));
+        }
+        else
+        {
+            if(vstate[a].IsInvalid())
+                entry.push_back(Pair("error", strprintf("%i: %s", vstate[a].GetRejectCode(), vstate[a].GetRejectReason())));
+            else
+                entry.push_back(Pair("error", vstate[a].GetRejectReason().size() ? vstate[a].GetRejectReason() : "transaction already in block chain"));
+        }
+        results.push_back(entry);
+    }
+    
+    if(vRelay.size())
+    {
+        RelayTransactions(vRelay);
+    }
+    
+    return results;
+}
+
 Value sendrawtransaction(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error("Help message not found\n");
 
+    if(params[0].type() == array_type)
+    {
+        if( (params.size() > 1) && (params[1].type() != bool_type) )
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid allowhighfees");
+        return sendrawtransactions(params[0].get_array(),(params.size() > 1) ? params[1].get_bool() : false);
+    }
+    
     RPCTypeCheck(params, list_of(str_type)(bool_type));
 
     // parse hex string from parameter
@@ -2264,9 +2403,12 @@ Value sendrawtransaction(const Array& params, bool fHelp)
         fOverrideFees = params[1].get_bool();
 
     CCoinsViewCache &view = *pcoinsTip;
-    const CCoins* existingCoins = view.AccessCoins(hashTx);
     bool fHaveMempool = mempool.exists(hashTx);
-    bool fHaveChain = existingCoins && existingCoins->nHeight < 1000000000;
+    bool fHaveChain = false;
+    for (unsigned int o = 0; !fHaveChain && o < tx.vout.size(); o++) {
+        const Coin& existingCoin = view.AccessCoin(COutPoint(hashTx, o));
+        fHaveChain = !existingCoin.IsSpent();
+    }
     bool fMissingInputs;
     
     if(mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS)
@@ -2280,18 +2422,9 @@ Value sendrawtransaction(const Array& params, bool fHelp)
     if (!fHaveMempool && !fHaveChain) {
         // push to local node and sync with wallets
         CValidationState state;
-        if(pMultiChainFilterEngine)
-        {
-            pMultiChainFilterEngine->SetTimeout(pMultiChainFilterEngine->GetSendTimeout());
-        }
+        BeginRawTransactionAccept();
         bool accepted=AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs, !fOverrideFees);
-        pwalletTxsMain->WRPWriteLock();        
-        pwalletTxsMain->WRPSync(0);
-        pwalletTxsMain->WRPWriteUnLock();
-        if(pMultiChainFilterEngine)
-        {
-            pMultiChainFilterEngine->SetTimeout(pMultiChainFilterEngine->GetAcceptTimeout());
-        }
+        EndRawTransactionAccept();
         if (!accepted) {
             if(state.IsInvalid())
                 throw JSONRPCError(RPC_TRANSACTION_REJECTED, strprintf("%i: %s", state.GetRejectCode(), state.GetRejectReason()));
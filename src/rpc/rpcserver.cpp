@@ -18,6 +18,7 @@
 #include "community/community.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/assign/list_of.hpp>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/bind.hpp>
@@ -28,6 +29,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include "json/json_spirit_writer_template.h"
+#include "json/json_spirit_ubjson.h"
 
 using namespace boost;
 using namespace boost::asio;
@@ -55,6 +57,11 @@ static std::vector< boost::shared_ptr<ip::tcp::acceptor> > rpc_acceptors;
 static map<uint64_t, RPCThreadLoad> rpc_loads;
 static map<uint64_t, int> rpc_slots;
 static uint32_t rpc_thread_flags[MC_PRM_MAX_THREADS];
+static FILE *rpc_capture_file = NULL;
+static int64_t rpc_capture_start = 0;
+static int rpc_capture_redact = DEFAULT_RPC_CAPTURE_REDACT;
+static set<string> setRPCCaptureSecretMethods;
+static CCriticalSection cs_rpcCapture;
 
 #define MC_ACF_NONE              0x00000000 
 #define MC_ACF_ENTERPRISE        0x00000001 
@@ -711,7 +718,12 @@ private:
     uint32_t _flags;
 };
 
-void ServiceConnection(AcceptedConnection *conn);
+/* MCHN START */
+struct CRPCIdleDeadline;
+void ServiceConnection(AcceptedConnection *conn,boost::shared_ptr<CRPCIdleDeadline> deadline = boost::shared_ptr<CRPCIdleDeadline>());
+static bool RPCQueueConnection(boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn);
+static void RPCWaitNewConnection(boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn);
+/* MCHN END */
 
 //! Forward declaration required for RPCListen
 template <typename Protocol, typename SocketAcceptorService>
@@ -775,12 +787,371 @@ static void RPCAcceptHandler(boost::shared_ptr< basic_socket_acceptor<Protocol,
             conn->stream() << HTTPError(HTTP_FORBIDDEN, false) << std::flush;
         conn->close();
     }
+/* MCHN START */
+    else if (tcp_conn && ((tcp_conn->get_flags() & MC_ACF_ENTERPRISE) == 0)) {
+        boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > rpc_conn=boost::dynamic_pointer_cast< AcceptedConnectionImpl<ip::tcp> >(conn);
+        if (fUseSSL)
+        {
+            // SSL layer buffers decrypted data, socket readiness cannot be used, connection is served by worker thread
+            if (!RPCQueueConnection(rpc_conn))
+                conn->close();
+        }
+        else
+        {
+            RPCWaitNewConnection(rpc_conn);
+        }
+    }
+/* MCHN END */
     else {
         ServiceConnection(conn.get());
         conn->close();
     }
 }
 
+/* MCHN START */
+
+/** Keep-alive connection whose requests are read asynchronously by RPC I/O threads */
+struct CRPCAsyncConnection
+{
+    boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn;
+    asio::io_service::strand strand;                                            // Read and timeout handlers never run concurrently
+    deadline_timer timer;                                                       // Deadline for receiving complete request
+    std::string strBuffer;                                                      // Received bytes not consumed by previous requests
+    char chBuffer[4096];
+    bool fReading;                                                              // Read or error reply is pending, request is not passed to worker
+
+    CRPCAsyncConnection(boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > connIn) : 
+            conn(connIn), strand(*rpc_io_service), timer(*rpc_io_service), fReading(false) {}
+};
+
+typedef boost::shared_ptr<CRPCAsyncConnection> CRPCAsyncConnectionPtr;
+
+static int nRPCServerTimeout = DEFAULT_RPC_SERVER_TIMEOUT;
+
+/** 
+ * Deadline for receiving request on SSL connection served by worker thread.
+ * Worker blocks in synchronous read, on expiry RPC I/O thread shuts the socket down and the read fails.
+ */
+struct CRPCIdleDeadline
+{
+    boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn;
+    deadline_timer timer;
+    boost::mutex mutex;
+    bool fArmed;                                                                // Worker waits for request, socket may be shut down
+    bool fExpired;
+
+    CRPCIdleDeadline(boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > connIn) : 
+            conn(connIn), timer(*rpc_io_service), fArmed(false), fExpired(false) {}
+};
+
+static void RPCIdleDeadlineExpired(boost::shared_ptr<CRPCIdleDeadline> deadline, const boost::system::error_code& error)
+{
+    if (error == asio::error::operation_aborted)
+        return;
+    
+    boost::unique_lock<boost::mutex> lock(deadline->mutex);
+    if (!deadline->fArmed)                                                      // Request was received, socket may be already closed
+        return;
+    if (deadline->timer.expires_at() > deadline_timer::traits_type::now())      // Timer was rearmed for the next request
+        return;
+    
+    if(fDebug)LogPrint("mcapi","mcapi: API connection from %s timed out\n",deadline->conn->peer_address_to_string().c_str());
+    deadline->fExpired=true;
+    boost::system::error_code ec;
+    deadline->conn->sslStream.lowest_layer().shutdown(ip::tcp::socket::shutdown_both,ec);
+}
+
+static void RPCArmIdleDeadline(boost::shared_ptr<CRPCIdleDeadline> deadline)
+{
+    boost::unique_lock<boost::mutex> lock(deadline->mutex);
+    deadline->fArmed=true;
+    deadline->timer.expires_from_now(posix_time::seconds(nRPCServerTimeout));
+    deadline->timer.async_wait(boost::bind(&RPCIdleDeadlineExpired, deadline, asio::placeholders::error));
+}
+
+/** Returns false if deadline expired and connection should be dropped */
+static bool RPCDisarmIdleDeadline(boost::shared_ptr<CRPCIdleDeadline> deadline)
+{
+    boost::unique_lock<boost::mutex> lock(deadline->mutex);
+    boost::system::error_code ec;
+    deadline->fArmed=false;
+    deadline->timer.cancel(ec);
+    return !deadline->fExpired;
+}
+
+/** HTTP request read by RPC I/O thread, waiting for RPC worker thread */
+struct CRPCWorkItem
+{
+    boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn;
+    CRPCAsyncConnectionPtr aconn;                                               // NULL if connection is served by worker
+    std::string strClient;
+    std::string strURI;
+    std::map<std::string, std::string> mapHeaders;
+    std::string strRequest;
+    bool fRun;
+    bool fServiceConnection;                                                    // Whole connection is served by worker, request is not read yet
+    int64_t nQueued;
+
+    CRPCWorkItem() : fRun(false), fServiceConnection(false), nQueued(0) {}
+};
+
+/**
+ * Bounded queue between RPC I/O threads and RPC worker threads.
+ * Requests are taken round-robin by client address, one client with many connections
+ * delays requests of other clients by at most one request per worker.
+ */
+class CRPCWorkQueue
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::map<std::string, std::deque<CRPCWorkItem> > mapClientItems;
+    std::deque<std::string> vClientOrder;
+    bool fStopping;
+    bool fOpen;                                                                 // Workers are registered in rpc_loads/rpc_slots
+    CRPCWorkQueueStats stats;
+
+public:
+    CRPCWorkQueue() : fStopping(false), fOpen(false)
+    {
+        memset(&stats,0,sizeof(CRPCWorkQueueStats));
+    }
+
+    void Start(int nIOThreads,int nWorkers,int nMaxSize)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStopping=false;
+        fOpen=false;
+        memset(&stats,0,sizeof(CRPCWorkQueueStats));
+        stats.nIOThreads=nIOThreads;
+        stats.nWorkers=nWorkers;
+        stats.nMaxSize=(nMaxSize > 0) ? nMaxSize : 1;
+    }
+
+    void Open()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fOpen=true;
+        cond.notify_all();
+    }
+
+    void Stop()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStopping=true;
+        mapClientItems.clear();
+        vClientOrder.clear();
+        stats.nDepth=0;
+        cond.notify_all();
+    }
+
+    bool Push(const CRPCWorkItem& item)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if(fStopping || (stats.nDepth >= stats.nMaxSize))
+        {
+            stats.nRejected++;
+            return false;
+        }
+        std::deque<CRPCWorkItem>& items=mapClientItems[item.strClient];
+        if(items.empty())
+        {
+            vClientOrder.push_back(item.strClient);
+        }
+        items.push_back(item);
+        stats.nDepth++;
+        stats.nQueued++;
+        if(stats.nDepth > stats.nMaxDepth)
+        {
+            stats.nMaxDepth=stats.nDepth;
+        }
+        cond.notify_one();
+        return true;
+    }
+
+    bool Pop(CRPCWorkItem& item)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while(!fStopping && (!fOpen || vClientOrder.empty()))
+        {
+            cond.wait(lock);
+        }
+        if(fStopping)
+        {
+            return false;
+        }
+        std::string strClient=vClientOrder.front();
+        vClientOrder.pop_front();
+        std::map<std::string, std::deque<CRPCWorkItem> >::iterator it=mapClientItems.find(strClient);
+        item=it->second.front();
+        it->second.pop_front();
+        if(it->second.empty())
+        {
+            mapClientItems.erase(it);
+        }
+        else
+        {
+            vClientOrder.push_back(strClient);
+        }
+        stats.nDepth--;
+        return true;
+    }
+
+    void Done(int64_t nWaitMicros,int64_t nExecMicros)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nCompleted++;
+        stats.nWaitMicros+=nWaitMicros;
+        stats.nExecMicros+=nExecMicros;
+    }
+
+    CRPCWorkQueueStats GetStats()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        CRPCWorkQueueStats result=stats;
+        result.nClients=(int)mapClientItems.size();
+        return result;
+    }
+};
+
+static CRPCWorkQueue rpcWorkQueue;
+
+CRPCWorkQueueStats GetRPCWorkQueueStats()
+{
+    return rpcWorkQueue.GetStats();
+}
+
+static void RPCWorkerThread();
+
+static Value RPCCaptureRedactValue(const Value& value)
+{
+    switch(value.type())
+    {
+        case str_type:
+            if( (value.get_str().size() > 64) && IsHex(value.get_str()) )          // Data payloads and raw transactions, hashes are kept
+            {
+                return string(value.get_str().size(),'0');
+            }
+            break;
+        case array_type:
+            {
+                Array arr;
+                BOOST_FOREACH(const Value& v, value.get_array())
+                {
+                    arr.push_back(RPCCaptureRedactValue(v));
+                }
+                return arr;
+            }
+        case obj_type:
+            {
+                Object obj;
+                BOOST_FOREACH(const Pair& p, value.get_obj())
+                {
+                    if( (p.name_ == "text") && (p.value_.type() == str_type) )
+                    {
+                        obj.push_back(Pair(p.name_,string(p.value_.get_str().size(),'x')));
+                    }
+                    else
+                    {
+                        obj.push_back(Pair(p.name_,RPCCaptureRedactValue(p.value_)));
+                    }
+                }
+                return obj;
+            }
+        default:
+            break;
+    }
+    return value;
+}
+
+static void StartRPCCapture(const string& strFile,int redact)
+{
+    filesystem::path pathCapture(strFile);
+    if (!pathCapture.is_complete()) pathCapture = filesystem::path(GetDataDir()) / pathCapture;
+
+    LOCK(cs_rpcCapture);
+    if(rpc_capture_file)
+    {
+        return;
+    }
+    
+    setRPCCaptureSecretMethods=boost::assign::list_of
+        ("dumpprivkey")("importprivkey")("dumpwallet")("importwallet")("backupwallet")
+        ("encryptwallet")("walletpassphrase")("walletpassphrasechange")
+        ("signmessage")("signrawtransaction").convert_to_container<set<string> >();
+    
+    rpc_capture_file=fopen(pathCapture.string().c_str(),"a");
+    if(rpc_capture_file == NULL)
+    {
+        LogPrintf("WARNING: Cannot open RPC capture file %s, capture is disabled\n",pathCapture.string().c_str());
+        return;
+    }
+    rpc_capture_redact=redact;
+    rpc_capture_start=GetTimeMicros();
+    
+    Object header;                                                              // Header line, replay skips lines without method
+    header.push_back(Pair("chain",string(mc_gState->m_NetworkParams->Name())));
+    header.push_back(Pair("version",mc_gState->GetNumericVersion()));
+    header.push_back(Pair("started",GetTime()));
+    header.push_back(Pair("redact",rpc_capture_redact));
+    fprintf(rpc_capture_file,"%s\n",write_string(Value(header),false).c_str());
+    
+    LogPrintf("RPC capture started: %s, redaction level %d\n",pathCapture.string().c_str(),rpc_capture_redact);
+}
+
+static void StopRPCCapture()
+{
+    LOCK(cs_rpcCapture);
+    if(rpc_capture_file)
+    {
+        fclose(rpc_capture_file);
+        rpc_capture_file=NULL;
+    }
+}
+
+/**
+ * Writes one line per executed request: offset from capture start and execution time in microseconds, 
+ * method, parameters (redacted according to -rpccaptureredact) and error flag.
+ */
+static void RPCCaptureRequest(const string& strMethod, const Array& params, int64_t nStart, int64_t nEnd, bool fError)
+{
+    if(rpc_capture_file == NULL)
+    {
+        return;
+    }
+    
+    Object entry;
+    entry.push_back(Pair("time",nStart-rpc_capture_start));
+    entry.push_back(Pair("method",strMethod));
+    if( (rpc_capture_redact >= MC_RPC_CAPTURE_REDACT_SECRETS) && setRPCCaptureSecretMethods.count(strMethod) )
+    {
+        entry.push_back(Pair("params",Array()));
+        entry.push_back(Pair("redacted",true));
+    }
+    else
+    {
+        if(rpc_capture_redact >= MC_RPC_CAPTURE_REDACT_PAYLOADS)
+        {
+            entry.push_back(Pair("params",RPCCaptureRedactValue(params)));
+        }
+        else
+        {
+            entry.push_back(Pair("params",params));
+        }
+    }
+    entry.push_back(Pair("duration",nEnd-nStart));
+    entry.push_back(Pair("error",fError));
+    string strLine=write_string(Value(entry),false);
+    
+    LOCK(cs_rpcCapture);
+    if(rpc_capture_file)
+    {
+        fprintf(rpc_capture_file,"%s\n",strLine.c_str());
+    }
+}
+
+/* MCHN END */
+
 static ip::tcp::endpoint ParseEndpoint(const std::string &strEndpoint, int defaultPort)
 {
     std::string addr;
@@ -1030,13 +1401,43 @@ void StartRPCThreads(string& strError)
     rpc_loads.clear();
     rpc_slots.clear();
 
+/* MCHN START */
+    int nIOThreads=GetArg("-rpciothreads", DEFAULT_RPC_IO_THREADS);
+    if(nIOThreads < 1)
+    {
+        nIOThreads=1;
+    }
+    int nWorkers=GetArg("-rpcthreads", DEFAULT_RPC_THREADS);
+    if(nWorkers < 1)
+    {
+        nWorkers=1;
+    }
+    rpcWorkQueue.Start(nIOThreads,nWorkers,GetArg("-rpcworkqueue", DEFAULT_RPC_WORK_QUEUE));
+    nRPCServerTimeout=GetArg("-rpcservertimeout", DEFAULT_RPC_SERVER_TIMEOUT);
+    if(nRPCServerTimeout < 1)
+    {
+        nRPCServerTimeout=1;
+    }
+    
+    if(mapArgs.count("-rpccapture"))
+    {
+        StartRPCCapture(GetArg("-rpccapture",""),GetArg("-rpccaptureredact",DEFAULT_RPC_CAPTURE_REDACT));
+    }
+/* MCHN END */
+
 #ifdef MAC_OSX
     boost::thread::attributes attrs;
     attrs.set_stack_size(8*1024*1024);
     
-    for (int i = 0; i < GetArg("-rpcthreads", 4); i++)
+/* MCHN START */
+    for (int i = 0; i < nIOThreads; i++)
+    {
+        rpc_worker_group->add_thread(new thread(attrs,boost::bind(&asio::io_service::run, rpc_io_service)));
+    }
+    for (int i = 0; i < nWorkers; i++)
     {
-        boost::thread *lpThread=new thread(attrs,boost::bind(&asio::io_service::run, rpc_io_service));
+        boost::thread *lpThread=new thread(attrs,&RPCWorkerThread);
+/* MCHN END */
         uint64_t thread_id=(uint64_t)(lpThread->native_handle());
         rpc_worker_group->add_thread(lpThread);
         RPCThreadLoad load;
@@ -1050,9 +1451,15 @@ void StartRPCThreads(string& strError)
         hc_worker_group->add_thread(lpThread);
     }        
 #else    
-    for (int i = 0; i < GetArg("-rpcthreads", 4); i++)
+/* MCHN START */
+    for (int i = 0; i < nIOThreads; i++)
+    {
+        rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_io_service));
+    }
+    for (int i = 0; i < nWorkers; i++)
     {        
-        boost::thread *lpThread=rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_io_service));        
+        boost::thread *lpThread=rpc_worker_group->create_thread(&RPCWorkerThread);        
+/* MCHN END */
         uint64_t thread_id=(uint64_t)(lpThread->native_handle());
 #ifdef WIN32        
         thread_id=GetThreadId((HANDLE)thread_id);
@@ -1069,6 +1476,9 @@ void StartRPCThreads(string& strError)
 #endif
     memset(rpc_thread_flags,0,MC_PRM_MAX_THREADS*sizeof(uint32_t));
     mc_gState->InitRPCThreads(rpc_slots.size());
+/* MCHN START */
+    rpcWorkQueue.Open();                                                        // Workers don't take items before rpc_loads/rpc_slots are filled
+/* MCHN END */
     
     fRPCRunning = true;
     
@@ -1119,6 +1529,9 @@ void StopRPCThreads()
 
     rpc_io_service->stop();
     hc_io_service->stop();
+/* MCHN START */
+    rpcWorkQueue.Stop();
+/* MCHN END */
     cvBlockChange.notify_all();
     if (rpc_worker_group != NULL)
         rpc_worker_group->join_all();
@@ -1131,6 +1544,9 @@ void StopRPCThreads()
     delete hc_ssl_context; hc_ssl_context = NULL;
     delete rpc_io_service; rpc_io_service = NULL;
     delete hc_io_service; hc_io_service = NULL;
+/* MCHN START */
+    StopRPCCapture();
+/* MCHN END */
 }
 
 int IsRPCWRPReadLockFlagSet() 
@@ -1413,10 +1829,23 @@ static bool HTTPReq_JSONRPC(AcceptedConnection *conn,
                     jreq.parse(valRequest);
                 }
 
+/* MCHN START */
+                bool fRawJSON=RawJSONOutputAllowed(jreq.strMethod);
+                if(fRawJSON)
+                {
+                    BeginRawJSONOutput();
+                }
+/* MCHN END */
                 Value result = tableRPC.execute(jreq.strMethod, jreq.params,jreq.id);
 
                 // Send reply
                 strReply = JSONRPCReply(result, Value::null, jreq.id);
+/* MCHN START */
+                if(fRawJSON)
+                {
+                    EndRawJSONOutput(&strReply);
+                }
+/* MCHN END */
 
             // array of requests
             } else if (valRequest.type() == array_type)
@@ -1432,6 +1861,7 @@ static bool HTTPReq_JSONRPC(AcceptedConnection *conn,
     {
 /* MCHN START */    
         mc_gState->m_WalletMode=wallet_mode;
+        EndRawJSONOutput(NULL);
         string strReply = JSONRPCReply(Value::null, objError, jreq.id);
         CheckFlagsOnException(jreq.strMethod,jreq.id,strReply);
         
@@ -1446,6 +1876,7 @@ static bool HTTPReq_JSONRPC(AcceptedConnection *conn,
     {
 /* MCHN START */    
         mc_gState->m_WalletMode=wallet_mode;
+        EndRawJSONOutput(NULL);
         CheckFlagsOnException(jreq.strMethod,jreq.id,e.what());
         if(fDebug)LogPrint("mcapi","mcapi: API request failure D: %s\n",JSONRPCMethodIDForLog(jreq.strMethod,jreq.id).c_str());        
 /* MCHN END */    
@@ -1484,8 +1915,104 @@ void SetRPCWRPReadLockFlag(int lock)
     }    
 }
 
+struct RawJSONOutput
+{
+    string strMarker;                                                           // Random per-request prefix of placeholder strings
+    vector<string> vTexts;                                                      // Transcoded JSON texts, placeholder suffix is index in this vector
+};
+
+static boost::thread_specific_ptr<RawJSONOutput> ptrRawJSONOutput;
 
-void ServiceConnection(AcceptedConnection *conn)
+bool RawJSONOutputAllowed(const string& strMethod)
+{
+    static const set<string> setRawJSONMethods = boost::assign::list_of
+        ("liststreamitems")("liststreamkeyitems")("liststreampublisheritems")("liststreamblockitems")
+        ("liststreamtxitems")("liststreamqueryitems")("getstreamitem")("gettxoutdata");
+
+    if(LogAcceptCategory("walletcompare"))                                      // Results are compared as text, placeholders would differ
+    {
+        return false;
+    }
+
+    return setRawJSONMethods.count(strMethod) > 0;
+}
+
+void BeginRawJSONOutput()
+{
+    unsigned char rand_marker[8];
+
+    if(ptrRawJSONOutput.get() == NULL)
+    {
+        ptrRawJSONOutput.reset(new RawJSONOutput);
+    }
+    GetRandBytes(rand_marker, 8);
+    ptrRawJSONOutput->strMarker="mcjson-" + HexStr(rand_marker,rand_marker+8) + "-";
+    ptrRawJSONOutput->vTexts.clear();
+}
+
+bool RawJSONOutputValue(const unsigned char *elem,size_t elem_size,Value *value)
+{
+    RawJSONOutput *output=ptrRawJSONOutput.get();
+
+    if( (output == NULL) || (output->strMarker.size() == 0) )
+    {
+        return false;
+    }
+
+    output->vTexts.push_back(string());
+    if(ubjson_read_json_text(elem,elem_size,MAX_FORMATTED_DATA_DEPTH,output->vTexts.back()) != MC_ERR_NOERROR)
+    {
+        output->vTexts.pop_back();
+        *value=Value::null;
+        return true;
+    }
+
+    *value=output->strMarker + strprintf("%u",(unsigned int)(output->vTexts.size()-1));
+    return true;
+}
+
+void EndRawJSONOutput(string *strReply)
+{
+    RawJSONOutput *output=ptrRawJSONOutput.get();
+
+    if(output == NULL)
+    {
+        return;
+    }
+
+    if(strReply && output->vTexts.size())
+    {
+        string strQuotedMarker="\"" + output->strMarker;
+        string strResult;
+        size_t pos=0;
+        size_t found,end;
+        unsigned int index;
+
+        while( (found=strReply->find(strQuotedMarker,pos)) != string::npos )
+        {
+            end=strReply->find('"',found+strQuotedMarker.size());
+            if(end == string::npos)
+            {
+                break;
+            }
+            index=(unsigned int)atoi(strReply->substr(found+strQuotedMarker.size(),end-found-strQuotedMarker.size()).c_str());
+            if(index >= output->vTexts.size())
+            {
+                break;
+            }
+            strResult.append(*strReply,pos,found-pos);
+            strResult.append(output->vTexts[index]);
+            pos=end+1;
+        }
+        strResult.append(*strReply,pos,string::npos);
+        strReply->swap(strResult);
+    }
+
+    output->strMarker.clear();
+    output->vTexts.clear();
+}
+
+void ServiceConnection(AcceptedConnection *conn,boost::shared_ptr<CRPCIdleDeadline> deadline)
 {
     bool fRun = true;
     
@@ -1511,6 +2038,11 @@ void ServiceConnection(AcceptedConnection *conn)
         map<string, string> mapHeaders;
         string strRequest, strMethod, strURI;
 
+/* MCHN START */
+        if (deadline)                                                           // Idle or slow client releases worker thread after -rpcservertimeout
+            RPCArmIdleDeadline(deadline);
+/* MCHN END */
+
         // Read HTTP request line
         if (!ReadHTTPRequestLine(conn->stream(), nProto, strMethod, strURI))
             break;
@@ -1518,6 +2050,11 @@ void ServiceConnection(AcceptedConnection *conn)
         // Read HTTP message headers and body
         ReadHTTPMessage(conn->stream(), mapHeaders, strRequest, nProto, MAX_SIZE);
 
+/* MCHN START */
+        if (deadline && !RPCDisarmIdleDeadline(deadline))
+            break;
+/* MCHN END */
+
         // HTTP Keep-Alive is false; close connection immediately
         if ((mapHeaders["connection"] == "close") || (!GetBoolArg("-rpckeepalive", false)))
             fRun = false;
@@ -1538,6 +2075,11 @@ void ServiceConnection(AcceptedConnection *conn)
         }
     }
     
+/* MCHN START */
+    if (deadline)
+        RPCDisarmIdleDeadline(deadline);
+/* MCHN END */
+    
     if(load_it != rpc_loads.end())
     {
         load_it->second.end=GetTimeMicros();
@@ -1545,6 +2087,251 @@ void ServiceConnection(AcceptedConnection *conn)
     }
 }
 
+/* MCHN START */
+
+static bool RPCQueueConnection(boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn)
+{
+    CRPCWorkItem item;
+    item.conn=conn;
+    item.strClient=conn->peer_address_to_string();
+    item.fServiceConnection=true;
+    item.nQueued=GetTimeMicros();
+    return rpcWorkQueue.Push(item);
+}
+
+/**
+ * Checks whether strBuffer starts with complete HTTP request, sets *pnSize to its size.
+ * Returns 1 if request is complete, 0 if more data is needed, -1 if request is malformed or too large.
+ */
+static int RPCCheckBufferedRequest(const std::string& strBuffer, size_t *pnSize)
+{
+    size_t nHeaderEnd=strBuffer.find("\n\n");
+    size_t nCRLFEnd=strBuffer.find("\n\r\n");
+    size_t nHeaderSize;
+    
+    if( (nCRLFEnd != string::npos) && ( (nHeaderEnd == string::npos) || (nCRLFEnd < nHeaderEnd) ) )
+    {
+        nHeaderSize=nCRLFEnd+3;
+    }
+    else
+    {
+        if(nHeaderEnd == string::npos)
+        {
+            return (strBuffer.size() > MC_RPC_MAX_HEADERS_SIZE) ? -1 : 0;
+        }
+        nHeaderSize=nHeaderEnd+2;
+    }
+    
+    if(nHeaderSize > MC_RPC_MAX_HEADERS_SIZE)
+    {
+        return -1;
+    }
+    
+    std::istringstream ssHeaders(strBuffer.substr(0,nHeaderSize));
+    std::map<std::string, std::string> mapHeaders;
+    int nProto = 0;
+    string strMethod,strURI;
+    
+    if (!ReadHTTPRequestLine(ssHeaders, nProto, strMethod, strURI))
+    {
+        return -1;
+    }
+    int nLen=ReadHTTPHeaders(ssHeaders, mapHeaders);
+    if (nLen < 0 || (size_t)nLen > MAX_SIZE)
+    {
+        return -1;
+    }
+    
+    if(strBuffer.size() < nHeaderSize+nLen)
+    {
+        return 0;
+    }
+    
+    *pnSize=nHeaderSize+nLen;
+    return 1;
+}
+
+static void RPCCloseAsyncConnection(CRPCAsyncConnectionPtr aconn)
+{
+    boost::system::error_code ec;
+    aconn->timer.cancel(ec);
+    aconn->conn->sslStream.lowest_layer().close(ec);
+    aconn->conn->close();
+}
+
+/** Deadline of the request expired, slow or idle client is disconnected */
+static void RPCRequestTimeout(CRPCAsyncConnectionPtr aconn, const boost::system::error_code& error)
+{
+    if (error == asio::error::operation_aborted)
+        return;
+    if (!aconn->fReading)                                                       // Request is already with worker, socket is not ours to touch
+        return;
+    if (aconn->timer.expires_at() > deadline_timer::traits_type::now())         // Timer was rearmed for the next request
+        return;
+    
+    if(fDebug)LogPrint("mcapi","mcapi: API connection from %s timed out\n",aconn->conn->peer_address_to_string().c_str());
+    boost::system::error_code ec;
+    aconn->conn->sslStream.lowest_layer().cancel(ec);                           // Pending read or error reply completes with error and closes connection
+}
+
+static void RPCErrorWritten(CRPCAsyncConnectionPtr aconn, boost::shared_ptr<std::string> strReply, const boost::system::error_code& error)
+{
+    aconn->fReading=false;
+    RPCCloseAsyncConnection(aconn);
+}
+
+/** Error reply is written asynchronously, client not reading it doesn't block RPC I/O thread */
+static void RPCReplyErrorAndClose(CRPCAsyncConnectionPtr aconn, int nStatus)
+{
+    boost::shared_ptr<std::string> strReply(new std::string(HTTPError(nStatus, false)));
+    aconn->timer.expires_from_now(posix_time::seconds(nRPCServerTimeout));      // Socket is closed if reply is not taken in time
+    aconn->fReading=true;
+    aconn->timer.async_wait(aconn->strand.wrap(boost::bind(&RPCRequestTimeout, aconn, asio::placeholders::error)));
+    asio::async_write(aconn->conn->sslStream.next_layer(), asio::buffer(*strReply),
+            aconn->strand.wrap(boost::bind(&RPCErrorWritten, aconn, strReply, asio::placeholders::error)));
+}
+
+/**
+ * Called on RPC I/O thread (in connection strand) when data arrives on keep-alive connection.
+ * Request is accumulated without blocking, idle or slow clients never occupy I/O or worker threads.
+ */
+static void RPCReadRequest(CRPCAsyncConnectionPtr aconn, const boost::system::error_code& error, size_t nBytes)
+{
+    aconn->fReading=false;
+    if (error || !fRPCRunning || ShutdownRequested())
+    {
+        RPCCloseAsyncConnection(aconn);
+        return;
+    }
+    
+    aconn->strBuffer.append(aconn->chBuffer,nBytes);
+    
+    size_t nSize=0;
+    int ret=RPCCheckBufferedRequest(aconn->strBuffer,&nSize);
+    if(ret < 0)
+    {
+        RPCReplyErrorAndClose(aconn, HTTP_BAD_REQUEST);
+        return;
+    }
+    
+    if(ret == 0)
+    {
+        aconn->fReading=true;
+        aconn->conn->sslStream.next_layer().async_read_some(asio::buffer(aconn->chBuffer,sizeof(aconn->chBuffer)),
+                aconn->strand.wrap(boost::bind(&RPCReadRequest, aconn, asio::placeholders::error, asio::placeholders::bytes_transferred)));
+        return;
+    }
+    
+    boost::system::error_code ec;
+    aconn->timer.cancel(ec);
+    
+    CRPCWorkItem item;
+    int nProto = 0;
+    string strMethod;
+    std::istringstream ssRequest(aconn->strBuffer.substr(0,nSize));
+    aconn->strBuffer.erase(0,nSize);                                            // Pipelined requests stay in the buffer
+    
+    ReadHTTPRequestLine(ssRequest, nProto, strMethod, item.strURI);
+    ReadHTTPMessage(ssRequest, item.mapHeaders, item.strRequest, nProto, MAX_SIZE);
+
+    // HTTP Keep-Alive is false; close connection after reply
+    item.fRun=!((item.mapHeaders["connection"] == "close") || (!GetBoolArg("-rpckeepalive", false)));
+    item.conn=aconn->conn;
+    item.aconn=aconn;
+    item.strClient=aconn->conn->peer_address_to_string();
+    item.nQueued=GetTimeMicros();
+
+    if (!rpcWorkQueue.Push(item))
+    {
+        if(fDebug)LogPrint("mcapi","mcapi: API request from %s rejected, work queue is full\n",item.strClient.c_str());
+        RPCReplyErrorAndClose(aconn, HTTP_SERVICE_UNAVAILABLE);
+    }
+}
+
+static void RPCStartRead(CRPCAsyncConnectionPtr aconn)
+{
+    aconn->timer.expires_from_now(posix_time::seconds(nRPCServerTimeout));
+    aconn->timer.async_wait(aconn->strand.wrap(boost::bind(&RPCRequestTimeout, aconn, asio::placeholders::error)));
+    RPCReadRequest(aconn, boost::system::error_code(), 0);                      // Request may be already buffered
+}
+
+static void RPCWaitRequest(CRPCAsyncConnectionPtr aconn)
+{
+    aconn->strand.post(boost::bind(&RPCStartRead, aconn));
+}
+
+static void RPCWaitNewConnection(boost::shared_ptr< AcceptedConnectionImpl<ip::tcp> > conn)
+{
+    RPCWaitRequest(CRPCAsyncConnectionPtr(new CRPCAsyncConnection(conn)));
+}
+
+static void RPCServiceRequest(CRPCWorkItem& item)
+{
+    AcceptedConnection *conn=item.conn.get();
+    bool fKeep=false;
+
+    // Process via JSON-RPC API
+    if (item.strURI == "/") {
+        fKeep=HTTPReq_JSONRPC(conn, item.strRequest, item.mapHeaders, item.fRun);
+
+    // Process via HTTP REST API
+    } else if (item.strURI.substr(0, 6) == "/rest/" && GetBoolArg("-rest", false)) {
+        fKeep=HTTPReq_REST(conn, item.strURI, item.mapHeaders, item.fRun);
+
+    } else {
+        conn->stream() << HTTPError(HTTP_NOT_FOUND, false) << std::flush;
+    }
+
+    if (fKeep && item.fRun && fRPCRunning && !ShutdownRequested())
+    {
+        RPCWaitRequest(item.aconn);
+    }
+    else
+    {
+        RPCCloseAsyncConnection(item.aconn);
+    }
+}
+
+static void RPCWorkerThread()
+{
+    uint64_t thread_id=__US_ThreadID();
+
+    CRPCWorkItem item;
+    while (rpcWorkQueue.Pop(item))
+    {
+        int64_t nStart=GetTimeMicros();
+        map<uint64_t,RPCThreadLoad>::iterator load_it=rpc_loads.find(thread_id);
+
+        if(item.fServiceConnection)
+        {
+            ServiceConnection(item.conn.get(),boost::shared_ptr<CRPCIdleDeadline>(new CRPCIdleDeadline(item.conn)));
+            item.conn->close();
+        }
+        else
+        {
+            if(load_it != rpc_loads.end())
+            {
+                load_it->second.start=nStart;
+            }
+            RPCServiceRequest(item);
+            if(load_it != rpc_loads.end())
+            {
+                load_it->second.end=GetTimeMicros();
+                load_it->second.Update();
+            }
+        }
+
+        int64_t nEnd=GetTimeMicros();
+        rpcWorkQueue.Done(nStart-item.nQueued,nEnd-nStart);
+        if(fDebug)LogPrint("mcapi","mcapi: API request from %s: queue wait %.3f ms, execution %.3f ms\n",
+                item.strClient.c_str(),(double)(nStart-item.nQueued)/1000.,(double)(nEnd-nStart)/1000.);
+
+        item=CRPCWorkItem();
+    }
+}
+
+/* MCHN END */
+
 json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_spirit::Array &params, const Value& req_id) const
 {
     // Find method
@@ -1596,6 +2383,9 @@ json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_s
         !pcmd->okSafeMode)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, string("Safe mode: ") + strWarning);
 
+/* MCHN START */
+    int64_t nCaptureStart=GetTimeMicros();
+/* MCHN END */
     try
     {
         // Execute
@@ -1670,11 +2460,20 @@ json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_s
 /* MCHN START */        
         if(fDebug)LogPrint("mcapi","mcapi: API request successful: %s\n",JSONRPCMethodIDForLog(strMethod,req_id).c_str());
         if(fDebug)LogPrint("drsrv01","drsrv01: %d: <-- %s\n",GetRPCSlot(),strMethod.c_str());            
+        RPCCaptureRequest(strMethod,params,nCaptureStart,GetTimeMicros(),false);
 /* MCHN END */        
         return result;
     }
+/* MCHN START */
+    catch (Object& objError)                                                    // JSONRPCError thrown by method, passed to caller as is
+    {
+        RPCCaptureRequest(strMethod,params,nCaptureStart,GetTimeMicros(),true);
+        throw;
+    }
+/* MCHN END */
     catch (std::exception& e)
     {
+        RPCCaptureRequest(strMethod,params,nCaptureStart,GetTimeMicros(),true);
         CheckFlagsOnException(strMethod,req_id,e.what());
         if(fDebug)LogPrint("mcapi","mcapi: API request failure: %s\n",JSONRPCMethodIDForLog(strMethod,req_id).c_str());//strMethod.c_str());
         if(strcmp(e.what(),"Help message not found\n") == 0)
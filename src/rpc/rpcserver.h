@@ -66,6 +66,38 @@ public:
 };
         
         
+/* MCHN START */
+static const int DEFAULT_RPC_THREADS = 4;
+static const int DEFAULT_RPC_IO_THREADS = 2;
+static const int DEFAULT_RPC_WORK_QUEUE = 64;
+static const int DEFAULT_RPC_SERVER_TIMEOUT = 30;                               // Seconds to receive complete request on keep-alive connection
+static const size_t MC_RPC_MAX_HEADERS_SIZE = 65536;
+
+/** Redaction levels of -rpccapture file */
+static const int MC_RPC_CAPTURE_REDACT_NONE     = 0;                            // Parameters are written as received
+static const int MC_RPC_CAPTURE_REDACT_SECRETS  = 1;                            // Parameters of methods dealing with keys and passphrases are dropped
+static const int MC_RPC_CAPTURE_REDACT_PAYLOADS = 2;                            // Also hex strings are zero-filled, sizes are preserved
+static const int DEFAULT_RPC_CAPTURE_REDACT = MC_RPC_CAPTURE_REDACT_SECRETS;
+
+struct CRPCWorkQueueStats
+{
+    int nIOThreads;
+    int nWorkers;
+    int nMaxSize;
+    int nDepth;
+    int nMaxDepth;
+    int nClients;
+    int64_t nQueued;
+    int64_t nRejected;
+    int64_t nCompleted;
+    int64_t nWaitMicros;
+    int64_t nExecMicros;
+};
+
+/** Statistics of the queue between RPC I/O threads and RPC worker threads */
+CRPCWorkQueueStats GetRPCWorkQueueStats();
+/* MCHN END */
+
 /** Start RPC threads */
 void StartRPCThreads(std::string& strError);
 /**
@@ -116,6 +148,16 @@ void RPCRunLater(const std::string& name, boost::function<void(void)> func, int6
 
 int GetRPCSlot();
 
+/**
+ * Raw JSON output of formatted stream items. For output-only methods item UBJSON is transcoded directly
+ * into JSON text, result tree contains placeholder strings which are replaced in serialized reply.
+ */
+
+bool RawJSONOutputAllowed(const std::string& strMethod);
+void BeginRawJSONOutput();
+void EndRawJSONOutput(std::string *strReply);
+bool RawJSONOutputValue(const unsigned char *elem,size_t elem_size,json_spirit::Value *value);
+
 typedef json_spirit::Value(*rpcfn_type)(const json_spirit::Array& params, bool fHelp);
 
 class CRPCCommand
@@ -1603,6 +1603,239 @@ int WRPGetHashAndFirstOutput(mc_TxEntityRow *lpEntTx,uint256 *hash)
     return first_output;
 }
 
+void WRPGetListByCursor(string token,mc_TxEntity *entity,int generation,int count,mc_Buffer *entity_rows,string& next_token,int *errCode,string *strError)
+{
+    mc_TxEntityCursor cursor;
+    
+    if(token == "first")
+    {
+        token=pwalletTxsMain->WRPCursorToken(entity,generation,1,1);
+    }
+    else
+    {
+        if(token == "last")
+        {
+            token=pwalletTxsMain->WRPCursorToken(entity,generation,pwalletTxsMain->WRPGetListSize(entity,generation,NULL),-1);
+        }
+        else
+        {
+            if(!pwalletTxsMain->WRPCursorParseToken(token,&cursor))
+            {
+                *errCode=RPC_INVALID_PARAMETER;
+                *strError="Invalid start";
+                return;
+            }
+            if(memcmp(&cursor.m_Entity,entity,sizeof(mc_TxEntity)))
+            {
+                *errCode=RPC_INVALID_PARAMETER;
+                *strError="Continuation token was issued for another stream, key or publisher";
+                return;                
+            }
+            if(cursor.m_Generation != generation)
+            {
+                *errCode=RPC_INVALID_PARAMETER;
+                *strError="Continuation token expired, stream was resubscribed";
+                return;                
+            }
+        }
+    }
+    
+    WRPCheckWalletError(pwalletTxsMain->WRPCursorRead(token,count,entity_rows),entity->m_EntityType,"",errCode,strError);
+    next_token=token;
+}
+
+void WRPGetListByTimeWindow(Value time_window,mc_TxEntity *entity,int generation,int count,mc_Buffer *entity_rows,int *next_start,int *errCode,string *strError)
+{
+    int64_t starttime=-1; 
+    int64_t endtime=-1; 
+    int64_t start=0;
+    int chain_height,height_from,height_to,first_item,last_item;
+    int range_from,range_to,range_count,read_count,skip;
+    int collected=0;
+    mc_Buffer *range_rows=NULL;
+    
+    *next_start=-1;
+    
+    BOOST_FOREACH(const Pair& d, time_window.get_obj()) 
+    {              
+        if( (d.name_ == "starttime") || (d.name_ == "endtime") || (d.name_ == "start") )
+        {
+            if(d.value_.type() != int_type)
+            {
+                *errCode=RPC_INVALID_PARAMETER;
+                *strError="Invalid "+d.name_;
+                return;
+            }
+            int64_t value=d.value_.get_int64();
+            if( (value<0) || (value > 0xffffffff))
+            {
+                *errCode=RPC_INVALID_PARAMETER;
+                *strError="Invalid "+d.name_;
+                return;
+            }
+            if(d.name_ == "starttime")
+            {
+                starttime=value;
+            }
+            else
+            {
+                if(d.name_ == "endtime")
+                {
+                    endtime=value;
+                }
+                else
+                {
+                    if(value > INT_MAX)                                         // Used as item offset
+                    {
+                        *errCode=RPC_INVALID_PARAMETER;
+                        *strError="Invalid "+d.name_;
+                        return;
+                    }
+                    start=value;
+                }
+            }
+        }
+        else
+        {
+            *errCode=RPC_INVALID_PARAMETER;
+            *strError="Invalid time range";
+            return;
+        }
+    }
+    
+    if(starttime < 0)
+    {
+        starttime=0;
+    }
+    if(endtime < 0)
+    {
+        endtime=0xffffffff;
+    }
+    
+    chain_height=chainActive.Height();
+                                                                                // Same semantics as block set time range - block belongs to the window
+                                                                                // if its nTime is in it. Block timestamps are not monotonic, so the window
+                                                                                // may consist of several ranges of consecutive blocks, items are paged across them
+    if(!ParseBlockTimeRange(starttime,endtime,chain_height,&height_from,&height_to))
+    {
+        return;
+    }
+    
+    skip=(int)start;
+    range_from=height_from;
+    while(range_from <= height_to)
+    {
+        while( (range_from <= height_to) && 
+               ( (chainActive[range_from]->nTime < starttime) || (chainActive[range_from]->nTime > endtime) ) )
+        {
+            range_from++;
+        }
+        if(range_from > height_to)
+        {
+            break;
+        }
+        range_to=range_from;
+        while( (range_to < height_to) && 
+               (chainActive[range_to+1]->nTime >= starttime) && (chainActive[range_to+1]->nTime <= endtime) )
+        {
+            range_to++;
+        }
+        
+        last_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,generation,range_to);
+        first_item=1;
+        if(range_from > 0)
+        {
+            first_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,generation,range_from-1)+1;
+        }
+        range_from=range_to+1;
+        
+        range_count=last_item-first_item+1;
+        if(range_count <= skip)
+        {
+            skip-=max(range_count,0);
+            continue;
+        }
+        first_item+=skip;
+        range_count-=skip;
+        skip=0;
+        
+        if(collected >= count)                                                  // More items in the window, caller should return offset of the next page
+        {
+            *next_start=(int)start+count;
+            break;
+        }
+        
+        read_count=min(range_count,count-collected);
+        if(collected == 0)
+        {
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(entity,generation,first_item,read_count,entity_rows),entity->m_EntityType,"",errCode,strError);
+        }
+        else
+        {
+            if(range_rows == NULL)
+            {
+                range_rows=new mc_Buffer;
+                range_rows->Initialize(entity_rows->m_KeySize,entity_rows->m_RowSize,MC_BUF_MODE_DEFAULT);
+            }
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(entity,generation,first_item,read_count,range_rows),entity->m_EntityType,"",errCode,strError);
+            for(int i=0;i<range_rows->GetCount();i++)
+            {
+                entity_rows->Add(range_rows->GetRow(i));
+            }
+        }
+        if(strError->size())
+        {
+            break;
+        }
+        collected+=read_count;
+        
+        if(read_count < range_count)
+        {
+            *next_start=(int)start+count;
+            break;
+        }
+    }
+    
+    if(range_rows)
+    {
+        delete range_rows;
+    }
+}
+
+Value WRPTimeWindowResult(Array& items,int next_start)
+{
+    Object result;
+    
+    result.push_back(Pair("items",items));
+    if(next_start >= 0)
+    {
+        result.push_back(Pair("next",next_start));
+    }
+    else
+    {
+        result.push_back(Pair("next",Value::null));        
+    }
+    
+    return result;
+}
+
+Value WRPCursorResult(Array& items,const string& next_token)
+{
+    Object result;
+    
+    result.push_back(Pair("items",items));
+    if(next_token.size())
+    {
+        result.push_back(Pair("next",next_token));
+    }
+    else
+    {
+        result.push_back(Pair("next",Value::null));        
+    }
+    
+    return result;
+}
+
 Value liststreamitems(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 5)
@@ -1636,15 +1869,38 @@ Value liststreamitems(const Array& params, bool fHelp)
         count=paramtoint(params[2],true,0,"Invalid count");
     }
     start=-count;
+    bool fCursor=false;
+    bool fTimeWindow=false;
+    string cursor_token;
+    int next_start=-1;
     if (params.size() > 3)    
     {
-        start=paramtoint(params[3],false,0,"Invalid start");
+        if(params[3].type() == str_type)
+        {
+            fCursor=true;
+        }
+        else
+        {
+            if(params[3].type() == obj_type)
+            {
+                fTimeWindow=true;
+            }
+            else
+            {
+                start=paramtoint(params[3],false,0,"Invalid start");
+            }
+        }
     }
     
     bool fLocalOrdering = false;
     if (params.size() > 4)
         fLocalOrdering = params[4].get_bool();
     
+    if(fTimeWindow && fLocalOrdering)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Time window cannot be used with local-ordering");                                
+    }
+    
     
     bool fWRPLocked=false;
     int chain_height; 
@@ -1688,10 +1944,32 @@ Value liststreamitems(const Array& params, bool fHelp)
     entity_rows=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcEntityRows;
     entity_rows->Clear();
     
-    mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entStat.m_Entity,entStat.m_Generation,NULL));
-    
+    if(fCursor)
+    {
+        WRPGetListByCursor(params[3].get_str(),&entStat.m_Entity,entStat.m_Generation,count,entity_rows,cursor_token,&errCode,&strError);
+        if(strError.size())
+        {
+            goto exitlbl;
+        }
+    }
+    else
+    {
+        if(fTimeWindow)
+        {
+            WRPGetListByTimeWindow(params[3],&entStat.m_Entity,entStat.m_Generation,count,entity_rows,&next_start,&errCode,&strError);
+            if(strError.size())
+            {
+                goto exitlbl;
+            }
+        }
+        else
+        {
+            mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entStat.m_Entity,entStat.m_Generation,NULL));
+
 //    CheckWalletError(pwalletTxsMain->GetList(&entStat.m_Entity,start+1,count,entity_rows),entStat.m_Entity.m_EntityType,"");
-    WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entStat.m_Entity,entStat.m_Generation,start+1,count,entity_rows),entStat.m_Entity.m_EntityType,"",&errCode,&strError);
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entStat.m_Entity,entStat.m_Generation,start+1,count,entity_rows),entStat.m_Entity.m_EntityType,"",&errCode,&strError);
+        }
+    }
 
     chain_height=chainActive.Height();
     for(int i=0;i<entity_rows->GetCount();i++)
@@ -1721,6 +1999,16 @@ exitlbl:
         throw JSONRPCError(errCode, strError);            
     }
     
+    if(fCursor)
+    {
+        return WRPCursorResult(retArray,cursor_token);
+    }
+    
+    if(fTimeWindow)
+    {
+        return WRPTimeWindowResult(retArray,next_start);
+    }
+    
     return retArray;
 }
 
@@ -1728,10 +2016,10 @@ void WRPTxsForBlockRange(vector <uint256>& txids,mc_TxEntity *entity,int generat
 {
     int first_item,last_item,count,i;
     
-    last_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,height_to);
+    last_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,generation,height_to);
     if(last_item)
     {
-        first_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,height_from-1)+1;
+        first_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,generation,height_from-1)+1;
         count=last_item-first_item+1;
         if(count > 0)
         {
@@ -2469,15 +2757,38 @@ Value liststreamkeyitems(const Array& params, bool fHelp)
         count=paramtoint(params[3],true,0,"Invalid count");
     }
     start=-count;
+    bool fCursor=false;
+    bool fTimeWindow=false;
+    string cursor_token;
+    int next_start=-1;
     if (params.size() > 4)    
     {
-        start=paramtoint(params[4],false,0,"Invalid start");
+        if(params[4].type() == str_type)
+        {
+            fCursor=true;
+        }
+        else
+        {
+            if(params[4].type() == obj_type)
+            {
+                fTimeWindow=true;
+            }
+            else
+            {
+                start=paramtoint(params[4],false,0,"Invalid start");
+            }
+        }
     }
         
     bool fLocalOrdering = false;
     if (params.size() > 5)
         fLocalOrdering = params[5].get_bool();
     
+    if(fTimeWindow && fLocalOrdering)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Time window cannot be used with local-ordering");                                
+    }
+    
     bool entity_found=false;
     string key_string=params[1].get_str();
     vector <mc_QueryCondition> conditions;
@@ -2537,9 +2848,23 @@ Value liststreamkeyitems(const Array& params, bool fHelp)
     entity_rows=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcEntityRows;
     entity_rows->Clear();
         
-    mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entity,entStat.m_Generation,NULL));
-    
-    WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entity,entStat.m_Generation,start+1,count,entity_rows),entity.m_EntityType,"",&errCode,&strError);
+    if(fCursor)
+    {
+        WRPGetListByCursor(params[4].get_str(),&entity,entStat.m_Generation,count,entity_rows,cursor_token,&errCode,&strError);
+    }
+    else
+    {
+        if(fTimeWindow)
+        {
+            WRPGetListByTimeWindow(params[4],&entity,entStat.m_Generation,count,entity_rows,&next_start,&errCode,&strError);
+        }
+        else
+        {
+            mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entity,entStat.m_Generation,NULL));
+
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entity,entStat.m_Generation,start+1,count,entity_rows),entity.m_EntityType,"",&errCode,&strError);
+        }
+    }
     if(strError.size())
     {
         goto exitlbl;
@@ -2573,6 +2898,16 @@ exitlbl:
         throw JSONRPCError(errCode, strError);            
     }
     
+    if(fCursor)
+    {
+        return WRPCursorResult(retArray,cursor_token);
+    }
+    
+    if(fTimeWindow)
+    {
+        return WRPTimeWindowResult(retArray,next_start);
+    }
+    
     return retArray;
 }
 
@@ -2627,15 +2962,38 @@ Value liststreampublisheritems(const Array& params, bool fHelp)
         count=paramtoint(params[3],true,0,"Invalid count");
     }
     start=-count;
+    bool fCursor=false;
+    bool fTimeWindow=false;
+    string cursor_token;
+    int next_start=-1;
     if (params.size() > 4)    
     {
-        start=paramtoint(params[4],false,0,"Invalid start");
+        if(params[4].type() == str_type)
+        {
+            fCursor=true;
+        }
+        else
+        {
+            if(params[4].type() == obj_type)
+            {
+                fTimeWindow=true;
+            }
+            else
+            {
+                start=paramtoint(params[4],false,0,"Invalid start");
+            }
+        }
     }
 
     bool fLocalOrdering = false;
     if (params.size() > 5)
         fLocalOrdering = params[5].get_bool();
     
+    if(fTimeWindow && fLocalOrdering)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Time window cannot be used with local-ordering");                                
+    }
+    
     bool fWRPLocked=false;
     int chain_height; 
     int rpc_slot=GetRPCSlot();
@@ -2686,9 +3044,23 @@ Value liststreampublisheritems(const Array& params, bool fHelp)
     entity_rows=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcEntityRows;
     entity_rows->Clear();
     
-    mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entity,entStat.m_Generation,NULL));
-    
-    WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entity,entStat.m_Generation,start+1,count,entity_rows),entity.m_EntityType,"",&errCode,&strError);
+    if(fCursor)
+    {
+        WRPGetListByCursor(params[4].get_str(),&entity,entStat.m_Generation,count,entity_rows,cursor_token,&errCode,&strError);
+    }
+    else
+    {
+        if(fTimeWindow)
+        {
+            WRPGetListByTimeWindow(params[4],&entity,entStat.m_Generation,count,entity_rows,&next_start,&errCode,&strError);
+        }
+        else
+        {
+            mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entity,entStat.m_Generation,NULL));
+
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entity,entStat.m_Generation,start+1,count,entity_rows),entity.m_EntityType,"",&errCode,&strError);
+        }
+    }
     if(strError.size())
     {
         goto exitlbl;
@@ -2725,6 +3097,16 @@ exitlbl:
     }
     
     
+    if(fCursor)
+    {
+        return WRPCursorResult(retArray,cursor_token);
+    }
+    
+    if(fTimeWindow)
+    {
+        return WRPTimeWindowResult(retArray,next_start);
+    }
+    
     return retArray;
 }
 
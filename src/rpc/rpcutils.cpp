@@ -1769,6 +1769,11 @@ Value OpReturnFormatEntry(const unsigned char *elem,int64_t elem_size,uint256 tx
         switch(format)
         {
             case MC_SCR_DATA_FORMAT_UBJSON:
+                if(RawJSONOutputValue(elem,elem_size,&metadata_value))          // Transcoded directly into reply text
+                {
+                    metadata_object.push_back(Pair("json",metadata_value));
+                    return metadata_object;                    
+                }
                 metadata_value=ubjson_read(elem,elem_size,MAX_FORMATTED_DATA_DEPTH,&err);
                 if(err == MC_ERR_NOERROR)
                 {
@@ -4573,23 +4578,15 @@ bool FindPreparedTxOut(CTxOut& txout,COutPoint outpoint,string& reason)
             CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
             view.SetBackend(viewMemPool);
             
-            if (!view.HaveCoins(outpoint.hash)) 
+            const Coin& coin = view.AccessCoin(outpoint);
+            if (coin.IsSpent()) 
             {
-                reason="Missing inputs";
+                reason="Missing inputs";                                        // Spent and unknown outputs are not distinguished with per-output coins
                 return false;
             }
             else
             {
-                const CCoins* coins = view.AccessCoins(outpoint.hash);
-                if (!coins || !coins->IsAvailable(outpoint.n)) 
-                {
-                    reason="Input already spent";
-                    return false;
-                }
-                else
-                {
-                    txout=coins->vout[outpoint.n];                        
-                }
+                txout=coin.out;                        
             }                                
 
             view.GetBestBlock();
@@ -4641,25 +4638,17 @@ bool GetTxInputsAsTxOuts(const CTransaction& tx, vector <CTxOut>& inputs, vector
             {
                 COutPoint outpoint = tx.vin[i].prevout;
                 
-                if (!view.HaveCoins(outpoint.hash)) 
+                const Coin& coin = view.AccessCoin(outpoint);
+                if (coin.IsSpent()) 
                 {
                     result=false;
                     errors[i]="Missing inputs";                        
                 }
                 else
                 {
-                    const CCoins* coins = view.AccessCoins(outpoint.hash);
-                    if (!coins || !coins->IsAvailable(outpoint.n)) 
+                    if(errors[i].size() == 0)
                     {
-                        result=false;
-                        errors[i]="Input already spent";                        
-                    }
-                    else
-                    {
-                        if(errors[i].size() == 0)
-                        {
-                            inputs[i]=coins->vout[outpoint.n];                        
-                        }
+                        inputs[i]=coin.out;                        
                     }
                 }                                
             }
@@ -6197,7 +6186,9 @@ int ParseBlockIdentifier(Value blockset_identifier)
         {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block identifier");                                
         }                
-        for(int block=0; block<chainActive.Height();block++)
+        CBlockIndex *pindex=chainActive.FindEarliestAtLeast(starttime);         // No earlier block has nTime >= starttime
+        int first_block=pindex ? pindex->nHeight : chainActive.Height();
+        for(int block=first_block; block<chainActive.Height();block++)          // Tip is not included, as before
         {
             if(chainActive[block]->nTime >= starttime)
             {
@@ -6252,6 +6243,48 @@ int ParseRescanParameter(Value rescan_identifier, bool *fRescan)
     return start_block;
 }
 
+bool ParseBlockTimeRange(int64_t starttime,int64_t endtime,int chain_height,int *first_block,int *last_block)
+{
+/* 
+ * Blocks before the first one with nTimeMax >= starttime cannot be in the range.
+ * Block timestamp is always greater than median time past of its predecessor and median time past never decreases,
+ * so no block after the one with median time past > endtime can be in the range either.
+ */    
+    CBlockIndex *pindex;
+    
+    *first_block=chain_height+1;
+    *last_block=chain_height;
+    
+    if( (chain_height < 0) || (starttime > endtime) )
+    {
+        return false;
+    }
+    
+    pindex=chainActive.FindEarliestAtLeast(starttime);
+    if( (pindex == NULL) || (pindex->nHeight > chain_height) )
+    {
+        return false;
+    }
+    
+    *first_block=pindex->nHeight;
+    
+    while(pindex && (pindex->nHeight < chain_height))
+    {
+        if(pindex->GetMedianTimePast() > endtime)
+        {
+            break;
+        }
+        pindex=chainActive.Next(pindex);
+    }
+    
+    if(pindex)
+    {
+        *last_block=pindex->nHeight;
+    }
+    
+    return true;
+}
+
 vector<int> ParseBlockSetIdentifier(Value blockset_identifier,int chain_height_in)
 {
     vector<int> block_set;
@@ -6310,7 +6343,9 @@ vector<int> ParseBlockSetIdentifier(Value blockset_identifier,int chain_height_i
         
         if(starttime <= endtime)
         {
-            for(int block=0; block<=chain_height;block++)
+            int first_block,last_block;
+            ParseBlockTimeRange(starttime,endtime,chain_height,&first_block,&last_block);
+            for(int block=first_block; block<=last_block;block++)
             {
                 if( (chainActive[block]->nTime >= starttime) && (chainActive[block]->nTime <= endtime) )
                 {
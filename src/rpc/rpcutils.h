@@ -151,6 +151,7 @@ int ParseBlockIdentifier(Value blockset_identifier);
 int ParseRescanParameter(Value rescan_identifier, bool *fRescan);
 vector<int> ParseBlockSetIdentifier(Value blockset_identifier);
 vector<int> ParseBlockSetIdentifier(Value blockset_identifier,int chain_height_in);
+bool ParseBlockTimeRange(int64_t starttime,int64_t endtime,int chain_height,int *first_block,int *last_block);
 vector<unsigned char> ParseRawFormattedData(const Value *value,uint32_t *data_format,mc_Script *lpDetailsScript,uint32_t in_options,uint32_t *out_options,int *errorCode,string *strError);
 void ParseRawDetails(const Value *value,mc_Script *lpDetails,mc_Script *lpDetailsScript,int *errorCode,string *strError);
 void ParseRawValue(const Value *value,mc_Script *lpDetails,mc_Script *lpDetailsScript,size_t *max_size,int *errorCode,string *strError);
@@ -16,6 +16,7 @@
 #include "keys/pubkey.h"
 #include "script/script.h"
 #include "structs/uint256.h"
+#include "utils/streams.h"
 
 using namespace std;
 
@@ -1084,6 +1085,49 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     return ss.GetHash();
 }
 
+/* MCHN START */
+CSignatureHashCache::CSignatureHashCache(const CTransaction& txToIn) : txTo(txToIn)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << txTo.nVersion;
+    WriteCompactSize(ss, txTo.vin.size());
+    vInputOffsets.reserve(txTo.vin.size()+1);
+    for (unsigned int nInput = 0; nInput < txTo.vin.size(); nInput++)
+    {
+        vInputOffsets.push_back(ss.size());
+        ss << txTo.vin[nInput].prevout << CScript() << txTo.vin[nInput].nSequence;
+    }
+    vInputOffsets.push_back(ss.size());
+    ss << txTo.vout << txTo.nLockTime;
+    vchBlanked.assign(ss.begin(), ss.end());
+
+    CHashWriter hw(SER_GETHASH, 0);
+    unsigned int nOffset = 0;
+    vPrefixes.reserve(txTo.vin.size());
+    for (unsigned int nInput = 0; nInput < txTo.vin.size(); nInput++)
+    {
+        hw.write((const char*)&vchBlanked[nOffset], vInputOffsets[nInput]-nOffset);
+        nOffset = vInputOffsets[nInput];
+        vPrefixes.push_back(hw);
+    }
+}
+
+uint256 CSignatureHashCache::SignatureHash(const CScript& scriptCode, unsigned int nIn, int nHashType) const
+{
+    if ( (nIn >= txTo.vin.size()) || (nHashType & SIGHASH_ANYONECANPAY) ||
+         ((nHashType & 0x1f) == SIGHASH_SINGLE) || ((nHashType & 0x1f) == SIGHASH_NONE) )
+        return ::SignatureHash(scriptCode, txTo, nIn, nHashType);
+
+    CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
+
+    CHashWriter ss = vPrefixes[nIn];
+    txTmp.SerializeInput(ss, nIn, SER_GETHASH, 0);
+    ss.write((const char*)&vchBlanked[vInputOffsets[nIn+1]], vchBlanked.size()-vInputOffsets[nIn+1]);
+    ss << nHashType;
+    return ss.GetHash();
+}
+/* MCHN END */
+
 bool TransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     return pubkey.Verify(sighash, vchSig);
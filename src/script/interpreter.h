@@ -9,6 +9,7 @@
 
 #include "script_error.h"
 #include "primitives/transaction.h"
+#include "structs/hash.h"
 
 #include <vector>
 #include <stdint.h>
@@ -78,6 +79,28 @@ enum
 
 uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
 
+/* MCHN START */
+/**
+ * Signature hashes of all inputs of one transaction.
+ * For SIGHASH_ALL the transaction with blanked input scripts is serialized once and hash midstates
+ * before every input are kept, only the signed input and the remaining suffix are hashed per input.
+ * Other hash types fall back to SignatureHash. Results are identical to SignatureHash.
+ */
+class CSignatureHashCache
+{
+private:
+    const CTransaction& txTo;
+    std::vector<unsigned char> vchBlanked;                                      // Serialization with blank input scripts
+    std::vector<unsigned int> vInputOffsets;                                    // Offsets of inputs in vchBlanked, last - end of inputs
+    std::vector<CHashWriter> vPrefixes;                                         // Hash midstates before every input
+
+public:
+    CSignatureHashCache(const CTransaction& txToIn);
+
+    uint256 SignatureHash(const CScript& scriptCode, unsigned int nIn, int nHashType) const;
+};
+/* MCHN END */
+
 class BaseSignatureChecker
 {
 public:
@@ -72,6 +72,15 @@ public:
         sigdata_type k(hash, vchSig, pubKey);
         setValid.insert(k);
     }
+
+    void GetAll(std::vector<CSignatureCacheEntry>& entries)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+
+        entries.reserve(entries.size()+setValid.size());
+        for (std::set<sigdata_type>::const_iterator it = setValid.begin(); it != setValid.end(); ++it)
+            entries.push_back(CSignatureCacheEntry(it->get<0>(), it->get<1>(), it->get<2>()));
+    }
 };
 
 }
@@ -96,3 +105,8 @@ void MultichainNode_AddSignatureToCache(const std::vector<unsigned char>& vchSig
     signatureCache.Set(sighash, vchSig, pubkey);    
 }
 
+void MultichainNode_GetSignatureCache(std::vector<CSignatureCacheEntry>& entries)
+{
+    signatureCache.GetAll(entries);
+}
+
@@ -8,10 +8,14 @@
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
 #include "script/interpreter.h"
+#include "keys/pubkey.h"
 
 #include <vector>
 
-class CPubKey;
+#include <boost/tuple/tuple.hpp>
+
+/** Known-valid signature: (signature hash, signature, public key) */
+typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> CSignatureCacheEntry;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
@@ -24,4 +28,10 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/* MCHN START */
+void MultichainNode_AddSignatureToCache(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash);
+/** Copy of the valid signature cache, used to persist it together with the memory pool */
+void MultichainNode_GetSignatureCache(std::vector<CSignatureCacheEntry>& entries);
+/* MCHN END */
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
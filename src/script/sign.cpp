@@ -13,8 +13,10 @@
 #include "script/standard.h"
 #include "structs/uint256.h"
 #include "sigcache.h"
+#include "checkqueue.h"
 
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 
 void MultichainNode_AddSignatureToCache(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash);
 
@@ -22,7 +24,75 @@ using namespace std;
 
 typedef vector<unsigned char> valtype;
 
-bool Sign1(const CKeyID& address, const CKeyStore& keystore, uint256 hash, int nHashType, CScript& scriptSigRet)
+/* MCHN START */
+int nSignatureThreads = 0;
+
+/** One ECDSA signature computed on signature worker thread */
+class CSignatureJob
+{
+private:
+    const CKey *pkey;                                                           // Owned by CSignatureBatch, not copied to avoid copying secret
+    const uint256 *phash;
+    valtype *pvchSig;
+
+public:
+    CSignatureJob() : pkey(NULL), phash(NULL), pvchSig(NULL) {}
+    CSignatureJob(const CKey *pkeyIn, const uint256 *phashIn, valtype *pvchSigIn) : pkey(pkeyIn), phash(phashIn), pvchSig(pvchSigIn) {}
+
+    bool operator()()
+    {
+        return pkey->Sign(*phash, *pvchSig);
+    }
+
+    void swap(CSignatureJob& job)
+    {
+        std::swap(pkey, job.pkey);
+        std::swap(phash, job.phash);
+        std::swap(pvchSig, job.pvchSig);
+    }
+};
+
+/** Below this number of signatures they are computed on the calling thread, dispatching costs more than it saves */
+static const unsigned int MIN_PARALLEL_SIGNATURES = 4;
+
+static CCheckQueue<CSignatureJob> signaturequeue(16);
+static boost::mutex cs_SignatureQueue;                                          // CCheckQueue supports only one master at a time
+
+void ThreadSignatureWorker()
+{
+    RenameThread("bitcoin-sign");
+    signaturequeue.Thread();
+}
+
+/**
+ * Context of SignSignatures. In collect mode Sign1 only records keys and hashes to sign,
+ * in apply mode it takes signatures computed in parallel.
+ */
+class CSignatureBatch
+{
+public:
+    const CSignatureHashCache *pHashCache;
+    bool fCollect;
+    std::map<std::pair<CKeyID, uint256>, CKey> mapKeys;
+    std::map<std::pair<CKeyID, uint256>, valtype> mapSignatures;
+    std::map<std::pair<unsigned int, CScript>, uint256> mapHashes;
+
+    CSignatureBatch(const CSignatureHashCache *pHashCacheIn) : pHashCache(pHashCacheIn), fCollect(true) {}
+
+    uint256 SignatureHash(const CScript& scriptCode, unsigned int nIn, int nHashType)
+    {
+        std::pair<unsigned int, CScript> key = std::make_pair(nIn, scriptCode);
+        std::map<std::pair<unsigned int, CScript>, uint256>::const_iterator it = mapHashes.find(key);
+        if (it != mapHashes.end())
+            return it->second;
+        uint256 hash = pHashCache->SignatureHash(scriptCode, nIn, nHashType);
+        mapHashes[key] = hash;
+        return hash;
+    }
+};
+/* MCHN END */
+
+bool Sign1(const CKeyID& address, const CKeyStore& keystore, uint256 hash, int nHashType, CScript& scriptSigRet, CSignatureBatch *batch = NULL)
 {
 /* MCHN START */    
 /*    
@@ -38,6 +108,21 @@ bool Sign1(const CKeyID& address, const CKeyStore& keystore, uint256 hash, int n
         return false;
        
     vector<unsigned char> vchSig;
+/* MCHN START */
+    if (batch)
+    {
+        std::pair<CKeyID, uint256> sig_key = std::make_pair(address, hash);
+        if (batch->fCollect)
+        {
+            batch->mapKeys.insert(std::make_pair(sig_key, key));
+            return true;
+        }
+        std::map<std::pair<CKeyID, uint256>, valtype>::const_iterator it = batch->mapSignatures.find(sig_key);
+        if ( (it != batch->mapSignatures.end()) && !it->second.empty() )
+            vchSig = it->second;
+    }
+    if (vchSig.empty())
+/* MCHN END */
     if (!key.Sign(hash, vchSig))
         return false;
     if(GetBoolArg("-cachejustsigned",true))
@@ -51,7 +136,7 @@ bool Sign1(const CKeyID& address, const CKeyStore& keystore, uint256 hash, int n
     return true;
 }
 
-bool SignN(const vector<valtype>& multisigdata, const CKeyStore& keystore, uint256 hash, int nHashType, CScript& scriptSigRet)
+bool SignN(const vector<valtype>& multisigdata, const CKeyStore& keystore, uint256 hash, int nHashType, CScript& scriptSigRet, CSignatureBatch *batch = NULL)
 {
     int nSigned = 0;
     int nRequired = multisigdata.front()[0];
@@ -71,7 +156,7 @@ bool SignN(const vector<valtype>& multisigdata, const CKeyStore& keystore, uint2
         }
 /* MCHN END */        
 
-        if (Sign1(keyID, keystore, hash, nHashType, scriptSigRet))
+        if (Sign1(keyID, keystore, hash, nHashType, scriptSigRet, batch))
             ++nSigned;
     }
 /* MCHN START */        
@@ -88,7 +173,7 @@ bool SignN(const vector<valtype>& multisigdata, const CKeyStore& keystore, uint2
  * Returns false if scriptPubKey could not be completely satisfied.
  */
 bool Solver(const CKeyStore& keystore, const CScript& scriptPubKey, uint256 hash, int nHashType,
-                  CScript& scriptSigRet, txnouttype& whichTypeRet)
+                  CScript& scriptSigRet, txnouttype& whichTypeRet, CSignatureBatch *batch = NULL)
 {
     scriptSigRet.clear();
 
@@ -104,10 +189,10 @@ bool Solver(const CKeyStore& keystore, const CScript& scriptPubKey, uint256 hash
         return false;
     case TX_PUBKEY:
         keyID = CPubKey(vSolutions[0]).GetID();
-        return Sign1(keyID, keystore, hash, nHashType, scriptSigRet);
+        return Sign1(keyID, keystore, hash, nHashType, scriptSigRet, batch);
     case TX_PUBKEYHASH:
         keyID = CKeyID(uint160(vSolutions[0]));
-        if (!Sign1(keyID, keystore, hash, nHashType, scriptSigRet))
+        if (!Sign1(keyID, keystore, hash, nHashType, scriptSigRet, batch))
             return false;
         else
         {
@@ -121,21 +206,21 @@ bool Solver(const CKeyStore& keystore, const CScript& scriptPubKey, uint256 hash
 
     case TX_MULTISIG:
         scriptSigRet << OP_0; // workaround CHECKMULTISIG bug
-        return (SignN(vSolutions, keystore, hash, nHashType, scriptSigRet));
+        return (SignN(vSolutions, keystore, hash, nHashType, scriptSigRet, batch));
     }
     return false;
 }
 
-bool SignSignature(const CKeyStore &keystore, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, int nHashType)
+static bool SignSignature(const CKeyStore &keystore, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, int nHashType, CSignatureBatch *batch)
 {
     assert(nIn < txTo.vin.size());
     CTxIn& txin = txTo.vin[nIn];
     
     // Leave out the signature from the hash, since a signature can't sign itself.
     // The checksig op will also drop the signatures from its hash.
-    uint256 hash = SignatureHash(fromPubKey, txTo, nIn, nHashType);
+    uint256 hash = batch ? batch->SignatureHash(fromPubKey, nIn, nHashType) : SignatureHash(fromPubKey, txTo, nIn, nHashType);
     txnouttype whichType;
-    if (!Solver(keystore, fromPubKey, hash, nHashType, txin.scriptSig, whichType))
+    if (!Solver(keystore, fromPubKey, hash, nHashType, txin.scriptSig, whichType, batch))
         return false;
 
     if (whichType == TX_SCRIPTHASH)
@@ -146,24 +231,86 @@ bool SignSignature(const CKeyStore &keystore, const CScript& fromPubKey, CMutabl
         CScript subscript = txin.scriptSig;
 
         // Recompute txn hash using subscript in place of scriptPubKey:
-        uint256 hash2 = SignatureHash(subscript, txTo, nIn, nHashType);
+        uint256 hash2 = batch ? batch->SignatureHash(subscript, nIn, nHashType) : SignatureHash(subscript, txTo, nIn, nHashType);
 
         txnouttype subType;
         bool fSolved =
-            Solver(keystore, subscript, hash2, nHashType, txin.scriptSig, subType) && subType != TX_SCRIPTHASH;
+            Solver(keystore, subscript, hash2, nHashType, txin.scriptSig, subType, batch) && subType != TX_SCRIPTHASH;
         // Append serialized subscript whether or not it is completely signed:
         txin.scriptSig << static_cast<valtype>(subscript);
         if (!fSolved) return false;
     }
 
     // Test solution
-    if(GetBoolArg("-verifyjustsigned",false))
+    if( (batch == NULL || !batch->fCollect) && GetBoolArg("-verifyjustsigned",false) )
     {
         return VerifyScript(txin.scriptSig, fromPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, MutableTransactionSignatureChecker(&txTo, nIn));
     }
     return true;
 }
 
+bool SignSignature(const CKeyStore &keystore, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, int nHashType)
+{
+    return SignSignature(keystore, fromPubKey, txTo, nIn, nHashType, NULL);
+}
+
+/* MCHN START */
+bool SignSignatures(const CKeyStore& keystore, const std::vector<CScript>& vFromPubKeys, CMutableTransaction& txTo, const std::vector<unsigned int>& vIn, int nHashType, std::vector<bool>* vSigned)
+{
+    assert(vFromPubKeys.size() == vIn.size());
+    
+    bool fAllSigned = true;
+    if (vSigned)
+        vSigned->assign(vIn.size(), false);
+    if (vIn.empty())
+        return true;
+    
+    // Input scripts are blanked in signature hashes, so all hashes can be computed before any input is signed
+    const CTransaction txConst(txTo);
+    CSignatureHashCache hashCache(txConst);
+    CSignatureBatch batch(&hashCache);
+
+    for (unsigned int i = 0; i < vIn.size(); i++)
+    {
+        CScript scriptSigSaved(txTo.vin[vIn[i]].scriptSig);
+        SignSignature(keystore, vFromPubKeys[i], txTo, vIn[i], nHashType, &batch);
+        txTo.vin[vIn[i]].scriptSig.swap(scriptSigSaved);
+    }
+
+    std::vector<CSignatureJob> vJobs;
+    vJobs.reserve(batch.mapKeys.size());
+    for (std::map<std::pair<CKeyID, uint256>, CKey>::const_iterator it = batch.mapKeys.begin(); it != batch.mapKeys.end(); ++it)
+        vJobs.push_back(CSignatureJob(&it->second, &it->first.second, &batch.mapSignatures[it->first]));
+
+    if ( (nSignatureThreads > 1) && (vJobs.size() >= MIN_PARALLEL_SIGNATURES) )
+    {
+        boost::unique_lock<boost::mutex> lock(cs_SignatureQueue);
+        CCheckQueueControl<CSignatureJob> control(&signaturequeue);
+        control.Add(vJobs);
+        control.Wait();                                                         // Failed signatures are recomputed below
+    }
+    else
+    {
+        BOOST_FOREACH(CSignatureJob& job, vJobs)
+            job();
+    }
+    vJobs.clear();
+    batch.mapKeys.clear();
+
+    batch.fCollect = false;
+    for (unsigned int i = 0; i < vIn.size(); i++)
+    {
+        bool fSigned = SignSignature(keystore, vFromPubKeys[i], txTo, vIn[i], nHashType, &batch);
+        if (vSigned)
+            (*vSigned)[i] = fSigned;
+        if (!fSigned)
+            fAllSigned = false;
+    }
+
+    return fAllSigned;
+}
+/* MCHN END */
+
 bool SignSignature(const CKeyStore &keystore, const CTransaction& txFrom, CMutableTransaction& txTo, unsigned int nIn, int nHashType)
 {
     assert(nIn < txTo.vin.size());
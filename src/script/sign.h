@@ -9,6 +9,8 @@
 
 #include "script/interpreter.h"
 
+#include <vector>
+
 class CKeyStore;
 class CScript;
 class CTransaction;
@@ -18,6 +20,23 @@ struct CMutableTransaction;
 bool SignSignature(const CKeyStore& keystore, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, int nHashType=SIGHASH_ALL);
 bool SignSignature(const CKeyStore& keystore, const CTransaction& txFrom, CMutableTransaction& txTo, unsigned int nIn, int nHashType=SIGHASH_ALL);
 
+/* MCHN START */
+/** Default for -signthreads, 0 = one thread per core */
+static const int DEFAULT_SIGNATURE_THREADS = 0;
+
+extern int nSignatureThreads;
+
+void ThreadSignatureWorker();
+
+/**
+ * Signs inputs vIn of txTo, vFromPubKeys[i] is the script spent by input vIn[i]. 
+ * Signature hashes share one serialization of txTo, ECDSA signatures are computed on signature worker threads.
+ * Result is identical to calling SignSignature for every input. Returns true if all inputs were signed,
+ * vSigned (if not NULL) gets result for every input.
+ */
+bool SignSignatures(const CKeyStore& keystore, const std::vector<CScript>& vFromPubKeys, CMutableTransaction& txTo, const std::vector<unsigned int>& vIn, int nHashType=SIGHASH_ALL, std::vector<bool>* vSigned=NULL);
+/* MCHN END */
+
 /**
  * Given two sets of signatures for scriptPubKey, possibly with OP_0 placeholders,
  * combine them intelligently and return the result.
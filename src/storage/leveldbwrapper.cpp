@@ -6,6 +6,7 @@
 #include "storage/leveldbwrapper.h"
 
 #include "utils/util.h"
+#include "utils/declare.h"
 
 #include <boost/filesystem.hpp>
 
@@ -47,6 +48,7 @@ static leveldb::Options GetOptions(size_t nCacheSize)
 CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
 {
     penv = NULL;
+    nMemoryAccounted = 0;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
@@ -67,10 +69,17 @@ CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCa
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+/* MCHN START */    
+    nMemoryAccounted = nCacheSize / 2 + 2 * (nCacheSize / 4);
+    mc_MemAccount(MC_MEM_TAG_LEVELDB, nMemoryAccounted);
+/* MCHN END */    
 }
 
 CLevelDBWrapper::~CLevelDBWrapper()
 {
+/* MCHN START */    
+    mc_MemAccount(MC_MEM_TAG_LEVELDB, -(int64_t)nMemoryAccounted);
+/* MCHN END */    
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
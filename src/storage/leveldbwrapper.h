@@ -86,6 +86,9 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! block cache and write buffer capacity accounted to MC_MEM_TAG_LEVELDB
+    size_t nMemoryAccounted;
+
 public:
     CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
     ~CLevelDBWrapper();
@@ -169,6 +172,17 @@ public:
     {
         return pdb->NewIterator(iteroptions);
     }
+
+    //! compacts the key range [begin,end], used to reclaim space after bulk erases
+    template <typename K>
+    void CompactRange(const K& begin, const K& end)
+    {
+        CDataStream ssBegin(SER_DISK, CLIENT_VERSION), ssEnd(SER_DISK, CLIENT_VERSION);
+        ssBegin << begin;
+        ssEnd << end;
+        leveldb::Slice slBegin(&ssBegin[0], ssBegin.size()), slEnd(&ssEnd[0], ssEnd.size());
+        pdb->CompactRange(&slBegin, &slEnd);
+    }
 };
 
 #endif // BITCOIN_LEVELDBWRAPPER_H
@@ -7,7 +7,9 @@
 #include "storage/txdb.h"
 
 #include "chain/pow.h"
+#include "core/init.h"
 #include "structs/uint256.h"
+#include "ui/ui_interface.h"
 
 #include <stdint.h>
 
@@ -15,20 +17,106 @@
 
 using namespace std;
 
-void static BatchWriteCoins(CLevelDBBatch &batch, const uint256 &hash, const CCoins &coins) {
-    if (coins.IsPruned())
+static const char DB_COIN = 'C';
+static const char DB_COINS = 'c';
+
+namespace {
+
+/** Key of the per-output coin record */
+struct CoinEntry {
+    COutPoint* outpoint;
+    char key;
+    CoinEntry(const COutPoint* ptr) : outpoint(const_cast<COutPoint*>(ptr)), key(DB_COIN)  {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(key);
+        READWRITE(outpoint->hash);
+        READWRITE(VARINT(outpoint->n));
+    }
+};
+
+/** 
+ * Whole-transaction coin record written by earlier versions, only read by CCoinsViewDB::Upgrade
+ *
+ * Serialized format:
+ * - VARINT(nVersion)
+ * - VARINT(nCode)
+ * - unspentness bitvector, for vout[2] and further; least significant byte first
+ * - the non-spent CTxOuts (via CTxOutCompressor)
+ * - VARINT(nHeight)
+ *
+ * The nCode value consists of:
+ * - bit 1: IsCoinBase()
+ * - bit 2: vout[0] is not spent
+ * - bit 4: vout[1] is not spent
+ * - The higher bits encode N, the number of non-zero bytes in the following bitvector.
+ *   - In case both bit 2 and bit 4 are unset, they encode N-1, as there must be at
+ *     least one non-spent output).
+ */
+class CCoins
+{
+public:
+    bool fCoinBase;
+    std::vector<CTxOut> vout;
+    int nHeight;
+    int nVersion;
+
+    CCoins() : fCoinBase(false), vout(0), nHeight(0), nVersion(0) { }
+
+    template<typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        unsigned int nCode = 0;
+        // version
+        ::Unserialize(s, VARINT(this->nVersion), nType, nVersion);
+        // header code
+        ::Unserialize(s, VARINT(nCode), nType, nVersion);
+        fCoinBase = nCode & 1;
+        std::vector<bool> vAvail(2, false);
+        vAvail[0] = (nCode & 2) != 0;
+        vAvail[1] = (nCode & 4) != 0;
+        unsigned int nMaskCode = (nCode / 8) + ((nCode & 6) != 0 ? 0 : 1);
+        // spentness bitmask
+        while (nMaskCode > 0) {
+            unsigned char chAvail = 0;
+            ::Unserialize(s, chAvail, nType, nVersion);
+            for (unsigned int p = 0; p < 8; p++) {
+                bool f = (chAvail & (1 << p)) != 0;
+                vAvail.push_back(f);
+            }
+            if (chAvail != 0)
+                nMaskCode--;
+        }
+        // txouts themself
+        vout.assign(vAvail.size(), CTxOut());
+        for (unsigned int i = 0; i < vAvail.size(); i++) {
+            if (vAvail[i])
+                ::Unserialize(s, REF(CTxOutCompressor(vout[i])), nType, nVersion);
+        }
+        // coinbase height
+        ::Unserialize(s, VARINT(nHeight), nType, nVersion);
+    }
+};
+
+}
+
+void static BatchWriteCoin(CLevelDBBatch &batch, const COutPoint &outpoint, const Coin &coin) {
+    CoinEntry entry(&outpoint);
+    if (coin.IsSpent())
     {
 /* MCHN START */    
-        if(fDebug)LogPrint("mccoin", "COIN: DB Erase  %s\n", hash.ToString().c_str());
+        if(fDebug)LogPrint("mccoin", "COIN: DB Erase  %s\n", outpoint.ToString().c_str());
 /* MCHN END */    
-        batch.Erase(make_pair('c', hash));
+        batch.Erase(entry);
     }
     else
     {
 /* MCHN START */    
-        if(fDebug)LogPrint("mccoin", "COIN: DB Write  %s\n", hash.ToString().c_str());
+        if(fDebug)LogPrint("mccoin", "COIN: DB Write  %s\n", outpoint.ToString().c_str());
 /* MCHN END */    
-        batch.Write(make_pair('c', hash), coins);
+        batch.Write(entry, coin);
     }
 }
 
@@ -39,12 +127,12 @@ void static BatchWriteHashBestChain(CLevelDBBatch &batch, const uint256 &hash) {
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) {
 }
 
-bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
-    return db.Read(make_pair('c', txid), coins);
+bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    return db.Read(CoinEntry(&outpoint), coin);
 }
 
-bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
-    return db.Exists(make_pair('c', txid));
+bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
@@ -60,7 +148,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     size_t changed = 0;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+            BatchWriteCoin(batch, it->first, it->second.coin);
             changed++;
         }
         count++;
@@ -70,10 +158,95 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     if (hashBlock != uint256(0))
         BatchWriteHashBestChain(batch, hashBlock);
 
-    if(fDebug)LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    if(fDebug)LogPrint("coindb", "Committing %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::Upgrade() {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_COINS, uint256(0));
+    pcursor->Seek(ssKeySet.str());
+    if (!pcursor->Valid()) {
+        return true;
+    }
+
+    LogPrintf("Upgrading coin database to per-output records...\n");
+    uiInterface.ShowProgress(_("Upgrading coin database..."), 0);
+    
+    int64_t nStart = GetTimeMillis();
+    size_t nTransactions = 0;
+    size_t nOutputs = 0;
+    size_t nBatchOutputs = 0;
+    int nReportDone = 0;
+    CLevelDBBatch batch;
+    std::pair<char, uint256> key;
+    std::pair<char, uint256> prev_key = make_pair(DB_COINS, uint256(0));
+    
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested()) {
+            break;
+        }
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType;
+            if (chType != DB_COINS) {
+                break;
+            }
+            key.first = chType;
+            ssKey >> key.second;
+            
+            uint32_t nHigh = 0x100 * *key.second.begin() + *(key.second.begin() + 1);  // Records are ordered by serialized txid
+            int nPercentageDone = (int)(nHigh * 100.0 / 65536.0 + 0.5);
+            if (nPercentageDone > nReportDone) {
+                uiInterface.ShowProgress(_("Upgrading coin database..."), nPercentageDone);
+                nReportDone = nPercentageDone;
+            }
+            
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoins old_coins;
+            ssValue >> old_coins;
+            
+            COutPoint outpoint(key.second, 0);
+            for (size_t i = 0; i < old_coins.vout.size(); ++i) {
+                if (!old_coins.vout[i].IsNull() && !old_coins.vout[i].scriptPubKey.IsUnspendable()) {
+                    Coin newcoin(old_coins.vout[i], old_coins.nHeight, old_coins.fCoinBase, old_coins.nVersion);
+                    outpoint.n = i;
+                    batch.Write(CoinEntry(&outpoint), newcoin);
+                    nOutputs++;
+                    nBatchOutputs++;
+                }
+            }
+            batch.Erase(key);                                                   // New records of the transaction are written in the same batch
+            nTransactions++;
+            
+            if (nBatchOutputs >= 100000) {
+                db.WriteBatch(batch);
+                batch = CLevelDBBatch();
+                nBatchOutputs = 0;
+                db.CompactRange(prev_key, key);
+                prev_key = key;
+            }
+            pcursor->Next();
+        } catch (std::exception &e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    
+    db.WriteBatch(batch);
+    db.CompactRange(make_pair(DB_COINS, uint256(0)), key);
+    uiInterface.ShowProgress("", 100);
+    LogPrintf("Upgrading coin database: %u transactions, %u outputs converted in %dms%s\n", 
+            (unsigned int)nTransactions, (unsigned int)nOutputs, (int)(GetTimeMillis() - nStart), ShutdownRequested() ? " (interrupted)" : "");
+    
+    return !ShutdownRequested();
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -110,17 +283,43 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read('l', nFile);
 }
 
+/** Adds outputs of one transaction to the UTXO set hash, same serialization as the earlier whole-transaction records */
+void static ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    assert(!outputs.empty());
+    int nVersion = outputs.begin()->second.nVersion;
+    int nHeight = outputs.begin()->second.nHeight;
+    ss << hash;
+    ss << VARINT(nVersion);
+    ss << (outputs.begin()->second.fCoinBase ? 'c' : 'n');
+    ss << VARINT(nHeight);
+    stats.nTransactions++;
+    for (std::map<uint32_t, Coin>::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        unsigned int nPos = it->first + 1;
+        ss << VARINT(nPos);
+        ss << it->second.out;
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += it->second.out.nValue;
+    }
+    ss << VARINT(0);
+}
+
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
+    
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_COIN, uint256(0));
+    pcursor->Seek(ssKeySet.str());
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     stats.hashBlock = GetBestBlock();
     ss << stats.hashBlock;
-    CAmount nTotalAmount = 0;
+    stats.nTotalAmount = 0;
+    uint256 prevkey = 0;
+    std::map<uint32_t, Coin> outputs;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         try {
@@ -128,38 +327,35 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
             CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
             char chType;
             ssKey >> chType;
-            if (chType == 'c') {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-                stats.nTransactions++;
-                for (unsigned int i=0; i<coins.vout.size(); i++) {
-                    const CTxOut &out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i+1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
-                }
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
+            if (chType != DB_COIN) {
+                break;
+            }
+            COutPoint outpoint;
+            ssKey >> outpoint.hash;
+            ssKey >> VARINT(outpoint.n);
+            
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            Coin coin;
+            ssValue >> coin;
+            
+            if (!outputs.empty() && outpoint.hash != prevkey) {
+                ApplyStats(stats, ss, prevkey, outputs);
+                outputs.clear();
             }
+            prevkey = outpoint.hash;
+            outputs[outpoint.n].swap(coin);
+            stats.nSerializedSize += slKey.size() + slValue.size();
             pcursor->Next();
         } catch (std::exception &e) {
             return error("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
     }
+    if (!outputs.empty()) {
+        ApplyStats(stats, ss, prevkey, outputs);
+    }
     stats.nHeight = mapBlockIndex.find(GetBestBlock())->second->nHeight;
     stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
     return true;
 }
 
@@ -186,6 +382,28 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+/* MCHN START */    
+bool CBlockTreeDB::WriteBlockFilter(const CBlockFilter &filter, const uint256 &header) {
+    CLevelDBBatch batch;
+    batch.Write(make_pair('g', filter.GetBlockHash()), filter);
+    batch.Write(make_pair('G', filter.GetBlockHash()), make_pair(filter.GetHash(), header));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256 &hash, CBlockFilter &filter) {
+    return Read(make_pair('g', hash), filter);
+}
+
+bool CBlockTreeDB::ReadBlockFilterHeader(const uint256 &hash, uint256 &filterHash, uint256 &header) {
+    std::pair<uint256, uint256> value;
+    if (!Read(make_pair('G', hash), value))
+        return false;
+    filterHash = value.first;
+    header = value.second;
+    return true;
+}
+/* MCHN END */    
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
     boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
@@ -9,13 +9,14 @@
 
 #include "storage/leveldbwrapper.h"
 #include "core/main.h"
+#include "structs/blockfilter.h"
 
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
-class CCoins;
+class Coin;
 class uint256;
 
 //! -dbcache default (MiB)
@@ -25,7 +26,12 @@ static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 4096 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
 
-/** CCoinsView backed by the LevelDB coin database (chainstate/) */
+/** 
+ * CCoinsView backed by the LevelDB coin database (chainstate/)
+ * 
+ * ('C',txid,VARINT(n)) - Coin, one record per unspent output
+ * ('c',txid) - whole-transaction CCoins record written by earlier versions, converted by Upgrade()
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
@@ -33,11 +39,14 @@ protected:
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
-    bool GetCoins(const uint256 &txid, CCoins &coins) const;
-    bool HaveCoins(const uint256 &txid) const;
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
     bool GetStats(CCoinsStats &stats) const;
+
+    //! Converts per-transaction records to per-output records, can be interrupted and resumed
+    bool Upgrade();
 };
 
 /** Access to the block database (blocks/index/) */
@@ -61,6 +70,12 @@ public:
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts();
+/* MCHN START */    
+    //! ('g',blockhash) - compact filter, ('G',blockhash) - filter hash and filter header
+    bool WriteBlockFilter(const CBlockFilter &filter, const uint256 &header);
+    bool ReadBlockFilter(const uint256 &hash, CBlockFilter &filter);
+    bool ReadBlockFilterHeader(const uint256 &hash, uint256 &filterHash, uint256 &header);
+/* MCHN END */    
 };
 
 #endif // BITCOIN_TXDB_H
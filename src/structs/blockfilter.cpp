@@ -0,0 +1,245 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+#include "structs/blockfilter.h"
+
+#include "structs/hash.h"
+#include "utils/streams.h"
+#include "version/clientversion.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/** MSB-first bit stream over byte vector */
+class CBitStreamWriter
+{
+private:
+    vector<unsigned char>& vData;
+    unsigned char nBuffer;
+    int nOffset;
+
+public:
+    CBitStreamWriter(vector<unsigned char>& vDataIn) : vData(vDataIn), nBuffer(0), nOffset(0) {}
+
+    void Write(uint64_t nValue, int nBits)
+    {
+        while (nBits > 0)
+        {
+            int nTake = min(8 - nOffset, nBits);
+            nBuffer |= (unsigned char)(((nValue >> (nBits - nTake)) & ((1 << nTake) - 1)) << (8 - nOffset - nTake));
+            nOffset += nTake;
+            nBits -= nTake;
+            if (nOffset == 8)
+                Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (nOffset == 0)
+            return;
+        vData.push_back(nBuffer);
+        nBuffer = 0;
+        nOffset = 0;
+    }
+};
+
+class CBitStreamReader
+{
+private:
+    const unsigned char *ptr;
+    const unsigned char *ptrEnd;
+    unsigned char nBuffer;
+    int nOffset;
+
+public:
+    CBitStreamReader(const unsigned char *ptrIn, const unsigned char *ptrEndIn) : ptr(ptrIn), ptrEnd(ptrEndIn), nBuffer(0), nOffset(8) {}
+
+    bool Read(int nBits, uint64_t& nValue)
+    {
+        nValue = 0;
+        while (nBits > 0)
+        {
+            if (nOffset == 8)
+            {
+                if (ptr >= ptrEnd)
+                    return false;
+                nBuffer = *ptr++;
+                nOffset = 0;
+            }
+            int nTake = min(8 - nOffset, nBits);
+            nValue = (nValue << nTake) | ((unsigned char)(nBuffer << nOffset) >> (8 - nTake));
+            nOffset += nTake;
+            nBits -= nTake;
+        }
+        return true;
+    }
+};
+
+static void GolombRiceEncode(CBitStreamWriter& writer, uint64_t nValue)
+{
+    uint64_t q = nValue >> BLOCKFILTER_P;
+    while (q > 0)
+    {
+        int nBits = (int)min(q, (uint64_t)64);
+        writer.Write(~(uint64_t)0, nBits);
+        q -= nBits;
+    }
+    writer.Write(0, 1);
+    writer.Write(nValue, BLOCKFILTER_P);
+}
+
+static bool GolombRiceDecode(CBitStreamReader& reader, uint64_t& nValue)
+{
+    uint64_t q = 0;
+    uint64_t nBit;
+    while (true)
+    {
+        if (!reader.Read(1, nBit))
+            return false;
+        if (nBit == 0)
+            break;
+        q++;
+    }
+    if (!reader.Read(BLOCKFILTER_P, nValue))
+        return false;
+    nValue += q << BLOCKFILTER_P;
+    return true;
+}
+
+/** (x * n) >> 64 without 128-bit arithmetic, maps uniform 64-bit hash into [0,n) */
+static uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+    uint64_t x_hi = x >> 32, x_lo = x & 0xFFFFFFFF;
+    uint64_t n_hi = n >> 32, n_lo = n & 0xFFFFFFFF;
+
+    uint64_t ac = x_hi * n_hi;
+    uint64_t ad = x_hi * n_lo;
+    uint64_t bc = x_lo * n_hi;
+    uint64_t bd = x_lo * n_lo;
+
+    uint64_t mid34 = (bd >> 32) + (bc & 0xFFFFFFFF) + (ad & 0xFFFFFFFF);
+    return ac + (bc >> 32) + (ad >> 32) + (mid34 >> 32);
+}
+
+CBlockFilter::CBlockFilter(const uint256& hash, const vector<vector<unsigned char> >& vElements) : blockHash(hash)
+{
+    vector<vector<unsigned char> > vUnique(vElements);
+    sort(vUnique.begin(), vUnique.end());
+    vUnique.erase(unique(vUnique.begin(), vUnique.end()), vUnique.end());
+
+    nElements = vUnique.size();                                                 // Range of hashed values depends on it
+
+    vector<uint64_t> vHashed;
+    vHashed.reserve(vUnique.size());
+    for (unsigned int i = 0; i < vUnique.size(); i++)
+        vHashed.push_back(HashToRange(vUnique[i]));
+    sort(vHashed.begin(), vHashed.end());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(ss, nElements);
+    vData.assign(ss.begin(), ss.end());
+    nDataOffset = vData.size();
+
+    CBitStreamWriter writer(vData);
+    uint64_t nLast = 0;
+    for (unsigned int i = 0; i < vHashed.size(); i++)
+    {
+        GolombRiceEncode(writer, vHashed[i] - nLast);
+        nLast = vHashed[i];
+    }
+    writer.Flush();
+}
+
+void CBlockFilter::MakeElement(vector<unsigned char>& vElement, int nType,
+                               const unsigned char *prefix, size_t prefix_size, const unsigned char *data, size_t data_size)
+{
+    vElement.clear();
+    vElement.reserve(1 + prefix_size + data_size);
+    vElement.push_back((unsigned char)nType);
+    if (prefix_size)
+        vElement.insert(vElement.end(), prefix, prefix + prefix_size);
+    if (data_size)
+        vElement.insert(vElement.end(), data, data + data_size);
+}
+
+uint64_t CBlockFilter::HashToRange(const vector<unsigned char>& vElement) const
+{
+    uint64_t nSeed = blockHash.GetLow64();                                       // Keyed by block hash, so collisions are not reproducible across blocks
+    uint64_t nHash = ((uint64_t)MurmurHash3((unsigned int)(nSeed >> 32), vElement) << 32) |
+                     (uint64_t)MurmurHash3((unsigned int)(nSeed & 0xFFFFFFFF), vElement);
+    return MapIntoRange(nHash, nElements * BLOCKFILTER_M);
+}
+
+bool CBlockFilter::DecodeHeader()
+{
+    nElements = 0;
+    nDataOffset = 0;
+    try {
+        CDataStream ss(vData, SER_NETWORK, PROTOCOL_VERSION);
+        nElements = ReadCompactSize(ss);
+        nDataOffset = vData.size() - ss.size();
+    } catch (std::exception &e) {
+        nElements = 0;
+        nDataOffset = vData.size();
+        return false;
+    }
+    return true;
+}
+
+uint256 CBlockFilter::GetHash() const
+{
+    return Hash(vData.begin(), vData.end());
+}
+
+uint256 CBlockFilter::ComputeHeader(const uint256& prevHeader) const
+{
+    uint256 hash = GetHash();
+    return Hash(hash.begin(), hash.end(), prevHeader.begin(), prevHeader.end());
+}
+
+bool CBlockFilter::MatchHashed(const vector<uint64_t>& vQuery) const
+{
+    if (nElements == 0 || vQuery.empty())
+        return false;
+
+    CBitStreamReader reader(vData.empty() ? NULL : &vData[0] + nDataOffset, vData.empty() ? NULL : &vData[0] + vData.size());
+    uint64_t nValue = 0;
+    uint64_t nDelta;
+    unsigned int q = 0;
+
+    for (uint64_t i = 0; i < nElements; i++)                                    // Merge of two sorted lists
+    {
+        if (!GolombRiceDecode(reader, nDelta))
+            return false;
+        nValue += nDelta;
+        while (q < vQuery.size() && vQuery[q] < nValue)
+            q++;
+        if (q >= vQuery.size())
+            return false;
+        if (vQuery[q] == nValue)
+            return true;
+    }
+    return false;
+}
+
+bool CBlockFilter::Match(const vector<unsigned char>& vElement) const
+{
+    if (nElements == 0)
+        return false;
+    vector<uint64_t> vQuery(1, HashToRange(vElement));
+    return MatchHashed(vQuery);
+}
+
+bool CBlockFilter::MatchAny(const vector<vector<unsigned char> >& vElements) const
+{
+    if (nElements == 0)
+        return false;
+    vector<uint64_t> vQuery;
+    vQuery.reserve(vElements.size());
+    for (unsigned int i = 0; i < vElements.size(); i++)
+        vQuery.push_back(HashToRange(vElements[i]));
+    sort(vQuery.begin(), vQuery.end());
+    return MatchHashed(vQuery);
+}
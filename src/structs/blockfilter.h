@@ -0,0 +1,82 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+#ifndef BITCOIN_BLOCKFILTER_H
+#define BITCOIN_BLOCKFILTER_H
+
+#include "structs/uint256.h"
+#include "utils/serialize.h"
+
+#include <stdint.h>
+#include <vector>
+
+/** Golomb-Rice parameter and inverse false positive rate of compact block filters */
+static const int BLOCKFILTER_P = 19;
+static const uint64_t BLOCKFILTER_M = 784931;
+
+//! Maximal number of blocks in one getcfilters/getcfheaders request
+static const unsigned int MAX_GETCFILTERS_SIZE = 1000;
+static const unsigned int MAX_GETCFHEADERS_SIZE = 2000;
+
+/**
+ * Element types, element data is prefixed by the type before hashing,
+ * so identical byte strings of different types do not collide
+ */
+enum blockfilterelement
+{
+    BLOCKFILTER_ELEMENT_STREAM = 1,                                             // Stream short txid
+    BLOCKFILTER_ELEMENT_KEY = 2,                                                // Stream short txid + item key
+    BLOCKFILTER_ELEMENT_PUBLISHER = 3,                                          // Hash160 of publisher pubkey or redeem script
+};
+
+/**
+ * Compact (Golomb-coded set) filter of stream IDs, item keys and publishers of the block.
+ *
+ * Unlike CBloomFilter it is built once by the serving node and is the same for all clients,
+ * so it can be stored with the block index and committed to by the chain of filter headers.
+ * Light client matches its subscriptions against the filter and downloads only the blocks which match.
+ * False positive rate is 1/BLOCKFILTER_M for every queried element, there are no false negatives.
+ */
+class CBlockFilter
+{
+private:
+    uint256 blockHash;
+    std::vector<unsigned char> vData;                                           // CompactSize(N) + Golomb-Rice coded deltas
+    uint64_t nElements;
+    unsigned int nDataOffset;
+
+    uint64_t HashToRange(const std::vector<unsigned char>& vElement) const;
+    bool DecodeHeader();
+    bool MatchHashed(const std::vector<uint64_t>& vQuery) const;
+
+public:
+    CBlockFilter() : nElements(0), nDataOffset(0) {}
+    CBlockFilter(const uint256& hash, const std::vector<std::vector<unsigned char> >& vElements);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(blockHash);
+        READWRITE(vData);
+        if (ser_action.ForRead())
+            DecodeHeader();
+    }
+
+    static void MakeElement(std::vector<unsigned char>& vElement, int nType,
+                            const unsigned char *prefix, size_t prefix_size, const unsigned char *data, size_t data_size);
+
+    const uint256& GetBlockHash() const { return blockHash; }
+    const std::vector<unsigned char>& GetEncoded() const { return vData; }
+    uint64_t GetNumElements() const { return nElements; }
+
+    //! Double-SHA256 of the encoded filter
+    uint256 GetHash() const;
+    //! Filter header, commits to the filter and all previous filters in the chain
+    uint256 ComputeHeader(const uint256& prevHeader) const;
+
+    bool Match(const std::vector<unsigned char>& vElement) const;
+    bool MatchAny(const std::vector<std::vector<unsigned char> >& vElements) const;
+};
+
+#endif // BITCOIN_BLOCKFILTER_H
@@ -7,6 +7,9 @@
 #include "leveldb/include/leveldb/c.h"
 #include "multichain/multichain.h"
 
+#define MC_DCT_DB_LEVELDB_CACHE_SIZE     (128 << 20)
+#define MC_DCT_DB_LEVELDB_MEMORY         (MC_DCT_DB_LEVELDB_CACHE_SIZE + 2 * (4 << 20)) // Block cache and up to two default write buffers
+
 int cs_Database::Zero()
 {
     
@@ -119,7 +122,7 @@ int cs_Database::Open(char *name,int Options)
                 m_IterOptions = (void*)leveldb_readoptions_create();
                 m_WriteOptions = (void*)leveldb_writeoptions_create();
                 m_SyncOptions = (void*)leveldb_writeoptions_create();
-                m_Cache = (void*)leveldb_cache_create_lru(128 << 20);
+                m_Cache = (void*)leveldb_cache_create_lru(MC_DCT_DB_LEVELDB_CACHE_SIZE);
                 
                 leveldb_readoptions_set_fill_cache((leveldb_readoptions_t*)m_ReadOptions,0);
                 leveldb_readoptions_set_fill_cache((leveldb_readoptions_t*)m_IterOptions,0);
@@ -152,6 +155,7 @@ int cs_Database::Open(char *name,int Options)
 
                     return MC_ERR_DBOPEN_ERROR;
                 }
+                mc_MemAccount(MC_MEM_TAG_LEVELDB,MC_DCT_DB_LEVELDB_MEMORY);
 //                m_Iterator=(void*)leveldb_create_iterator((leveldb_t*)m_DB,(leveldb_readoptions_t*)m_IterOptions);
             }
             
@@ -317,6 +321,7 @@ int cs_Database::Close()
                 {
                     case MC_OPT_DB_DATABASE_LEVELDB:                          
                         leveldb_close((leveldb_t*)m_DB);
+                        mc_MemAccount(MC_MEM_TAG_LEVELDB,-MC_DCT_DB_LEVELDB_MEMORY);
                         break;
                 }
                 m_DB=NULL;
@@ -447,6 +452,94 @@ char *cs_Database::MoveNextKeyLevels(int key_levels,int *error)
     return NULL;
 }
 
+void *cs_Database::CursorCreate()
+{
+    if(m_DB == NULL)
+    {
+        return NULL;
+    }
+    
+    switch(m_Options & MC_OPT_DB_DATABASE_TYPE_MASK)
+    {
+        case MC_OPT_DB_DATABASE_LEVELDB:    
+            return (void*)leveldb_create_iterator((leveldb_t*)m_DB,(leveldb_readoptions_t*)m_IterOptions);
+    }
+    
+    return NULL;
+}
+
+void cs_Database::CursorDestroy(void *cursor)
+{
+    if(cursor)
+    {
+        leveldb_iter_destroy((leveldb_iterator_t*)cursor);
+    }
+}
+
+int cs_Database::CursorSeek(void *cursor,char *key,int key_len)
+{
+    if(cursor == NULL)
+    {
+        return 0;
+    }
+    
+    leveldb_iter_seek((leveldb_iterator_t*)cursor, key, key_len);
+    
+    return leveldb_iter_valid((leveldb_iterator_t*)cursor) ? 1 : 0;
+}
+
+int cs_Database::CursorMove(void *cursor,int direction)
+{
+    if(cursor == NULL)
+    {
+        return 0;
+    }
+    
+    if(!leveldb_iter_valid((leveldb_iterator_t*)cursor))
+    {
+        return 0;
+    }
+    
+    if(direction < 0)
+    {
+        leveldb_iter_prev((leveldb_iterator_t*)cursor);
+    }
+    else
+    {
+        leveldb_iter_next((leveldb_iterator_t*)cursor);
+    }
+    
+    return leveldb_iter_valid((leveldb_iterator_t*)cursor) ? 1 : 0;
+}
+
+const char *cs_Database::CursorRead(void *cursor,int *key_len,const char **value,int *value_len)
+{
+    size_t keylen;
+    size_t vallen;
+    const char *lpKey;
+    
+    *key_len=0;
+    *value=NULL;
+    *value_len=0;
+    
+    if(cursor == NULL)
+    {
+        return NULL;
+    }
+    
+    if(!leveldb_iter_valid((leveldb_iterator_t*)cursor))
+    {
+        return NULL;
+    }
+    
+    lpKey=leveldb_iter_key((leveldb_iterator_t*)cursor, &keylen);
+    *value=leveldb_iter_value((leveldb_iterator_t*)cursor, &vallen);
+    *key_len=keylen;
+    *value_len=vallen;
+    
+    return lpKey;
+}
+
 char *cs_Database::Read(char *key,int key_len,int *value_len,int Options,int *error)
 {
     char *err = NULL;
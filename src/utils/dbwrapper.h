@@ -201,6 +201,26 @@ typedef struct mc_Database
         int *error
     );
     
+    void *CursorCreate();                                                       /* Creates iterator independent of m_Iterator, NULL on failure */
+    void CursorDestroy(
+        void *cursor                                                            /* Iterator created by CursorCreate */
+    );
+    int CursorSeek(                                                             /* Positions iterator at the first key >= key, returns 1 if valid */
+        void *cursor,                                                           /* Iterator created by CursorCreate */
+        char *key,                                                              /* key */
+        int key_len                                                             /* key length */
+    );
+    int CursorMove(                                                             /* Moves iterator, returns 1 if valid */
+        void *cursor,                                                           /* Iterator created by CursorCreate */
+        int direction                                                           /* 1 - next, -1 - previous */
+    );
+    const char *CursorRead(                                                     /* Returns key at iterator position, NULL if invalid. Pointers valid until next move */
+        void *cursor,                                                           /* Iterator created by CursorCreate */
+        int *key_len,                                                           /* Output. key length */
+        const char **value,                                                     /* Output. value */
+        int *value_len                                                          /* Output. value length */
+    );
+    
 } cs_Database;
 
 
@@ -63,6 +63,7 @@ typedef struct mc_Buffer
 {
     mc_Buffer()
     {
+        m_MemTag=MC_MEM_TAG_NONE;
         Zero();
     }
 
@@ -79,10 +80,14 @@ typedef struct mc_Buffer
     int                     m_RowSize;
     int                     m_Count;
     uint32_t                m_Mode;
+    int                     m_MemTag;                                           // Subsystem allocation is accounted to, kept by Zero()
+    int64_t                 m_IndexMemSize;                                     // Estimated size of index entries accounted to m_MemTag
     
     void Zero();
     int Destroy();
     int Initialize(int KeySize,int TotalSize,uint32_t Mode);
+    void SetMemTag(int tag);
+    void AccountIndex();
     
     int Clear();
     int Realloc(int Rows);
@@ -106,6 +111,7 @@ typedef struct mc_List
 {
     mc_List()
     {
+         m_MemTag=MC_MEM_TAG_NONE;
          Zero();
     }
 
@@ -119,9 +125,11 @@ typedef struct mc_List
     int                     m_Size;
     int                     m_Pos;
     int                     m_ItemSize;
+    int                     m_MemTag;
     
     void Zero();
     int Destroy();
+    void SetMemTag(int tag);
     
     void Clear();
     int Put(unsigned char *ptr, int size);
@@ -131,6 +139,48 @@ typedef struct mc_List
 } mc_List;
 
 
+/* Per-block undo of key-value state, DB values before the block for every key written by the block commit */
+
+typedef struct mc_BlockUndoHeader
+{
+    int32_t                 m_Version;
+    int32_t                 m_Block;                                            // Height before the block
+    int32_t                 m_KeySize;
+    int32_t                 m_ValueSize;
+    int32_t                 m_Count;                                            // Number of recorded keys
+    int32_t                 m_Reserved;
+    int64_t                 m_Row;                                              // Subsystem ledger position before the block
+    int64_t                 m_Pos;                                              // Subsystem ledger position before the block, second value if needed
+} mc_BlockUndoHeader;
+
+typedef struct mc_BlockUndo
+{
+    mc_BlockUndo()
+    {
+        Zero();
+    }
+
+    ~mc_BlockUndo()
+    {
+        Destroy();
+    }
+    
+    mc_BlockUndoHeader      m_Header;
+    mc_Buffer              *m_Rows;                                             // key -> found flag (int32), value before the block
+    
+    void Zero();
+    int Destroy();
+    int Initialize(int KeySize,int ValueSize,int MemTag);
+    
+    void Reset(int32_t block,int64_t row,int64_t pos);
+    int Record(const void *lpKey,const void *lpValue);                          // lpValue is NULL if key was not found, only first value of the key is kept
+    int GetRow(int RowID,unsigned char **lppKey,unsigned char **lppValue);      // Returns found flag
+    int GetSize();
+    void Serialize(unsigned char *lpDest);                                      // GetSize() bytes
+    int Load(const unsigned char *lpSrc,int size);
+    
+} mc_BlockUndo;
+
 typedef struct mc_SHA256
 {
     void *m_HashObject;
@@ -207,6 +257,12 @@ struct mc_TerminalInput
 int mc_AllocSize(int items,int chunk_size,int item_size);
 void *mc_New(int Size);
 void mc_Delete(void *ptr);
+void mc_MemAccount(int tag,int64_t bytes);
+void mc_MemSetLive(int tag,int64_t bytes);
+int64_t mc_MemLive(int tag);
+int64_t mc_MemPeak(int tag);
+const char *mc_MemTagName(int tag);
+int mc_MapStringIndexRowSize(int key_size);
 void mc_PutLE(void *dest,void *src,int dest_size);
 int64_t mc_GetLE(void *src,int size);
 uint32_t mc_SwapBytes32(uint32_t src);
@@ -68,6 +68,18 @@
 #define MC_BUF_MODE_DEFAULT             0x00000000
 #define MC_BUF_MODE_MAP                 0x00000001
 
+#define MC_MEM_TAG_NONE                 0                                       // Not accounted
+#define MC_MEM_TAG_PERMISSIONS          1
+#define MC_MEM_TAG_ASSETS               2
+#define MC_MEM_TAG_TXDB                 3
+#define MC_MEM_TAG_CHUNKCOLLECTOR       4
+#define MC_MEM_TAG_CHUNKDB              5
+#define MC_MEM_TAG_COINSCACHE           6
+#define MC_MEM_TAG_TXMEMPOOL            7
+#define MC_MEM_TAG_RELAY                8
+#define MC_MEM_TAG_LEVELDB              9
+#define MC_MEM_TAG_COUNT                10
+
 
 #define MC_PRM_NETWORK_NAME_MAX_SIZE    32
 #define MC_PRM_MAX_THREADS              256
@@ -0,0 +1,196 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+#include "utils/lzcodec.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+static const int LZCODEC_MIN_HASH_BITS = 8;
+static const int LZCODEC_MAX_HASH_BITS = 14;
+
+static inline uint32_t ReadU32(const unsigned char *ptr)
+{
+    uint32_t v;
+    memcpy(&v, ptr, sizeof(v));
+    return v;
+}
+
+static inline unsigned int HashU32(uint32_t v, int nBits)
+{
+    return (v * 2654435761U) >> (32 - nBits);
+}
+
+static unsigned char *WriteLength(unsigned char *op, size_t nLength)
+{
+    while (nLength >= 255)
+    {
+        *op++ = 255;
+        nLength -= 255;
+    }
+    *op++ = (unsigned char)nLength;
+    return op;
+}
+
+static bool ReadLength(const unsigned char *&ip, const unsigned char *iend, size_t& nLength)
+{
+    unsigned char b;
+    do
+    {
+        if (ip >= iend)
+            return false;
+        b = *ip++;
+        nLength += b;
+    } while (b == 255);
+    return true;
+}
+
+size_t LZCompressBound(size_t nSize)
+{
+    return nSize + nSize / 255 + 16;
+}
+
+size_t LZCompress(const unsigned char *src, size_t nSize, vector<unsigned char>& vOut)
+{
+    vOut.resize(LZCompressBound(nSize));
+    unsigned char *op = &vOut[0];
+
+    const unsigned char *ip = src;
+    const unsigned char *anchor = src;                                          // Start of pending literals
+    const unsigned char *iend = src + nSize;
+
+    if (nSize >= (size_t)LZCODEC_MIN_MATCH)
+    {
+        const unsigned char *ilimit = iend - LZCODEC_MIN_MATCH;                 // Last position match can start at
+        int nBits = LZCODEC_MIN_HASH_BITS;                                      // Small messages (tx) don't pay for large table reset
+        while (nBits < LZCODEC_MAX_HASH_BITS && ((size_t)1 << nBits) < nSize)
+            nBits++;
+        vector<int> vTable((size_t)1 << nBits, -1);
+        unsigned int nMisses = 0;
+
+        while (ip <= ilimit)
+        {
+            uint32_t nSeq = ReadU32(ip);
+            unsigned int h = HashU32(nSeq, nBits);
+            int nCandidate = vTable[h];
+            vTable[h] = (int)(ip - src);
+            if (nCandidate < 0 || (ip - src) - nCandidate > LZCODEC_MAX_OFFSET || ReadU32(src + nCandidate) != nSeq)
+            {
+                ip += 1 + (nMisses++ >> 6);                                     // Skip faster through incompressible data
+                continue;
+            }
+            nMisses = 0;
+
+            const unsigned char *match = src + nCandidate;
+            while (ip > anchor && match > src && ip[-1] == match[-1])
+            {
+                ip--;
+                match--;
+            }
+            const unsigned char *mend = ip + LZCODEC_MIN_MATCH;
+            const unsigned char *mptr = match + LZCODEC_MIN_MATCH;
+            while (mend < iend && *mend == *mptr)
+            {
+                mend++;
+                mptr++;
+            }
+
+            size_t nLiterals = ip - anchor;
+            size_t nMatch = (mend - ip) - LZCODEC_MIN_MATCH;
+            size_t nOffset = ip - match;
+
+            *op++ = (unsigned char)((min(nLiterals, (size_t)15) << 4) | min(nMatch, (size_t)15));
+            if (nLiterals >= 15)
+                op = WriteLength(op, nLiterals - 15);
+            memcpy(op, anchor, nLiterals);
+            op += nLiterals;
+            *op++ = (unsigned char)(nOffset & 0xFF);
+            *op++ = (unsigned char)(nOffset >> 8);
+            if (nMatch >= 15)
+                op = WriteLength(op, nMatch - 15);
+
+            ip = mend;
+            anchor = ip;
+            if (ip - 2 <= ilimit)
+                vTable[HashU32(ReadU32(ip - 2), nBits)] = (int)(ip - 2 - src);
+        }
+    }
+
+    size_t nLiterals = iend - anchor;                                           // Last record, literals only
+    *op++ = (unsigned char)(min(nLiterals, (size_t)15) << 4);
+    if (nLiterals >= 15)
+        op = WriteLength(op, nLiterals - 15);
+    if (nLiterals)
+        memcpy(op, anchor, nLiterals);
+    op += nLiterals;
+
+    vOut.resize(op - &vOut[0]);
+    return vOut.size();
+}
+
+size_t LZDecompressBound(size_t nSize)
+{
+    return nSize*LZCODEC_MAX_EXPANSION+16;
+}
+
+bool LZDecompress(const unsigned char *src, size_t nSize, size_t nRawSize, vector<unsigned char>& vOut)
+{
+    if (nRawSize > LZDecompressBound(nSize))                                    // Claimed size cannot be produced from this input, don't allocate it
+        return false;
+    
+    vOut.resize(nRawSize);
+
+    const unsigned char *ip = src;
+    const unsigned char *iend = src + nSize;
+    size_t nPos = 0;
+
+    while (ip < iend)
+    {
+        unsigned int nToken = *ip++;
+
+        size_t nLiterals = nToken >> 4;
+        if (nLiterals == 15 && !ReadLength(ip, iend, nLiterals))
+            return false;
+        if (nLiterals > (size_t)(iend - ip) || nLiterals > nRawSize - nPos)
+            return false;
+        if (nLiterals)
+            memcpy(&vOut[nPos], ip, nLiterals);
+        ip += nLiterals;
+        nPos += nLiterals;
+
+        if (ip == iend)                                                         // Last record
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t nOffset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (nOffset == 0 || nOffset > nPos)
+            return false;
+
+        size_t nMatch = nToken & 0x0F;
+        if (nMatch == 15 && !ReadLength(ip, iend, nMatch))
+            return false;
+        nMatch += LZCODEC_MIN_MATCH;
+        if (nMatch > nRawSize - nPos)
+            return false;
+
+        unsigned char *op = &vOut[nPos];
+        const unsigned char *mptr = op - nOffset;
+        if (nOffset >= nMatch)
+        {
+            memcpy(op, mptr, nMatch);
+        }
+        else
+        {
+            for (size_t i = 0; i < nMatch; i++)                                 // Overlapping copy repeats the pattern
+                op[i] = mptr[i];
+        }
+        nPos += nMatch;
+    }
+
+    return nPos == nRawSize;
+}
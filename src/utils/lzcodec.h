@@ -0,0 +1,36 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+#ifndef BITCOIN_LZCODEC_H
+#define BITCOIN_LZCODEC_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Byte-oriented LZ77 codec used for compression of P2P messages.
+ *
+ * Compressed data is a sequence of (token, literals, offset, match) records, as in LZ4 block format:
+ * token high nibble - literal count, low nibble - match length minus LZCODEC_MIN_MATCH,
+ * value 15 in either nibble is continued by bytes added until the first byte < 255,
+ * offset - 2 bytes little-endian distance back into output (1..65535).
+ * The last record has literals only. Uncompressed size is not stored and should be passed by caller.
+ */
+
+static const int LZCODEC_MIN_MATCH = 4;
+static const int LZCODEC_MAX_OFFSET = 65535;
+static const int LZCODEC_MAX_EXPANSION = 255;                                   // Max output bytes per input byte, one length byte adds at most 255
+
+//! Upper bound of uncompressed size for compressed input of nSize bytes
+size_t LZDecompressBound(size_t nSize);
+
+//! Upper bound of compressed size for input of nSize bytes
+size_t LZCompressBound(size_t nSize);
+
+//! Replaces vOut with compressed data, returns its size
+size_t LZCompress(const unsigned char *src, size_t nSize, std::vector<unsigned char>& vOut);
+
+//! Returns false if data is malformed or does not decompress into exactly nRawSize bytes
+bool LZDecompress(const unsigned char *src, size_t nSize, size_t nRawSize, std::vector<unsigned char>& vOut);
+
+#endif // BITCOIN_LZCODEC_H
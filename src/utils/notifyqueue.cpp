@@ -0,0 +1,284 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+#include "utils/notifyqueue.h"
+#include "utils/util.h"
+#include "utils/utiltime.h"
+
+#include <string.h>
+
+#include <boost/algorithm/string/replace.hpp>
+
+using namespace std;
+
+CNotifyQueue notifyQueue;
+
+void CNotifyEvent::Set(const string& strName,const string& strValue,bool fShared)
+{
+    CArg arg;
+    arg.strName=strName;
+    arg.strValue=strValue;
+    arg.fShared=fShared;
+    vArgs.push_back(arg);
+}
+
+bool CNotifyEvent::NeedsArg(const string& strName) const
+{
+    return strTemplate.find(strName) != string::npos;
+}
+
+bool CNotifyEvent::SameArgs(const CNotifyEvent& other) const
+{
+    if(vArgs.size() != other.vArgs.size())
+    {
+        return false;
+    }
+    for(unsigned int i=0;i<vArgs.size();i++)
+    {
+        if( (vArgs[i].strName != other.vArgs[i].strName) || (vArgs[i].strValue != other.vArgs[i].strValue) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+CNotifyQueue::CNotifyQueue()
+{
+    fRunning=false;
+    fStopping=false;
+    memset(&stats,0,sizeof(CNotifyQueueStats));
+}
+
+CNotifyQueue::~CNotifyQueue()
+{
+    Stop();
+}
+
+void CNotifyQueue::Start(int nThreads,int nMaxSize,int nBatchSize)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if(fRunning)
+    {
+        return;
+    }
+    
+    stats.nThreads=max(1,min(nThreads,MAX_NOTIFY_THREADS));
+    stats.nMaxSize=max(1,nMaxSize);
+    stats.nBatchSize=max(1,nBatchSize);
+    fStopping=false;
+    fRunning=true;
+    
+    for(int i=0;i<stats.nThreads;i++)
+    {
+        workers.create_thread(boost::bind(&CNotifyQueue::Loop, this));
+    }
+    LogPrint("notify","notify: Started %d notification threads, queue size: %d, batch size: %d\n",stats.nThreads,stats.nMaxSize,stats.nBatchSize);
+}
+
+void CNotifyQueue::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if(!fRunning)
+        {
+            return;
+        }
+        fStopping=true;
+    }
+    condWorker.notify_all();
+    workers.join_all();
+    
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fRunning=false;
+    LogPrint("notify","notify: Stopped, %d notifications not executed\n",(int)queue.size());
+    stats.nDiscarded+=queue.size();
+    queue.clear();
+}
+
+bool CNotifyQueue::Push(const CNotifyEvent& event)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if(!fRunning || fStopping)
+    {
+        return false;
+    }
+    
+    if((int)queue.size() >= stats.nMaxSize)                                     // Callers may hold cs_main/cs_wallet, never wait here
+    {
+        stats.nDropped++;
+        if(fDebug)LogPrint("notify","notify: Queue is full, notification dropped: %s\n",event.strTemplate);
+        return true;
+    }
+    
+    queue.push_back(make_pair(event,GetTimeMicros()));
+    stats.nPushed++;
+    if((int)queue.size() > stats.nMaxDepth)
+    {
+        stats.nMaxDepth=queue.size();
+    }
+    condWorker.notify_one();
+    
+    return true;
+}
+
+CNotifyQueueStats CNotifyQueue::GetStats()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    stats.nDepth=queue.size();
+    return stats;
+}
+
+void CNotifyQueue::Loop()
+{
+    RenameThread("bitcoin-notify");
+    vector<CNotifyEvent> vBatch;
+    
+    while(true)
+    {
+        vBatch.clear();
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while(queue.empty() && !fStopping)
+            {
+                condWorker.wait(lock);
+            }
+            if(queue.empty())
+            {
+                return;
+            }
+            
+// Events with the same command are batched, identical events in the batch are coalesced
+            
+            int64_t nNow=GetTimeMicros();
+            string strTemplate=queue.front().first.strTemplate;
+            deque<pair<CNotifyEvent,int64_t> >::iterator it=queue.begin();
+            while( (it != queue.end()) && ((int)vBatch.size() < stats.nBatchSize) )
+            {
+                if(it->first.strTemplate != strTemplate)
+                {
+                    it++;
+                    continue;
+                }
+                stats.nWaitMicros+=nNow-it->second;
+                bool fDuplicate=false;
+                for(unsigned int i=0;i<vBatch.size();i++)
+                {
+                    if(vBatch[i].SameArgs(it->first))
+                    {
+                        fDuplicate=true;
+                        break;
+                    }
+                }
+                if(fDuplicate)
+                {
+                    stats.nCoalesced++;
+                }
+                else
+                {
+                    vBatch.push_back(it->first);
+                }
+                it=queue.erase(it);
+            }
+        }
+        
+        int nExecuted=Execute(vBatch);
+        
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.nInvocations+=nExecuted;
+    }
+}
+
+static bool IsBatchSafeValue(const string& strValue)
+{
+    if(strValue == "\"\"")                                                    // Empty list placeholder
+    {
+        return true;
+    }
+    for(unsigned int i=0;i<strValue.size();i++)
+    {
+        char c=strValue[i];
+        if( !isalnum((unsigned char)c) && (strchr(".:_-",c) == NULL) )        // No separator - list values are not batched
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static string SubstituteArgs(const CNotifyEvent& event)
+{
+    string strCmd=event.strTemplate;
+    for(unsigned int a=0;a<event.vArgs.size();a++)
+    {
+        boost::replace_all(strCmd, event.vArgs[a].strName, event.vArgs[a].strValue);
+    }
+    return strCmd;
+}
+
+/** Runs batch, returns number of commands executed */
+
+int CNotifyQueue::Execute(vector<CNotifyEvent>& vBatch)
+{
+    if(vBatch.size() == 0)
+    {
+        return 0;
+    }
+    
+    if(vBatch.size() > 1)                                                       // Joined values should not be interpreted by shell
+    {
+        bool fSafe=true;
+        for(unsigned int i=0;(i<vBatch.size()) && fSafe;i++)
+        {
+            for(unsigned int a=0;(a<vBatch[i].vArgs.size()) && fSafe;a++)
+            {
+                if(!vBatch[i].vArgs[a].fShared && !IsBatchSafeValue(vBatch[i].vArgs[a].strValue))
+                {
+                    fSafe=false;
+                }
+            }
+        }
+        if(!fSafe)
+        {
+            for(unsigned int i=0;i<vBatch.size();i++)
+            {
+                runCommand(SubstituteArgs(vBatch[i]));
+            }
+            return vBatch.size();
+        }
+    }
+    
+    string strCmd=vBatch[0].strTemplate;
+    for(unsigned int a=0;a<vBatch[0].vArgs.size();a++)
+    {
+        const CNotifyEvent::CArg& arg=vBatch[0].vArgs[a];
+        string strValue=arg.strValue;
+        if(!arg.fShared)
+        {
+            for(unsigned int i=1;i<vBatch.size();i++)
+            {
+                strValue += MC_NTF_BATCH_SEPARATOR;
+                if(a < vBatch[i].vArgs.size())
+                {
+                    strValue += vBatch[i].vArgs[a].strValue;
+                }
+            }
+        }
+        boost::replace_all(strCmd, arg.strName, strValue);
+    }
+    
+    runCommand(strCmd);
+    return 1;
+}
+
+bool QueueNotification(const CNotifyEvent& event)
+{
+    if(notifyQueue.Push(event))
+    {
+        return true;
+    }
+    
+    string strCmd=SubstituteArgs(event);
+    boost::thread t(runCommand, strCmd); // thread runs free
+    return false;
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+#ifndef BITCOIN_NOTIFYQUEUE_H
+#define BITCOIN_NOTIFYQUEUE_H
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+static const int DEFAULT_NOTIFY_THREADS = 2;
+static const int MAX_NOTIFY_THREADS = 16;
+static const int DEFAULT_NOTIFY_QUEUE_SIZE = 10000;
+static const int DEFAULT_NOTIFY_BATCH_SIZE = 1;
+
+/** Separator between values of different events in one batched invocation, should not be interpreted by shell */
+#define MC_NTF_BATCH_SEPARATOR                 ","
+
+/**
+ * External command notification (-walletnotify, -blocknotify, ...).
+ * Placeholders are substituted in the order they were added, shared
+ * placeholders are substituted once per batch, others - by the list of values of all events in the batch.
+ * Events with values containing characters other than alphanumeric and .:_- (e.g. quoted JSON or lists of
+ * addresses) are not batched, joined list is passed to shell unquoted and should be split unambiguously by separator.
+ */
+class CNotifyEvent
+{
+public:
+    struct CArg
+    {
+        std::string strName;
+        std::string strValue;
+        bool fShared;
+    };
+
+    std::string strTemplate;
+    std::vector<CArg> vArgs;
+
+    CNotifyEvent(const std::string& strTemplateIn) : strTemplate(strTemplateIn) {}
+
+    void Set(const std::string& strName,const std::string& strValue,bool fShared = false);
+    bool NeedsArg(const std::string& strName) const;
+    bool SameArgs(const CNotifyEvent& other) const;
+};
+
+struct CNotifyQueueStats
+{
+    int nThreads;
+    int nMaxSize;
+    int nBatchSize;
+    int nDepth;
+    int nMaxDepth;
+    int64_t nPushed;
+    int64_t nCoalesced;
+    int64_t nInvocations;                                                       // Commands executed, unsafe batch runs one command per event
+    int64_t nDropped;                                                           // Dropped because the queue was full
+    int64_t nDiscarded;                                                         // Still queued at shutdown
+    int64_t nWaitMicros;
+};
+
+/**
+ * Bounded queue of external command notifications drained by a fixed worker pool.
+ * Producers (validation signals, wallet) never execute commands themselves and never wait - they may hold
+ * cs_main/cs_wallet, when the queue is full the event is dropped and counted.
+ */
+class CNotifyQueue
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+    boost::thread_group workers;
+
+    std::deque<std::pair<CNotifyEvent,int64_t> > queue;
+
+    bool fRunning;
+    bool fStopping;
+    CNotifyQueueStats stats;
+
+    void Loop();
+    int Execute(std::vector<CNotifyEvent>& vBatch);
+
+public:
+    CNotifyQueue();
+    ~CNotifyQueue();
+
+    void Start(int nThreads,int nMaxSize,int nBatchSize);
+    void Stop();
+
+    bool Push(const CNotifyEvent& event);
+    CNotifyQueueStats GetStats();
+};
+
+extern CNotifyQueue notifyQueue;
+
+/** Queue notification, falls back to detached thread if the queue is not running */
+bool QueueNotification(const CNotifyEvent& event);
+
+#endif // BITCOIN_NOTIFYQUEUE_H
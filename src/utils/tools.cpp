@@ -2,6 +2,7 @@
 // MultiChain code distributed under the GPLv3 license, see COPYING file.
 
 #include "multichain/multichain.h"
+#include "utils/memusage.h"
 
 #include <iosfwd>
 #include <string>
@@ -29,6 +30,16 @@ void mc_MapStringIndex::Clear()
     Init();
 }
 
+int mc_MapStringIndexRowSize(int key_size)                                      // Estimated memory per index entry
+{
+    int size=(int)memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const string, int> >));
+    if(key_size >= (int)sizeof(string))                                         // Short keys are stored inside string object
+    {
+        size+=(int)memusage::MallocUsage(key_size+1);
+    }
+    return size;
+}
+
 void mc_MapStringIndex::Add(const char* key, int value)
 {
     ((std::map<string, int>*)mapObject)->insert(std::pair<string, int>(string(key), value));
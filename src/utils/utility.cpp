@@ -2,6 +2,7 @@
 // MultiChain code distributed under the GPLv3 license, see COPYING file.
 
 #include "multichain/multichain.h"
+#include <atomic>
 #ifndef WIN32
 #include <termios.h>
 #include <sys/ioctl.h>
@@ -12,6 +13,9 @@
 #define MC_DCT_LIST_ALLOC_MIN_SIZE      32768
 #define MC_DCT_LIST_ALLOC_MAX_SIZE      268435456
 
+static std::atomic<int64_t> mc_MemLiveBytes[MC_MEM_TAG_COUNT];                 // Accounted allocations per subsystem, zero-initialized as static
+static std::atomic<int64_t> mc_MemPeakBytes[MC_MEM_TAG_COUNT];
+
 
 int c_IsHexNumeric[256]={
  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -62,6 +66,78 @@ void mc_Delete(void *ptr)
     delete [] (int64_t*)ptr;
 }
 
+static void mc_MemUpdatePeak(int tag,int64_t live)
+{
+    int64_t peak=mc_MemPeakBytes[tag].load(std::memory_order_relaxed);
+    while(live > peak)
+    {
+        if(mc_MemPeakBytes[tag].compare_exchange_weak(peak,live,std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+}
+
+void mc_MemAccount(int tag,int64_t bytes)
+{
+    if( (tag <= MC_MEM_TAG_NONE) || (tag >= MC_MEM_TAG_COUNT) || (bytes == 0) )
+    {
+        return;
+    }
+    
+    int64_t live=mc_MemLiveBytes[tag].fetch_add(bytes,std::memory_order_relaxed)+bytes;
+    if(bytes > 0)
+    {
+        mc_MemUpdatePeak(tag,live);
+    }
+}
+
+void mc_MemSetLive(int tag,int64_t bytes)                                       // For containers which are measured rather than accounted
+{
+    if( (tag <= MC_MEM_TAG_NONE) || (tag >= MC_MEM_TAG_COUNT) )
+    {
+        return;
+    }
+    
+    mc_MemLiveBytes[tag].store(bytes,std::memory_order_relaxed);
+    mc_MemUpdatePeak(tag,bytes);
+}
+
+int64_t mc_MemLive(int tag)
+{
+    if( (tag <= MC_MEM_TAG_NONE) || (tag >= MC_MEM_TAG_COUNT) )
+    {
+        return 0;
+    }
+    return mc_MemLiveBytes[tag].load(std::memory_order_relaxed);
+}
+
+int64_t mc_MemPeak(int tag)
+{
+    if( (tag <= MC_MEM_TAG_NONE) || (tag >= MC_MEM_TAG_COUNT) )
+    {
+        return 0;
+    }
+    return mc_MemPeakBytes[tag].load(std::memory_order_relaxed);
+}
+
+const char *mc_MemTagName(int tag)
+{
+    switch(tag)
+    {
+        case MC_MEM_TAG_PERMISSIONS:    return "permissions";
+        case MC_MEM_TAG_ASSETS:         return "assets";
+        case MC_MEM_TAG_TXDB:           return "txdb";
+        case MC_MEM_TAG_CHUNKCOLLECTOR: return "chunkcollector";
+        case MC_MEM_TAG_CHUNKDB:        return "chunkdb";
+        case MC_MEM_TAG_COINSCACHE:     return "coinscache";
+        case MC_MEM_TAG_TXMEMPOOL:      return "txmempool";
+        case MC_MEM_TAG_RELAY:          return "relay";
+        case MC_MEM_TAG_LEVELDB:        return "leveldb";
+    }
+    return "none";
+}
+
 void mc_PutLE(void *dest,void *src,int dest_size)
 {
     memcpy(dest,src,dest_size);                                                 // Assuming all systems are little endian
@@ -347,6 +423,7 @@ void mc_Buffer::Zero()
     m_RowSize=0;
     m_Count=0;
     m_Mode=0;    
+    m_IndexMemSize=0;
 }
 
 int mc_Buffer::Destroy()
@@ -360,6 +437,8 @@ int mc_Buffer::Destroy()
         mc_Delete(m_lpData);
     }
     
+    mc_MemAccount(m_MemTag,-((int64_t)m_AllocSize+m_IndexMemSize));
+    
     Zero();
     
     return MC_ERR_NOERROR;
@@ -393,8 +472,45 @@ int mc_Buffer::Initialize(int KeySize,int RowSize,uint32_t Mode)
         return err;
     }
     
+    mc_MemAccount(m_MemTag,m_AllocSize);
+    
     return err;
 }
+
+void mc_Buffer::SetMemTag(int tag)
+{
+    if(tag == m_MemTag)
+    {
+        return;
+    }
+    mc_MemAccount(m_MemTag,-((int64_t)m_AllocSize+m_IndexMemSize));
+    m_IndexMemSize=0;
+    m_MemTag=tag;
+    mc_MemAccount(m_MemTag,m_AllocSize);
+    AccountIndex();
+}
+
+void mc_Buffer::AccountIndex()
+{
+    int64_t size;
+    
+    if(m_MemTag == MC_MEM_TAG_NONE)
+    {
+        return;
+    }
+    
+    size=0;
+    if(m_lpIndex)
+    {
+        size=(int64_t)m_Count*mc_MapStringIndexRowSize(m_KeySize);
+    }
+    
+    if(size != m_IndexMemSize)
+    {
+        mc_MemAccount(m_MemTag,size-m_IndexMemSize);
+        m_IndexMemSize=size;
+    }
+}
     
 int mc_Buffer::Clear()
 {
@@ -405,6 +521,7 @@ int mc_Buffer::Clear()
     {
         m_lpIndex->Clear();
     }
+    AccountIndex();
     
     
     return MC_ERR_NOERROR;
@@ -432,6 +549,7 @@ int mc_Buffer::Realloc(int Rows)
         memcpy(lpNewBuffer,m_lpData,m_AllocSize);
         mc_Delete(m_lpData);
 
+        mc_MemAccount(m_MemTag,NewSize-m_AllocSize);
         m_AllocSize=NewSize;
         m_lpData=lpNewBuffer;                
     }
@@ -477,6 +595,7 @@ int mc_Buffer::Add(const void *lpKey,const void *lpValue)
     }
     
     m_Count++;
+    AccountIndex();
     
     return err;
 }
@@ -617,6 +736,7 @@ int mc_Buffer::SetCount(int count)
     
     m_Count=count;
     m_Size=count*m_RowSize;
+    AccountIndex();
     
     return err;
 }
@@ -676,6 +796,143 @@ int mc_Buffer::Sort()
 
 
 
+void mc_BlockUndo::Zero()
+{
+    memset(&m_Header,0,sizeof(mc_BlockUndoHeader));
+    m_Header.m_Block=-1;
+    m_Rows=NULL;
+}
+
+int mc_BlockUndo::Destroy()
+{
+    if(m_Rows)
+    {
+        delete m_Rows;
+    }
+    
+    Zero();
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_BlockUndo::Initialize(int KeySize,int ValueSize,int MemTag)
+{
+    int err;
+    
+    Destroy();
+    
+    m_Header.m_Version=1;
+    m_Header.m_KeySize=KeySize;
+    m_Header.m_ValueSize=ValueSize;
+    
+    m_Rows=new mc_Buffer;
+    err=m_Rows->Initialize(KeySize,KeySize+sizeof(int32_t)+ValueSize,MC_BUF_MODE_MAP);
+    m_Rows->SetMemTag(MemTag);
+    
+    return err;
+}
+
+void mc_BlockUndo::Reset(int32_t block,int64_t row,int64_t pos)
+{
+    m_Header.m_Block=block;
+    m_Header.m_Row=row;
+    m_Header.m_Pos=pos;
+    m_Header.m_Count=0;
+    m_Rows->Clear();
+}
+
+int mc_BlockUndo::Record(const void *lpKey,const void *lpValue)
+{
+    int err;
+    int32_t found;
+    unsigned char *ptr;
+    
+    if(m_Rows->Seek((void*)lpKey) >= 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    err=m_Rows->Add(lpKey,NULL);
+    if(err)
+    {
+        return err;
+    }
+    
+    ptr=m_Rows->GetRow(m_Rows->GetCount()-1)+m_Header.m_KeySize;
+    found=lpValue ? 1 : 0;
+    memcpy(ptr,&found,sizeof(int32_t));
+    if(lpValue)
+    {
+        memcpy(ptr+sizeof(int32_t),lpValue,m_Header.m_ValueSize);
+    }
+    m_Header.m_Count=m_Rows->GetCount();
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_BlockUndo::GetRow(int RowID,unsigned char **lppKey,unsigned char **lppValue)
+{
+    int32_t found;
+    unsigned char *ptr;
+    
+    ptr=m_Rows->GetRow(RowID);
+    *lppKey=ptr;
+    memcpy(&found,ptr+m_Header.m_KeySize,sizeof(int32_t));
+    *lppValue=ptr+m_Header.m_KeySize+sizeof(int32_t);
+    
+    return found;
+}
+
+int mc_BlockUndo::GetSize()
+{
+    return sizeof(mc_BlockUndoHeader)+m_Rows->GetCount()*m_Rows->m_RowSize;
+}
+
+void mc_BlockUndo::Serialize(unsigned char *lpDest)
+{
+    m_Header.m_Count=m_Rows->GetCount();
+    memcpy(lpDest,&m_Header,sizeof(mc_BlockUndoHeader));
+    if(m_Header.m_Count)
+    {
+        memcpy(lpDest+sizeof(mc_BlockUndoHeader),m_Rows->GetRow(0),m_Header.m_Count*m_Rows->m_RowSize);
+    }
+}
+
+int mc_BlockUndo::Load(const unsigned char *lpSrc,int size)
+{
+    int i,err;
+    mc_BlockUndoHeader header;
+    
+    if(size < (int)sizeof(mc_BlockUndoHeader))
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    memcpy(&header,lpSrc,sizeof(mc_BlockUndoHeader));
+    if( (header.m_Version != 1) || (header.m_KeySize != m_Header.m_KeySize) || (header.m_ValueSize != m_Header.m_ValueSize) || (header.m_Count < 0) )
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    if(size != (int)sizeof(mc_BlockUndoHeader)+header.m_Count*m_Rows->m_RowSize)
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    Reset(header.m_Block,header.m_Row,header.m_Pos);
+    for(i=0;i<header.m_Count;i++)
+    {
+        err=m_Rows->Add(lpSrc+sizeof(mc_BlockUndoHeader)+i*m_Rows->m_RowSize);
+        if(err)
+        {
+            return err;
+        }
+    }
+    m_Header.m_Count=m_Rows->GetCount();
+    
+    return MC_ERR_NOERROR;
+}
+
 void mc_List::Zero()
 {
     m_lpData=NULL;   
@@ -693,11 +950,20 @@ int mc_List::Destroy()
         mc_Delete(m_lpData);
     }
     
+    mc_MemAccount(m_MemTag,-(int64_t)m_AllocSize);
+    
     Zero();
     
     return MC_ERR_NOERROR;
 }
 
+void mc_List::SetMemTag(int tag)
+{
+    mc_MemAccount(m_MemTag,-(int64_t)m_AllocSize);
+    m_MemTag=tag;
+    mc_MemAccount(m_MemTag,m_AllocSize);
+}
+
 void mc_List::Clear()
 {
     m_Size=0;
@@ -754,6 +1020,7 @@ int mc_List::Put(unsigned char *ptr, int size)
             m_lpData=NULL;                    
         }
         
+        mc_MemAccount(m_MemTag,NewSize-m_AllocSize);
         m_AllocSize=NewSize;
         m_lpData=NewBuffer;        
     }
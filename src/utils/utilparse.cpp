@@ -28,6 +28,11 @@ const unsigned char* GetAddressIDPtr(const CTxDestination& address)
 }
 
 bool mc_ExtractOutputAssetQuantities(mc_Buffer *assets,string& reason,bool with_followons)
+{
+    return mc_ExtractOutputAssetQuantities(mc_gState->m_TmpScript,assets,reason,with_followons);
+}
+
+bool mc_ExtractOutputAssetQuantities(mc_Script *script,mc_Buffer *assets,string& reason,bool with_followons)
 {
     int err;
     uint32_t script_type=MC_SCR_ASSET_SCRIPT_TYPE_TRANSFER;
@@ -35,10 +40,10 @@ bool mc_ExtractOutputAssetQuantities(mc_Buffer *assets,string& reason,bool with_
     {        
         script_type |= MC_SCR_ASSET_SCRIPT_TYPE_FOLLOWON | MC_SCR_ASSET_SCRIPT_TYPE_TOKEN;
     }
-    for (int e = 0; e < mc_gState->m_TmpScript->GetNumElements(); e++)
+    for (int e = 0; e < script->GetNumElements(); e++)
     {
-        mc_gState->m_TmpScript->SetElement(e);
-        err=mc_gState->m_TmpScript->GetAssetQuantities(assets,script_type);
+        script->SetElement(e);
+        err=script->GetAssetQuantities(assets,script_type);
         if((err != MC_ERR_NOERROR) && (err != MC_ERR_WRONG_SCRIPT))
         {
             reason="Asset transfer script rejected - error in output transfer script";
@@ -24,6 +24,7 @@ bool FindFollowOnsInScript(const CScript& script1,mc_Buffer *amounts,mc_Script *
 int CheckRequiredPermissions(const CTxDestination& addressRet,int expected_allowed,std::map<uint32_t, uint256>* mapSpecialEntity,std::string* strFailReason);
 bool mc_VerifyAssetPermissions(mc_Buffer *assets, std::vector<CTxDestination> addressRets, int required_permissions, uint32_t permission, std::string& reason);
 bool mc_ExtractOutputAssetQuantities(mc_Buffer *assets,std::string& reason,bool with_followons);
+bool mc_ExtractOutputAssetQuantities(mc_Script *script,mc_Buffer *assets,std::string& reason,bool with_followons);
 
 
 #endif	/* MULTICHAINUTILS_H */
@@ -5,8 +5,9 @@
 #include "wallet/chunkcollector.h"
 
 #define MC_IMPOSSIBLE_NEXT_ATTEMPT 0xFFFFFFFF
-#define MC_CCW_KBS_PER_SECOND_DELAY_UP         60000
-#define MC_CCW_KBS_PER_SECOND_DELAY_DOWN       15000
+#define MC_CCW_KBS_PER_SECOND_DELAY_DOWN        2000
+
+static CCriticalSection cs_ChunkRate;                                           // Per-peer rate state, no other lock is taken while it is held
 
 void mc_ChunkEntityKey::Zero()
 {
@@ -150,49 +151,174 @@ int mc_ChunkCollector::Lock(int write_mode,int allow_secondary)
     return 0;
 }
 
+/*
+ * Per-peer request window, in the spirit of BBR: delivery rate is measured as bytes delivered over intervals of at least one round trip,
+ * path delay (round trip less transfer time) is sampled from chunk responses, the window is MC_CCW_WINDOW_GAIN bandwidth-delay products, capped by what can be delivered before request timeout.
+ * Window doubles on every response while the rate keeps growing (startup), failures and timeouts halve it.
+ */
+
 void mc_ChunkCollector::AdjustKBPerDestination(CNode *pfrom,bool success)
 {
     int64_t time_now=GetTimeMillis();
-    if(pfrom->nMaxKBPerDestination == 0)
-    {
-        pfrom->nMaxKBPerDestination=m_MaxKBPerDestination;
-    }
+    int64_t rtt,window_time,interval;
+    int bytes,rate,target,old_kb_per_destination;
+    bool rate_sample;
+    int bandwidth=0;
+    int seconds_per_request=m_TimeoutRequest-MC_CCW_TIMEOUT_REQUEST_SHIFT;
     
-    if(success)
     {
-        if(pfrom->nMaxKBPerDestination >= m_MaxMaxKBPerDestination)
+        LOCK(cs_ChunkRate);
+        if(pfrom->nMaxKBPerDestination == 0)
         {
-            return;
+            pfrom->nMaxKBPerDestination=m_MinMaxKBPerDestination;
+                                                                                // Configured rate until the first sample, dropped by first filter window shift
+            pfrom->nChunkBandwidth[1]=m_MaxMaxKBPerDestination/seconds_per_request;
         }
-        if( (time_now - pfrom->nLastKBPerDestinationChangeTimestamp) < MC_CCW_KBS_PER_SECOND_DELAY_UP )
+        old_kb_per_destination=pfrom->nMaxKBPerDestination;
+
+        if(success)
         {
-            return;
+            if(pfrom->nChunkRTTSample == 0)                                     // Not a chunk response
+            {
+                return;
+            }
+            rtt=pfrom->nChunkRTTSample;
+            bytes=pfrom->nChunkBytesSample;
+            pfrom->nChunkRTTSample=0;
+            pfrom->nChunkBytesSample=0;
+            pfrom->nChunkDelivered+=bytes;
+
+            pfrom->nChunkSRTT=pfrom->nChunkSRTT ? (7*pfrom->nChunkSRTT+rtt)/8 : rtt;
+
+            rate_sample=false;                                                  // Delivery rate is measured over interval covering many responses,
+                                                                                // single response round trip includes queueing and says little about rate
+            if(pfrom->nChunkRateTimestamp == 0)
+            {
+                pfrom->nChunkRateTimestamp=time_now-rtt;
+                pfrom->nChunkRateDelivered=pfrom->nChunkDelivered-bytes;
+            }
+            interval=time_now-pfrom->nChunkRateTimestamp;
+            if(interval > MC_CCW_BANDWIDTH_WINDOW)                              // Peer was idle, interval says nothing about the path
+            {
+                pfrom->nChunkRateTimestamp=time_now-rtt;
+                pfrom->nChunkRateDelivered=pfrom->nChunkDelivered-bytes;
+                interval=rtt;
+            }
+            if(interval >= max(pfrom->nChunkSRTT,(int64_t)MC_CCW_RATE_INTERVAL))
+            {
+                rate=(int)(((pfrom->nChunkDelivered-pfrom->nChunkRateDelivered)*1000)/(1024*interval));
+                pfrom->nChunkRateTimestamp=time_now;
+                pfrom->nChunkRateDelivered=pfrom->nChunkDelivered;
+                rate_sample=true;
+                
+                if(time_now - pfrom->nChunkBandwidthTimestamp > MC_CCW_BANDWIDTH_WINDOW)
+                {
+                    pfrom->nChunkBandwidth[1]=pfrom->nChunkBandwidth[0];
+                    pfrom->nChunkBandwidth[0]=0;
+                    pfrom->nChunkBandwidthTimestamp=time_now;
+                }
+                if(rate > pfrom->nChunkBandwidth[0])
+                {
+                    pfrom->nChunkBandwidth[0]=rate;
+                }
+            }
+            bandwidth=max(pfrom->nChunkBandwidth[0],pfrom->nChunkBandwidth[1]);
+            
+            if(bandwidth > 0)
+            {
+                rtt-=((int64_t)bytes*1000)/(1024*(int64_t)bandwidth);           // Response transfer time is not part of the path delay
+            }
+            if(rtt <= 0)
+            {
+                rtt=1;
+            }
+            if( (pfrom->nChunkMinRTT == 0) || (rtt <= pfrom->nChunkMinRTT) || 
+                (time_now - pfrom->nChunkMinRTTTimestamp > MC_CCW_RTT_WINDOW) )
+            {
+                pfrom->nChunkMinRTT=rtt;
+                pfrom->nChunkMinRTTTimestamp=time_now;
+            }
+
+            window_time=max(pfrom->nChunkMinRTT,(int64_t)MC_CCW_MIN_WINDOW_TIME);
+            target=(int)(((int64_t)bandwidth*MC_CCW_WINDOW_GAIN*window_time)/1000);
+            if(target > bandwidth*seconds_per_request)                          // The whole window should arrive before request timeout
+            {
+                target=bandwidth*seconds_per_request;
+            }
+            if(pfrom->nChunkBandwidthTimestamp == 0)                            // No rate sample yet, seeded rate only lets the window double
+            {
+                if(target > 2*pfrom->nMaxKBPerDestination)
+                {
+                    target=2*pfrom->nMaxKBPerDestination;
+                }
+            }
+
+            if(pfrom->nChunkStartupRounds >= 0)
+            {
+                if(rate_sample)
+                {
+                    if(bandwidth >= pfrom->nChunkStartupBandwidth + pfrom->nChunkStartupBandwidth/4)
+                    {
+                        pfrom->nChunkStartupBandwidth=bandwidth;
+                        pfrom->nChunkStartupRounds=0;
+                    }
+                    else
+                    {
+                        pfrom->nChunkStartupRounds++;
+                    }
+                }
+                if(pfrom->nChunkStartupRounds >= MC_CCW_STARTUP_ROUNDS)
+                {
+                    pfrom->nChunkStartupRounds=-1;
+                }
+                else
+                {
+                    if(target < 2*pfrom->nMaxKBPerDestination)
+                    {
+                        target=2*pfrom->nMaxKBPerDestination;
+                    }
+                }
+            }
+            pfrom->nMaxKBPerDestination=target;
+        }
+        else
+        {
+            if( (time_now - pfrom->nLastKBPerDestinationChangeTimestamp) < max(2*pfrom->nChunkSRTT,(int64_t)MC_CCW_KBS_PER_SECOND_DELAY_DOWN) )
+            {
+                return;
+            }
+            pfrom->nLastKBPerDestinationChangeTimestamp=time_now;        
+            pfrom->nChunkTimeouts++;
+            pfrom->nChunkStartupRounds=-1;
+            pfrom->nChunkBandwidth[0]/=2;
+            pfrom->nChunkBandwidth[1]/=2;
+            pfrom->nMaxKBPerDestination /= 2;
         }
-        pfrom->nMaxKBPerDestination *= 2;
+
         if(pfrom->nMaxKBPerDestination >= m_MaxMaxKBPerDestination)
         {
             pfrom->nMaxKBPerDestination = m_MaxMaxKBPerDestination;
         }
-    }
-    else
-    {
         if(pfrom->nMaxKBPerDestination <= m_MinMaxKBPerDestination)
+        {
+            pfrom->nMaxKBPerDestination = m_MinMaxKBPerDestination;
+        }        
+        if(pfrom->nMaxKBPerDestination == old_kb_per_destination)
         {
             return;
         }
-        if( (time_now - pfrom->nLastKBPerDestinationChangeTimestamp) < MC_CCW_KBS_PER_SECOND_DELAY_DOWN )
+        if(success)
         {
-            return;
+            if(fDebug)LogPrint("chunks","Adjusted offchain request window for peer %d to %dKB, rate: %dKB/s, rtt: %dms (min %dms)%s\n",pfrom->id,pfrom->nMaxKBPerDestination,
+                    bandwidth,(int)pfrom->nChunkSRTT,(int)pfrom->nChunkMinRTT,(pfrom->nChunkStartupRounds >= 0) ? ", startup" : "");
         }
-        pfrom->nMaxKBPerDestination /= 2;
-        if(pfrom->nMaxKBPerDestination <= m_MinMaxKBPerDestination)
+        else
         {
-            pfrom->nMaxKBPerDestination = m_MinMaxKBPerDestination;
-        }        
+            if(fDebug)LogPrint("chunks","Adjusted offchain request window for peer %d on failure to %dKB\n",pfrom->id,pfrom->nMaxKBPerDestination);
+        }
     }
-    pfrom->nLastKBPerDestinationChangeTimestamp=time_now;        
+    
     int max_kb_per_destination=0;
-    LogPrintf("Adjusted offchain processing rate for peer %d on %s to %dMB\n",pfrom->id,(success ? "success" : "failure"),pfrom->nMaxKBPerDestination/1024);
     {
         LOCK(cs_vNodes);
         BOOST_FOREACH(CNode* pnode, vNodes)
@@ -206,7 +332,7 @@ void mc_ChunkCollector::AdjustKBPerDestination(CNode *pfrom,bool success)
     if(max_kb_per_destination != m_MaxKBPerDestination)
     {
         m_MaxKBPerDestination=max_kb_per_destination;
-        LogPrintf("Adjusted global offchain processing rate on %s to %dMB\n",(success ? "success" : "failure"),m_MaxKBPerDestination/1024);        
+        if(fDebug)LogPrint("chunks","Adjusted global offchain request window on %s to %dKB\n",(success ? "success" : "failure"),m_MaxKBPerDestination);        
     }
 }
 
@@ -571,10 +697,13 @@ int mc_ChunkCollector::Initialize(mc_ChunkDB *chunk_db,const char *name,uint32_t
     
     m_MarkPool=new mc_Buffer;                                                
     err=m_MarkPool->Initialize(m_KeySize,m_TotalSize,MC_BUF_MODE_DEFAULT);
+    m_MarkPool->SetMemTag(MC_MEM_TAG_CHUNKCOLLECTOR);
     m_MemPool1=new mc_Buffer;                                                
     err=m_MemPool1->Initialize(m_KeySize,m_TotalSize,MC_BUF_MODE_MAP);
+    m_MemPool1->SetMemTag(MC_MEM_TAG_CHUNKCOLLECTOR);
     m_MemPool2=new mc_Buffer;                                                
     err=m_MemPool2->Initialize(m_KeySize,m_TotalSize,MC_BUF_MODE_MAP);
+    m_MemPool2->SetMemTag(MC_MEM_TAG_CHUNKCOLLECTOR);
     
     m_MemPool=m_MemPool1;
 
@@ -32,6 +32,12 @@
 #define MC_CCW_MIN_KBS_PER_SECOND                128
 #define MC_CCW_MAX_DELAY_BETWEEN_COLLECTS       1000
 #define MC_CCW_QUERY_SPLIT                         4
+#define MC_CCW_RTT_WINDOW                      10000                            // Min RTT validity, ms
+#define MC_CCW_BANDWIDTH_WINDOW                10000                            // Max delivery rate filter window, ms
+#define MC_CCW_RATE_INTERVAL                    1000                            // Min interval delivery rate is measured over, ms
+#define MC_CCW_MIN_WINDOW_TIME                  1000                            // Min time covered by request window, ms
+#define MC_CCW_WINDOW_GAIN                         2                            // Request window, in bandwidth-delay products
+#define MC_CCW_STARTUP_ROUNDS                      3                            // Responses without 25% rate growth before startup ends
 #define MC_CCW_MAX_ITEMS_PER_CHUNKFOR_CHECK       16
 #define MC_CCW_MAX_EF_SIZE                     65536
 
@@ -208,7 +214,7 @@ typedef struct mc_ChunkCollector
     int CopyFlags();    
     int FillMarkPoolByHash(const unsigned char *hash);    
     int FillMarkPoolByFlag(uint32_t flag, uint32_t not_flag);    
-    void AdjustKBPerDestination(CNode* pfrom,bool success);
+    void AdjustKBPerDestination(CNode* pfrom,bool success);                     // Updates peer request window from the last chunk response or failure
         
     int Commit();                                                      
     int CommitInternal(int fill_mempool); 
@@ -5,9 +5,16 @@
 #include "wallet/chunkdb.h"
 #include "community/community.h"
 
+#include <deque>
+#include <boost/thread.hpp>
+
 #define MC_CDB_TMP_FLAG_SHOULD_COMMIT           0x00000001
 #define MC_CDB_FILE_PAGE_SIZE                   0x00100000
 
+#define MC_CDB_RAB_EMPTY                        0
+#define MC_CDB_RAB_PENDING                      1
+#define MC_CDB_RAB_READY                        2
+
 unsigned char null_txid[MC_TDB_TXID_SIZE];
 
 void mc_SubscriptionFileDBRow::Zero()
@@ -46,6 +53,318 @@ void mc_ChunkDBRow::SwapPosBytes()
     ptr[2]=t;
 }
 
+void mc_ChunkDBReadAheadStats::Zero()
+{
+    memset(this,0,sizeof(mc_ChunkDBReadAheadStats));        
+}
+
+/** Read-ahead block, filled by background thread while PENDING, read by consumers when READY */
+
+typedef struct mc_ChunkDBReadBlock
+{
+    int32_t m_SubscriptionID;
+    int32_t m_FileID;
+    uint32_t m_Offset;
+    uint32_t m_Size;
+    uint32_t m_Status;
+    uint32_t m_Generation;                                                      // Incremented on invalidation, stale reads are discarded
+    uint64_t m_LastUsed;
+    char m_FileName[MC_DCT_DB_MAX_PATH];
+    unsigned char *m_Data;
+} mc_ChunkDBReadBlock;
+
+/** Last read of the subscription, used for sequential access detection */
+
+typedef struct mc_ChunkDBReadStream
+{
+    int32_t m_SubscriptionID;
+    int32_t m_FileID;
+    uint32_t m_NextOffset;
+    uint32_t m_SequentialReads;
+    uint64_t m_LastUsed;
+} mc_ChunkDBReadStream;
+
+struct mc_ChunkDBReadAhead
+{
+    boost::mutex m_Mutex;
+    boost::condition_variable m_Cond;
+    boost::thread *m_Thread;
+    int m_Stopping;
+    
+    int m_BlockCount;
+    mc_ChunkDBReadBlock *m_Blocks;
+    mc_ChunkDBReadStream m_Streams[MC_CDB_READ_AHEAD_STREAMS];
+    std::deque<int> m_Requests;
+    uint64_t m_Clock;
+    mc_ChunkDBReadAheadStats m_Stats;
+
+    mc_ChunkDBReadAhead(int block_count);
+    ~mc_ChunkDBReadAhead();
+    
+    void Loop();
+    int Read(int32_t subscription_id,int32_t fileid,uint32_t offset,uint32_t size,unsigned char *buf);
+    void NoteRead(int32_t subscription_id,int32_t fileid,const char *FileName,uint32_t offset,uint32_t size);
+    void Invalidate(int32_t subscription_id,int32_t fileid);
+    int FindBlock(int32_t subscription_id,int32_t fileid,uint32_t offset);
+};
+
+mc_ChunkDBReadAhead::mc_ChunkDBReadAhead(int block_count)
+{
+    m_Stopping=0;
+    m_Clock=0;
+    m_BlockCount=block_count;
+    m_Blocks=new mc_ChunkDBReadBlock[m_BlockCount];
+    for(int i=0;i<m_BlockCount;i++)
+    {
+        memset(m_Blocks+i,0,sizeof(mc_ChunkDBReadBlock));
+        m_Blocks[i].m_Data=new unsigned char[MC_CDB_READ_AHEAD_BLOCK_SIZE];
+    }
+    memset(m_Streams,0,sizeof(m_Streams));
+    m_Stats.Zero();
+    m_Stats.m_Blocks=m_BlockCount;
+    m_Thread=new boost::thread(boost::bind(&mc_ChunkDBReadAhead::Loop, this));
+}
+
+mc_ChunkDBReadAhead::~mc_ChunkDBReadAhead()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(m_Mutex);
+        m_Stopping=1;
+        m_Cond.notify_all();
+    }
+    m_Thread->join();
+    delete m_Thread;
+    for(int i=0;i<m_BlockCount;i++)
+    {
+        delete [] m_Blocks[i].m_Data;
+    }
+    delete [] m_Blocks;
+}
+
+void mc_ChunkDBReadAhead::Loop()
+{
+    char FileName[MC_DCT_DB_MAX_PATH];
+    int FileHan;
+    int block;
+    uint32_t offset,generation;
+    int bytes_read;
+    
+    while(true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_Mutex);
+            while(!m_Stopping && m_Requests.empty())
+            {
+                m_Cond.wait(lock);
+            }
+            if(m_Stopping)
+            {
+                return;
+            }
+            block=m_Requests.front();
+            m_Requests.pop_front();
+            if(m_Blocks[block].m_Status != MC_CDB_RAB_PENDING)                  // Block was queued again or recycled before this request was served
+            {
+                continue;
+            }
+            strcpy(FileName,m_Blocks[block].m_FileName);
+            offset=m_Blocks[block].m_Offset;
+            generation=m_Blocks[block].m_Generation;
+        }
+        
+        bytes_read=-1;                                                          // PENDING blocks are not touched by readers, data is read without lock
+        FileHan=open(FileName,_O_BINARY | O_RDONLY, S_IRUSR | S_IWUSR);
+        if(FileHan>0)
+        {
+            if(lseek64(FileHan,offset,SEEK_SET) == offset)
+            {
+                bytes_read=read(FileHan,m_Blocks[block].m_Data,MC_CDB_READ_AHEAD_BLOCK_SIZE);
+            }
+            close(FileHan);
+        }
+        
+        {
+            boost::unique_lock<boost::mutex> lock(m_Mutex);
+            mc_ChunkDBReadBlock *rab=m_Blocks+block;
+            if( (rab->m_Generation == generation) && (rab->m_Status == MC_CDB_RAB_PENDING) )
+            {
+                if(bytes_read > 0)
+                {
+                    rab->m_Size=bytes_read;
+                    rab->m_Status=MC_CDB_RAB_READY;
+                    m_Stats.m_PrefetchedBytes+=bytes_read;
+                }
+                else
+                {
+                    rab->m_Status=MC_CDB_RAB_EMPTY;
+                }
+            }
+        }
+    }
+}
+
+int mc_ChunkDBReadAhead::FindBlock(int32_t subscription_id,int32_t fileid,uint32_t offset)
+{
+    for(int i=0;i<m_BlockCount;i++)
+    {
+        mc_ChunkDBReadBlock *rab=m_Blocks+i;
+        if( (rab->m_Status != MC_CDB_RAB_EMPTY) && (rab->m_SubscriptionID == subscription_id) && (rab->m_FileID == fileid) )
+        {
+            if( (offset >= rab->m_Offset) && (offset < rab->m_Offset+rab->m_Size) )
+            {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+int mc_ChunkDBReadAhead::Read(int32_t subscription_id,int32_t fileid,uint32_t offset,uint32_t size,unsigned char *buf)
+{
+    boost::unique_lock<boost::mutex> lock(m_Mutex);
+    m_Clock++;
+    while(size > 0)                                                             // Read may span adjacent blocks
+    {
+        int block=FindBlock(subscription_id,fileid,offset);
+        if( (block < 0) || (m_Blocks[block].m_Status != MC_CDB_RAB_READY) )
+        {
+            m_Stats.m_Misses++;
+            return 0;
+        }
+        mc_ChunkDBReadBlock *rab=m_Blocks+block;
+        uint32_t bytes=rab->m_Offset+rab->m_Size-offset;
+        if(bytes > size)
+        {
+            bytes=size;
+        }
+        memcpy(buf,rab->m_Data+(offset-rab->m_Offset),bytes);
+        rab->m_LastUsed=m_Clock;
+        buf+=bytes;
+        offset+=bytes;
+        size-=bytes;
+    }
+    m_Stats.m_Hits++;
+    return 1;
+}
+
+void mc_ChunkDBReadAhead::NoteRead(int32_t subscription_id,int32_t fileid,const char *FileName,uint32_t offset,uint32_t size)
+{
+    boost::unique_lock<boost::mutex> lock(m_Mutex);
+    mc_ChunkDBReadStream *stream=NULL;
+    mc_ChunkDBReadStream *oldest=m_Streams;
+    int sequential=0;
+    
+    m_Clock++;
+    for(int i=0;i<MC_CDB_READ_AHEAD_STREAMS;i++)
+    {
+        if( (m_Streams[i].m_LastUsed != 0) && (m_Streams[i].m_SubscriptionID == subscription_id) )
+        {
+            stream=m_Streams+i;
+        }
+        if(m_Streams[i].m_LastUsed < oldest->m_LastUsed)
+        {
+            oldest=m_Streams+i;
+        }
+    }
+    
+    if(stream)
+    {
+        if( (stream->m_FileID == fileid) && (offset >= stream->m_NextOffset) && (offset < stream->m_NextOffset+MC_CDB_READ_AHEAD_BLOCK_SIZE) )
+        {
+            sequential=1;
+        }
+        if( (stream->m_FileID+1 == fileid) && (offset < MC_CDB_READ_AHEAD_BLOCK_SIZE) )
+        {
+            sequential=1;
+        }
+    }
+    else
+    {
+        stream=oldest;
+        memset(stream,0,sizeof(mc_ChunkDBReadStream));
+        stream->m_SubscriptionID=subscription_id;
+    }
+    
+    stream->m_SequentialReads = sequential ? stream->m_SequentialReads+1 : 0;
+    stream->m_FileID=fileid;
+    stream->m_NextOffset=offset+size;
+    stream->m_LastUsed=m_Clock;
+    
+    if(stream->m_SequentialReads == 0)                                          // Random access, nothing to prefetch
+    {
+        return;
+    }
+    
+    uint32_t pos=stream->m_NextOffset;
+    for(int k=0;k<MC_CDB_READ_AHEAD_WINDOW;k++)
+    {
+        int block=FindBlock(subscription_id,fileid,pos);
+        if(block >= 0)
+        {
+            if( (m_Blocks[block].m_Status == MC_CDB_RAB_READY) && (m_Blocks[block].m_Size < MC_CDB_READ_AHEAD_BLOCK_SIZE) )
+            {
+                return;                                                         // End of file
+            }
+            pos=m_Blocks[block].m_Offset+m_Blocks[block].m_Size;
+            continue;
+        }
+        
+        mc_ChunkDBReadBlock *victim=NULL;
+        for(int i=0;i<m_BlockCount;i++)
+        {
+            mc_ChunkDBReadBlock *rab=m_Blocks+i;
+            if(rab->m_Status == MC_CDB_RAB_EMPTY)
+            {
+                victim=rab;
+                break;
+            }
+            if(rab->m_Status == MC_CDB_RAB_READY)
+            {
+                if( (victim == NULL) || (rab->m_LastUsed < victim->m_LastUsed) )
+                {
+                    victim=rab;
+                }
+            }
+        }
+        if( (victim == NULL) || (victim->m_LastUsed == m_Clock) )
+        {
+            return;
+        }
+        
+        victim->m_SubscriptionID=subscription_id;
+        victim->m_FileID=fileid;
+        victim->m_Offset=pos;
+        victim->m_Size=MC_CDB_READ_AHEAD_BLOCK_SIZE;
+        victim->m_Status=MC_CDB_RAB_PENDING;
+        victim->m_Generation++;
+        victim->m_LastUsed=m_Clock;
+        strcpy(victim->m_FileName,FileName);
+        m_Requests.push_back(victim-m_Blocks);
+        m_Stats.m_Prefetched++;
+        m_Cond.notify_one();
+        
+        pos+=MC_CDB_READ_AHEAD_BLOCK_SIZE;
+    }
+}
+
+void mc_ChunkDBReadAhead::Invalidate(int32_t subscription_id,int32_t fileid)
+{
+    boost::unique_lock<boost::mutex> lock(m_Mutex);
+    for(int i=0;i<m_BlockCount;i++)
+    {
+        mc_ChunkDBReadBlock *rab=m_Blocks+i;
+        if( (rab->m_Status != MC_CDB_RAB_EMPTY) && (rab->m_SubscriptionID == subscription_id) )
+        {
+            if( (fileid < 0) || (rab->m_FileID == fileid) )
+            {
+                rab->m_Status=MC_CDB_RAB_EMPTY;
+                rab->m_Generation++;
+                m_Stats.m_Invalidated++;
+            }
+        }
+    }
+}
+
 void mc_ChunkDB::LogString(const char *message)
 {
     FILE *fHan;
@@ -82,6 +401,7 @@ void mc_ChunkDB::Zero()
     
     m_Semaphore=NULL;
     m_LockedBy=0;    
+    m_ReadAhead=NULL;
 }
 
 int mc_ChunkDB::Destroy()
@@ -123,6 +443,11 @@ int mc_ChunkDB::Destroy()
         delete m_ThreadTmpScripts;
     }
     
+    if(m_ReadAhead)
+    {
+        delete m_ReadAhead;
+    }
+    
     if(m_Semaphore)
     {
         __US_SemDestroy(m_Semaphore);
@@ -614,6 +939,10 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
     }
     
     m_Subscriptions->PutRow(old_subscription->m_SubscriptionID,&subscription,(char*)&subscription+m_ValueOffset);
+    if(m_ReadAhead)
+    {
+        m_ReadAhead->Invalidate(old_subscription->m_SubscriptionID,-1);
+    }
     
     sprintf(msg,"Entity (%08X, %s) unlinked successfully",entity->m_EntityType,enthex);
     LogString(msg);
@@ -900,6 +1229,7 @@ int mc_ChunkDB::Initialize(const char *name,uint32_t mode)
     m_Subscriptions=new mc_Buffer;
     
     m_Subscriptions->Initialize(m_KeySize,sizeof(mc_SubscriptionDBRow),MC_BUF_MODE_MAP);    
+    m_Subscriptions->SetMemTag(MC_MEM_TAG_CHUNKDB);
     
     
     subscription.Zero();
@@ -999,8 +1329,10 @@ int mc_ChunkDB::Initialize(const char *name,uint32_t mode)
     
     m_MemPool=new mc_Buffer;                                                // Key - entity with m_Pos set to 0 + txid
     err=m_MemPool->Initialize(m_KeySize,m_TotalSize,MC_BUF_MODE_MAP);
+    m_MemPool->SetMemTag(MC_MEM_TAG_CHUNKDB);
     
     m_ChunkData=new mc_Script();
+    m_ChunkData->SetMemTag(MC_MEM_TAG_CHUNKDB);
     m_ChunkData->Clear();
    
     m_TmpScript=new mc_Script;
@@ -1019,6 +1351,12 @@ int mc_ChunkDB::Initialize(const char *name,uint32_t mode)
         return MC_ERR_INTERNAL_ERROR;
     }
 
+    int read_ahead_size=(int)GetArg("-chunkreadahead",MC_CDB_DEFAULT_READ_AHEAD_SIZE);
+    if(read_ahead_size > 0)
+    {
+        m_ReadAhead=new mc_ChunkDBReadAhead(read_ahead_size*1024*1024/MC_CDB_READ_AHEAD_BLOCK_SIZE);
+    }
+    
     Dump("Initialize");
     
     sprintf(msg, "Initialized. Chunks: %d",m_DBStat.m_Count);
@@ -1816,12 +2154,6 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
         subscription=(mc_SubscriptionDBRow *)m_Subscriptions->GetRow(subscription_id);
         SetFileName(FileName,subscription,chunk_def->m_InternalFileID);
      
-        FileHan=open(FileName,_O_BINARY | O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-        if(FileHan<=0)
-        {
-            return NULL;
-        }
-        
         if(chunk_def->m_HeaderSize >=0x80000000)                                // Fixing the overflow bug if data is not written
         {
             chunk_def->m_HeaderSize+=chunk_def->m_Size;
@@ -1833,17 +2165,13 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
         {            
             if(salt)
             {
-                if(lseek64(FileHan,read_from,SEEK_SET) != (int)read_from)
-                {
-                    goto exitlbl;
-                }
                 tmpscript->Clear();
                 if(tmpscript->Resize(bytes_to_read,1))
                 {
                     goto exitlbl;                                
                 }
     
-                if(read(FileHan,tmpscript->m_lpData,bytes_to_read) != (int)bytes_to_read)
+                if(ReadFileData(subscription_id,chunk_def->m_InternalFileID,FileName,&FileHan,read_from,bytes_to_read,tmpscript->m_lpData))
                 {
                     goto exitlbl;
                 }
@@ -1858,22 +2186,22 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
             }
         }
         
-        if(lseek64(FileHan,read_from,SEEK_SET) != (int)read_from)
-        {
-            goto exitlbl;
-        }
-        
         tmpscript->Clear();
         if(tmpscript->Resize(bytes_to_read,1))
         {
             goto exitlbl;            
         }
     
-        if(read(FileHan,tmpscript->m_lpData,bytes_to_read) != (int)bytes_to_read)
+        if(ReadFileData(subscription_id,chunk_def->m_InternalFileID,FileName,&FileHan,read_from,bytes_to_read,tmpscript->m_lpData))
         {
             goto exitlbl;
         }
         
+        if(m_ReadAhead)
+        {
+            m_ReadAhead->NoteRead(subscription_id,chunk_def->m_InternalFileID,FileName,read_from,bytes_to_read);
+        }
+        
         ptr=tmpscript->m_lpData;        
         if(bytes)
         {
@@ -1908,6 +2236,64 @@ unsigned char *mc_ChunkDB::GetChunk(mc_ChunkDBRow *chunk_def,
 }
 
 
+int mc_ChunkDB::ReadFileData(int32_t subscription_id,
+                             int32_t fileid,
+                             const char *FileName,
+                             int *FileHan,
+                             uint32_t offset,
+                             uint32_t size,
+                             unsigned char *buf)
+{
+    if(m_ReadAhead)
+    {
+        if(m_ReadAhead->Read(subscription_id,fileid,offset,size,buf))
+        {
+            return MC_ERR_NOERROR;
+        }
+    }
+    
+    if(*FileHan <= 0)
+    {
+        *FileHan=open(FileName,_O_BINARY | O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+        if(*FileHan <= 0)
+        {
+            *FileHan=0;
+            return MC_ERR_INTERNAL_ERROR;
+        }
+    }
+    
+    if(lseek64(*FileHan,offset,SEEK_SET) != (int)offset)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    if(read(*FileHan,buf,size) != (int)size)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+void mc_ChunkDB::GetReadAheadStats(mc_ChunkDBReadAheadStats *stats)
+{
+    stats->Zero();
+    if(m_ReadAhead == NULL)
+    {
+        return;
+    }
+    
+    boost::unique_lock<boost::mutex> lock(m_ReadAhead->m_Mutex);
+    *stats=m_ReadAhead->m_Stats;
+    for(int i=0;i<m_ReadAhead->m_BlockCount;i++)
+    {
+        if(m_ReadAhead->m_Blocks[i].m_Status == MC_CDB_RAB_READY)
+        {
+            stats->m_Cached++;
+        }
+    }
+}
+
 int mc_ChunkDB::AddToFile(const void* chunk,                  
                           uint32_t size,
                           mc_SubscriptionDBRow *subscription,
@@ -1924,6 +2310,11 @@ int mc_ChunkDB::AddToFile(const void* chunk,
     tail[1]=MC_ENT_SPRM_FILE_END;
     tail[2]=0x00;
     
+    if(m_ReadAhead)
+    {
+        m_ReadAhead->Invalidate(subscription->m_SubscriptionID,fileid);      // Prefetched blocks may contain zero padding this chunk overwrites
+    }
+    
     mc_CreateDir(subscription->m_DirName);
     SetFileName(FileName,subscription,fileid);
     err=MC_ERR_NOERROR;
@@ -22,6 +22,10 @@
 #define MC_CDB_MAX_FILE_READ_BUFFER_SIZE 0x0100000                              // Maximal size of chunk pool before commit, 1MB
 #define MC_CDB_MAX_CHUNK_EXTRA_SIZE      1024 
 #define MC_CDB_MAX_MEMPOOL_SIZE          1024 
+#define MC_CDB_READ_AHEAD_BLOCK_SIZE     0x0100000                              // Size of read-ahead block, 1MB
+#define MC_CDB_READ_AHEAD_WINDOW         2                                      // Number of blocks prefetched ahead of sequential reader
+#define MC_CDB_READ_AHEAD_STREAMS        64                                     // Number of tracked readers
+#define MC_CDB_DEFAULT_READ_AHEAD_SIZE   16                                     // Default read-ahead cache size, MB
 
 #define MC_CDB_FLUSH_MODE_NONE        0x00000000
 #define MC_CDB_FLUSH_MODE_FILE        0x00000001
@@ -120,6 +124,22 @@ typedef struct mc_ChunkDBRow
 } mc_ChunkDBRow;
 
 
+/** Read-ahead statistics **/
+
+typedef struct mc_ChunkDBReadAheadStats
+{
+    int m_Blocks;                                                               // Total number of blocks
+    int m_Cached;                                                               // Number of blocks with data
+    int64_t m_Hits;                                                             // File reads served from cache
+    int64_t m_Misses;                                                           // File reads served from disk
+    int64_t m_Prefetched;                                                       // Number of prefetched blocks
+    int64_t m_PrefetchedBytes;                                                  // Number of prefetched bytes
+    int64_t m_Invalidated;                                                      // Blocks dropped because of file writes
+    void Zero();
+} mc_ChunkDBReadAheadStats;
+
+struct mc_ChunkDBReadAhead;
+
 /** Chunk DB **/
 
 typedef struct mc_ChunkDB
@@ -149,6 +169,8 @@ typedef struct mc_ChunkDB
     void *m_Semaphore;                                                          // mc_TxDB object semaphore
     uint64_t m_LockedBy;                                                        // ID of the thread locking it
     
+    mc_ChunkDBReadAhead *m_ReadAhead;                                           // Prefetch cache for sequential readers, NULL if disabled
+    
     mc_ChunkDB()
     {
         Zero();
@@ -249,6 +271,16 @@ typedef struct mc_ChunkDB
     
     int RestoreChunkIfNeeded(mc_ChunkDBRow *chunk_def);
     
+    int ReadFileData(int32_t subscription_id,                                   // Reads data file, from read-ahead cache if possible
+                     int32_t fileid,
+                     const char *FileName,
+                     int *FileHan,                                              // Opened on cache miss, should be closed by caller
+                     uint32_t offset,
+                     uint32_t size,
+                     unsigned char *buf);
+    
+    void GetReadAheadStats(mc_ChunkDBReadAheadStats *stats);
+    
     int AddToFile(const void *chunk,                  
                           uint32_t size,
                           mc_SubscriptionDBRow *subscription,
@@ -15,6 +15,8 @@
 #include <openssl/aes.h>
 #include <openssl/evp.h>
 
+int nWalletKeyCacheSize = DEFAULT_WALLET_KEY_CACHE_SIZE;
+
 bool CCrypter::SetKeyFromPassphrase(const SecureString& strKeyData, const std::vector<unsigned char>& chSalt, const unsigned int nRounds, const unsigned int nDerivationMethod)
 {
     if (nRounds < 1 || chSalt.size() != WALLET_CRYPTO_SALT_SIZE)
@@ -148,12 +150,27 @@ bool CCryptoKeyStore::Lock()
     {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        ClearDecryptedKeys();
     }
 
     NotifyStatusChanged(this);
     return true;
 }
 
+void CCryptoKeyStore::ClearDecryptedKeys() const
+{
+    // CKeyingMaterial buffers are cleansed by secure_allocator when released
+    mapDecryptedKeys.clear();
+}
+
+void CCryptoKeyStore::GetDecryptedKeyCacheStats(int& nSize,int64_t& nHits,int64_t& nMisses) const
+{
+    LOCK(cs_KeyStore);
+    nSize=(int)mapDecryptedKeys.size();
+    nHits=nDecryptedKeyHits;
+    nMisses=nDecryptedKeyMisses;
+}
+
 bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
 {
     {
@@ -198,6 +215,7 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
         if (keyFail || !keyPass)
             return false;
         vMasterKey = vMasterKeyIn;
+        ClearDecryptedKeys();
         fDecryptionThoroughlyChecked = true;
     }
     NotifyStatusChanged(this);
@@ -234,6 +252,7 @@ bool CCryptoKeyStore::AddCryptedKey(const CPubKey &vchPubKey, const std::vector<
             return false;
 
         mapCryptedKeys[vchPubKey.GetID()] = make_pair(vchPubKey, vchCryptedSecret);
+        mapDecryptedKeys.erase(vchPubKey.GetID());
     }
     return true;
 }
@@ -250,12 +269,33 @@ bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
         {
             const CPubKey &vchPubKey = (*mi).second.first;
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
+/* MCHN START */
+            if (vMasterKey.empty())
+                return false;
+            std::map<CKeyID, CKeyingMaterial>::const_iterator di = mapDecryptedKeys.find(address);
+            if (di != mapDecryptedKeys.end())
+            {
+                nDecryptedKeyHits++;
+                keyOut.Set((*di).second.begin(), (*di).second.end(), vchPubKey.IsCompressed());
+                return true;
+            }
+            nDecryptedKeyMisses++;
+/* MCHN END */
             CKeyingMaterial vchSecret;
             if (!DecryptSecret(vMasterKey, vchCryptedSecret, vchPubKey.GetHash(), vchSecret))
                 return false;
             if (vchSecret.size() != 32)
                 return false;
             keyOut.Set(vchSecret.begin(), vchSecret.end(), vchPubKey.IsCompressed());
+/* MCHN START */
+            int nCacheSize = (nDecryptedKeyCacheSize >= 0) ? nDecryptedKeyCacheSize : nWalletKeyCacheSize;
+            if (nCacheSize > 0)
+            {
+                if ((int)mapDecryptedKeys.size() >= nCacheSize)
+                    ClearDecryptedKeys();
+                mapDecryptedKeys[address] = vchSecret;
+            }
+/* MCHN END */
             return true;
         }
     }
@@ -15,6 +15,11 @@ class uint256;
 const unsigned int WALLET_CRYPTO_KEY_SIZE = 32;
 const unsigned int WALLET_CRYPTO_SALT_SIZE = 8;
 
+/** Default for -walletkeycache, maximal number of decrypted keys kept while wallet is unlocked */
+static const int DEFAULT_WALLET_KEY_CACHE_SIZE = 10000;
+
+extern int nWalletKeyCacheSize;
+
 /**
  * Private key encryption is done based on a CMasterKey,
  * which holds a salt and random encryption key.
@@ -128,7 +133,17 @@ private:
     //! keeps track of whether Unlock has run a thorough check before
     bool fDecryptionThoroughlyChecked;
 
+    //! decrypted keys of unlocked wallet, secrets are in locked memory, cleared on Lock() and Unlock()
+    mutable std::map<CKeyID, CKeyingMaterial> mapDecryptedKeys;
+    mutable int64_t nDecryptedKeyHits;
+    mutable int64_t nDecryptedKeyMisses;
+
+    void ClearDecryptedKeys() const;
+
 protected:
+    //! maximal size of decrypted key cache, -1 - use -walletkeycache
+    int nDecryptedKeyCacheSize;
+
     bool SetCrypted();
 
     //! will encrypt previously unencrypted keys
@@ -137,7 +152,7 @@ protected:
     bool Unlock(const CKeyingMaterial& vMasterKeyIn);
 
 public:
-    CCryptoKeyStore() : fUseCrypto(false), fDecryptionThoroughlyChecked(false)
+    CCryptoKeyStore() : fUseCrypto(false), fDecryptionThoroughlyChecked(false), nDecryptedKeyHits(0), nDecryptedKeyMisses(0), nDecryptedKeyCacheSize(-1)
     {
     }
 
@@ -174,6 +189,7 @@ public:
     }
     bool GetKey(const CKeyID &address, CKey& keyOut) const;
     bool GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const;
+    void GetDecryptedKeyCacheStats(int& nSize,int64_t& nHits,int64_t& nMisses) const;
     void GetKeys(std::set<CKeyID> &setAddress) const
     {
         if (!IsCrypted())
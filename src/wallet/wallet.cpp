@@ -19,6 +19,7 @@ extern mc_WalletTxs* pwalletTxsMain;
 #include "utils/timedata.h"
 #include "utils/util.h"
 #include "utils/utilmoneystr.h"
+#include "utils/notifyqueue.h"
 #include "community/community.h"
 
 #include <assert.h>
@@ -366,6 +367,9 @@ void CWallet::SetBestChain(const CBlockLocator& loc)
         CWalletDB walletdb(strWalletFile);
         walletdb.WriteBestBlock(loc);
     }
+/* MCHN START */    
+    SaveAssetGroups();
+/* MCHN END */    
 }
 
 bool CWallet::SetMinVersion(enum WalletFeature nVersion, CWalletDB* pwalletdbIn, bool fExplicit)
@@ -803,8 +807,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
 
         if ( !strCmd.empty())
         {
-            boost::replace_all(strCmd, "%s", wtxIn.GetHash().GetHex());
-            boost::thread t(runCommand, strCmd); // thread runs free
+            CNotifyEvent event(strCmd);
+            event.Set("%s", wtxIn.GetHash().GetHex());
+            QueueNotification(event);
         }
 
         UpdateUnspentList(wtx,true);
@@ -2630,13 +2635,21 @@ bool CWallet::CreateTransaction(const vector<pair<CScript, CAmount> >& vecSend,
                     txNew.vin.push_back(CTxIn(coin.first->GetHash(),coin.second));
 
                 // Sign
+/* MCHN START */
+                vector<CScript> vFromPubKeys;
+                vector<unsigned int> vIn;
                 int nIn = 0;
                 BOOST_FOREACH(const PAIRTYPE(const CWalletTx*,unsigned int)& coin, setCoins)
-                    if (!SignSignature(*this, *coin.first, txNew, nIn++))
-                    {                        
-                        strFailReason = _("Signing transaction failed");
-                        return false;
-                    }
+                {
+                    vFromPubKeys.push_back(coin.first->vout[coin.second].scriptPubKey);
+                    vIn.push_back(nIn++);
+                }
+                if (!SignSignatures(*this, vFromPubKeys, txNew, vIn))
+                {                        
+                    strFailReason = _("Signing transaction failed");
+                    return false;
+                }
+/* MCHN END */
 
                 // Embed the constructed transaction data in wtxNew.
                 *static_cast<CTransaction*>(&wtxNew) = CTransaction(txNew);
@@ -3157,90 +3170,161 @@ bool CWallet::SelectMultiChainCoins(const CAmount& nTargetValue, vector<COutput>
 
 bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, string& reject_reason)
 {
+    vector<CWalletTx*> vpwtxNew;
+    vector<string> vRejectReasons;
+    
+    vpwtxNew.push_back(&wtxNew);
     {
         LOCK2(cs_main, cs_wallet);
-        LogPrintf("CommitTransaction: %s, vin: %d, vout: %d\n",wtxNew.GetHash().ToString().c_str(),(int)wtxNew.vin.size(),(int)wtxNew.vout.size());
-        if(fDebug)LogPrint("wallet","CommitTransaction:\n%s", wtxNew.ToString());
+        RecordTransaction(wtxNew, reservekey);
+        if(CommitTransactions(vpwtxNew, vRejectReasons) == 0)
         {
-/* MCHN START */            
-            if(((mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS) == 0) || (mc_gState->m_WalletMode & MC_WMD_MAP_TXS))
-            {
+            reject_reason=vRejectReasons[0];
+            return false;
+        }
+    }
+    return true;
+}
+
+/* MCHN START */
+/*
+ * First half of CommitTransaction - adds signed transaction to wallet before it is accepted to mempool.
+ * Transactions recorded in a burst are then accepted together by CommitTransactions.
+ */
+
+void CWallet::RecordTransaction(CWalletTx& wtxNew, CReserveKey& reservekey)
+{
+    LOCK2(cs_main, cs_wallet);
+    LogPrintf("CommitTransaction: %s, vin: %d, vout: %d\n",wtxNew.GetHash().ToString().c_str(),(int)wtxNew.vin.size(),(int)wtxNew.vout.size());
+    if(fDebug)LogPrint("wallet","CommitTransaction:\n%s", wtxNew.ToString());
+    
+    if(((mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS) == 0) || (mc_gState->m_WalletMode & MC_WMD_MAP_TXS))
+    {
 /* MCHN END */            
-                // This is only to keep the database open to defeat the auto-flush for the
-                // duration of this scope.  This is the only place where this optimization
-                // maybe makes sense; please don't do it anywhere else.
-                CWalletDB* pwalletdb = fFileBacked ? new CWalletDB(strWalletFile,"r") : NULL;
+        // This is only to keep the database open to defeat the auto-flush for the
+        // duration of this scope.  This is the only place where this optimization
+        // maybe makes sense; please don't do it anywhere else.
+        CWalletDB* pwalletdb = fFileBacked ? new CWalletDB(strWalletFile,"r") : NULL;
 
-                // Take key pair from key pool so it won't be used again
-                reservekey.KeepKey();
+        // Take key pair from key pool so it won't be used again
+        reservekey.KeepKey();
 
-                // Add tx to wallet, because if it has change it's also ours,
-                // otherwise just for transaction history.
-                AddToWallet(wtxNew);
+        // Add tx to wallet, because if it has change it's also ours,
+        // otherwise just for transaction history.
+        AddToWallet(wtxNew);
 
-                // Notify that old coins are spent
-                set<CWalletTx*> setCoins;
-                BOOST_FOREACH(const CTxIn& txin, wtxNew.vin)
-                {
-                    CWalletTx &coin = mapWallet[txin.prevout.hash];
-                    coin.BindWallet(this);
-                    NotifyTransactionChanged(this, coin.GetHash(), CT_UPDATED);
-                }
+        // Notify that old coins are spent
+        BOOST_FOREACH(const CTxIn& txin, wtxNew.vin)
+        {
+            CWalletTx &coin = mapWallet[txin.prevout.hash];
+            coin.BindWallet(this);
+            NotifyTransactionChanged(this, coin.GetHash(), CT_UPDATED);
+        }
 
-                if (fFileBacked)
-                    delete pwalletdb;
+        if (fFileBacked)
+            delete pwalletdb;
 /* MCHN START */            
-            }
-/* MCHN END */            
-        }
+    }
+}
 
-        // Track how many getdata requests our transaction gets
-        // mapRequestCount[wtxNew.GetHash()] = 0;
+/*
+ * Second half of CommitTransaction for topologically ordered batch of recorded transactions.
+ * All transactions are accepted to mempool under one cs_main lock, so they see the same coins view
+ * and mempool permission overlay, wallet is synced once and accepted transactions are relayed 
+ * in one inventory announcement.
+ * Returns number of accepted transactions, vRejectReasons is empty string for accepted ones.
+ */
+
+int CWallet::CommitTransactions(vector<CWalletTx*>& vpwtxNew, vector<string>& vRejectReasons)
+{
+    int nAccepted=0;
+    vector<CTransaction> vtx;
+    vector<CTransaction> vRelay;
+    vector<CValidationState> vstate;
+    vector<bool> vAccepted;
+    
+    vRejectReasons.assign(vpwtxNew.size(),"");
+    if(vpwtxNew.size() == 0)
+    {
+        return 0;
+    }
+    
+    LOCK2(cs_main, cs_wallet);
+    
+    // Track how many getdata requests our transaction gets
+    // mapRequestCount[wtxNew.GetHash()] = 0;
 
-        // Broadcast
+    // Broadcast
 
-        if(mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS)
+    if(mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS)
+    {
+//        pwalletTxsMain->m_ChunkDB->FlushSourceChunks(GetArg("-chunkflushmode",MC_CDB_FLUSH_MODE_COMMIT));
+        if(pwalletTxsMain->m_ChunkDB->FlushSourceChunks(GetArg("-flushsourcechunks",true) ? (MC_CDB_FLUSH_MODE_FILE | MC_CDB_FLUSH_MODE_DATASYNC) : MC_CDB_FLUSH_MODE_NONE))
         {
-//            pwalletTxsMain->m_ChunkDB->FlushSourceChunks(GetArg("-chunkflushmode",MC_CDB_FLUSH_MODE_COMMIT));
-            if(pwalletTxsMain->m_ChunkDB->FlushSourceChunks(GetArg("-flushsourcechunks",true) ? (MC_CDB_FLUSH_MODE_FILE | MC_CDB_FLUSH_MODE_DATASYNC) : MC_CDB_FLUSH_MODE_NONE))
-            {
-                reject_reason="Couldn't store offchain items, probably chunk database is corrupted";                                        
-                return false;
-            }
+            vRejectReasons.assign(vpwtxNew.size(),"Couldn't store offchain items, probably chunk database is corrupted");
+            return 0;
         }
-        
-        if (!wtxNew.AcceptToMemoryPoolReturnReason(false,true,reject_reason))   // MCHN
+    }
+    
+    BOOST_FOREACH(CWalletTx* pwtxNew, vpwtxNew)
+    {
+        vtx.push_back(*pwtxNew);
+    }
+    
+    if(pMultiChainFilterEngine)
+    {
+        pMultiChainFilterEngine->SetTimeout(pMultiChainFilterEngine->GetSendTimeout());
+    }
+
+    nAccepted=AcceptToMemoryPoolMany(mempool, vstate, vtx, false, vAccepted, true, &vpwtxNew);
+
+    if(pMultiChainFilterEngine)
+    {
+        pMultiChainFilterEngine->SetTimeout(pMultiChainFilterEngine->GetAcceptTimeout());
+    }
+    
+    for(unsigned int t=0;t<vpwtxNew.size();t++)
+    {
+        if(!vAccepted[t])
         {
+            if(vstate[t].IsInvalid())
+                vRejectReasons[t] = strprintf("%i: %s", vstate[t].GetRejectCode(), vstate[t].GetRejectReason());
+            else
+                vRejectReasons[t] = vstate[t].GetRejectReason();
+            
             // This must not fail. The transaction has already been signed and recorded.
-            LogPrintf("CommitTransaction() : Error: Transaction not valid: %s\n",reject_reason.c_str());  // MCHN
-            if(fDebug)LogPrint("mchn","mchn: Tx not committed (%s): %s\n",reject_reason.c_str(),EncodeHexTx(wtxNew));
-            return false;
+            LogPrintf("CommitTransaction() : Error: Transaction not valid: %s\n",vRejectReasons[t].c_str());
+            if(fDebug)LogPrint("mchn","mchn: Tx not committed (%s): %s\n",vRejectReasons[t].c_str(),EncodeHexTx(*vpwtxNew[t]));
+            continue;
         }
         
-        pwalletTxsMain->WRPWriteLock();        
-        pwalletTxsMain->WRPSync(0);
-        pwalletTxsMain->WRPWriteUnLock();
-        
-/*        
-        else
+        for (unsigned int i = 0; i < vpwtxNew[t]->vin.size(); i++) 
         {
-            pwalletTxsMain->AddTx(NULL,wtxNew,-1,NULL,-1,0);   
-            if(((mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS) == 0) || (mc_gState->m_WalletMode & MC_WMD_MAP_TXS))
-            {
-                SyncWithWallets(wtxNew, NULL);            
-            }
+            COutPoint outp=vpwtxNew[t]->vin[i].prevout;
+            UnlockCoin(outp);
         }
-*/    
-        for (unsigned int i = 0; i < wtxNew.vin.size(); i++) 
+        if (!vpwtxNew[t]->IsCoinBase() && (vpwtxNew[t]->GetDepthInMainChain() == 0))
         {
-            COutPoint outp=wtxNew.vin[i].prevout;
-            UnlockCoin(outp);
+            LogPrint("wallet","Relaying wtx %s\n", vpwtxNew[t]->GetHash().ToString());
+            vRelay.push_back(vtx[t]);
         }
-        wtxNew.RelayWalletTransaction();
-
     }
-    return true;
+    
+    if(nAccepted)
+    {
+        pwalletTxsMain->WRPWriteLock();        
+        pwalletTxsMain->WRPSync(0);
+        pwalletTxsMain->WRPWriteUnLock();
+    }
+        
+    if(vRelay.size())
+    {
+        RelayTransactions(vRelay);
+    }
+    
+    return nAccepted;
 }
+/* MCHN END */
 
 CAmount CWallet::GetMinimumFee(unsigned int nTxBytes, unsigned int nConfirmTarget, const CTxMemPool& pool)
 {
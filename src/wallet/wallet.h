@@ -186,6 +186,8 @@ public:
 };
 
 
+#define MC_AGT_FILE_VERSION               1
+
 class CAssetGroupTree
 {
 private:
@@ -224,6 +226,8 @@ public:
     int AssetsPerGroup();
     int GetGroup(mc_Buffer *assets,int addIfNeeded);
     int GetGroup(unsigned char *assetRef,int addIfNeeded);
+    int Save(const char *FileName,const uint256& hashBlock);
+    int Load(const char *FileName,const uint256& hashBlock,int maxAssetsPerGroup);
 };
 
 /* MCHN END */
@@ -513,13 +517,18 @@ public:
                            CWalletTx& wtxNew, CReserveKey& reservekey, CAmount& nFeeRet, std::string& strFailReason, const CCoinControl* coinControl = NULL,
                            const std::set<CTxDestination>* addresses = NULL,int min_conf = 1,int min_inputs = -1,int max_inputs = -1, const std::vector<COutPoint> *lpCoinsToUse = NULL, int *eErrorCode = NULL);
     bool CreateAndCommitOptimizeTransaction(CWalletTx& wtxNew,std::string& strFailReason,
-                           const std::set<CTxDestination>* addresses = NULL,int min_conf = 1,int min_inputs = -1,int max_inputs = -1);
+                           const std::set<CTxDestination>* addresses = NULL,int min_conf = 1,int min_inputs = -1,int max_inputs = -1,bool fRecordOnly = false);
     int OptimizeUnspentList(); 
     bool UpdateUnspentList(const CWalletTx& wtx, bool update_inputs);
-    bool InitializeUnspentList();
+    bool InitializeUnspentList(bool fUsePersistedGroups = false);
+    void SaveAssetGroups();
     void PurgeSpentCoins(int min_depth,int max_coins);   
 /* MCHN END */       
     bool CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std::string& reject_reason);
+/* MCHN START */       
+    void RecordTransaction(CWalletTx& wtxNew, CReserveKey& reservekey);
+    int CommitTransactions(std::vector<CWalletTx*>& vpwtxNew, std::vector<std::string>& vRejectReasons);
+/* MCHN END */       
 
     static CFeeRate minTxFee;
     static CAmount GetMinimumFee(unsigned int nTxBytes, unsigned int nConfirmTarget, const CTxMemPool& pool);
@@ -551,6 +551,129 @@ int CAssetGroupTree::GetGroup(unsigned char *assetRef,int addIfNeeded)
     return group_id;
 } 
 
+/*
+ * Writes grouping to file together with the hash of the block it corresponds to.
+ * File is written under temporary name and renamed, so it is never left half-written.
+ */
+
+int CAssetGroupTree::Save(const char *FileName,const uint256& hashBlock)
+{
+    if( (lpAssets == NULL) || (lpAssetGroups == NULL) )
+    {
+        return MC_ERR_NOT_ALLOWED;
+    }
+    
+    string strTmpFileName=strprintf("%s.tmp",FileName);
+    FILE *fHan=fopen(strTmpFileName.c_str(),"wb");
+    if(fHan == NULL)
+    {
+        return MC_ERR_FILE_WRITE_ERROR;
+    }
+    
+    CAutoFile fileout(fHan, SER_DISK, CLIENT_VERSION);
+    try 
+    {
+        int version=MC_AGT_FILE_VERSION;
+        int asset_count=lpAssets->GetCount();
+        int group_count=lpAssetGroups->GetCount();
+        fileout << version << hashBlock;
+        fileout << nAssetsPerGroup << nMaxAssetsPerGroup << nOptimalGroupCount << nMode << nSingleAssetGroupCount;
+        fileout << lpAssets->m_RowSize << asset_count << lpAssetGroups->m_RowSize << group_count;
+        for(int i=0;i<asset_count;i++)
+        {
+            fileout.write((const char*)lpAssets->GetRow(i),lpAssets->m_RowSize);
+        }
+        for(int i=0;i<group_count;i++)
+        {
+            fileout.write((const char*)lpAssetGroups->GetRow(i),lpAssetGroups->m_RowSize);
+        }
+        FileCommit(fileout.Get());
+    } 
+    catch (std::exception &e) 
+    {
+        fileout.fclose();
+        remove(strTmpFileName.c_str());
+        return MC_ERR_FILE_WRITE_ERROR;
+    }
+    fileout.fclose();
+    
+    if(!RenameOver(strTmpFileName,FileName))
+    {
+        return MC_ERR_FILE_WRITE_ERROR;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+/*
+ * Restores grouping saved by Save(). 
+ * Fails with MC_ERR_NOT_FOUND if file is missing, was written for another block or for different maximal group size -
+ * caller should rebuild grouping from unspent coins in this case.
+ */
+
+int CAssetGroupTree::Load(const char *FileName,const uint256& hashBlock,int maxAssetsPerGroup)
+{
+    FILE *fHan=fopen(FileName,"rb");
+    if(fHan == NULL)
+    {
+        return MC_ERR_NOT_FOUND;
+    }
+    
+    CAutoFile filein(fHan, SER_DISK, CLIENT_VERSION);
+    try 
+    {
+        int version,assets_per_group,max_assets_per_group,optimal_group_count,mode,single_asset_group_count;
+        int asset_row_size,asset_count,group_row_size,group_count;
+        uint256 hashSaved;
+        
+        filein >> version >> hashSaved;
+        if( (version != MC_AGT_FILE_VERSION) || (hashSaved != hashBlock) )
+        {
+            return MC_ERR_NOT_FOUND;
+        }
+        filein >> assets_per_group >> max_assets_per_group >> optimal_group_count >> mode >> single_asset_group_count;
+        filein >> asset_row_size >> asset_count >> group_row_size >> group_count;
+        if( (max_assets_per_group != maxAssetsPerGroup) || (assets_per_group <= 0) || (assets_per_group > max_assets_per_group) ||
+            (asset_row_size != MC_AST_ASSET_QUANTITY_OFFSET+(int)sizeof(int)) ||
+            (group_row_size != (int)sizeof(CAssetGroup)+assets_per_group*(int)sizeof(int)) ||
+            (asset_count < 0) || (group_count < 1) )
+        {
+            return MC_ERR_NOT_FOUND;
+        }
+        
+        if(Initialize(assets_per_group,max_assets_per_group,optimal_group_count,mode))
+        {
+            return MC_ERR_INTERNAL_ERROR;
+        }
+        nSingleAssetGroupCount=single_asset_group_count;
+        
+        vector<unsigned char> row(group_row_size);
+        if(lpAssets->Realloc(asset_count) || lpAssetGroups->Realloc(group_count))
+        {
+            Destroy();
+            return MC_ERR_ALLOCATION;
+        }
+        for(int i=0;i<asset_count;i++)
+        {
+            filein.read((char*)&row[0],asset_row_size);
+            lpAssets->Add(&row[0]);
+        }
+        filein.read((char*)lpAssetGroups->GetRow(0),group_row_size);            // Row 0 is created by Initialize, it keeps lists of underfilled groups
+        for(int i=1;i<group_count;i++)
+        {
+            filein.read((char*)&row[0],group_row_size);
+            lpAssetGroups->Add(&row[0]);
+        }
+    } 
+    catch (std::exception &e) 
+    {
+        Destroy();
+        return MC_ERR_NOT_FOUND;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 int64_t mc_GetABCoinQuantity(void *ptr,int coin_id)
 {
     return (int64_t)mc_GetLE((unsigned char*)ptr+MC_AST_ASSET_QUANTITY_OFFSET+coin_id*MC_AST_ASSET_QUANTITY_SIZE,MC_AST_ASSET_QUANTITY_SIZE);        
@@ -2390,6 +2513,8 @@ CAmount BuildAssetTransaction(CWallet *lpWallet,
         
         int nIn=0;
         unsigned int nSignatureBytes=0;
+        vector<CScript> vFromPubKeys;
+        vector<unsigned int> vSignIn;
         coin_id=0;
         BOOST_FOREACH(const COutput& out, vCoins)                               // Signing
         {            
@@ -2402,15 +2527,8 @@ CAmount BuildAssetTransaction(CWallet *lpWallet,
 
                     if(flags & MC_CSF_SIGN)
                     {
-                        if (!SignSignature(*lpWallet, txout.scriptPubKey, txNew, nIn++))
-                        {
-                            CTransaction printableTx=CTransaction(txNew);
-                            if(fDebug)LogPrint("mchn","Cannot sign transaction input %d: (%s,%d), scriptPubKey %s \n",
-                                    nIn-1,txNew.vin[nIn-1].prevout.hash.ToString().c_str(),txNew.vin[nIn-1].prevout.n,txout.scriptPubKey.ToString().c_str());
-
-                            strFailReason = _("Signing transaction failed");
-                            return -2;
-                        }
+                        vFromPubKeys.push_back(txout.scriptPubKey);             // Signed together after the loop
+                        vSignIn.push_back(nIn++);
                     }
                     else
                     {
@@ -2428,6 +2546,25 @@ CAmount BuildAssetTransaction(CWallet *lpWallet,
             coin_id++;
         }
         
+        if(vSignIn.size())
+        {
+            vector<bool> vSigned;
+            if (!SignSignatures(*lpWallet, vFromPubKeys, txNew, vSignIn, SIGHASH_ALL, &vSigned))
+            {
+                for(unsigned int i=0;i<vSignIn.size();i++)
+                {
+                    if(!vSigned[i])
+                    {
+                        if(fDebug)LogPrint("mchn","Cannot sign transaction input %d: (%s,%d), scriptPubKey %s \n",
+                                vSignIn[i],txNew.vin[vSignIn[i]].prevout.hash.ToString().c_str(),txNew.vin[vSignIn[i]].prevout.n,vFromPubKeys[i].ToString().c_str());
+                        break;
+                    }
+                }
+                strFailReason = _("Signing transaction failed");
+                return -2;
+            }
+        }
+        
         wtxNew.fTimeReceivedIsTxTime = true;
         wtxNew.fFromMe=true;
         wtxNew.BindWallet(lpWallet);
@@ -3368,7 +3505,29 @@ bool CWallet::UpdateUnspentList(const CWalletTx& wtx, bool update_inputs)
     return true;
 }
 
-bool CWallet::InitializeUnspentList()
+static string AssetGroupsFileName()
+{
+    char FileName[MC_DCT_DB_MAX_PATH];                      
+    mc_GetFullFileName(mc_gState->m_Params->NetworkName(),"wallet/assetgroups",".dat",MC_FOM_RELATIVE_TO_DATADIR | MC_FOM_CREATE_DIR, FileName);
+    return string(FileName);
+}
+
+void CWallet::SaveAssetGroups()
+{
+    LOCK2(cs_main, cs_wallet);
+    if( (lpAssetGroups == NULL) || (chainActive.Tip() == NULL) )
+    {
+        return;
+    }
+    
+    int err=lpAssetGroups->Save(AssetGroupsFileName().c_str(),chainActive.Tip()->GetBlockHash());
+    if(err)
+    {
+        LogPrintf("mchn: Cannot save asset grouping, error %d\n",err);
+    }
+}
+
+bool CWallet::InitializeUnspentList(bool fUsePersistedGroups)
 {
     LOCK2(cs_main, cs_wallet);
     mapUnspent.clear();
@@ -3415,6 +3574,19 @@ bool CWallet::InitializeUnspentList()
 
     int max_assets_per_group=assets_per_opdrop*MCP_STD_OP_DROP_COUNT;
 
+    if(fUsePersistedGroups && chainActive.Tip() && !GetBoolArg("-rescan",false))// Grouping saved at last flush is valid if chain tip didn't change since,
+                                                                                // assets received later are added to groups by coin selection
+    {
+        if(lpAssetGroups->Load(AssetGroupsFileName().c_str(),chainActive.Tip()->GetBlockHash(),max_assets_per_group) == MC_ERR_NOERROR)
+        {
+            if(fDebug)LogPrint("mchn","mchn: Asset grouping loaded: %d groups, %d assets per group\n",lpAssetGroups->GroupCount()-1,lpAssetGroups->AssetsPerGroup());
+            lpAssetGroups->Dump();
+            if(fDebug)LogPrint("mchn","mchn: Unspent list initialized: Total: %d, Unspent: %d\n",mapWallet.size(),mapUnspent.size());
+            return true;
+        }
+        if(fDebug)LogPrint("mchn","mchn: Saved asset grouping doesn't match chain tip, rebuilding\n");
+    }
+    
     lpAssetGroups->Initialize(1,max_assets_per_group,32,1);
     
     vector <COutput> vCoins;
@@ -3652,7 +3824,12 @@ bool OutputCanSend(COutput out)
 }
 
 
-bool CWallet::CreateAndCommitOptimizeTransaction(CWalletTx& wtx,std::string& strFailReason,const std::set<CTxDestination>* addresses,int min_conf,int min_inputs,int max_inputs)
+/*
+ * If fRecordOnly is set, transaction is only recorded in the wallet and its inputs are locked, 
+ * so that next transaction in the burst doesn't select them. Caller commits the burst by CommitTransactions.
+ */
+
+bool CWallet::CreateAndCommitOptimizeTransaction(CWalletTx& wtx,std::string& strFailReason,const std::set<CTxDestination>* addresses,int min_conf,int min_inputs,int max_inputs,bool fRecordOnly)
 {
     CReserveKey reservekey(this);
     
@@ -3674,6 +3851,17 @@ bool CWallet::CreateAndCommitOptimizeTransaction(CWalletTx& wtx,std::string& str
     {    
         if(fDebug)LogPrint("mchn","Committing wallet optimization tx. Inputs: %ld, Outputs: %ld\n",wtx.vin.size(),wtx.vout.size());
         
+        if(fRecordOnly)
+        {
+            RecordTransaction(wtx, reservekey);
+            for (unsigned int i = 0; i < wtx.vin.size(); i++) 
+            {
+                COutPoint outp=wtx.vin[i].prevout;
+                LockCoin(outp);
+            }
+            return true;
+        }
+        
         if (CommitTransaction(wtx, reservekey, strFailReason))
         {
             if(fDebug)LogPrint("mchn","Committing wallet optimization tx completed\n");
@@ -3779,6 +3967,7 @@ int CWallet::OptimizeUnspentList()
     }        
            
     int tx_sent=0;
+    vector<CWalletTx> vwtxBurst;                                                // Combine transactions are accepted to mempool in one batch
     
     if(fDebug)LogPrint("mchn","mchn: Found %d UTXOs in %d addresses\n",total,(int)addressesToOptimize.size());
     
@@ -3841,9 +4030,10 @@ int CWallet::OptimizeUnspentList()
                             if(lpKeyID)
                             {
                                 CWalletTx wtx;
-                                result=CreateAndCommitOptimizeTransaction(wtx,strError,lpAddresses,min_conf,min_inputs,max_inputs);
+                                result=CreateAndCommitOptimizeTransaction(wtx,strError,lpAddresses,min_conf,min_inputs,max_inputs,true);
                                 if(result)
                                 {
+                                    vwtxBurst.push_back(wtx);
                                     LogPrintf("Combine transaction for address %s (%d inputs,%d outputs): %s; Time: %8.3fs\n",
                                             bitcoin_address.ToString().c_str(), wtx.vin.size(),wtx.vout.size(),wtx.GetHash().GetHex().c_str(),mc_TimeNowAsDouble()-start_time);
                                     total-=txOutCounts[it->second];
@@ -3863,6 +4053,29 @@ int CWallet::OptimizeUnspentList()
             }
         }
     }
+    
+    if(vwtxBurst.size())
+    {
+        vector<CWalletTx*> vpwtxBurst;
+        vector<string> vRejectReasons;
+        for(unsigned int t=0;t<vwtxBurst.size();t++)
+        {
+            vpwtxBurst.push_back(&vwtxBurst[t]);
+        }
+        tx_sent=CommitTransactions(vpwtxBurst,vRejectReasons);
+        for(unsigned int t=0;t<vwtxBurst.size();t++)                            // Inputs of rejected transactions are locked by us too
+        {
+            if(vRejectReasons[t].size())
+            {
+                for (unsigned int i = 0; i < vwtxBurst[t].vin.size(); i++) 
+                {
+                    COutPoint outp=vwtxBurst[t].vin[i].prevout;
+                    UnlockCoin(outp);
+                }
+            }
+        }
+        if(fDebug)LogPrint("mchn","mchn: Wallet optimization: %d of %d combine transactions accepted\n",tx_sent,(int)vwtxBurst.size());
+    }
         
     nNextUnspentOptimization=mc_TimeNowAsUInt()+next_delay;
     return tx_sent;
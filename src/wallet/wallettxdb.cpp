@@ -71,6 +71,13 @@ void mc_TxEntityStat::Zero()
     memset(this,0,sizeof(mc_TxEntityStat));
 }
 
+void mc_TxEntityCursor::Zero()
+{
+    memset(this,0,sizeof(mc_TxEntityCursor));
+    m_Direction=1;
+    m_MemPoolRow=-1;
+}
+
 void mc_TxImportRow::Zero()
 {
     memset(this,0,sizeof(mc_TxImportRow));
@@ -96,6 +103,12 @@ void mc_TxEntityDBStat::Zero()
     m_WalletVersion=MC_TDB_WALLET_VERSION;
 }
 
+void mc_TxBlockUndoRow::Zero()
+{
+    memset(this,0,sizeof(mc_TxBlockUndoRow));
+    m_RowType=MC_TET_BLOCK_UNDO;
+}
+
 void mc_TxImport::Zero()
 {
     memset(this,0,sizeof(mc_TxImport));
@@ -248,11 +261,14 @@ void mc_TxDB::Zero()
     m_LogFileName[0]=0x00;
     
     m_UnsubscribeMemPoolSize=0;
+    m_BlockUndoFrom=0;
     
     m_Mode=MC_WMD_NONE;
     m_Semaphore=NULL;
     m_LockedBy=0;    
     
+    m_ChangeID=0;
+    
     m_WRPRWLock=NULL;
     m_WRPLockedBy=0;
     m_WRPMemPool=NULL;                                          
@@ -301,6 +317,16 @@ void mc_TxDB::UnLock()
     __US_SemPost(m_Semaphore);
 }
 
+void mc_TxDB::IncrementChangeID()
+{
+    int locked=WRPWriteLock(1);                                                 // Read APIs check it under WRP read lock
+    m_ChangeID++;
+    if(locked == 0)
+    {
+        WRPWriteUnLock(0);
+    }
+}
+
 int mc_TxDB::WRPReadLock()
 {
     if(WRPUsed() == 0)
@@ -515,6 +541,7 @@ int mc_TxDB::Initialize(const char *name,uint32_t mode)
     {        
         memcpy((char*)&m_DBStat+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
         m_Mode |= m_DBStat.m_InitMode & MC_WMD_MODE_MASK; 
+        m_BlockUndoFrom=m_DBStat.m_Block+1;
         edbImport.Zero();
         edbImport.m_ImportID=0;
         edbImport.m_Pos=0;
@@ -648,12 +675,15 @@ int mc_TxDB::Initialize(const char *name,uint32_t mode)
     
     m_MemPools[0]=new mc_Buffer;                                                // Key - entity with m_Pos set to 0 + txid
     err=m_MemPools[0]->Initialize(MC_TDB_ENTITY_KEY_SIZE+MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
+    m_MemPools[0]->SetMemTag(MC_MEM_TAG_TXDB);
     
     m_RawMemPools[0]=new mc_Buffer;    
     err=m_RawMemPools[0]->Initialize(MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
+    m_RawMemPools[0]->SetMemTag(MC_MEM_TAG_TXDB);
 
     m_RawUpdatePool=new mc_Buffer;    
     err=m_RawUpdatePool->Initialize(MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);        
+    m_RawUpdatePool->SetMemTag(MC_MEM_TAG_TXDB);
     
     m_Semaphore=__US_SemCreate();
     if(m_Semaphore == NULL)
@@ -666,12 +696,15 @@ int mc_TxDB::Initialize(const char *name,uint32_t mode)
     {
         m_WRPMemPool=new mc_Buffer;                                                // Key - entity with m_Pos set to 0 + txid
         err=m_WRPMemPool->Initialize(MC_TDB_ENTITY_KEY_SIZE+MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
+        m_WRPMemPool->SetMemTag(MC_MEM_TAG_TXDB);
 
         m_WRPRawMemPool=new mc_Buffer;    
         err=m_WRPRawMemPool->Initialize(MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
+        m_WRPRawMemPool->SetMemTag(MC_MEM_TAG_TXDB);
 
         m_WRPRawUpdatePool=new mc_Buffer;    
         err=m_WRPRawUpdatePool->Initialize(MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);        
+        m_WRPRawUpdatePool->SetMemTag(MC_MEM_TAG_TXDB);
 
         m_WRPRWLock=__US_RWLockCreate();
         if(m_WRPRWLock == NULL)
@@ -2425,6 +2458,12 @@ int mc_TxDB::Commit(mc_TxImport *import)
         goto exitlbl;
     }                    
     
+    err=WriteBlockUndo(imp,block);
+    if(err)
+    {
+        goto exitlbl;
+    }                    
+    
     for(i=0;i<imp->m_Entities->GetCount();i++)                                  // Import entity update
     {
         stat=(mc_TxEntityStat*)imp->m_Entities->GetRow(i);
@@ -2513,8 +2552,12 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
     uint32_t pos;
     mc_TxEntity global_subkeys_entity;
     mc_TxEntity subkey_entity;
+    mc_Buffer *lpUndoEntities;
+    mc_TxBlockUndoEntity *undo_entity;
             
     err=MC_ERR_NOERROR;
+    IncrementChangeID();
+    lpUndoEntities=NULL;
    
     Dump("Before RollBack");
     imp=m_Imports;
@@ -2646,17 +2689,54 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
         m_RawUpdatePool->Clear();
     }
     
+    lpUndoEntities=new mc_Buffer;                                               // Entities appended in rolled back blocks, other entities are not touched
+    lpUndoEntities->Initialize(sizeof(mc_TxEntity),sizeof(mc_TxBlockUndoEntity),MC_BUF_MODE_MAP);
+    if(GetBlockUndo(imp,block,lpUndoEntities) != MC_ERR_NOERROR)
+    {
+        delete lpUndoEntities;
+        lpUndoEntities=NULL;
+    }
+    
     for(i=0;i<imp->m_Entities->GetCount();i++)                                  // Removing ordered-by-blockchain-position rows
     {
         stat=(mc_TxEntityStat*)imp->m_Entities->GetRow(i);
         if((stat->m_Entity.m_EntityType & MC_TET_ORDERMASK) != MC_TET_TIMERECEIVED)
         {        
             stat->m_LastPos=stat->m_LastClearedPos;
+            undo_entity=NULL;
+            if(lpUndoEntities)
+            {
+                r=lpUndoEntities->Seek((unsigned char*)&(stat->m_Entity));
+                if(r < 0)
+                {
+                    continue;
+                }
+                undo_entity=(mc_TxBlockUndoEntity*)lpUndoEntities->GetRow(r);
+            }
             pos=stat->m_LastPos;
             erow.Zero();
             memcpy(&erow.m_Entity,&(stat->m_Entity),sizeof(mc_TxEntity));
             erow.m_Generation=stat->m_Generation;
-            while(pos)
+            if( (undo_entity != NULL) && 
+                (undo_entity->m_Generation == stat->m_Generation) && 
+                (undo_entity->m_LastPos <= pos) )                               // Truncating to the recorded position, rows are not read
+            {
+                while(pos > undo_entity->m_LastPos)
+                {
+                    erow.m_Pos=pos;
+                    erow.SwapPosBytes();
+                    err=m_Database->m_DB->Delete((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    erow.SwapPosBytes();
+                    if(err)
+                    {
+                        goto exitlbl;
+                    }
+                    pos--;
+                }
+                stat->m_LastPos=pos;
+                pos=0;
+            }
+            while(pos)                                                          // No usable undo record, walking back from the last row
             {
                 erow.m_Pos=pos;
                 erow.SwapPosBytes();
@@ -2711,6 +2791,18 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
         }        
     }    
 
+    if(imp->m_ImportID == 0)
+    {
+        for(j=imp->m_Block;j>block;j--)
+        {
+            err=DeleteBlockUndo(j);
+            if(err)
+            {
+                goto exitlbl;
+            }                    
+        }
+    }
+
     edbImport.Zero();                                                           // Import block update
     edbImport.m_Block=block;
     edbImport.m_ImportID=imp->m_ImportID;
@@ -2750,14 +2842,171 @@ exitlbl:
     }
     else
     {
-        sprintf(msg,"Rolled back to block %d successfully",block);
+        sprintf(msg,"Rolled back to block %d successfully%s",block,lpUndoEntities ? ", using undo records" : "");
         LogString(msg);
     }
+    
+    if(lpUndoEntities)
+    {
+        delete lpUndoEntities;
+    }
 
     Dump("After RollBack");
     return err;
 }
 
+int mc_TxDB::WriteBlockUndo(mc_TxImport *import,int block)
+{
+    int i,err;
+    uint32_t count;
+    mc_TxEntityStat *stat;
+    mc_TxBlockUndoRow undorow;
+    
+    if(import->m_ImportID != 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    count=0;
+    for(i=0;i<import->m_Entities->GetCount();i++)
+    {
+        stat=(mc_TxEntityStat*)import->m_Entities->GetRow(i);
+        if( (stat->m_LastPos != stat->m_LastClearedPos) && 
+            ((stat->m_Entity.m_EntityType & MC_TET_ORDERMASK) != MC_TET_TIMERECEIVED) )
+        {
+            count++;
+            undorow.Zero();
+            undorow.m_Block=block;
+            undorow.m_Pos=count;
+            memcpy(&(undorow.m_Entity),&(stat->m_Entity),sizeof(mc_TxEntity));
+            undorow.m_Generation=stat->m_Generation;
+            undorow.m_LastPos=stat->m_LastClearedPos;
+            err=m_Database->m_DB->Write((char*)&undorow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&undorow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            if(err)
+            {
+                return err;
+            }                    
+        }
+    }
+    
+    undorow.Zero();
+    undorow.m_Block=block;
+    undorow.m_Pos=0;
+    undorow.m_Count=count;
+    err=m_Database->m_DB->Write((char*)&undorow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&undorow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    if(err)
+    {
+        return err;
+    }                    
+    
+    if(block >= MC_TDB_BLOCK_UNDO_DEPTH)
+    {
+        err=DeleteBlockUndo(block-MC_TDB_BLOCK_UNDO_DEPTH);
+    }
+    
+    return err;
+}
+
+int mc_TxDB::GetBlockUndo(mc_TxImport *import,int block,mc_Buffer *lpEntities)
+{
+    int b,err,value_len;
+    uint32_t pos,count;
+    unsigned char *ptr;
+    mc_TxBlockUndoRow undorow;
+    mc_TxBlockUndoEntity undo_entity;
+    
+    if(import->m_ImportID != 0)
+    {
+        return MC_ERR_NOT_FOUND;
+    }
+    
+    if(block+1 < m_BlockUndoFrom)
+    {
+        return MC_ERR_NOT_FOUND;
+    }
+    
+    for(b=block+1;b<=import->m_Block;b++)
+    {
+        undorow.Zero();
+        undorow.m_Block=b;
+        undorow.m_Pos=0;
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&undorow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(err)
+        {
+            return err;
+        }
+        if(ptr == NULL)
+        {
+            return MC_ERR_NOT_FOUND;
+        }
+        memcpy((char*)&undorow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+        count=undorow.m_Count;
+        
+        for(pos=1;pos<=count;pos++)
+        {
+            undorow.Zero();
+            undorow.m_Block=b;
+            undorow.m_Pos=pos;
+            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&undorow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            if(err)
+            {
+                return err;
+            }
+            if(ptr == NULL)
+            {
+                return MC_ERR_NOT_FOUND;
+            }
+            memcpy((char*)&undorow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+            if(lpEntities->Seek((unsigned char*)&(undorow.m_Entity)) < 0)      // Blocks are read in ascending order, the first record has the position to truncate to
+            {
+                memcpy(&(undo_entity.m_Entity),&(undorow.m_Entity),sizeof(mc_TxEntity));
+                undo_entity.m_Generation=undorow.m_Generation;
+                undo_entity.m_LastPos=undorow.m_LastPos;
+                lpEntities->Add(&undo_entity);
+            }
+        }
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_TxDB::DeleteBlockUndo(int block)
+{
+    int err,value_len;
+    uint32_t pos,count;
+    unsigned char *ptr;
+    mc_TxBlockUndoRow undorow;
+    
+    undorow.Zero();
+    undorow.m_Block=block;
+    undorow.m_Pos=0;
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&undorow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    if(err)
+    {
+        return err;
+    }
+    if(ptr == NULL)
+    {
+        return MC_ERR_NOERROR;
+    }
+    memcpy((char*)&undorow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+    count=undorow.m_Count;
+    
+    for(pos=0;pos<=count;pos++)
+    {
+        undorow.Zero();
+        undorow.m_Block=block;
+        undorow.m_Pos=pos;
+        err=m_Database->m_DB->Delete((char*)&undorow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        if(err)
+        {
+            return err;
+        }
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 int mc_TxDB::GetLastItem(
                     mc_TxImport *import,
                     mc_TxEntity *entity,                                        
@@ -3222,6 +3471,185 @@ int mc_TxDB::WRPGetList(
     return MC_ERR_NOERROR;
 }
 
+void mc_TxDB::CursorClose(mc_TxEntityCursor *cursor)
+{
+    if(cursor->m_DBCursor)
+    {
+        if(m_Database)
+        {
+            m_Database->m_DB->CursorDestroy(cursor->m_DBCursor);
+        }
+        cursor->m_DBCursor=NULL;
+    }
+    cursor->m_DBCursorPos=0;
+}
+
+int mc_TxDB::WRPCursorRead(mc_TxEntityCursor *cursor,int count,mc_Buffer *txs)
+{
+    int last,confirmed,found,reseek,key_len,value_len;
+    mc_TxEntityRow erow;
+    mc_TxEntityRow *lpEnt;
+    mc_Buffer *mempool;
+    const char *key;
+    const char *value;
+    char msg[256];
+    
+    txs->Clear();
+    
+    if(IsCSkipped(cursor->m_Entity.m_EntityType))
+    {
+        return MC_ERR_NOT_SUPPORTED;
+    }
+    
+    if(pEF->STR_IsIndexSkipped(m_Imports,NULL,&cursor->m_Entity))
+    {
+        return MC_ERR_NOT_ALLOWED;
+    }   
+    
+    mempool=m_MemPools[0];
+    if(WRPUsed())
+    {
+        mempool=m_WRPMemPool;    
+    }
+    
+    cursor->m_LastUsed=mc_TimeNowAsUInt();
+    last=WRPGetListSize(&cursor->m_Entity,cursor->m_Generation,&confirmed);
+    
+    if( (cursor->m_Direction < 0) && ((int)cursor->m_NextPos > last) )
+    {
+        cursor->m_NextPos=last;
+    }
+    
+    if(cursor->m_DBChangeID != m_ChangeID)                                      // Rows may be replaced, iterator snapshot is invalid
+    {
+        CursorClose(cursor);
+        cursor->m_MemPoolRow=-1;
+    }
+    
+    while( (txs->GetCount() < count) && (cursor->m_NextPos >= 1) && ((int)cursor->m_NextPos <= last) )
+    {
+        erow.Zero();
+        memcpy(&erow.m_Entity,&cursor->m_Entity,sizeof(mc_TxEntity));
+        erow.m_Generation=cursor->m_Generation;
+        erow.m_Pos=cursor->m_NextPos;
+        
+        if((int)erow.m_Pos <= confirmed)                                        // Database rows
+        {
+            erow.SwapPosBytes();
+            reseek=1;
+            if( cursor->m_DBCursor && (cursor->m_DBCursorPos != 0) )
+            {
+                if(cursor->m_DBCursorPos == cursor->m_NextPos)
+                {
+                    reseek=0;
+                }
+                else
+                {
+                    if((int)cursor->m_DBCursorPos + cursor->m_Direction == (int)cursor->m_NextPos)
+                    {
+                        m_Database->m_DB->CursorMove(cursor->m_DBCursor,cursor->m_Direction);
+                        reseek=0;
+                    }
+                }
+            }
+            
+            found=0;
+            while(found == 0)
+            {
+                if(reseek)
+                {
+                    CursorClose(cursor);                                        // New iterator sees rows committed after the previous one was created
+                    cursor->m_DBCursor=m_Database->m_DB->CursorCreate();
+                    cursor->m_DBChangeID=m_ChangeID;
+                    if(cursor->m_DBCursor == NULL)
+                    {
+                        return MC_ERR_INTERNAL_ERROR;
+                    }
+                    m_Database->m_DB->CursorSeek(cursor->m_DBCursor,(char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize);
+                }
+                key=m_Database->m_DB->CursorRead(cursor->m_DBCursor,&key_len,&value,&value_len);
+                if( key && (key_len == (int)m_Database->m_KeySize) && (value_len >= (int)m_Database->m_ValueSize) &&
+                    (memcmp(key,(char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize) == 0) )
+                {
+                    found=1;
+                }
+                else
+                {
+                    if(reseek)
+                    {
+                        break;
+                    }
+                    reseek=1;
+                }
+            }
+            erow.SwapPosBytes();
+            
+            if(found == 0)
+            {
+                CursorClose(cursor);
+                sprintf(msg,"CursorRead: couldn't find item %d in database, entity type %08X",erow.m_Pos,erow.m_Entity.m_EntityType);
+                LogString(msg);
+                return MC_ERR_NOT_FOUND;
+            }
+            
+            cursor->m_DBCursorPos=cursor->m_NextPos;
+            txs->Add((char*)&erow,value);
+        }
+        else                                                                    // mempool rows
+        {
+            found=0;
+            if( (cursor->m_MemPoolRow >= 0) && (cursor->m_MemPoolRow < mempool->GetCount()) )   // Rows are ordered by position, start from the previous one
+            {
+                int mprow=cursor->m_MemPoolRow;
+                while( (found == 0) && (mprow >= 0) && (mprow < mempool->GetCount()) )
+                {
+                    lpEnt=(mc_TxEntityRow *)mempool->GetRow(mprow);
+                    if( (lpEnt->m_TempPos == erow.m_Pos) && 
+                        (memcmp(&(lpEnt->m_Entity),&cursor->m_Entity,sizeof(mc_TxEntity)) == 0))
+                    {
+                        found=1;
+                    }
+                    else
+                    {
+                        mprow+=cursor->m_Direction;
+                    }
+                }
+                if(found)
+                {
+                    cursor->m_MemPoolRow=mprow;
+                }
+            }
+            if(found == 0)
+            {
+                for(int mprow=0;(found == 0) && (mprow < mempool->GetCount());mprow++)
+                {
+                    lpEnt=(mc_TxEntityRow *)mempool->GetRow(mprow);
+                    if( (lpEnt->m_TempPos == erow.m_Pos) && 
+                        (memcmp(&(lpEnt->m_Entity),&cursor->m_Entity,sizeof(mc_TxEntity)) == 0))
+                    {
+                        cursor->m_MemPoolRow=mprow;
+                        found=1;
+                    }
+                }
+            }
+            if(found == 0)
+            {
+                sprintf(msg,"CursorRead: couldn't find item %d in mempool, entity type %08X",erow.m_Pos,erow.m_Entity.m_EntityType);
+                LogString(msg);
+                return MC_ERR_NOT_FOUND;                
+            }
+            lpEnt=(mc_TxEntityRow *)mempool->GetRow(cursor->m_MemPoolRow);
+            memcpy(&erow,lpEnt,MC_TDB_ROW_SIZE);
+            erow.m_Pos=cursor->m_NextPos;                    
+            txs->Add((char*)&erow,(char*)&erow+MC_TDB_ENTITY_KEY_SIZE);                
+        }
+        
+        cursor->m_NextPos+=cursor->m_Direction;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 int mc_TxDB::GetList(mc_TxEntity *entity,
                 int generation,
                 int from,
@@ -3418,7 +3846,8 @@ int mc_TxDB::GetBlockItemIndex(mc_TxImport *import,mc_TxEntity *entity,int block
 int mc_TxDB::WRPGetBlockItemIndex(mc_TxImport *import,mc_TxEntity *entity,int block)
 {
     mc_TxImport *imp;
-    int first,last,next;
+    int row;
+    mc_TxEntityStat *stat;
    
     imp=m_Imports;
     if(import)
@@ -3426,10 +3855,6 @@ int mc_TxDB::WRPGetBlockItemIndex(mc_TxImport *import,mc_TxEntity *entity,int bl
         imp=import;
     }
     
-    mc_TxEntityRow erow;
-    int row;
-    mc_TxEntityStat *stat;
-    
     row=imp->FindEntity(entity);
     if(row < 0)
     {
@@ -3438,30 +3863,73 @@ int mc_TxDB::WRPGetBlockItemIndex(mc_TxImport *import,mc_TxEntity *entity,int bl
     
     stat=(mc_TxEntityStat*)imp->m_Entities->GetRow(row);
     
-    first=1;
-    WRPGetListSize(entity,stat->m_Generation,&last);
-        
-    if(last <= 0)
+    return WRPGetBlockItemIndex(&(stat->m_Entity),stat->m_Generation,block,-1,-1,NULL);
+}
+
+int mc_TxDB::WRPGetBlockItemIndex(mc_TxEntity *entity,int generation,int block,int first_hint,int last_hint,int *in_range)
+{
+    int first,last,next;
+    mc_TxEntityRow erow;
+    
+    if(in_range)
     {
-        return 0;
+        *in_range=0;
     }
-    
+   
     erow.Zero();
-    memcpy(&erow.m_Entity,&(stat->m_Entity),sizeof(mc_TxEntity));
-    erow.m_Generation=stat->m_Generation;
+    memcpy(&erow.m_Entity,entity,sizeof(mc_TxEntity));
+    erow.m_Generation=generation;
     
-    erow.m_Pos=first;
-    WRPGetRow(&erow);
-    if(erow.m_Block > block)
+    if(first_hint >= 0)                                                         // Hints come from earlier searches, 
+    {                                                                           // item first_hint is confirmed in block <= block, 
+        first=first_hint;                                                       // item last_hint - in block > block
+    }
+    else
     {
-        return 0;
+        first=1;
     }
     
-    erow.m_Pos=last;
-    WRPGetRow(&erow);
-    if(erow.m_Block <= block)
+    if(last_hint > 0)
     {
-        return last;        
+        last=last_hint;
+    }
+    else
+    {
+        WRPGetListSize(entity,generation,&last);
+
+        if(last <= 0)
+        {
+            return 0;
+        }
+    }
+    
+    if(first_hint < 0)
+    {
+        erow.m_Pos=first;
+        WRPGetRow(&erow);
+        if(erow.m_Block > block)
+        {
+            if(in_range)
+            {
+                *in_range=1;
+            }
+            return 0;
+        }
+    }
+    
+    if(last_hint <= 0)
+    {
+        erow.m_Pos=last;
+        WRPGetRow(&erow);
+        if(erow.m_Block <= block)
+        {
+            return last;        
+        }
+    }
+    
+    if(in_range)
+    {
+        *in_range=1;
     }
     
     while(last-first > 1)
@@ -3876,6 +4344,7 @@ exitlbl:
     {
         m_MemPools[slot]=new mc_Buffer;    
         m_MemPools[slot]->Initialize(MC_TDB_ENTITY_KEY_SIZE+MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
+        m_MemPools[slot]->SetMemTag(MC_MEM_TAG_TXDB);
     }
 
     if(m_RawMemPools[slot])
@@ -3886,6 +4355,7 @@ exitlbl:
     {
         m_RawMemPools[slot]=new mc_Buffer;    
         m_RawMemPools[slot]->Initialize(MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
+        m_RawMemPools[slot]->SetMemTag(MC_MEM_TAG_TXDB);
     }
     
     
@@ -3943,6 +4413,7 @@ int mc_TxDB::Unsubscribe(mc_Buffer* lpEntities)
     {
         return MC_ERR_NOERROR;
     }
+    IncrementChangeID();
     
     Dump("Before Unsubscribe");
     
@@ -4110,6 +4581,7 @@ int mc_TxDB::CompleteImport(mc_TxImport *import,uint32_t flags)
     Dump("Before CompleteImport");
     
     err=MC_ERR_NOERROR;
+    IncrementChangeID();
    
     chain_entities=m_Imports->m_Entities->GetCount();
     
@@ -4483,6 +4955,7 @@ exitlbl:
     {
         sprintf(msg,"CompleteImport: Import %d completed",import->m_ImportID);
         LogString(msg);
+        m_BlockUndoFrom=import->m_Block+1;                                      // Merged entities are not in undo records of earlier blocks
         m_MemPools[import-m_Imports]->Clear();
         m_RawMemPools[import-m_Imports]->Clear();
         delete import->m_Entities;
@@ -4512,6 +4985,7 @@ int mc_TxDB::DropImport(mc_TxImport *import)
     unsigned char *ptr;
     int subkey_list_size,deleted_items;
     
+    IncrementChangeID();
     Dump("Before DropImport");
     
     deleted_items=0;
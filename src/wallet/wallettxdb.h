@@ -16,6 +16,7 @@
 #define MC_TDB_ROW_SIZE              80
 
 #define MC_TDB_MAX_IMPORTS           16
+#define MC_TDB_BLOCK_UNDO_DEPTH    1000                                         // Number of blocks wallet undo records are kept for
 
 #define MC_TDB_WALLET_VERSION         3
 
@@ -69,6 +70,7 @@
 #define MC_TET_DB_STAT                          0x01000000
 #define MC_TET_IMPORT                           0x02000000
 #define MC_TET_DELETED                          0x04000000
+#define MC_TET_BLOCK_UNDO                       0x08000000
 #define MC_TET_GETDB_ADD_TX                     0x10000000   
 #define MC_TET_SPECIALMASK                      0xFF000000
 
@@ -153,6 +155,22 @@ typedef struct mc_TxEntityStat
     void Zero();    
 } mc_TxEntityStat;
 
+/** Entity list cursor - keeps database iterator and position across calls. In-memory structure **/
+
+typedef struct mc_TxEntityCursor
+{
+    mc_TxEntity m_Entity;                                                       // Entity
+    int m_Generation;                                                           // Generation of entity data
+    uint32_t m_NextPos;                                                         // Position of the next row to return, 1-based, 0 - no more rows (reverse only)
+    int m_Direction;                                                            // 1 - forward, -1 - reverse
+    void *m_DBCursor;                                                           // Database iterator, NULL if not created yet
+    uint32_t m_DBCursorPos;                                                     // Position database iterator points to, 0 if unknown
+    uint32_t m_DBChangeID;                                                      // mc_TxDB::m_ChangeID when iterator was created
+    int m_MemPoolRow;                                                           // Mempool row of the last returned row, -1 if unknown
+    int64_t m_LastUsed;                                                         // Time cursor was last used, for cache eviction
+    void Zero();
+} mc_TxEntityCursor;
+
 /** Import row - image of mc_TxEntityStat on disk **/
 
 typedef struct mc_TxImportRow
@@ -192,6 +210,36 @@ typedef struct mc_TxEntityDBStat
     void Zero();
 } mc_TxEntityDBStat;
 
+/** Block undo row - entity appended in the chain import block and its last position before the block **/
+/** Row with m_Pos=0 is a header, without it the record is incomplete **/
+/** Block undo is split: permissions, entities and follow-ons are restored from CMultiChainBlockUndo in the rev file, **/
+/** these rows cover wallet entity-list appends and chunk references committed with the import block **/
+
+typedef struct mc_TxBlockUndoRow
+{
+    unsigned char m_Zero[MC_TDB_ENTITY_ID_SIZE];                                       
+    uint32_t m_RowType;                                                         // MC_TET_BLOCK_UNDO
+    int m_Block;                                                                // Block
+    uint32_t m_Pos;                                                             // Position within block record, 1-based, 0 - header
+    mc_TxEntity m_Entity;                                                       // Entity
+    int m_Generation;                                                           // Generation of entity within import
+    uint32_t m_LastPos;                                                         // Last position before the block
+    uint32_t m_Count;                                                           // Number of entities, header only
+    uint32_t m_Reserved1;
+    uint32_t m_Reserved2;
+    uint32_t m_Reserved3;
+    void Zero();
+} mc_TxBlockUndoRow;
+
+/** Entity from undo records of rolled back blocks, m_LastPos - last position before the earliest of them **/
+
+typedef struct mc_TxBlockUndoEntity
+{
+    mc_TxEntity m_Entity;
+    int m_Generation;
+    uint32_t m_LastPos;
+} mc_TxBlockUndoEntity;
+
 /** Import structure, in-memory **/
 
 typedef struct mc_TxImport
@@ -283,12 +331,15 @@ typedef struct mc_TxDB
     char m_LogFileName[MC_DCT_DB_MAX_PATH];                                     // Full log file name    
     
     int m_UnsubscribeMemPoolSize;                                               // Size of the mempool when unsubscribed
+    int m_BlockUndoFrom;                                                        // First block with complete undo record, records of previous runs are not trusted
     uint32_t m_Mode;
     void *m_Semaphore;                                                          // mc_TxDB object semaphore
     uint64_t m_LockedBy;                                                        // ID of the thread locking it
     mc_TxDefRow m_TxCachedDef;                                                              
     uint32_t m_TxCachedFlags;                                                              
 
+    uint32_t m_ChangeID;                                                        // Incremented when database rows may be deleted or replaced
+    
     void *m_WRPRWLock;                                                      // Semaphore protecting resources used by read APIs
     uint64_t m_WRPLockedBy;                                                    // ID of the thread locking it
     mc_Buffer *m_WRPMemPool;                                                   // Read mc_TxEntityRow mempool
@@ -442,6 +493,10 @@ typedef struct mc_TxDB
     int BeforeCommit(mc_TxImport *import);                                      // Should be called before re-adding tx while processing block
     int Commit(mc_TxImport *import);                                            // Commit when block was processed
     int RollBack(mc_TxImport *import,int block);                                // Rollback to specific block
+    
+    int WriteBlockUndo(mc_TxImport *import,int block);                          // Writes undo record for the block being committed, chain import only
+    int GetBlockUndo(mc_TxImport *import,int block,mc_Buffer *lpEntities);      // mc_TxBlockUndoEntity list of entities appended after block, MC_ERR_NOT_FOUND if records are incomplete
+    int DeleteBlockUndo(int block);                                             // Deletes undo record of the block
 
     int Unsubscribe(mc_Buffer *lpEntities);                                     // List of the entities to unsubscribe from
 
@@ -485,6 +540,7 @@ typedef struct mc_TxDB
     
     void LogString(const char *message);
     
+    void IncrementChangeID();
     int WRPReadLock();
     int WRPWriteLock(int allow_secondary);
     void WRPReadUnLock();
@@ -509,6 +565,14 @@ typedef struct mc_TxDB
                 int count,
                 mc_Buffer *txs);
     
+    int WRPCursorRead(                                                          // Returns next rows and advances cursor
+                mc_TxEntityCursor *cursor,                                      // Cursor
+                int count,                                                      // Maximal number of rows to return
+                mc_Buffer *txs);                                                // Output list. mc_TxEntityRow
+    
+    void CursorClose(                                                           // Releases database iterator
+                mc_TxEntityCursor *cursor);
+    
     int WRPGetTx(                                                              // Returns tx definition if found, error if not found
               mc_TxDefRow *txdef,                                               // Output. Tx def
               const unsigned char *hash,                                        // Input. Tx hash
@@ -521,6 +585,14 @@ typedef struct mc_TxDB
                     mc_TxImport *import,                                        // Import object, if NULL - chain
                     mc_TxEntity *entity,                                        // Entity to return info for
                     int block);                                                 // Block to find item for
+
+    int WRPGetBlockItemIndex(                                                      // Returns item id for the last item confirmed in this block or before
+                    mc_TxEntity *entity,                                        // Entity to return info for, may be subkey
+                    int generation,                                             // Entity generation
+                    int block,                                                  // Block to find item for
+                    int first_hint,                                             // Item confirmed in this block or before, -1 if unknown
+                    int last_hint,                                              // Item confirmed after this block, -1 if unknown
+                    int *in_range);                                             // Output. 1 if result will not change when new blocks are added
 } mc_TxDB;
 
 
@@ -6,6 +6,7 @@
 #include "wallet/wallettxs.h"
 #include "utils/core_io.h"
 #include "community/community.h"
+#include "utils/notifyqueue.h"
 
 #include "json/json_spirit_utils.h"
 #include "json/json_spirit_value.h"
@@ -72,18 +73,25 @@ void WalletTxNotify(mc_TxImport *imp,const CWalletTx& tx,int block,bool fFound,u
         return;        
     }
 
-    boost::replace_all(strNotifyCmd, "%s", tx.GetHash().ToString());
+    CNotifyEvent event(strNotifyCmd);
+    
+    event.Set("%s", tx.GetHash().ToString());
 
-    boost::replace_all(strNotifyCmd, "%c", strprintf("%d",fFound ? 0 : 1));
-    boost::replace_all(strNotifyCmd, "%n", strprintf("%d",block));
-    boost::replace_all(strNotifyCmd, "%b", block_hash.ToString());
-    boost::replace_all(strNotifyCmd, "%h", EncodeHexTx(*static_cast<const CTransaction*>(&tx)));
+    event.Set("%c", strprintf("%d",fFound ? 0 : 1));
+    event.Set("%n", strprintf("%d",block));
+    event.Set("%b", block_hash.ToString());
+    if(event.NeedsArg("%h"))
+    {
+        event.Set("%h", EncodeHexTx(*static_cast<const CTransaction*>(&tx)));
+    }
 
     string strAddresses="";
     string strEntities="";
     CBitcoinAddress address;
     mc_EntityDetails entity;
     uint256 txid;
+    bool fNeedAddresses=event.NeedsArg("%a");
+    bool fNeedEntities=event.NeedsArg("%e");
     
     for(int i=0;i<imp->m_TmpEntities->GetCount();i++)
     {
@@ -95,7 +103,7 @@ void WalletTxNotify(mc_TxImport *imp,const CWalletTx& tx,int block,bool fFound,u
             {
                 case MC_TET_PUBKEY_ADDRESS:
                 case MC_TET_SCRIPT_ADDRESS:
-                    if(CBitcoinAddressFromTxEntity(address,lpent))
+                    if(fNeedAddresses && CBitcoinAddressFromTxEntity(address,lpent))
                     {
                         if(strAddresses.size())
                         {
@@ -106,7 +114,7 @@ void WalletTxNotify(mc_TxImport *imp,const CWalletTx& tx,int block,bool fFound,u
                     break;
                 case MC_TET_STREAM:
                 case MC_TET_ASSET:
-                    if(mc_gState->m_Assets->FindEntityByShortTxID(&entity,lpent->m_EntityID))
+                    if(fNeedEntities && mc_gState->m_Assets->FindEntityByShortTxID(&entity,lpent->m_EntityID))
                     {
                         if(strEntities.size())
                         {
@@ -120,23 +128,26 @@ void WalletTxNotify(mc_TxImport *imp,const CWalletTx& tx,int block,bool fFound,u
         }        
     }
 
-    boost::replace_all(strNotifyCmd, "%a", (strAddresses.size() > 0) ? strAddresses : "\"\"");
-    boost::replace_all(strNotifyCmd, "%e", (strEntities.size() > 0) ? strEntities : "\"\"");
+    event.Set("%a", (strAddresses.size() > 0) ? strAddresses : "\"\"");
+    event.Set("%e", (strEntities.size() > 0) ? strEntities : "\"\"");
 
     string str=strprintf("%s",mc_gState->m_NetworkParams->Name());              
     boost::replace_all(str, "\"", "\\\"");        
-    boost::replace_all(strNotifyCmd, "%m", "\"" + str + "\"");
+    event.Set("%m", "\"" + str + "\"",true);
     
 // If chain name (retrieved by %m) contains %j, it will be replaced by full JSON. 
 // It is minor issue, but one should be careful when adding other "free text" specifications
     
-    Object result;
-    TxToJSON(tx, block_hash, result);        
-    str=write_string(Value(result),false);
-    boost::replace_all(str, "\"", "\\\"");        
-    boost::replace_all(strNotifyCmd, "%j", "\"" + str + "\"");
+    if(event.NeedsArg("%j"))
+    {
+        Object result;
+        TxToJSON(tx, block_hash, result);        
+        str=write_string(Value(result),false);
+        boost::replace_all(str, "\"", "\\\"");        
+        event.Set("%j", "\"" + str + "\"");
+    }
     
-    boost::thread t(runCommand, strNotifyCmd); // thread runs free        
+    QueueNotification(event);
 }
 
 void mc_Coin::Zero()
@@ -361,6 +372,12 @@ int mc_WalletTxs::SetMode(uint32_t mode, uint32_t mask)
 
 int mc_WalletTxs::Destroy()
 {
+    CloseCursors();
+    {
+        LOCK(cs_BlockIndexes);
+        m_BlockIndexes.clear();
+    }
+    
     if(m_ChunkCollector)
     {
         m_ChunkCollector->Commit();
@@ -1037,6 +1054,7 @@ int mc_WalletTxs::RollBack(mc_TxImport *import,int block)
     mc_TxEntity wallet_entity;
     mc_TxEntityStat *stat;
     mc_Buffer *lpSubKeyEntRowBuffer;
+    mc_Buffer *lpUndoEntities;
     bool fInBlocks;   
     std::vector<mc_Coin> txouts;
     std::vector<uint256> removed_coinbases;
@@ -1070,10 +1088,22 @@ int mc_WalletTxs::RollBack(mc_TxImport *import,int block)
     
     m_Database->Lock(1,0);
     
+    lpUndoEntities=new mc_Buffer;                                               // Streams without items in rolled back blocks have no subkeys to decrement
+    lpUndoEntities->Initialize(sizeof(mc_TxEntity),sizeof(mc_TxBlockUndoEntity),MC_BUF_MODE_MAP);
+    if(m_Database->GetBlockUndo(imp,block,lpUndoEntities) != MC_ERR_NOERROR)
+    {
+        delete lpUndoEntities;
+        lpUndoEntities=NULL;
+    }
+    
     lpSubKeyEntRowBuffer=NULL;
     for(i=0;i<imp->m_Entities->GetCount();i++)                                  // Removing ordered-by-blockchain-position rows
     {
         stat=(mc_TxEntityStat*)imp->m_Entities->GetRow(i);
+        if( (lpUndoEntities != NULL) && (lpUndoEntities->Seek((unsigned char*)&(stat->m_Entity)) < 0) )
+        {
+            continue;
+        }
         if( stat->m_Entity.m_EntityType == (MC_TET_STREAM | MC_TET_CHAINPOS) )
         {        
             if(err == MC_ERR_NOERROR)
@@ -1095,6 +1125,10 @@ int mc_WalletTxs::RollBack(mc_TxImport *import,int block)
     {
         delete lpSubKeyEntRowBuffer;
     }
+    if(lpUndoEntities)
+    {
+        delete lpUndoEntities;
+    }
     
     if(err == MC_ERR_NOERROR)
     {
@@ -1499,6 +1533,103 @@ int mc_WalletTxs::WRPGetBlockItemIndex(mc_TxEntity *entity, int block)
     return res;            
 }
 
+int mc_WalletTxs::WRPGetBlockItemIndex(mc_TxEntity *entity, int generation, int block)
+{
+    int res,first_hint,last_hint,in_range;
+    uint32_t change_id;
+    string key((char*)entity,sizeof(mc_TxEntity));
+    key.append((char*)&generation,sizeof(int));
+    map<string,mc_TxEntityBlockIndex>::iterator it;
+    map<int,int>::iterator pit;
+    int use_read=m_Database->WRPUsed();
+    
+    first_hint=-1;
+    last_hint=-1;
+    if(use_read == 0)                                                           // Otherwise caller holds WRP read lock
+    {
+        m_Database->Lock(0,0);
+    }
+    change_id=m_Database->m_ChangeID;
+    if(use_read == 0)
+    {
+        m_Database->UnLock();
+    }
+    
+    {
+        LOCK(cs_BlockIndexes);
+        it=m_BlockIndexes.find(key);
+        if(it != m_BlockIndexes.end())
+        {
+            if(it->second.m_ChangeID != change_id)                              // Rollback or resubscription, positions may be invalid
+            {
+                m_BlockIndexes.erase(it);
+            }
+            else
+            {
+                it->second.m_LastUsed=mc_TimeNowAsUInt();
+                pit=it->second.m_Positions.upper_bound(block);
+                if(pit != it->second.m_Positions.end())
+                {
+                    last_hint=pit->second+1;
+                }
+                if(pit != it->second.m_Positions.begin())
+                {
+                    pit--;
+                    if(pit->first == block)
+                    {
+                        return pit->second;
+                    }
+                    first_hint=pit->second;
+                }
+            }
+        }
+    }
+    
+    if(use_read == 0)
+    {
+        m_Database->Lock(0,0);
+    }
+    res=m_Database->WRPGetBlockItemIndex(entity,generation,block,first_hint,last_hint,&in_range);
+    if(use_read == 0)
+    {
+        m_Database->UnLock();
+    }
+    
+    if(in_range)                                                                // Results for blocks after the last confirmed item are not cached
+    {
+        LOCK(cs_BlockIndexes);
+        it=m_BlockIndexes.find(key);
+        if(it == m_BlockIndexes.end())
+        {
+            if(m_BlockIndexes.size() >= MC_TDB_MAX_BLOCK_INDEXES)               // Least recently used entity
+            {
+                map<string,mc_TxEntityBlockIndex>::iterator lru=m_BlockIndexes.begin();
+                for(it=m_BlockIndexes.begin();it != m_BlockIndexes.end();it++)
+                {
+                    if(it->second.m_LastUsed < lru->second.m_LastUsed)
+                    {
+                        lru=it;
+                    }
+                }
+                m_BlockIndexes.erase(lru);
+            }
+            it=m_BlockIndexes.insert(make_pair(key,mc_TxEntityBlockIndex())).first;
+            it->second.m_ChangeID=change_id;
+        }
+        if(it->second.m_ChangeID == change_id)
+        {
+            if(it->second.m_Positions.size() >= MC_TDB_MAX_BLOCK_INDEX_POINTS)
+            {
+                it->second.m_Positions.clear();
+            }
+            it->second.m_Positions[block]=res;
+            it->second.m_LastUsed=mc_TimeNowAsUInt();
+        }
+    }
+    
+    return res;            
+}
+
 
 int mc_WalletTxs::GetListSize(mc_TxEntity *entity,int *confirmed)
 {
@@ -1517,6 +1648,138 @@ int mc_WalletTxs::GetListSize(mc_TxEntity *entity,int *confirmed)
     return res;                
 }
 
+string mc_WalletTxs::WRPCursorToken(mc_TxEntity *entity,int generation,int from,int direction)
+{
+    unsigned char buf[sizeof(mc_TxEntity)+9];
+    uint32_t pos=(from > 0) ? from : 0;
+    
+    memcpy(buf,entity,sizeof(mc_TxEntity));
+    mc_PutLE(buf+sizeof(mc_TxEntity),&generation,4);
+    mc_PutLE(buf+sizeof(mc_TxEntity)+4,&pos,4);
+    buf[sizeof(mc_TxEntity)+8]=(direction < 0) ? 1 : 0;
+    
+    return "c" + HexStr(buf,buf+sizeof(buf));
+}
+
+bool mc_WalletTxs::WRPCursorParseToken(const string& token,mc_TxEntityCursor *cursor)
+{
+    if( (token.size() != 2*(sizeof(mc_TxEntity)+9)+1) || (token[0] != 'c') || !IsHex(token.substr(1)) )
+    {
+        return false;
+    }
+    
+    vector<unsigned char> buf=ParseHex(token.substr(1));
+    
+    cursor->Zero();
+    memcpy(&cursor->m_Entity,&buf[0],sizeof(mc_TxEntity));
+    cursor->m_Generation=mc_GetLE(&buf[sizeof(mc_TxEntity)],4);
+    cursor->m_NextPos=mc_GetLE(&buf[sizeof(mc_TxEntity)+4],4);
+    cursor->m_Direction=buf[sizeof(mc_TxEntity)+8] ? -1 : 1;
+    
+    return true;
+}
+
+void mc_WalletTxs::CloseCursors()
+{
+    LOCK(cs_Cursors);
+    for(map<string,mc_TxEntityCursor>::iterator it=m_Cursors.begin();it != m_Cursors.end();it++)
+    {
+        if(m_Database)
+        {
+            m_Database->CursorClose(&(it->second));
+        }
+    }
+    m_Cursors.clear();
+}
+
+int mc_WalletTxs::WRPCursorRead(string& token,int count,mc_Buffer *txs)
+{
+    int err;
+    mc_TxEntityCursor cursor;
+    map<string,mc_TxEntityCursor>::iterator it;
+    
+    if((m_Mode & MC_WMD_TXS) == 0)
+    {
+        return MC_ERR_NOT_SUPPORTED;
+    }    
+    if(m_Database == NULL)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    {
+        LOCK(cs_Cursors);
+        it=m_Cursors.find(token);
+        if(it != m_Cursors.end())                                               // Idle cursor is taken out of the cache while in use
+        {
+            cursor=it->second;
+            m_Cursors.erase(it);
+        }
+        else
+        {
+            if(!WRPCursorParseToken(token,&cursor))
+            {
+                return MC_ERR_INVALID_PARAMETER_VALUE;
+            }
+        }
+    }
+
+    int use_read=m_Database->WRPUsed();
+    
+    if(use_read == 0)
+    {
+        m_Database->Lock(0,0);
+    }
+    err=m_Database->WRPCursorRead(&cursor,count,txs);
+    if(use_read == 0)
+    {
+        m_Database->UnLock();
+    }
+    
+    if( err || ( (cursor.m_Direction < 0) && (cursor.m_NextPos == 0) ) )
+    {
+        m_Database->CursorClose(&cursor);
+        token="";
+        return err;
+    }
+    
+    token=WRPCursorToken(&cursor.m_Entity,cursor.m_Generation,cursor.m_NextPos,cursor.m_Direction);
+    
+    {
+        LOCK(cs_Cursors);
+        int64_t time_now=mc_TimeNowAsUInt();
+        it=m_Cursors.begin();
+        while(it != m_Cursors.end())                                            // Expired cursors 
+        {
+            if( (it->second.m_LastUsed + MC_TDB_CURSOR_TIMEOUT < time_now) || (it->first == token) )
+            {
+                m_Database->CursorClose(&(it->second));
+                m_Cursors.erase(it++);
+            }
+            else
+            {
+                it++;
+            }
+        }
+        if(m_Cursors.size() >= MC_TDB_MAX_CURSORS)                             // Least recently used cursor
+        {
+            map<string,mc_TxEntityCursor>::iterator lru=m_Cursors.begin();
+            for(it=m_Cursors.begin();it != m_Cursors.end();it++)
+            {
+                if(it->second.m_LastUsed < lru->second.m_LastUsed)
+                {
+                    lru=it;
+                }
+            }
+            m_Database->CursorClose(&(lru->second));
+            m_Cursors.erase(lru);
+        }
+        m_Cursors.insert(make_pair(token,cursor));
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 int mc_WalletTxs::WRPGetListSize(mc_TxEntity *entity,int *confirmed)
 {
     int res;
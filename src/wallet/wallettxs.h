@@ -16,6 +16,10 @@
 #include "wallet/chunkcollector.h"
 
 #define MC_TDB_MAX_OP_RETURN_SIZE             256
+#define MC_TDB_MAX_CURSORS                     64
+#define MC_TDB_CURSOR_TIMEOUT                 600
+#define MC_TDB_MAX_BLOCK_INDEXES               64
+#define MC_TDB_MAX_BLOCK_INDEX_POINTS        4096
 
 #define MC_MTX_TAG_DIRECT_MASK                           0x00000000FFFFFFFF   
 #define MC_MTX_TAG_EXTENSION_MASK                        0xFFFFFFFF00000000
@@ -113,6 +117,19 @@ typedef struct mc_WalletCachedAddTx
     
 } mc_WalletCachedAddTx;
 
+typedef struct mc_TxEntityBlockIndex
+{
+    uint32_t m_ChangeID;                                                        // mc_TxDB::m_ChangeID when the positions were found
+    int64_t m_LastUsed;
+    std::map<int,int> m_Positions;                                              // Block -> last item confirmed in this block or before
+    
+    mc_TxEntityBlockIndex()
+    {
+        m_ChangeID=0;
+        m_LastUsed=0;
+    }
+} mc_TxEntityBlockIndex;
+
 typedef struct mc_WalletTxs
 {
     mc_TxDB *m_Database;
@@ -124,6 +141,10 @@ typedef struct mc_WalletTxs
     std::map<uint256,CWalletTx> m_UnconfirmedSends;
     std::vector<uint256> m_UnconfirmedSendsHashes;
     std::map<uint256, CWalletTx> vAvailableCoins;    
+    std::map<std::string,mc_TxEntityCursor> m_Cursors;                          // Idle entity list cursors by continuation token
+    CCriticalSection cs_Cursors;
+    std::map<std::string,mc_TxEntityBlockIndex> m_BlockIndexes;                 // Sparse block -> position index by entity
+    CCriticalSection cs_BlockIndexes;
  
     unsigned char* m_ChunkBuffer;
     mc_WalletTxs()
@@ -279,6 +300,18 @@ typedef struct mc_WalletTxs
     int WRPGetList(mc_TxEntity *entity,int generation,int from,int count,mc_Buffer *txs);    
     int WRPGetLastItem(mc_TxEntity *entity,int generation,mc_TxEntityRow *erow);    
     
+    std::string WRPCursorToken(                                                 // Returns continuation token for position in entity list
+                    mc_TxEntity *entity,                                        // Entity 
+                    int generation,                                             // Entity generation
+                    int from,                                                   // Position of the first row to return, 1-based
+                    int direction);                                             // 1 - forward, -1 - reverse
+    bool WRPCursorParseToken(const std::string& token,mc_TxEntityCursor *cursor);  // Decodes continuation token, doesn't open iterator
+    int WRPCursorRead(                                                          // Returns rows starting from continuation token
+                    std::string& token,                                         // In/Out. Continuation token, empty on output if there are no more rows
+                    int count,                                                  // Maximal number of rows to return
+                    mc_Buffer *txs);                                            // Output list. mc_TxEntityRow
+    void CloseCursors();
+    
     CWalletTx WRPGetWalletTx(uint256 hash,mc_TxDefRow *txdef,int *errOut);
     std::string WRPGetSubKey(void *hash,mc_TxDefRow *txdef,int *errOut);         
     int WRPGetRow(mc_TxEntityRow *erow);
@@ -287,6 +320,10 @@ typedef struct mc_WalletTxs
     int WRPGetBlockItemIndex(                                                      // Returns item id for the last item confirmed in this block or before
                     mc_TxEntity *entity,                                        // Entity to return info for
                     int block);                                                 // Block to find item for
+    int WRPGetBlockItemIndex(                                                      // Same as above, remembers found positions in sparse block index
+                    mc_TxEntity *entity,                                        // Entity to return info for, may be subkey
+                    int generation,                                             // Entity generation
+                    int block);                                                 // Block to find item for
 } mc_WalletTxs;
 
 